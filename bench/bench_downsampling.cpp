@@ -0,0 +1,653 @@
+///-------------------------------------------------------------------
+///
+///
+///
+/// PURPOSE:        Benchmarks for the downsampling algorithms
+///                 (simpleDownsample, averagingDownsample and the
+///                 Largest-Triangle-Three-Buckets variants) on
+///                 synthetic signals, timing their throughput and
+///                 heap use and checking how faithfully the
+///                 downsampled polyline follows the original one
+///
+/// AUTHOR:         Vincenzo Barbato
+///                 navyenzo@gmail.com
+///
+/// NOTE:           The signals are generated from the sample index
+///                 alone, so sizes too big for memory are written
+///                 to a raw file in the scratch directory and run
+///                 memory mapped (--scratch-dir=<dir>, needed for
+///                 sizes past --in-memory-limit samples)
+///
+///                 The fidelity error is the area between the
+///                 original and the downsampled polylines over the
+///                 area of the signal's bounding box, 0 is perfect
+///
+/// LISENSE:        MIT-LICENCE
+///                 http://www.opensource.org/licenses/mit-license.php
+///
+///
+///
+///-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Includes needed for this file
+//-------------------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "blBenchmark.hpp"
+
+#include "blDownsamplingAlgorithms.hpp"
+#include "blMemoryMappedArray.hpp"
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+using namespace blMathAPI;
+using namespace blMathAPI::blBenchmark;
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Extra settings of this benchmark
+//
+//   --points=<n>             downsampled size (default 2048)
+//   --scratch-dir=<dir>      where the big signals are written
+//   --in-memory-limit=<n>    biggest size generated in memory
+//-------------------------------------------------------------------
+struct blDownsamplingSettings
+{
+    std::size_t                             numberOfPoints = 2048;
+    std::string                             scratchDirectory;
+    std::size_t                             inMemoryLimit = std::size_t(100000000);
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+inline void printDownsamplingUsage(const char* programName)
+{
+    std::fprintf(stderr,
+                 "usage: %s [options]\n"
+                 "\n"
+                 "  --min-time=<seconds>     minimum timed run per case\n"
+                 "  --max-size=<n>           largest problem size to run\n"
+                 "  --threads=<n>            largest thread count to sweep\n"
+                 "  --filter=<substring>     only run cases whose name matches\n"
+                 "  --full                   lift the per-kernel size caps\n"
+                 "  --points=<n>             downsampled size (default 2048)\n"
+                 "  --scratch-dir=<dir>      where the big signals are written\n"
+                 "  --in-memory-limit=<n>    biggest size generated in memory\n",
+                 programName);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Parses the extra settings, any argument that
+// is neither one of them nor a shared benchmark
+// setting prints the usage and exits, so a typo
+// (or --help) doesn't start the full run
+//-------------------------------------------------------------------
+inline blDownsamplingSettings parseDownsamplingSettings(int argc,char** argv)
+{
+    blDownsamplingSettings settings;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+
+        if(arg.compare(0,9,"--points=") == 0)
+            settings.numberOfPoints = std::strtoull(arg.c_str() + 9,nullptr,10);
+        else if(arg.compare(0,14,"--scratch-dir=") == 0)
+            settings.scratchDirectory = arg.substr(14);
+        else if(arg.compare(0,18,"--in-memory-limit=") == 0)
+            settings.inMemoryLimit = std::strtoull(arg.c_str() + 18,nullptr,10);
+        else if(arg.compare(0,11,"--min-time=") != 0 &&
+                arg.compare(0,11,"--max-size=") != 0 &&
+                arg.compare(0,10,"--threads=") != 0 &&
+                arg.compare(0,9,"--filter=") != 0 &&
+                arg != "--full")
+        {
+            std::fprintf(stderr,"bench_downsampling: unknown argument \"%s\"\n\n",arg.c_str());
+            printDownsamplingUsage(argv[0]);
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    return settings;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// A random access iterator over the sample
+// indices, used as the x axis of the x/y
+// overloads without storing it
+//-------------------------------------------------------------------
+struct blIndexIterator
+{
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef double                          value_type;
+    typedef std::ptrdiff_t                  difference_type;
+    typedef const double*                   pointer;
+    typedef double                          reference;
+
+    double                                  operator*()const{return double(index);}
+    double                                  operator[](const std::ptrdiff_t& offset)const{return double(index + offset);}
+
+    blIndexIterator&                        operator++(){++index; return *this;}
+    blIndexIterator&                        operator--(){--index; return *this;}
+    blIndexIterator                         operator++(int){blIndexIterator copy = *this; ++index; return copy;}
+    blIndexIterator                         operator--(int){blIndexIterator copy = *this; --index; return copy;}
+    blIndexIterator&                        operator+=(const std::ptrdiff_t& offset){index += offset; return *this;}
+    blIndexIterator&                        operator-=(const std::ptrdiff_t& offset){index -= offset; return *this;}
+
+    blIndexIterator                         operator+(const std::ptrdiff_t& offset)const{return blIndexIterator{index + offset};}
+    blIndexIterator                         operator-(const std::ptrdiff_t& offset)const{return blIndexIterator{index - offset};}
+    std::ptrdiff_t                          operator-(const blIndexIterator& other)const{return index - other.index;}
+
+    bool                                    operator==(const blIndexIterator& other)const{return index == other.index;}
+    bool                                    operator!=(const blIndexIterator& other)const{return index != other.index;}
+    bool                                    operator<(const blIndexIterator& other)const{return index < other.index;}
+
+    std::ptrdiff_t                          index;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Synthetic signals, every sample is a pure
+// function of its index and the signal size
+//-------------------------------------------------------------------
+enum blSignalKind {BL_SIGNAL_NOISE,
+                   BL_SIGNAL_CHIRP,
+                   BL_SIGNAL_STEP_TRAIN,
+                   BL_SIGNAL_SPARSE_SPIKES};
+
+inline const char* signalName(const blSignalKind& kind)
+{
+    switch(kind)
+    {
+    case BL_SIGNAL_NOISE: return "noise";
+    case BL_SIGNAL_CHIRP: return "chirp";
+    case BL_SIGNAL_STEP_TRAIN: return "steps";
+    default: return "spikes";
+    }
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Uniform noise in [-1,1) from a
+// splitmix64 hash of the index
+//-------------------------------------------------------------------
+inline double hashNoise(std::uint64_t index)
+{
+    index += 0x9E3779B97F4A7C15ULL;
+    index = (index ^ (index >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    index = (index ^ (index >> 27)) * 0x94D049BB133111EBULL;
+    index = index ^ (index >> 31);
+
+    return double(index >> 11) * (2.0 / 9007199254740992.0) - 1.0;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+inline double signalValue(const blSignalKind& kind,
+                          const std::size_t& index,
+                          const std::size_t& numberOfSamples)
+{
+    double t = double(index) / double(numberOfSamples);
+
+    switch(kind)
+    {
+    case BL_SIGNAL_NOISE:
+
+        return hashNoise(index);
+
+    case BL_SIGNAL_CHIRP:
+    {
+        // Sweeps from 1 cycle per record up
+        // to 1 cycle every 20 samples
+
+        double endFrequency = double(numberOfSamples) / 20.0;
+
+        return std::sin(2.0 * pi * (t + 0.5 * (endFrequency - 1.0) * t * t));
+    }
+
+    case BL_SIGNAL_STEP_TRAIN:
+
+        return ((std::size_t(t * 50.0) % 2) ? 1.0 : -1.0) + 0.05 * hashNoise(index);
+
+    default:
+
+        // One spike every 10^4 samples on average
+
+        return (hashNoise(index ^ 0xABCDEFULL) > 0.9998 ? 1.0 : 0.0) + 0.01 * hashNoise(index);
+    }
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Writes a signal to a raw binary file in chunks
+//-------------------------------------------------------------------
+inline bool writeSignalFile(const std::string& filename,
+                            const blSignalKind& kind,
+                            const std::size_t& numberOfSamples)
+{
+    std::ofstream file(filename.c_str(),std::ios::binary | std::ios::trunc);
+
+    if(!file)
+        return false;
+
+    std::vector<double> chunk(std::size_t(1) << 20);
+
+    for(std::size_t first = 0; first < numberOfSamples; first += chunk.size())
+    {
+        std::size_t chunkSize = std::min(chunk.size(),numberOfSamples - first);
+
+        for(std::size_t i = 0; i < chunkSize; ++i)
+            chunk[i] = signalValue(kind,first + i,numberOfSamples);
+
+        file.write(reinterpret_cast<const char*>(chunk.data()),std::streamsize(chunkSize * sizeof(double)));
+    }
+
+    return bool(file);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The fidelity of a downsampled polyline, its points
+// are sorted by x and the ones left untouched (NaN)
+// by the LTTB functions are skipped and counted
+//-------------------------------------------------------------------
+struct blFidelity
+{
+    double                                  areaError = 0;
+    double                                  rangeRetained = 0;
+    std::size_t                             untouchedPoints = 0;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+inline blFidelity measureFidelity(const double* srcData,
+                                  const std::size_t& srcDataSize,
+                                  const std::vector<double>& xDstData,
+                                  const std::vector<double>& yDstData)
+{
+    blFidelity fidelity;
+
+    std::vector<double> x;
+    std::vector<double> y;
+
+    for(std::size_t k = 0; k < xDstData.size(); ++k)
+    {
+        if(std::isnan(xDstData[k]) || std::isnan(yDstData[k]))
+        {
+            ++fidelity.untouchedPoints;
+            continue;
+        }
+
+        x.push_back(xDstData[k]);
+        y.push_back(yDstData[k]);
+    }
+
+    if(x.empty() || srcDataSize == 0)
+        return fidelity;
+
+    double srcMin = srcData[0];
+    double srcMax = srcData[0];
+    double area = 0;
+
+    std::size_t segment = 0;
+
+    for(std::size_t i = 0; i < srcDataSize; ++i)
+    {
+        double xi = double(i);
+
+        while(segment + 1 < x.size() && x[segment + 1] <= xi)
+            ++segment;
+
+        // Linear interpolation of the downsampled
+        // polyline, flat past its end points
+
+        double polylineValue = y[segment];
+
+        if(xi > x[segment] && segment + 1 < x.size())
+        {
+            double w = (xi - x[segment]) / (x[segment + 1] - x[segment]);
+            polylineValue = y[segment] + w * (y[segment + 1] - y[segment]);
+        }
+        else if(xi < x[segment])
+        {
+            polylineValue = y[0];
+        }
+
+        area += std::abs(srcData[i] - polylineValue);
+
+        srcMin = std::min(srcMin,srcData[i]);
+        srcMax = std::max(srcMax,srcData[i]);
+    }
+
+    double dstMin = *std::min_element(y.begin(),y.end());
+    double dstMax = *std::max_element(y.begin(),y.end());
+
+    double srcRange = srcMax - srcMin;
+
+    fidelity.areaError = (srcRange > 0) ? area / (double(srcDataSize) * srcRange) : 0;
+    fidelity.rangeRetained = (srcRange > 0) ? (dstMax - dstMin) / srcRange : 1;
+
+    return fidelity;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+inline void printFidelityHeader()
+{
+    std::printf("\n%-56s %14s %14s %12s\n","Fidelity","area error","range kept","untouched");
+    std::printf("%s\n",std::string(99,'-').c_str());
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+inline void printFidelity(const std::string& name,const blFidelity& fidelity)
+{
+    std::printf("%-56s %14.4e %13.1f%% %12zu\n",
+                name.c_str(),
+                fidelity.areaError,
+                100.0 * fidelity.rangeRetained,
+                fidelity.untouchedPoints);
+
+    std::fflush(stdout);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// One timed algorithm: it fills the x/y outputs
+// (x is the index of each picked sample) so the
+// fidelity can be measured from the same call
+//-------------------------------------------------------------------
+struct blDownsamplingCase
+{
+    std::string                             name;
+    std::vector<double>                     xDstData;
+    std::vector<double>                     yDstData;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Runs every algorithm on one signal, the source
+// is a plain pointer whether it lives in memory
+// or in a memory mapped file
+//-------------------------------------------------------------------
+inline bool benchmarkSignal(const std::string& signalLabel,
+                            const double* srcData,
+                            const std::size_t& srcDataSize,
+                            const blMemoryMappedArray<double>* mappedData,
+                            const blBenchmarkSettings& settings,
+                            const blDownsamplingSettings& downsamplingSettings,
+                            std::vector< std::pair<std::string,blFidelity> >& fidelities)
+{
+    const std::size_t dstDataSize = downsamplingSettings.numberOfPoints;
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+
+    bool isConsistent = true;
+
+    std::vector<double> xDstData(dstDataSize);
+    std::vector<double> yDstData(dstDataSize);
+    std::vector<double> yOnlyDstData(dstDataSize);
+
+    blIndexIterator xSrcData = {0};
+
+    auto caseName = [&](const char* algorithm)
+    {
+        return std::string(algorithm) + "/" + signalLabel + "/m:" + std::to_string(dstDataSize);
+    };
+
+    auto run = [&](const char* algorithm,const std::function<void()>& functor,bool hasFidelity)
+    {
+        std::string name = caseName(algorithm);
+
+        if(!matchesFilter(name,settings))
+            return false;
+
+        std::fill(xDstData.begin(),xDstData.end(),nan);
+        std::fill(yDstData.begin(),yDstData.end(),nan);
+
+        printResult(runBenchmark(name,0,double(srcDataSize),settings,functor));
+
+        if(hasFidelity)
+            fidelities.push_back(std::make_pair(name,measureFidelity(srcData,srcDataSize,xDstData,yDstData)));
+
+        return true;
+    };
+
+    // Decimation by picking one sample per bucket
+
+    run("simple",[&]()
+    {
+        simpleDownsample(srcData,srcDataSize,yDstData.begin(),dstDataSize);
+        simpleDownsample(xSrcData,srcDataSize,xDstData.begin(),dstDataSize);
+        doNotOptimize(yDstData);
+    },true);
+
+    if(mappedData)
+    {
+        run("simpleMapped",[&]()
+        {
+            simpleDownsampleMapped(*mappedData,yDstData.begin(),dstDataSize);
+            doNotOptimize(yDstData);
+        },false);
+    }
+
+    // Box filter, its points sit at the
+    // centers of their buckets
+
+    run("averaging",[&]()
+    {
+        averagingDownsample(srcData,srcDataSize,yDstData.begin(),dstDataSize);
+        doNotOptimize(yDstData);
+    },false);
+
+    if(matchesFilter(caseName("averaging"),settings))
+    {
+        blExactSamplingStepper stepper(srcDataSize,dstDataSize);
+
+        for(std::size_t i = 0; i < dstDataSize; ++i)
+        {
+            std::size_t bucketBegin = stepper.index;
+            std::size_t bucketEnd = bucketBegin + stepper.step();
+
+            xDstData[i] = 0.5 * double(bucketBegin + std::max(bucketBegin + 1,bucketEnd) - 1);
+        }
+
+        fidelities.push_back(std::make_pair(caseName("averaging"),measureFidelity(srcData,srcDataSize,xDstData,yDstData)));
+    }
+
+    // The Largest-Triangle-Three-Buckets variants,
+    // the y only overload picks the same samples
+    // as the x/y one, which gives the fidelity
+
+    run("LTTB(y)",[&]()
+    {
+        largestTriangleThreeBuckets(srcData,srcDataSize,yDstData.begin(),dstDataSize);
+        doNotOptimize(yDstData);
+    },false);
+
+    yOnlyDstData = yDstData;
+
+    if(run("LTTB(x,y)",[&]()
+    {
+        largestTriangleThreeBuckets(xSrcData,srcData,srcDataSize,xDstData.begin(),yDstData.begin(),dstDataSize);
+        doNotOptimize(yDstData);
+    },true) && matchesFilter(caseName("LTTB(y)"),settings))
+    {
+        for(std::size_t i = 0; i < dstDataSize; ++i)
+        {
+            if(!(yOnlyDstData[i] == yDstData[i] || (std::isnan(yOnlyDstData[i]) && std::isnan(yDstData[i]))))
+            {
+                std::printf("MISMATCH: the y and x/y LTTB overloads disagree at point %zu\n",i);
+                isConsistent = false;
+                break;
+            }
+        }
+    }
+
+    std::vector<double> serialDstData = yDstData;
+
+    if(run("LTTBParallel(x,y)",[&]()
+    {
+        largestTriangleThreeBucketsParallel(xSrcData,srcData,srcDataSize,xDstData.begin(),yDstData.begin(),dstDataSize);
+        doNotOptimize(yDstData);
+    },true) && matchesFilter(caseName("LTTB(x,y)"),settings))
+    {
+        for(std::size_t i = 0; i < dstDataSize; ++i)
+        {
+            if(!(serialDstData[i] == yDstData[i] || (std::isnan(serialDstData[i]) && std::isnan(yDstData[i]))))
+            {
+                std::printf("MISMATCH: the parallel and serial LTTB disagree at point %zu\n",i);
+                isConsistent = false;
+                break;
+            }
+        }
+    }
+
+    if(mappedData)
+    {
+        run("LTTBMapped(y)",[&]()
+        {
+            largestTriangleThreeBucketsMapped(*mappedData,yDstData.begin(),dstDataSize);
+            doNotOptimize(yDstData);
+        },false);
+    }
+
+    run("MinMaxLTTB(x,y)",[&]()
+    {
+        minMaxLargestTriangleThreeBuckets(xSrcData,srcData,srcDataSize,xDstData.begin(),yDstData.begin(),dstDataSize);
+        doNotOptimize(yDstData);
+    },true);
+
+    return isConsistent;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+int main(int argc,char** argv)
+{
+    blDownsamplingSettings downsamplingSettings = parseDownsamplingSettings(argc,argv);
+    blBenchmarkSettings settings = parseSettings(argc,argv);
+
+    // Sizes go from 10^5 up to 10^7 by default,
+    // or 10^10 with --full (given the disk space)
+
+    std::size_t maxSize = settings.full ? std::size_t(10000000000ULL) : std::size_t(10000000);
+
+    if(settings.maxSize > 0)
+        maxSize = settings.maxSize;
+
+    std::printf("bench_downsampling: up to %d threads, min time %.3f s per case, %zu points\n\n",
+                getMaxThreads(),
+                settings.minTime,
+                downsamplingSettings.numberOfPoints);
+
+    printHeader();
+
+    const blSignalKind signalKinds[] = {BL_SIGNAL_NOISE,
+                                        BL_SIGNAL_CHIRP,
+                                        BL_SIGNAL_STEP_TRAIN,
+                                        BL_SIGNAL_SPARSE_SPIKES};
+
+    std::vector< std::pair<std::string,blFidelity> > fidelities;
+
+    bool isConsistent = true;
+
+    for(std::size_t n = 100000; n <= maxSize; n *= 10)
+    {
+        if(n <= downsamplingSettings.numberOfPoints)
+            continue;
+
+        for(const blSignalKind& kind : signalKinds)
+        {
+            std::string signalLabel = std::string(signalName(kind)) + "/n:" + std::to_string(n);
+
+            if(n <= downsamplingSettings.inMemoryLimit)
+            {
+                std::vector<double> srcData(n);
+
+                for(std::size_t i = 0; i < n; ++i)
+                    srcData[i] = signalValue(kind,i,n);
+
+                isConsistent &= benchmarkSignal(signalLabel,srcData.data(),n,nullptr,settings,downsamplingSettings,fidelities);
+            }
+            else if(!downsamplingSettings.scratchDirectory.empty())
+            {
+                std::string filename = downsamplingSettings.scratchDirectory + "/bench_downsampling_" + signalName(kind) + ".bin";
+
+                if(!writeSignalFile(filename,kind,n))
+                {
+                    std::printf("could not write %s, skipping\n",filename.c_str());
+                    continue;
+                }
+
+                {
+                    blMemoryMappedArray<double> mappedData;
+
+                    if(mappedData.open(filename))
+                        isConsistent &= benchmarkSignal(signalLabel,mappedData.data(),n,&mappedData,settings,downsamplingSettings,fidelities);
+                }
+
+                std::remove(filename.c_str());
+            }
+            else
+            {
+                std::printf("%s: past --in-memory-limit and no --scratch-dir given, skipping\n",signalLabel.c_str());
+            }
+        }
+    }
+
+    printFidelityHeader();
+
+    for(std::size_t i = 0; i < fidelities.size(); ++i)
+        printFidelity(fidelities[i].first,fidelities[i].second);
+
+    return isConsistent ? 0 : 1;
+}
+//-------------------------------------------------------------------
@@ -0,0 +1,377 @@
+///-------------------------------------------------------------------
+///
+///
+///
+/// PURPOSE:        Benchmarks for the vbMatrix dense linear
+///                 algebra kernels (operator*, inv, pinv,
+///                 QRdecomposition, eigs, MatrixSign, riccati
+///                 and hinf) sweeping problem size, scalar type
+///                 and thread count
+///
+/// AUTHOR:         Vincenzo Barbato
+///                 navyenzo@gmail.com
+///
+/// NOTE:           GFLOP/s are computed from the nominal LAPACK
+///                 style operation count of each kernel, not from
+///                 what vbMatrix actually executes, so a faster
+///                 algorithm shows up as a higher GFLOP/s
+///
+/// LISENSE:        MIT-LICENCE
+///                 http://www.opensource.org/licenses/mit-license.php
+///
+///
+///
+///-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Includes needed for this file
+//-------------------------------------------------------------------
+#include <complex>
+#include <random>
+#include <string>
+
+#include "blBenchmark.hpp"
+
+// The vbMath framework header that brings
+// vbMatrix (blMatrixOneDim.hpp) into scope
+
+#include BL_VBMATRIX_HEADER
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+using namespace blMathAPI::blBenchmark;
+using vbMath::vbMatrix;
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Scalar type names used in the case names
+//-------------------------------------------------------------------
+template<typename vbType> inline const char* typeName();
+template<> inline const char* typeName<float>(){return "float";}
+template<> inline const char* typeName<double>(){return "double";}
+template<> inline const char* typeName< std::complex<float> >(){return "cfloat";}
+template<> inline const char* typeName< std::complex<double> >(){return "cdouble";}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Random matrix generators
+//-------------------------------------------------------------------
+template<typename vbType>
+inline vbType randomValue(std::mt19937& generator)
+{
+    std::uniform_real_distribution<double> distribution(-1,1);
+    return vbType(distribution(generator));
+}
+
+template<>
+inline std::complex<float> randomValue< std::complex<float> >(std::mt19937& generator)
+{
+    std::uniform_real_distribution<float> distribution(-1,1);
+    return std::complex<float>(distribution(generator),distribution(generator));
+}
+
+template<>
+inline std::complex<double> randomValue< std::complex<double> >(std::mt19937& generator)
+{
+    std::uniform_real_distribution<double> distribution(-1,1);
+    return std::complex<double>(distribution(generator),distribution(generator));
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename vbType>
+inline vbMatrix<vbType> randomMatrix(const int& m,const int& n,std::mt19937& generator)
+{
+    vbMatrix<vbType> M(m,n,vbType(0));
+
+    for(int i = 0; i < m; ++i)
+        for(int j = 0; j < n; ++j)
+            M(i,j) = randomValue<vbType>(generator);
+
+    return M;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// A random matrix shifted to be Hurwitz
+// (all eigenvalues in the left half plane),
+// used for the control oriented kernels
+//-------------------------------------------------------------------
+template<typename vbType>
+inline vbMatrix<vbType> randomStableMatrix(const int& n,std::mt19937& generator)
+{
+    vbMatrix<vbType> A = randomMatrix<vbType>(n,n,generator);
+
+    for(int i = 0; i < n; ++i)
+        A(i,i) -= vbType(n);
+
+    return A;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// One benchmarked kernel: a name, the
+// largest size run by default and the
+// nominal flop count for a given size
+//-------------------------------------------------------------------
+struct blKernelInfo
+{
+    const char*                             name;
+    std::size_t                             defaultMaxSize;
+    double                                  (*flops)(double n);
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Sweeps sizes 2,4,...,2048 and thread counts
+// for a kernel, the setup functor builds the
+// inputs for a size and returns the functor
+// to time
+//-------------------------------------------------------------------
+template<typename vbType,
+         typename blSetupFunctorType>
+
+inline void sweep(const blKernelInfo& kernel,
+                  const blBenchmarkSettings& settings,
+                  const blSetupFunctorType& setup)
+{
+    std::size_t maxSize = settings.full ? std::size_t(2048) : kernel.defaultMaxSize;
+
+    if(settings.maxSize > 0 && settings.maxSize < maxSize)
+        maxSize = settings.maxSize;
+
+    std::vector<int> threadSweep = getThreadSweep(settings);
+
+    for(std::size_t n = 2; n <= maxSize; n *= 2)
+    {
+        std::mt19937 generator(static_cast<unsigned>(n));
+
+        auto functor = setup(int(n),generator);
+
+        for(std::size_t t = 0; t < threadSweep.size(); ++t)
+        {
+            std::string name = std::string(kernel.name) + "<" + typeName<vbType>() + ">/" +
+                               std::to_string(n) + "/threads:" + std::to_string(threadSweep[t]);
+
+            if(!matchesFilter(name,settings))
+                continue;
+
+            setNumThreads(threadSweep[t]);
+
+            printResult(runBenchmark(name,kernel.flops(double(n)),0,settings,functor));
+        }
+    }
+
+    setNumThreads(getMaxThreads());
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Nominal operation counts
+//-------------------------------------------------------------------
+inline double flopsMultiply(double n){return 2.0*n*n*n;}
+inline double flopsInverse(double n){return 2.0*n*n*n;}
+inline double flopsPseudoInverse(double n){return 4.0*n*n*n;}
+inline double flopsQR(double n){return 4.0/3.0*n*n*n;}
+inline double flopsEigs(double n){return 10.0*n*n*n;}
+inline double flopsMatrixSign(double n){return 20.0*n*n*n;}
+inline double flopsRiccati(double n){return 20.0*8.0*n*n*n;}
+inline double flopsUnknown(double){return 0;}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Kernels defined for any scalar type
+//-------------------------------------------------------------------
+template<typename vbType>
+inline void benchmarkMultiply(const blBenchmarkSettings& settings)
+{
+    blKernelInfo kernel = {"operator*",2048,flopsMultiply};
+
+    sweep<vbType>(kernel,settings,[](const int& n,std::mt19937& generator)
+    {
+        vbMatrix<vbType> A = randomMatrix<vbType>(n,n,generator);
+        vbMatrix<vbType> B = randomMatrix<vbType>(n,n,generator);
+
+        return [A,B]()
+        {
+            vbMatrix<vbType> C = A*B;
+            doNotOptimize(C);
+        };
+    });
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Kernels that need an ordered (real) scalar type
+//-------------------------------------------------------------------
+template<typename vbType>
+inline void benchmarkRealKernels(const blBenchmarkSettings& settings)
+{
+    blKernelInfo invKernel = {"inv",256,flopsInverse};
+
+    sweep<vbType>(invKernel,settings,[](const int& n,std::mt19937& generator)
+    {
+        vbMatrix<vbType> A = randomMatrix<vbType>(n,n,generator);
+
+        return [A]()
+        {
+            vbMatrix<vbType> Ainv = vbMath::inv(A);
+            doNotOptimize(Ainv);
+        };
+    });
+
+
+
+    blKernelInfo pinvKernel = {"pinv",256,flopsPseudoInverse};
+
+    sweep<vbType>(pinvKernel,settings,[](const int& n,std::mt19937& generator)
+    {
+        vbMatrix<vbType> A = randomMatrix<vbType>(n,n,generator);
+
+        return [A]()
+        {
+            vbMatrix<vbType> Apinv = vbMath::pinv(A);
+            doNotOptimize(Apinv);
+        };
+    });
+
+
+
+    blKernelInfo qrKernel = {"QRdecomposition",256,flopsQR};
+
+    sweep<vbType>(qrKernel,settings,[](const int& n,std::mt19937& generator)
+    {
+        vbMatrix<vbType> A = randomMatrix<vbType>(n,n,generator);
+
+        return [A]()
+        {
+            vbMatrix<vbType> Q,R;
+            vbMath::QRdecomposition(A,Q,R);
+            doNotOptimize(R);
+        };
+    });
+
+
+
+    blKernelInfo eigsKernel = {"eigs",128,flopsEigs};
+
+    sweep<vbType>(eigsKernel,settings,[](const int& n,std::mt19937& generator)
+    {
+        // Symmetric input so that the
+        // eigenvalues are real
+
+        vbMatrix<vbType> A = randomMatrix<vbType>(n,n,generator);
+        A = A + vbMath::Transpose(A);
+
+        return [A]()
+        {
+            vbMatrix<vbType> EigenValues,EigenVectors;
+            vbMath::eigs(A,EigenValues,EigenVectors);
+            doNotOptimize(EigenValues);
+        };
+    });
+
+
+
+    blKernelInfo signKernel = {"MatrixSign",128,flopsMatrixSign};
+
+    sweep<vbType>(signKernel,settings,[](const int& n,std::mt19937& generator)
+    {
+        vbMatrix<vbType> A = randomMatrix<vbType>(n,n,generator);
+
+        return [A]()
+        {
+            vbMatrix<vbType> S = vbMath::MatrixSign(A);
+            doNotOptimize(S);
+        };
+    });
+
+
+
+    blKernelInfo riccatiKernel = {"riccati",64,flopsRiccati};
+
+    sweep<vbType>(riccatiKernel,settings,[](const int& n,std::mt19937& generator)
+    {
+        vbMatrix<vbType> A = randomStableMatrix<vbType>(n,generator);
+        vbMatrix<vbType> B = randomMatrix<vbType>(n,1,generator);
+        vbMatrix<vbType> Q = vbMath::eye<vbType>(n);
+        vbMatrix<vbType> R = vbMath::eye<vbType>(1);
+
+        return [A,B,Q,R]()
+        {
+            vbMatrix<vbType> P;
+            vbMath::riccati(A,B,Q,R,P);
+            doNotOptimize(P);
+        };
+    });
+
+
+
+    // The bisection in hinf runs a data dependent
+    // number of eigen decompositions, so there is
+    // no meaningful nominal flop count for it
+
+    blKernelInfo hinfKernel = {"hinf",16,flopsUnknown};
+
+    sweep<vbType>(hinfKernel,settings,[](const int& n,std::mt19937& generator)
+    {
+        vbMatrix<vbType> A = randomStableMatrix<vbType>(n,generator);
+        vbMatrix<vbType> B = randomMatrix<vbType>(n,1,generator);
+        vbMatrix<vbType> C = randomMatrix<vbType>(1,n,generator);
+        vbMatrix<vbType> D(1,1,vbType(0));
+
+        return [A,B,C,D]()
+        {
+            int numOfIterations = 0;
+            vbType error = 0;
+            vbType gamma = vbMath::hinf(A,B,C,D,vbType(0.00000001),vbType(0.1),numOfIterations,error);
+            doNotOptimize(gamma);
+        };
+    });
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+int main(int argc,char** argv)
+{
+    blBenchmarkSettings settings = parseSettings(argc,argv);
+
+    std::printf("bench_linalg: up to %d threads, min time %.3f s per case\n\n",getMaxThreads(),settings.minTime);
+
+    printHeader();
+
+    benchmarkMultiply<float>(settings);
+    benchmarkMultiply<double>(settings);
+    benchmarkMultiply< std::complex<float> >(settings);
+    benchmarkMultiply< std::complex<double> >(settings);
+
+    benchmarkRealKernels<float>(settings);
+    benchmarkRealKernels<double>(settings);
+
+    return 0;
+}
+//-------------------------------------------------------------------
@@ -0,0 +1,397 @@
+#ifndef BL_BENCHMARK_HPP
+#define BL_BENCHMARK_HPP
+
+
+///-------------------------------------------------------------------
+///
+///
+///
+/// PURPOSE:        A small Google-Benchmark style harness used by
+///                 the blMathAPI benchmark targets, it times a
+///                 functor until a minimum run time is reached and
+///                 reports time per call, GFLOP/s and heap
+///                 allocations and bytes allocated per call
+///
+/// AUTHOR:         Vincenzo Barbato
+///                 navyenzo@gmail.com
+///
+/// NOTE:           This header replaces the global operator new
+///                 and delete to count allocations, so it must be
+///                 included by exactly one translation unit of
+///                 each benchmark executable
+///
+/// LISENSE:        MIT-LICENCE
+///                 http://www.opensource.org/licenses/mit-license.php
+///
+///
+///
+///-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Includes needed for this file
+//-------------------------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Global allocation counter
+//-------------------------------------------------------------------
+namespace blMathAPI
+{
+namespace blBenchmark
+{
+inline std::atomic<std::size_t>& allocationCounter()
+{
+    static std::atomic<std::size_t> counter(0);
+    return counter;
+}
+
+inline std::atomic<std::size_t>& allocatedBytesCounter()
+{
+    static std::atomic<std::size_t> counter(0);
+    return counter;
+}
+}
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Replacement allocation functions, they
+// just count and forward to malloc/free
+//-------------------------------------------------------------------
+void* operator new(std::size_t size)
+{
+    blMathAPI::blBenchmark::allocationCounter().fetch_add(1,std::memory_order_relaxed);
+    blMathAPI::blBenchmark::allocatedBytesCounter().fetch_add(size,std::memory_order_relaxed);
+
+    void* ptr = std::malloc(size ? size : 1);
+
+    if(!ptr)
+        throw std::bad_alloc();
+
+    return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void operator delete(void* ptr)noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr)noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr,std::size_t)noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr,std::size_t)noexcept
+{
+    std::free(ptr);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// NOTE: This class is defined within the blMathAPI namespace
+//-------------------------------------------------------------------
+namespace blMathAPI
+{
+namespace blBenchmark
+{
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Settings parsed from the command line
+//
+//   --min-time=<seconds>     minimum timed run per case
+//   --max-size=<n>           largest problem size to run
+//   --threads=<n>            largest thread count to sweep
+//   --filter=<substring>     only run cases whose name matches
+//   --full                   lift the per-kernel size caps
+//-------------------------------------------------------------------
+struct blBenchmarkSettings
+{
+    double                                  minTime = 0.1;
+    std::size_t                             maxSize = 0;
+    int                                     maxThreads = 0;
+    std::string                             filter;
+    bool                                    full = false;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+inline blBenchmarkSettings parseSettings(int argc,char** argv)
+{
+    blBenchmarkSettings settings;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+
+        if(arg.compare(0,11,"--min-time=") == 0)
+            settings.minTime = std::atof(arg.c_str() + 11);
+        else if(arg.compare(0,11,"--max-size=") == 0)
+            settings.maxSize = std::strtoull(arg.c_str() + 11,nullptr,10);
+        else if(arg.compare(0,10,"--threads=") == 0)
+            settings.maxThreads = std::atoi(arg.c_str() + 10);
+        else if(arg.compare(0,9,"--filter=") == 0)
+            settings.filter = arg.substr(9);
+        else if(arg == "--full")
+            settings.full = true;
+    }
+
+    return settings;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Thread count helpers (everything runs
+// single threaded without OpenMP)
+//-------------------------------------------------------------------
+inline int getMaxThreads()
+{
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+inline void setNumThreads(const int& numberOfThreads)
+{
+#ifdef _OPENMP
+    omp_set_num_threads(numberOfThreads);
+#else
+    (void)numberOfThreads;
+#endif
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Thread counts to sweep: 1,2,4,... up to the max
+//-------------------------------------------------------------------
+inline std::vector<int> getThreadSweep(const blBenchmarkSettings& settings)
+{
+    int maxThreads = (settings.maxThreads > 0) ? settings.maxThreads : getMaxThreads();
+
+    std::vector<int> threads;
+
+    for(int t = 1; t < maxThreads; t *= 2)
+        threads.push_back(t);
+
+    threads.push_back(maxThreads);
+
+    return threads;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Result of one benchmark case
+//-------------------------------------------------------------------
+struct blBenchmarkResult
+{
+    std::string                             name;
+    std::size_t                             iterations = 0;
+    double                                  secondsPerCall = 0;
+    double                                  flopsPerCall = 0;
+    double                                  itemsPerCall = 0;
+    double                                  allocationsPerCall = 0;
+    double                                  bytesAllocatedPerCall = 0;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Keeps the compiler from optimizing
+// away the value of a benchmarked call
+//-------------------------------------------------------------------
+template<typename blValueType>
+inline void doNotOptimize(const blValueType& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Runs the functor once to warm up, then keeps
+// doubling the number of iterations until the
+// timed run lasts at least the minimum time
+//-------------------------------------------------------------------
+template<typename blFunctorType>
+inline blBenchmarkResult runBenchmark(const std::string& name,
+                                      const double& flopsPerCall,
+                                      const double& itemsPerCall,
+                                      const blBenchmarkSettings& settings,
+                                      const blFunctorType& functor)
+{
+    typedef std::chrono::steady_clock blClockType;
+
+    blBenchmarkResult result;
+    result.name = name;
+    result.flopsPerCall = flopsPerCall;
+    result.itemsPerCall = itemsPerCall;
+
+    functor();
+
+    std::size_t iterations = 1;
+
+    while(true)
+    {
+        std::size_t allocationsBefore = allocationCounter().load();
+        std::size_t allocatedBytesBefore = allocatedBytesCounter().load();
+
+        auto startTime = blClockType::now();
+
+        for(std::size_t i = 0; i < iterations; ++i)
+            functor();
+
+        double elapsed = std::chrono::duration<double>(blClockType::now() - startTime).count();
+
+        std::size_t allocations = allocationCounter().load() - allocationsBefore;
+        std::size_t allocatedBytes = allocatedBytesCounter().load() - allocatedBytesBefore;
+
+        if(elapsed >= settings.minTime || iterations >= (std::size_t(1) << 30))
+        {
+            result.iterations = iterations;
+            result.secondsPerCall = elapsed / double(iterations);
+            result.allocationsPerCall = double(allocations) / double(iterations);
+            result.bytesAllocatedPerCall = double(allocatedBytes) / double(iterations);
+            break;
+        }
+
+        // Grow the iteration count
+        // towards the target time
+
+        if(elapsed <= 0)
+            iterations *= 10;
+        else
+            iterations = std::max(iterations * 2,std::size_t(1.2 * settings.minTime / elapsed * double(iterations)));
+    }
+
+    return result;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Console output in the same column
+// layout Google Benchmark uses
+//-------------------------------------------------------------------
+inline void printHeader()
+{
+    std::printf("%-56s %14s %12s %12s %14s %12s %12s\n","Benchmark","Time","Iterations","GFLOP/s","items/s","allocs/call","bytes/call");
+    std::printf("%s\n",std::string(138,'-').c_str());
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+inline void printResult(const blBenchmarkResult& result)
+{
+    double seconds = result.secondsPerCall;
+
+    char timeString[32];
+
+    if(seconds < 1e-6)
+        std::snprintf(timeString,sizeof(timeString),"%.1f ns",seconds * 1e9);
+    else if(seconds < 1e-3)
+        std::snprintf(timeString,sizeof(timeString),"%.2f us",seconds * 1e6);
+    else if(seconds < 1)
+        std::snprintf(timeString,sizeof(timeString),"%.2f ms",seconds * 1e3);
+    else
+        std::snprintf(timeString,sizeof(timeString),"%.3f s",seconds);
+
+    char gflopsString[32] = "-";
+    if(result.flopsPerCall > 0 && seconds > 0)
+        std::snprintf(gflopsString,sizeof(gflopsString),"%.3f",result.flopsPerCall / seconds * 1e-9);
+
+    char itemsString[32] = "-";
+    if(result.itemsPerCall > 0 && seconds > 0)
+        std::snprintf(itemsString,sizeof(itemsString),"%.4g",result.itemsPerCall / seconds);
+
+    std::printf("%-56s %14s %12zu %12s %14s %12.1f %12.4g\n",
+                result.name.c_str(),
+                timeString,
+                result.iterations,
+                gflopsString,
+                itemsString,
+                result.allocationsPerCall,
+                result.bytesAllocatedPerCall);
+
+    std::fflush(stdout);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Checks a case name against the filter
+//-------------------------------------------------------------------
+inline bool matchesFilter(const std::string& name,const blBenchmarkSettings& settings)
+{
+    return settings.filter.empty() || name.find(settings.filter) != std::string::npos;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// End of the blBenchmark and blMathAPI namespaces
+}
+}
+//-------------------------------------------------------------------
+
+
+
+#endif // BL_BENCHMARK_HPP
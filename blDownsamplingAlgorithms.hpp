@@ -27,7 +27,19 @@
 //-------------------------------------------------------------------
 // Includes needed for this file
 //-------------------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <iterator>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include "blMathConstants.hpp"
 #include "blNumericFunctions.hpp"
 //-------------------------------------------------------------------
 
@@ -50,229 +62,343 @@ namespace blMathAPI
 
 
 //-------------------------------------------------------------------
-// The following function downsamples a
-// source into the destination container
-// simply by skipping every so many values
+// Exact integer stepping used by the downsampling
+// functions below, destination point i comes from
+// source index floor(i*srcDataSize/dstDataSize)
+// computed Bresenham style, so it doesn't drift
+// or overflow no matter how big the sizes are
 //-------------------------------------------------------------------
-template<typename srcDataIteratorType,
-         typename dstDataIteratorType>
+struct blExactSamplingStepper
+{
+    blExactSamplingStepper(const std::size_t& srcDataSize,
+                           const std::size_t& dstDataSize) : quotient(srcDataSize / dstDataSize),
+                                                             remainder(srcDataSize % dstDataSize),
+                                                             denominator(dstDataSize),
+                                                             error(0),
+                                                             index(0){}
 
-inline void simpleDownsample(srcDataIteratorType srcDataBegin,
-                             const std::size_t& srcDataSize,
-                             dstDataIteratorType dstDataBegin,
-                             const std::size_t& dstDataSize)
+    // Moves to the next destination point and
+    // returns how many source samples it skipped
+
+    std::size_t                             step()
+    {
+        std::size_t increment = quotient;
+
+        error += remainder;
+
+        if(error >= denominator)
+        {
+            error -= denominator;
+            ++increment;
+        }
+
+        index += increment;
+
+        return increment;
+    }
+
+    std::size_t                             quotient;
+    std::size_t                             remainder;
+    std::size_t                             denominator;
+    std::size_t                             error;
+    std::size_t                             index;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Gathers the samples at the given indices, the
+// contiguous float/double versions use AVX2 gathers
+//-------------------------------------------------------------------
+template<typename blNumberType>
+
+inline void gatherSamples(const blNumberType* srcDataBegin,
+                          const std::int64_t* srcIndices,
+                          const std::size_t& numberOfSamples,
+                          blNumberType* dstDataBegin)
 {
-    // First we calculate
-    // the downsampling step
+    for(std::size_t i = 0; i < numberOfSamples; ++i)
+        dstDataBegin[i] = srcDataBegin[srcIndices[i]];
+}
+//-------------------------------------------------------------------
+
 
-    double downsamplingStep = double(srcDataSize)/double(dstDataSize);
 
-    std::size_t previousSourceSamplingIndex = 0;
-    double currentSourceSamplingIndex = 0;
+//-------------------------------------------------------------------
+inline void gatherSamples(const double* srcDataBegin,
+                          const std::int64_t* srcIndices,
+                          const std::size_t& numberOfSamples,
+                          double* dstDataBegin)
+{
+    std::size_t i = 0;
 
-    // Then we step through
-    // source data and pick
-    // every "DownsamplingStep"
-    // data point and save it
-    // into the destination
-    // data set
+#if defined(__AVX2__)
 
-    for(std::size_t i = 0; i < dstDataSize; ++i)
+    for(; i + 4 <= numberOfSamples; i += 4)
     {
-        // Sample the
-        // data point
+        __m256i indices = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcIndices + i));
 
-        (*dstDataBegin) = (*srcDataBegin);
+        _mm256_storeu_pd(dstDataBegin + i,_mm256_i64gather_pd(srcDataBegin,indices,8));
+    }
 
-        // Calculate the
-        // sampling indices
+#endif
 
-        currentSourceSamplingIndex += downsamplingStep;
+    for(; i < numberOfSamples; ++i)
+        dstDataBegin[i] = srcDataBegin[srcIndices[i]];
+}
+//-------------------------------------------------------------------
 
-        // Advance the
-        // iterators
 
-        std::advance(srcDataBegin,std::size_t(currentSourceSamplingIndex) - previousSourceSamplingIndex);
 
-        ++dstDataBegin;
+//-------------------------------------------------------------------
+inline void gatherSamples(const float* srcDataBegin,
+                          const std::int64_t* srcIndices,
+                          const std::size_t& numberOfSamples,
+                          float* dstDataBegin)
+{
+    std::size_t i = 0;
 
-        // Recalculate the
-        // previous sampling
-        // index
+#if defined(__AVX2__)
+
+    for(; i + 4 <= numberOfSamples; i += 4)
+    {
+        __m256i indices = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcIndices + i));
 
-        previousSourceSamplingIndex += std::size_t(currentSourceSamplingIndex - double(previousSourceSamplingIndex));
+        _mm_storeu_ps(dstDataBegin + i,_mm256_i64gather_ps(srcDataBegin,indices,4));
     }
+
+#endif
+
+    for(; i < numberOfSamples; ++i)
+        dstDataBegin[i] = srcDataBegin[srcIndices[i]];
 }
 //-------------------------------------------------------------------
 
 
 
 //-------------------------------------------------------------------
-// The following function downsamples a source
-// into the destination container by use of the
-// Largest-Triangle-Three-Buckets algorithm
+// Generic version of simpleDownsample, it walks the
+// source with std::advance by the exact number of
+// samples between destination points (never past
+// the last point picked)
 //-------------------------------------------------------------------
 template<typename srcDataIteratorType,
          typename dstDataIteratorType>
 
-inline void largestTriangleThreeBuckets(srcDataIteratorType srcDataBegin,
-                                        const std::size_t& srcDataSize,
-                                        dstDataIteratorType dstDataBegin,
-                                        const std::size_t& dstDataSize)
+inline void simpleDownsample(srcDataIteratorType srcDataBegin,
+                             const std::size_t& srcDataSize,
+                             dstDataIteratorType dstDataBegin,
+                             const std::size_t& dstDataSize,
+                             std::false_type)
 {
-    if(srcDataSize <= 0 || dstDataSize <= 0)
-    {
-        // We have no data to downsample
+    blExactSamplingStepper stepper(srcDataSize,dstDataSize);
 
-        return;
-    }
-    else if(dstDataSize >= srcDataSize)
+    for(std::size_t i = 0; i < dstDataSize; ++i)
     {
-        // In this case we are trying to upsample
-        // the source data, we do this using
-        // a linear sampling
-
-        double srcStep = double(srcDataSize)/double(dstDataSize);
-
-        int dstIndex = 0;
-
-        int srcIndex = 0;
-        double idealSrcIndex = 0;
+        if(i > 0)
+            std::advance(srcDataBegin,stepper.step());
 
-        while(srcIndex < srcDataSize && dstIndex < dstDataSize)
-        {
-            // Copy the data point
+        (*dstDataBegin) = (*srcDataBegin);
 
-            (*dstDataBegin) = (*srcDataBegin);
+        ++dstDataBegin;
+    }
+}
+//-------------------------------------------------------------------
 
-            // Move forward in the destination array
 
-            ++dstDataBegin;
 
-            // Calculate how much to move forward
-            // in the source array
+//-------------------------------------------------------------------
+// Contiguous version of simpleDownsample, a fixed stride
+// is a plain strided copy (a memcpy for stride 1) and
+// any other step gathers blocks of exactly computed
+// indices into a small buffer
+//-------------------------------------------------------------------
+template<typename blNumberType,
+         typename dstDataIteratorType>
 
-            idealSrcIndex += srcStep;
+inline void simpleDownsample(const blNumberType* srcDataBegin,
+                             const std::size_t& srcDataSize,
+                             dstDataIteratorType dstDataBegin,
+                             const std::size_t& dstDataSize,
+                             std::true_type)
+{
+    if(srcDataSize % dstDataSize == 0)
+    {
+        std::size_t stride = srcDataSize / dstDataSize;
 
-            if(int(idealSrcIndex) > srcIndex)
+        if(stride == 1)
+        {
+            std::copy(srcDataBegin,srcDataBegin + dstDataSize,dstDataBegin);
+        }
+        else
+        {
+            for(std::size_t i = 0; i < dstDataSize; ++i)
             {
-                srcIndex = int(idealSrcIndex);
-
-                ++srcDataBegin;
+                (*dstDataBegin) = srcDataBegin[i * stride];
+                ++dstDataBegin;
             }
         }
 
         return;
     }
-    else if(dstDataSize == 1)
-    {
-        // In this case we just
-        // copy the first data point
-
-        (*dstDataBegin) = (*srcDataBegin);
 
-        return;
-    }
+    const std::size_t blockSize = 256;
 
+    std::int64_t srcIndices[blockSize];
 
+    typename std::remove_const<blNumberType>::type samples[blockSize];
 
-    // Now we got all the special
-    // cases out of the way
+    blExactSamplingStepper stepper(srcDataSize,dstDataSize);
 
+    for(std::size_t blockBegin = 0; blockBegin < dstDataSize; blockBegin += blockSize)
+    {
+        std::size_t numberOfSamples = std::min(blockSize,dstDataSize - blockBegin);
 
+        for(std::size_t i = 0; i < numberOfSamples; ++i)
+        {
+            if(blockBegin + i > 0)
+                stepper.step();
 
-    // Calculate the size of each bucket
+            srcIndices[i] = std::int64_t(stepper.index);
+        }
 
-    std::size_t bucketStep = srcDataSize / dstDataSize;
+        gatherSamples(srcDataBegin,srcIndices,numberOfSamples,samples);
 
-    // Create temporary point values
-    // used to find the point to sample
+        dstDataBegin = std::copy(samples,samples + numberOfSamples,dstDataBegin);
+    }
+}
+//-------------------------------------------------------------------
 
-    auto previousBucketPoint = (*srcDataBegin);
-    auto nextBucketAvgValue = previousBucketPoint;
 
-    // Temporary variables used to find
-    // the max triangle area formed by
-    // the sampled points
 
-    auto maxTriangleArea = previousBucketPoint;
-    auto currentTriangleArea = maxTriangleArea;
+//-------------------------------------------------------------------
+// The following function downsamples a
+// source into the destination container
+// simply by skipping every so many values
+//
+// Destination point i is source sample
+// floor(i*srcDataSize/dstDataSize), contiguous
+// sources of numbers take the fast path above
+//-------------------------------------------------------------------
+template<typename srcDataIteratorType,
+         typename dstDataIteratorType>
 
-    // Iterators used to move through the
-    // source data buckets at a time
+inline void simpleDownsample(srcDataIteratorType srcDataBegin,
+                             const std::size_t& srcDataSize,
+                             dstDataIteratorType dstDataBegin,
+                             const std::size_t& dstDataSize)
+{
+    if(srcDataSize == 0 || dstDataSize == 0)
+        return;
 
-    auto srcCurrentBucketIterator = srcDataBegin;
+    simpleDownsample(srcDataBegin,
+                     srcDataSize,
+                     dstDataBegin,
+                     dstDataSize,
+                     std::integral_constant<bool,std::is_pointer<srcDataIteratorType>::value &&
+                                                 std::is_arithmetic<typename std::iterator_traits<srcDataIteratorType>::value_type>::value>());
+}
+//-------------------------------------------------------------------
 
-    auto srcNextBucketIterator = srcDataBegin;
-    std::advance(srcNextBucketIterator,1 + bucketStep);
 
-    // Value of 2 used to calculate
-    // the triangle area
 
-    auto two = static_cast<decltype(previousBucketPoint)>(2);
+//-------------------------------------------------------------------
+// The following function downsamples a source by
+// averaging every bucket of samples that makes up a
+// destination point, a box filter that keeps noise
+// and spikes from aliasing into the decimated data
+//
+// Bucket i holds the samples [floor(i*srcDataSize/dstDataSize),
+// floor((i+1)*srcDataSize/dstDataSize)), when upsampling
+// the empty buckets just take the sample they start at
+//-------------------------------------------------------------------
+template<typename srcDataIteratorType,
+         typename dstDataIteratorType>
 
+inline void averagingDownsample(srcDataIteratorType srcDataBegin,
+                                const std::size_t& srcDataSize,
+                                dstDataIteratorType dstDataBegin,
+                                const std::size_t& dstDataSize)
+{
+    if(srcDataSize == 0 || dstDataSize == 0)
+        return;
 
+    typedef typename std::decay<decltype((*srcDataBegin) * 1.0)>::type blSumType;
 
-    // Let's step through the data and
-    // sample the points of interest
+    blExactSamplingStepper stepper(srcDataSize,dstDataSize);
 
-    for(std::size_t bucketIndex = 0; bucketIndex < dstDataSize; ++bucketIndex)
+    for(std::size_t i = 0; i < dstDataSize; ++i)
     {
-        // If we are in the first or
-        // last buckets then we just
-        // copy the first or last data
-        // point
+        std::size_t bucketSize = stepper.step();
 
-        if(bucketIndex == 0)
-        {
-            (*dstDataBegin) = (*srcDataBegin);
-            ++srcCurrentBucketIterator;
-        }
-        else if(bucketIndex == dstDataSize - 1)
+        if(bucketSize == 0)
         {
-            std::advance(srcDataBegin,srcDataSize - 1);
             (*dstDataBegin) = (*srcDataBegin);
         }
         else
         {
-            // Calculate the average value
-            // of the next bucket
-
-            nextBucketAvgValue = 0;
+            blSumType bucketSum = 0;
 
-            for(std::size_t i = 0; i < bucketStep; ++i)
+            for(std::size_t j = 0; j < bucketSize; ++j)
             {
-                nextBucketAvgValue += (*srcNextBucketIterator);
-                ++srcNextBucketIterator;
+                bucketSum += (*srcDataBegin);
+                ++srcDataBegin;
             }
 
-            nextBucketAvgValue /= static_cast<decltype(nextBucketAvgValue)>(bucketStep);
+            (*dstDataBegin) = bucketSum / static_cast<blSumType>(bucketSize);
+        }
 
-            // Calculate which point gives
-            // the triangle with the biggest
-            // area and choose that point as
-            // the point for this current bucket
+        ++dstDataBegin;
+    }
+}
+//-------------------------------------------------------------------
 
-            maxTriangleArea = 0;
-            currentTriangleArea = 0;
 
-            for(std::size_t i = 0; i < bucketStep; ++i)
-            {
-                currentTriangleArea = blMathAPI::abs( (nextBucketAvgValue - previousBucketPoint) + two*(previousBucketPoint - (*srcCurrentBucketIterator)) ) / two;
 
-                if(currentTriangleArea > maxTriangleArea)
-                {
-                    maxTriangleArea = currentTriangleArea;
-                    (*dstDataBegin) = (*srcCurrentBucketIterator);
-                }
+//-------------------------------------------------------------------
+// The following function designs the low pass FIR
+// filter used by antialiasDownsample, a Hamming
+// windowed sinc with its cutoff at the Nyquist
+// frequency of the decimated data and unit DC gain
+//
+// The number of taps should be odd and a few times
+// the decimation ratio for a sharp cutoff
+//-------------------------------------------------------------------
+template<typename coefficientsIteratorType>
 
-                ++srcCurrentBucketIterator;
-            }
-        }
+inline void designAntialiasFilter(const double& decimationRatio,
+                                  const std::size_t& numberOfTaps,
+                                  coefficientsIteratorType coefficientsBegin)
+{
+    if(numberOfTaps == 0)
+        return;
 
-        // Advance to the next destination point
+    double cutoff = 0.5 / std::max(1.0,decimationRatio);
 
-        ++dstDataBegin;
+    double center = 0.5 * double(numberOfTaps - 1);
+
+    std::vector<double> coefficients(numberOfTaps);
+
+    double coefficientsSum = 0;
+
+    for(std::size_t k = 0; k < numberOfTaps; ++k)
+    {
+        double t = double(k) - center;
+
+        double sinc = (t == 0) ? 2.0 * cutoff : std::sin(2.0 * pi * cutoff * t) / (pi * t);
+
+        double window = (numberOfTaps == 1) ? 1.0 : 0.54 - 0.46 * std::cos(2.0 * pi * double(k) / double(numberOfTaps - 1));
+
+        coefficients[k] = sinc * window;
+
+        coefficientsSum += coefficients[k];
+    }
+
+    for(std::size_t k = 0; k < numberOfTaps; ++k)
+    {
+        (*coefficientsBegin) = coefficients[k] / coefficientsSum;
+        ++coefficientsBegin;
     }
 }
 //-------------------------------------------------------------------
@@ -280,68 +406,476 @@ inline void largestTriangleThreeBuckets(srcDataIteratorType srcDataBegin,
 
 
 //-------------------------------------------------------------------
-// The following function downsamples a source
-// into the destination container by use of the
-// Largest-Triangle-Three-Buckets algorithm like above
-// The difference is that this function takes an x-axis
-// as well as y-axis and samples the y-axis while also
-// taking the x-axis points corresponding to the sampled
-// y-axis points
+// The following function decimates a source with an
+// antialiasing FIR filter, every destination point is
+// the filter evaluated at the center of its bucket
+// (only the kept outputs are computed), repeating
+// the first and last samples past the edges
+//
+// The source must be random access, and if no taps
+// are given a windowed sinc of about four times the
+// decimation ratio taps is designed (up to 4095,
+// for bigger ratios averagingDownsample is a better
+// choice anyway)
 //-------------------------------------------------------------------
-template<typename xSrcDataIteratorType,
-         typename ySrcDataIteratorType,
-         typename xDstDataIteratorType,
-         typename yDstDataIteratorType>
+template<typename srcDataIteratorType,
+         typename dstDataIteratorType>
 
-inline void largestTriangleThreeBuckets(xSrcDataIteratorType xSrcDataBegin,
-                                        ySrcDataIteratorType ySrcDataBegin,
-                                        const std::size_t& srcDataSize,
-                                        xDstDataIteratorType xDstDataBegin,
-                                        yDstDataIteratorType yDstDataBegin,
-                                        const std::size_t& dstDataSize)
+inline void antialiasDownsample(srcDataIteratorType srcDataBegin,
+                                const std::size_t& srcDataSize,
+                                dstDataIteratorType dstDataBegin,
+                                const std::size_t& dstDataSize,
+                                std::vector<double> coefficients = std::vector<double>())
 {
-    if(srcDataSize <= 0 || dstDataSize <= 0)
+    if(srcDataSize == 0 || dstDataSize == 0)
+        return;
+
+    typedef typename std::decay<decltype((*srcDataBegin) * 1.0)>::type blSumType;
+
+    double decimationRatio = double(srcDataSize) / double(dstDataSize);
+
+    if(coefficients.empty())
     {
-        // We have no data to downsample
+        std::size_t numberOfTaps = std::min(std::size_t(4095),2 * std::size_t(std::ceil(2.0 * decimationRatio)) + 1);
 
-        return;
+        coefficients.resize(numberOfTaps);
+
+        designAntialiasFilter(decimationRatio,numberOfTaps,coefficients.begin());
     }
-    else if(dstDataSize >= srcDataSize)
-    {
-        // In this case we are trying to upsample
-        // the source data, we do this using
-        // a linear sampling
 
-        double srcStep = double(srcDataSize)/double(dstDataSize);
+    std::ptrdiff_t numberOfTaps = std::ptrdiff_t(coefficients.size());
+    std::ptrdiff_t halfNumberOfTaps = numberOfTaps / 2;
+    std::ptrdiff_t lastIndex = std::ptrdiff_t(srcDataSize) - 1;
 
-        int dstIndex = 0;
+    blExactSamplingStepper stepper(srcDataSize,dstDataSize);
 
-        int srcIndex = 0;
-        double idealSrcIndex = 0;
+    for(std::size_t i = 0; i < dstDataSize; ++i)
+    {
+        std::size_t bucketBegin = stepper.index;
+        std::size_t bucketEnd = bucketBegin + stepper.step();
 
-        while(srcIndex < srcDataSize && dstIndex < dstDataSize)
-        {
-            // Copy the data point
+        std::ptrdiff_t center = std::ptrdiff_t(bucketBegin + bucketEnd) / 2;
 
-            (*xDstDataBegin) = (*xSrcDataBegin);
-            (*yDstDataBegin) = (*ySrcDataBegin);
+        if(center > lastIndex)
+            center = lastIndex;
 
-            // Move forward in the destination array
+        std::ptrdiff_t firstIndex = center - halfNumberOfTaps;
 
-            ++xDstDataBegin;
-            ++yDstDataBegin;
+        blSumType filteredValue = 0;
 
-            // Calculate how much to move forward
-            // in the source array
+        if(firstIndex >= 0 && firstIndex + numberOfTaps - 1 <= lastIndex)
+        {
+            // The whole filter is inside the source
 
-            idealSrcIndex += srcStep;
+            srcDataIteratorType srcIterator = srcDataBegin + firstIndex;
 
-            if(int(idealSrcIndex) > srcIndex)
-            {
+            for(std::ptrdiff_t k = 0; k < numberOfTaps; ++k)
+                filteredValue += coefficients[k] * srcIterator[k];
+        }
+        else
+        {
+            for(std::ptrdiff_t k = 0; k < numberOfTaps; ++k)
+            {
+                std::ptrdiff_t srcIndex = std::min(std::max(firstIndex + k,std::ptrdiff_t(0)),lastIndex);
+
+                filteredValue += coefficients[k] * srcDataBegin[srcIndex];
+            }
+        }
+
+        (*dstDataBegin) = filteredValue;
+
+        ++dstDataBegin;
+    }
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The following function finds the point in a bucket
+// that forms the largest triangle area used by the
+// Largest-Triangle-Three-Buckets algorithms below
+//
+// It returns the index (within the bucket) of the
+// first point with the largest area, or -1 if no
+// point has an area greater than zero, in which case
+// the algorithms leave the destination point alone
+//-------------------------------------------------------------------
+template<typename srcDataIteratorType,
+         typename blNumberType>
+
+inline std::ptrdiff_t findLargestTriangleInBucket(srcDataIteratorType srcBucketBegin,
+                                                  const std::size_t& bucketSize,
+                                                  const blNumberType& nextBucketAvgValue,
+                                                  const blNumberType& previousBucketPoint)
+{
+    auto two = static_cast<blNumberType>(2);
+
+    blNumberType maxTriangleArea = 0;
+    blNumberType currentTriangleArea = 0;
+
+    std::ptrdiff_t largestTriangleIndex = -1;
+
+    for(std::size_t i = 0; i < bucketSize; ++i)
+    {
+        currentTriangleArea = blMathAPI::abs( (nextBucketAvgValue - previousBucketPoint) + two*(previousBucketPoint - (*srcBucketBegin)) ) / two;
+
+        if(currentTriangleArea > maxTriangleArea)
+        {
+            maxTriangleArea = currentTriangleArea;
+            largestTriangleIndex = std::ptrdiff_t(i);
+        }
+
+        ++srcBucketBegin;
+    }
+
+    return largestTriangleIndex;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Contiguous buffer versions of the function above,
+// vectorized with AVX-512 or AVX2 when the compiler
+// targets them (e.g. -mavx2 or -march=native)
+//
+// Every lane keeps its own max area and the index
+// where it first saw it (so a strict > compare and
+// blend), the lanes are then reduced to the first
+// index of the overall max, which is exactly what
+// the scalar loop picks
+//
+// The area is computed with the same operations as
+// the scalar loop, and since multiplying or dividing
+// by two is exact the results are bit for bit equal
+// whether or not the compiler fuses the multiply-add
+//-------------------------------------------------------------------
+template<typename blNumberType,
+         typename blIndexType>
+
+inline void reduceLargestTriangleLanes(const blNumberType* laneMaxAreas,
+                                       const blIndexType* laneIndices,
+                                       const int& numberOfLanes,
+                                       blNumberType& maxTriangleArea,
+                                       std::ptrdiff_t& largestTriangleIndex)
+{
+    for(int lane = 0; lane < numberOfLanes; ++lane)
+    {
+        if(laneIndices[lane] < 0)
+            continue;
+
+        if(laneMaxAreas[lane] > maxTriangleArea ||
+           (laneMaxAreas[lane] == maxTriangleArea && std::ptrdiff_t(laneIndices[lane]) < largestTriangleIndex))
+        {
+            maxTriangleArea = laneMaxAreas[lane];
+            largestTriangleIndex = std::ptrdiff_t(laneIndices[lane]);
+        }
+    }
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+inline std::ptrdiff_t findLargestTriangleInBucket(const double* srcBucketBegin,
+                                                  const std::size_t& bucketSize,
+                                                  const double& nextBucketAvgValue,
+                                                  const double& previousBucketPoint)
+{
+    double maxTriangleArea = 0;
+
+    std::ptrdiff_t largestTriangleIndex = -1;
+
+    std::size_t i = 0;
+
+#if defined(__AVX512F__)
+
+    if(bucketSize >= 8)
+    {
+        const __m512d avgMinusPrevious = _mm512_set1_pd(nextBucketAvgValue - previousBucketPoint);
+        const __m512d previous = _mm512_set1_pd(previousBucketPoint);
+        const __m512d two = _mm512_set1_pd(2.0);
+        const __m512d half = _mm512_set1_pd(0.5);
+        const __m512i absMask = _mm512_set1_epi64(0x7FFFFFFFFFFFFFFFLL);
+        const __m512i indexStep = _mm512_set1_epi64(8);
+
+        __m512d laneMaxAreas = _mm512_setzero_pd();
+        __m512i laneIndices = _mm512_set1_epi64(-1);
+        __m512i indices = _mm512_set_epi64(7,6,5,4,3,2,1,0);
+
+        for(; i + 8 <= bucketSize; i += 8)
+        {
+            __m512d area = _mm512_add_pd(avgMinusPrevious,_mm512_mul_pd(two,_mm512_sub_pd(previous,_mm512_loadu_pd(srcBucketBegin + i))));
+            area = _mm512_mul_pd(_mm512_castsi512_pd(_mm512_and_si512(_mm512_castpd_si512(area),absMask)),half);
+
+            __mmask8 isBigger = _mm512_cmp_pd_mask(area,laneMaxAreas,_CMP_GT_OQ);
+
+            laneMaxAreas = _mm512_mask_blend_pd(isBigger,laneMaxAreas,area);
+            laneIndices = _mm512_mask_blend_epi64(isBigger,laneIndices,indices);
+
+            indices = _mm512_add_epi64(indices,indexStep);
+        }
+
+        alignas(64) double areas[8];
+        alignas(64) std::int64_t lanes[8];
+        _mm512_store_pd(areas,laneMaxAreas);
+        _mm512_store_si512(reinterpret_cast<__m512i*>(lanes),laneIndices);
+
+        reduceLargestTriangleLanes(areas,lanes,8,maxTriangleArea,largestTriangleIndex);
+    }
+
+#elif defined(__AVX2__)
+
+    if(bucketSize >= 4)
+    {
+        const __m256d avgMinusPrevious = _mm256_set1_pd(nextBucketAvgValue - previousBucketPoint);
+        const __m256d previous = _mm256_set1_pd(previousBucketPoint);
+        const __m256d two = _mm256_set1_pd(2.0);
+        const __m256d half = _mm256_set1_pd(0.5);
+        const __m256d signMask = _mm256_set1_pd(-0.0);
+        const __m256i indexStep = _mm256_set1_epi64x(4);
+
+        __m256d laneMaxAreas = _mm256_setzero_pd();
+        __m256i laneIndices = _mm256_set1_epi64x(-1);
+        __m256i indices = _mm256_set_epi64x(3,2,1,0);
+
+        for(; i + 4 <= bucketSize; i += 4)
+        {
+            __m256d area = _mm256_add_pd(avgMinusPrevious,_mm256_mul_pd(two,_mm256_sub_pd(previous,_mm256_loadu_pd(srcBucketBegin + i))));
+            area = _mm256_mul_pd(_mm256_andnot_pd(signMask,area),half);
+
+            __m256d isBigger = _mm256_cmp_pd(area,laneMaxAreas,_CMP_GT_OQ);
+
+            laneMaxAreas = _mm256_blendv_pd(laneMaxAreas,area,isBigger);
+            laneIndices = _mm256_castpd_si256(_mm256_blendv_pd(_mm256_castsi256_pd(laneIndices),
+                                                               _mm256_castsi256_pd(indices),
+                                                               isBigger));
+
+            indices = _mm256_add_epi64(indices,indexStep);
+        }
+
+        alignas(32) double areas[4];
+        alignas(32) std::int64_t lanes[4];
+        _mm256_store_pd(areas,laneMaxAreas);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes),laneIndices);
+
+        reduceLargestTriangleLanes(areas,lanes,4,maxTriangleArea,largestTriangleIndex);
+    }
+
+#endif
+
+    // The remaining points (or all of
+    // them without AVX) one at a time
+
+    for(; i < bucketSize; ++i)
+    {
+        double currentTriangleArea = blMathAPI::abs( (nextBucketAvgValue - previousBucketPoint) + 2.0*(previousBucketPoint - srcBucketBegin[i]) ) / 2.0;
+
+        if(currentTriangleArea > maxTriangleArea)
+        {
+            maxTriangleArea = currentTriangleArea;
+            largestTriangleIndex = std::ptrdiff_t(i);
+        }
+    }
+
+    return largestTriangleIndex;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+inline std::ptrdiff_t findLargestTriangleInBucket(const float* srcBucketBegin,
+                                                  const std::size_t& bucketSize,
+                                                  const float& nextBucketAvgValue,
+                                                  const float& previousBucketPoint)
+{
+    float maxTriangleArea = 0;
+
+    std::ptrdiff_t largestTriangleIndex = -1;
+
+    std::size_t i = 0;
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+
+    // The float lanes carry 32 bit indices, so very
+    // large buckets are left to the scalar loop
+
+    int numberOfLanes = 0;
+
+    if(bucketSize >= 16 && bucketSize <= std::size_t(0x7FFFFFFF))
+    {
+
+#if defined(__AVX512F__)
+
+        const __m512 avgMinusPrevious = _mm512_set1_ps(nextBucketAvgValue - previousBucketPoint);
+        const __m512 previous = _mm512_set1_ps(previousBucketPoint);
+        const __m512 two = _mm512_set1_ps(2.0f);
+        const __m512 half = _mm512_set1_ps(0.5f);
+        const __m512i absMask = _mm512_set1_epi32(0x7FFFFFFF);
+        const __m512i indexStep = _mm512_set1_epi32(16);
+
+        __m512 laneMaxAreas = _mm512_setzero_ps();
+        __m512i laneIndices = _mm512_set1_epi32(-1);
+        __m512i indices = _mm512_set_epi32(15,14,13,12,11,10,9,8,7,6,5,4,3,2,1,0);
+
+        for(; i + 16 <= bucketSize; i += 16)
+        {
+            __m512 area = _mm512_add_ps(avgMinusPrevious,_mm512_mul_ps(two,_mm512_sub_ps(previous,_mm512_loadu_ps(srcBucketBegin + i))));
+            area = _mm512_mul_ps(_mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(area),absMask)),half);
+
+            __mmask16 isBigger = _mm512_cmp_ps_mask(area,laneMaxAreas,_CMP_GT_OQ);
+
+            laneMaxAreas = _mm512_mask_blend_ps(isBigger,laneMaxAreas,area);
+            laneIndices = _mm512_mask_blend_epi32(isBigger,laneIndices,indices);
+
+            indices = _mm512_add_epi32(indices,indexStep);
+        }
+
+        numberOfLanes = 16;
+
+#else
+
+        const __m256 avgMinusPrevious = _mm256_set1_ps(nextBucketAvgValue - previousBucketPoint);
+        const __m256 previous = _mm256_set1_ps(previousBucketPoint);
+        const __m256 two = _mm256_set1_ps(2.0f);
+        const __m256 half = _mm256_set1_ps(0.5f);
+        const __m256 signMask = _mm256_set1_ps(-0.0f);
+        const __m256i indexStep = _mm256_set1_epi32(8);
+
+        __m256 laneMaxAreas = _mm256_setzero_ps();
+        __m256i laneIndices = _mm256_set1_epi32(-1);
+        __m256i indices = _mm256_set_epi32(7,6,5,4,3,2,1,0);
+
+        for(; i + 8 <= bucketSize; i += 8)
+        {
+            __m256 area = _mm256_add_ps(avgMinusPrevious,_mm256_mul_ps(two,_mm256_sub_ps(previous,_mm256_loadu_ps(srcBucketBegin + i))));
+            area = _mm256_mul_ps(_mm256_andnot_ps(signMask,area),half);
+
+            __m256 isBigger = _mm256_cmp_ps(area,laneMaxAreas,_CMP_GT_OQ);
+
+            laneMaxAreas = _mm256_blendv_ps(laneMaxAreas,area,isBigger);
+            laneIndices = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(laneIndices),
+                                                               _mm256_castsi256_ps(indices),
+                                                               isBigger));
+
+            indices = _mm256_add_epi32(indices,indexStep);
+        }
+
+        numberOfLanes = 8;
+
+#endif
+
+        alignas(64) float areas[16];
+        alignas(64) std::int32_t lanes[16];
+
+#if defined(__AVX512F__)
+        _mm512_store_ps(areas,laneMaxAreas);
+        _mm512_store_si512(reinterpret_cast<__m512i*>(lanes),laneIndices);
+#else
+        _mm256_store_ps(areas,laneMaxAreas);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes),laneIndices);
+#endif
+
+        reduceLargestTriangleLanes(areas,lanes,numberOfLanes,maxTriangleArea,largestTriangleIndex);
+    }
+
+#endif
+
+    for(; i < bucketSize; ++i)
+    {
+        float currentTriangleArea = blMathAPI::abs( (nextBucketAvgValue - previousBucketPoint) + 2.0f*(previousBucketPoint - srcBucketBegin[i]) ) / 2.0f;
+
+        if(currentTriangleArea > maxTriangleArea)
+        {
+            maxTriangleArea = currentTriangleArea;
+            largestTriangleIndex = std::ptrdiff_t(i);
+        }
+    }
+
+    return largestTriangleIndex;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Non-const pointers would otherwise pick the
+// generic template, so forward them explicitly
+//-------------------------------------------------------------------
+inline std::ptrdiff_t findLargestTriangleInBucket(double* srcBucketBegin,
+                                                  const std::size_t& bucketSize,
+                                                  const double& nextBucketAvgValue,
+                                                  const double& previousBucketPoint)
+{
+    return findLargestTriangleInBucket(static_cast<const double*>(srcBucketBegin),bucketSize,nextBucketAvgValue,previousBucketPoint);
+}
+
+inline std::ptrdiff_t findLargestTriangleInBucket(float* srcBucketBegin,
+                                                  const std::size_t& bucketSize,
+                                                  const float& nextBucketAvgValue,
+                                                  const float& previousBucketPoint)
+{
+    return findLargestTriangleInBucket(static_cast<const float*>(srcBucketBegin),bucketSize,nextBucketAvgValue,previousBucketPoint);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The following function downsamples a source
+// into the destination container by use of the
+// Largest-Triangle-Three-Buckets algorithm
+//-------------------------------------------------------------------
+template<typename srcDataIteratorType,
+         typename dstDataIteratorType>
+
+inline void largestTriangleThreeBuckets(srcDataIteratorType srcDataBegin,
+                                        const std::size_t& srcDataSize,
+                                        dstDataIteratorType dstDataBegin,
+                                        const std::size_t& dstDataSize)
+{
+    if(srcDataSize <= 0 || dstDataSize <= 0)
+    {
+        // We have no data to downsample
+
+        return;
+    }
+    else if(dstDataSize >= srcDataSize)
+    {
+        // In this case we are trying to upsample
+        // the source data, we do this using
+        // a linear sampling
+
+        double srcStep = double(srcDataSize)/double(dstDataSize);
+
+        int dstIndex = 0;
+
+        int srcIndex = 0;
+        double idealSrcIndex = 0;
+
+        while(srcIndex < srcDataSize && dstIndex < dstDataSize)
+        {
+            // Copy the data point
+
+            (*dstDataBegin) = (*srcDataBegin);
+
+            // Move forward in the destination array
+
+            ++dstDataBegin;
+            ++dstIndex;
+
+            // Calculate how much to move forward
+            // in the source array
+
+            idealSrcIndex += srcStep;
+
+            if(int(idealSrcIndex) > srcIndex)
+            {
                 srcIndex = int(idealSrcIndex);
 
-                ++xSrcDataBegin;
-                ++ySrcDataBegin;
+                ++srcDataBegin;
             }
         }
 
@@ -352,8 +886,7 @@ inline void largestTriangleThreeBuckets(xSrcDataIteratorType xSrcDataBegin,
         // In this case we just
         // copy the first data point
 
-        (*xDstDataBegin) = (*xSrcDataBegin);
-        (*yDstDataBegin) = (*ySrcDataBegin);
+        (*dstDataBegin) = (*srcDataBegin);
 
         return;
     }
@@ -372,29 +905,16 @@ inline void largestTriangleThreeBuckets(xSrcDataIteratorType xSrcDataBegin,
     // Create temporary point values
     // used to find the point to sample
 
-    auto yPreviousBucketPoint = (*ySrcDataBegin);
-    auto yNextBucketAvgValue = yPreviousBucketPoint;
-
-    // Temporary variables used to find
-    // the max triangle area formed by
-    // the sampled points
-
-    auto maxTriangleArea = yPreviousBucketPoint;
-    auto currentTriangleArea = maxTriangleArea;
+    auto previousBucketPoint = (*srcDataBegin);
+    auto nextBucketAvgValue = previousBucketPoint;
 
     // Iterators used to move through the
-    // source data n buckets at a time
-
-    auto xSrcCurrentBucketIterator = xSrcDataBegin;
-    auto ySrcCurrentBucketIterator = ySrcDataBegin;
-
-    auto ySrcNextBucketIterator = ySrcDataBegin;
-    std::advance(ySrcNextBucketIterator,1 + bucketStep);
+    // source data buckets at a time
 
-    // Value of 2 used to calculate
-    // the triangle area
+    auto srcCurrentBucketIterator = srcDataBegin;
 
-    auto two = static_cast<decltype(yPreviousBucketPoint)>(2);
+    auto srcNextBucketIterator = srcDataBegin;
+    std::advance(srcNextBucketIterator,1 + bucketStep);
 
 
 
@@ -410,70 +930,1233 @@ inline void largestTriangleThreeBuckets(xSrcDataIteratorType xSrcDataBegin,
 
         if(bucketIndex == 0)
         {
-            (*xDstDataBegin) = (*xSrcDataBegin);
-            (*yDstDataBegin) = (*ySrcDataBegin);
-
-            ++xSrcCurrentBucketIterator;
-            ++ySrcCurrentBucketIterator;
+            (*dstDataBegin) = (*srcDataBegin);
+            ++srcCurrentBucketIterator;
         }
         else if(bucketIndex == dstDataSize - 1)
         {
-            std::advance(xSrcDataBegin,srcDataSize - 1);
-            std::advance(ySrcDataBegin,srcDataSize - 1);
-
-            (*xDstDataBegin) = (*xSrcDataBegin);
-            (*yDstDataBegin) = (*ySrcDataBegin);
+            std::advance(srcDataBegin,srcDataSize - 1);
+            (*dstDataBegin) = (*srcDataBegin);
         }
         else
         {
             // Calculate the average value
             // of the next bucket
 
-            yNextBucketAvgValue = 0;
+            nextBucketAvgValue = 0;
 
             for(std::size_t i = 0; i < bucketStep; ++i)
             {
-                yNextBucketAvgValue += (*ySrcNextBucketIterator);
-                ++ySrcNextBucketIterator;
+                nextBucketAvgValue += (*srcNextBucketIterator);
+                ++srcNextBucketIterator;
             }
 
-            yNextBucketAvgValue /= static_cast<decltype(yNextBucketAvgValue)>(bucketStep);
+            nextBucketAvgValue /= static_cast<decltype(nextBucketAvgValue)>(bucketStep);
 
             // Calculate which point gives
             // the triangle with the biggest
             // area and choose that point as
             // the point for this current bucket
 
-            maxTriangleArea = 0;
-            currentTriangleArea = 0;
+            std::ptrdiff_t largestTriangleIndex = findLargestTriangleInBucket(srcCurrentBucketIterator,
+                                                                              bucketStep,
+                                                                              nextBucketAvgValue,
+                                                                              previousBucketPoint);
 
-            for(std::size_t i = 0; i < bucketStep; ++i)
+            if(largestTriangleIndex >= 0)
             {
-                currentTriangleArea = blMathAPI::abs( (yNextBucketAvgValue - yPreviousBucketPoint) + two*(yPreviousBucketPoint - (*ySrcCurrentBucketIterator)) ) / two;
-
-                if(currentTriangleArea > maxTriangleArea)
-                {
-                    maxTriangleArea = currentTriangleArea;
-
-                    (*xDstDataBegin) = (*xSrcCurrentBucketIterator);
-                    (*yDstDataBegin) = (*ySrcCurrentBucketIterator);
-                }
+                auto srcLargestTriangleIterator = srcCurrentBucketIterator;
+                std::advance(srcLargestTriangleIterator,largestTriangleIndex);
 
-                ++xSrcCurrentBucketIterator;
-                ++ySrcCurrentBucketIterator;
+                (*dstDataBegin) = (*srcLargestTriangleIterator);
             }
+
+            std::advance(srcCurrentBucketIterator,bucketStep);
         }
 
         // Advance to the next destination point
 
-        ++xDstDataBegin;
-        ++yDstDataBegin;
+        ++dstDataBegin;
     }
 }
 //-------------------------------------------------------------------
 
 
 
+//-------------------------------------------------------------------
+// The following function downsamples a source
+// into the destination container by use of the
+// Largest-Triangle-Three-Buckets algorithm like above
+// The difference is that this function takes an x-axis
+// as well as y-axis and samples the y-axis while also
+// taking the x-axis points corresponding to the sampled
+// y-axis points
+//-------------------------------------------------------------------
+template<typename xSrcDataIteratorType,
+         typename ySrcDataIteratorType,
+         typename xDstDataIteratorType,
+         typename yDstDataIteratorType>
+
+inline void largestTriangleThreeBuckets(xSrcDataIteratorType xSrcDataBegin,
+                                        ySrcDataIteratorType ySrcDataBegin,
+                                        const std::size_t& srcDataSize,
+                                        xDstDataIteratorType xDstDataBegin,
+                                        yDstDataIteratorType yDstDataBegin,
+                                        const std::size_t& dstDataSize)
+{
+    if(srcDataSize <= 0 || dstDataSize <= 0)
+    {
+        // We have no data to downsample
+
+        return;
+    }
+    else if(dstDataSize >= srcDataSize)
+    {
+        // In this case we are trying to upsample
+        // the source data, we do this using
+        // a linear sampling
+
+        double srcStep = double(srcDataSize)/double(dstDataSize);
+
+        int dstIndex = 0;
+
+        int srcIndex = 0;
+        double idealSrcIndex = 0;
+
+        while(srcIndex < srcDataSize && dstIndex < dstDataSize)
+        {
+            // Copy the data point
+
+            (*xDstDataBegin) = (*xSrcDataBegin);
+            (*yDstDataBegin) = (*ySrcDataBegin);
+
+            // Move forward in the destination array
+
+            ++xDstDataBegin;
+            ++yDstDataBegin;
+            ++dstIndex;
+
+            // Calculate how much to move forward
+            // in the source array
+
+            idealSrcIndex += srcStep;
+
+            if(int(idealSrcIndex) > srcIndex)
+            {
+                srcIndex = int(idealSrcIndex);
+
+                ++xSrcDataBegin;
+                ++ySrcDataBegin;
+            }
+        }
+
+        return;
+    }
+    else if(dstDataSize == 1)
+    {
+        // In this case we just
+        // copy the first data point
+
+        (*xDstDataBegin) = (*xSrcDataBegin);
+        (*yDstDataBegin) = (*ySrcDataBegin);
+
+        return;
+    }
+
+
+
+    // Now we got all the special
+    // cases out of the way
+
+
+
+    // Calculate the size of each bucket
+
+    std::size_t bucketStep = srcDataSize / dstDataSize;
+
+    // Create temporary point values
+    // used to find the point to sample
+
+    auto yPreviousBucketPoint = (*ySrcDataBegin);
+    auto yNextBucketAvgValue = yPreviousBucketPoint;
+
+    // Iterators used to move through the
+    // source data n buckets at a time
+
+    auto xSrcCurrentBucketIterator = xSrcDataBegin;
+    auto ySrcCurrentBucketIterator = ySrcDataBegin;
+
+    auto ySrcNextBucketIterator = ySrcDataBegin;
+    std::advance(ySrcNextBucketIterator,1 + bucketStep);
+
+
+
+    // Let's step through the data and
+    // sample the points of interest
+
+    for(std::size_t bucketIndex = 0; bucketIndex < dstDataSize; ++bucketIndex)
+    {
+        // If we are in the first or
+        // last buckets then we just
+        // copy the first or last data
+        // point
+
+        if(bucketIndex == 0)
+        {
+            (*xDstDataBegin) = (*xSrcDataBegin);
+            (*yDstDataBegin) = (*ySrcDataBegin);
+
+            ++xSrcCurrentBucketIterator;
+            ++ySrcCurrentBucketIterator;
+        }
+        else if(bucketIndex == dstDataSize - 1)
+        {
+            std::advance(xSrcDataBegin,srcDataSize - 1);
+            std::advance(ySrcDataBegin,srcDataSize - 1);
+
+            (*xDstDataBegin) = (*xSrcDataBegin);
+            (*yDstDataBegin) = (*ySrcDataBegin);
+        }
+        else
+        {
+            // Calculate the average value
+            // of the next bucket
+
+            yNextBucketAvgValue = 0;
+
+            for(std::size_t i = 0; i < bucketStep; ++i)
+            {
+                yNextBucketAvgValue += (*ySrcNextBucketIterator);
+                ++ySrcNextBucketIterator;
+            }
+
+            yNextBucketAvgValue /= static_cast<decltype(yNextBucketAvgValue)>(bucketStep);
+
+            // Calculate which point gives
+            // the triangle with the biggest
+            // area and choose that point as
+            // the point for this current bucket
+
+            std::ptrdiff_t largestTriangleIndex = findLargestTriangleInBucket(ySrcCurrentBucketIterator,
+                                                                              bucketStep,
+                                                                              yNextBucketAvgValue,
+                                                                              yPreviousBucketPoint);
+
+            if(largestTriangleIndex >= 0)
+            {
+                auto xSrcLargestTriangleIterator = xSrcCurrentBucketIterator;
+                auto ySrcLargestTriangleIterator = ySrcCurrentBucketIterator;
+                std::advance(xSrcLargestTriangleIterator,largestTriangleIndex);
+                std::advance(ySrcLargestTriangleIterator,largestTriangleIndex);
+
+                (*xDstDataBegin) = (*xSrcLargestTriangleIterator);
+                (*yDstDataBegin) = (*ySrcLargestTriangleIterator);
+            }
+
+            std::advance(xSrcCurrentBucketIterator,bucketStep);
+            std::advance(ySrcCurrentBucketIterator,bucketStep);
+        }
+
+        // Advance to the next destination point
+
+        ++xDstDataBegin;
+        ++yDstDataBegin;
+    }
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The following function is a parallel version of the
+// Largest-Triangle-Three-Buckets downsampling above for
+// random access iterators, it first computes the average
+// of every bucket in a parallel pass, then each thread
+// selects the points for a chunk of buckets
+//
+// The output is identical to the serial version
+//-------------------------------------------------------------------
+template<typename srcDataIteratorType,
+         typename dstDataIteratorType>
+
+inline void largestTriangleThreeBucketsParallel(srcDataIteratorType srcDataBegin,
+                                                const std::size_t& srcDataSize,
+                                                dstDataIteratorType dstDataBegin,
+                                                const std::size_t& dstDataSize)
+{
+    if(srcDataSize <= 0 || dstDataSize <= 2 || dstDataSize >= srcDataSize)
+    {
+        // The special cases are cheap
+        // so we let the serial version
+        // handle them
+
+        largestTriangleThreeBuckets(srcDataBegin,srcDataSize,dstDataBegin,dstDataSize);
+
+        return;
+    }
+
+    typedef typename std::decay<decltype(*srcDataBegin)>::type valueType;
+
+    // Calculate the size of each bucket
+
+    std::size_t bucketStep = srcDataSize / dstDataSize;
+
+    // The serial version never moves the
+    // previous bucket point from the first
+    // sample, so the buckets are independent
+
+    valueType previousBucketPoint = (*srcDataBegin);
+
+    std::ptrdiff_t numberOfInnerBuckets = std::ptrdiff_t(dstDataSize) - 2;
+
+    // First pass -- the average of the "next"
+    // bucket of every inner bucket, summed in
+    // the same order as the serial version
+
+    std::vector<valueType> nextBucketAvgValues(dstDataSize);
+
+    #pragma omp parallel for schedule(static)
+    for(std::ptrdiff_t b = 0; b < numberOfInnerBuckets; ++b)
+    {
+        srcDataIteratorType srcNextBucketIterator = srcDataBegin + std::ptrdiff_t(1 + (b + 1) * bucketStep);
+
+        valueType nextBucketAvgValue = 0;
+
+        for(std::size_t i = 0; i < bucketStep; ++i)
+        {
+            nextBucketAvgValue += (*srcNextBucketIterator);
+            ++srcNextBucketIterator;
+        }
+
+        nextBucketAvgValue /= static_cast<valueType>(bucketStep);
+
+        nextBucketAvgValues[b] = nextBucketAvgValue;
+    }
+
+    // Second pass -- pick the point with
+    // the biggest triangle in every bucket
+
+    #pragma omp parallel for schedule(static)
+    for(std::ptrdiff_t b = 0; b < numberOfInnerBuckets; ++b)
+    {
+        srcDataIteratorType srcCurrentBucketIterator = srcDataBegin + std::ptrdiff_t(1 + b * bucketStep);
+
+        std::ptrdiff_t largestTriangleIndex = findLargestTriangleInBucket(srcCurrentBucketIterator,
+                                                                          bucketStep,
+                                                                          nextBucketAvgValues[b],
+                                                                          previousBucketPoint);
+
+        if(largestTriangleIndex >= 0)
+            dstDataBegin[b + 1] = srcCurrentBucketIterator[largestTriangleIndex];
+    }
+
+    // The first and last points
+    // are copied as they are
+
+    dstDataBegin[0] = srcDataBegin[0];
+    dstDataBegin[std::ptrdiff_t(dstDataSize - 1)] = srcDataBegin[std::ptrdiff_t(srcDataSize - 1)];
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Parallel version of the x/y Largest-Triangle-Three-Buckets
+// downsampling above, with the same two passes and the
+// same output as the serial version
+//-------------------------------------------------------------------
+template<typename xSrcDataIteratorType,
+         typename ySrcDataIteratorType,
+         typename xDstDataIteratorType,
+         typename yDstDataIteratorType>
+
+inline void largestTriangleThreeBucketsParallel(xSrcDataIteratorType xSrcDataBegin,
+                                                ySrcDataIteratorType ySrcDataBegin,
+                                                const std::size_t& srcDataSize,
+                                                xDstDataIteratorType xDstDataBegin,
+                                                yDstDataIteratorType yDstDataBegin,
+                                                const std::size_t& dstDataSize)
+{
+    if(srcDataSize <= 0 || dstDataSize <= 2 || dstDataSize >= srcDataSize)
+    {
+        largestTriangleThreeBuckets(xSrcDataBegin,ySrcDataBegin,srcDataSize,xDstDataBegin,yDstDataBegin,dstDataSize);
+
+        return;
+    }
+
+    typedef typename std::decay<decltype(*ySrcDataBegin)>::type yValueType;
+
+    std::size_t bucketStep = srcDataSize / dstDataSize;
+
+    yValueType yPreviousBucketPoint = (*ySrcDataBegin);
+
+    std::ptrdiff_t numberOfInnerBuckets = std::ptrdiff_t(dstDataSize) - 2;
+
+    // First pass -- next bucket averages
+
+    std::vector<yValueType> yNextBucketAvgValues(dstDataSize);
+
+    #pragma omp parallel for schedule(static)
+    for(std::ptrdiff_t b = 0; b < numberOfInnerBuckets; ++b)
+    {
+        ySrcDataIteratorType ySrcNextBucketIterator = ySrcDataBegin + std::ptrdiff_t(1 + (b + 1) * bucketStep);
+
+        yValueType yNextBucketAvgValue = 0;
+
+        for(std::size_t i = 0; i < bucketStep; ++i)
+        {
+            yNextBucketAvgValue += (*ySrcNextBucketIterator);
+            ++ySrcNextBucketIterator;
+        }
+
+        yNextBucketAvgValue /= static_cast<yValueType>(bucketStep);
+
+        yNextBucketAvgValues[b] = yNextBucketAvgValue;
+    }
+
+    // Second pass -- point selection
+
+    #pragma omp parallel for schedule(static)
+    for(std::ptrdiff_t b = 0; b < numberOfInnerBuckets; ++b)
+    {
+        std::ptrdiff_t bucketBegin = std::ptrdiff_t(1 + b * bucketStep);
+
+        std::ptrdiff_t largestTriangleIndex = findLargestTriangleInBucket(ySrcDataBegin + bucketBegin,
+                                                                          bucketStep,
+                                                                          yNextBucketAvgValues[b],
+                                                                          yPreviousBucketPoint);
+
+        if(largestTriangleIndex >= 0)
+        {
+            xDstDataBegin[b + 1] = xSrcDataBegin[bucketBegin + largestTriangleIndex];
+            yDstDataBegin[b + 1] = ySrcDataBegin[bucketBegin + largestTriangleIndex];
+        }
+    }
+
+    // First and last points
+
+    xDstDataBegin[0] = xSrcDataBegin[0];
+    yDstDataBegin[0] = ySrcDataBegin[0];
+
+    xDstDataBegin[std::ptrdiff_t(dstDataSize - 1)] = xSrcDataBegin[std::ptrdiff_t(srcDataSize - 1)];
+    yDstDataBegin[std::ptrdiff_t(dstDataSize - 1)] = ySrcDataBegin[std::ptrdiff_t(srcDataSize - 1)];
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The following function runs the x/y Largest-Triangle-
+// Three-Buckets downsampling on many y channels sampled
+// against the same x axis in one call
+//
+// The y channels are a column-major block (channel c
+// starts at ySrcDataBegin + c*srcDataSize), and the
+// output is written into preallocated column-major
+// x and y blocks (channel c starts at c*dstDataSize)
+//
+// The buckets are computed once and the channels are
+// processed in parallel, the x axis is never scanned,
+// only the x points of the picked samples are read
+//
+// Every channel's output is the same as calling the
+// x/y version above on that channel
+//-------------------------------------------------------------------
+template<typename xSrcDataIteratorType,
+         typename ySrcDataIteratorType,
+         typename xDstDataIteratorType,
+         typename yDstDataIteratorType>
+
+inline void largestTriangleThreeBucketsMultiChannel(xSrcDataIteratorType xSrcDataBegin,
+                                                    ySrcDataIteratorType ySrcDataBegin,
+                                                    const std::size_t& srcDataSize,
+                                                    const std::size_t& numberOfChannels,
+                                                    xDstDataIteratorType xDstDataBegin,
+                                                    yDstDataIteratorType yDstDataBegin,
+                                                    const std::size_t& dstDataSize)
+{
+    std::ptrdiff_t srcChannelStride = std::ptrdiff_t(srcDataSize);
+    std::ptrdiff_t dstChannelStride = std::ptrdiff_t(dstDataSize);
+
+    if(srcDataSize <= 0 || dstDataSize <= 2 || dstDataSize >= srcDataSize)
+    {
+        // The special cases don't
+        // look at the buckets
+
+        for(std::size_t channel = 0; channel < numberOfChannels; ++channel)
+        {
+            largestTriangleThreeBuckets(xSrcDataBegin,
+                                        ySrcDataBegin + std::ptrdiff_t(channel) * srcChannelStride,
+                                        srcDataSize,
+                                        xDstDataBegin + std::ptrdiff_t(channel) * dstChannelStride,
+                                        yDstDataBegin + std::ptrdiff_t(channel) * dstChannelStride,
+                                        dstDataSize);
+        }
+
+        return;
+    }
+
+    typedef typename std::decay<decltype(*ySrcDataBegin)>::type yValueType;
+
+    // The buckets are the same for every
+    // channel, so they're calculated once
+
+    std::size_t bucketStep = srcDataSize / dstDataSize;
+
+    std::ptrdiff_t numberOfInnerBuckets = std::ptrdiff_t(dstDataSize) - 2;
+
+    std::vector<std::ptrdiff_t> bucketBegins(std::size_t(numberOfInnerBuckets) + 1);
+
+    for(std::ptrdiff_t b = 0; b <= numberOfInnerBuckets; ++b)
+        bucketBegins[b] = std::ptrdiff_t(1 + std::size_t(b) * bucketStep);
+
+    #pragma omp parallel for schedule(static)
+    for(std::ptrdiff_t channel = 0; channel < std::ptrdiff_t(numberOfChannels); ++channel)
+    {
+        ySrcDataIteratorType ySrc = ySrcDataBegin + channel * srcChannelStride;
+
+        xDstDataIteratorType xDst = xDstDataBegin + channel * dstChannelStride;
+        yDstDataIteratorType yDst = yDstDataBegin + channel * dstChannelStride;
+
+        yValueType yPreviousBucketPoint = ySrc[0];
+
+        xDst[0] = xSrcDataBegin[0];
+        yDst[0] = ySrc[0];
+
+        for(std::ptrdiff_t b = 0; b < numberOfInnerBuckets; ++b)
+        {
+            // Average of the next bucket,
+            // summed as in the serial version
+
+            yValueType yNextBucketAvgValue = 0;
+
+            for(std::ptrdiff_t i = bucketBegins[b + 1]; i < bucketBegins[b + 1] + std::ptrdiff_t(bucketStep); ++i)
+                yNextBucketAvgValue += ySrc[i];
+
+            yNextBucketAvgValue /= static_cast<yValueType>(bucketStep);
+
+            std::ptrdiff_t largestTriangleIndex = findLargestTriangleInBucket(ySrc + bucketBegins[b],
+                                                                              bucketStep,
+                                                                              yNextBucketAvgValue,
+                                                                              yPreviousBucketPoint);
+
+            if(largestTriangleIndex >= 0)
+            {
+                xDst[b + 1] = xSrcDataBegin[bucketBegins[b] + largestTriangleIndex];
+                yDst[b + 1] = ySrc[bucketBegins[b] + largestTriangleIndex];
+            }
+        }
+
+        xDst[dstChannelStride - 1] = xSrcDataBegin[srcChannelStride - 1];
+        yDst[dstChannelStride - 1] = ySrc[srcChannelStride - 1];
+    }
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The following function finds the point in a bucket
+// that forms the largest triangle with the previous
+// point and the next bucket's average, using the x
+// and y of every point (the area is doubled, which
+// doesn't change which point is the largest)
+//
+// It returns the index of the first point with the
+// largest area, or 0 if no area can be compared
+// (NaNs), so a non-empty bucket always gives a point
+//-------------------------------------------------------------------
+template<typename xSrcDataIteratorType,
+         typename ySrcDataIteratorType,
+         typename blNumberType>
+
+inline std::ptrdiff_t findLargestTriangleInBucket2d(xSrcDataIteratorType xSrcBucketBegin,
+                                                    ySrcDataIteratorType ySrcBucketBegin,
+                                                    const std::size_t& bucketSize,
+                                                    const blNumberType& xPreviousPoint,
+                                                    const blNumberType& yPreviousPoint,
+                                                    const blNumberType& xNextBucketAvgValue,
+                                                    const blNumberType& yNextBucketAvgValue)
+{
+    // Doubled area = |a*(y - yPrevious) + b*(x - xPrevious)|
+
+    blNumberType a = xPreviousPoint - xNextBucketAvgValue;
+    blNumberType b = yNextBucketAvgValue - yPreviousPoint;
+
+    blNumberType maxTriangleArea = -1;
+
+    std::ptrdiff_t largestTriangleIndex = 0;
+
+    for(std::size_t i = 0; i < bucketSize; ++i)
+    {
+        blNumberType currentTriangleArea = blMathAPI::abs( a*((*ySrcBucketBegin) - yPreviousPoint) + b*((*xSrcBucketBegin) - xPreviousPoint) );
+
+        if(currentTriangleArea > maxTriangleArea)
+        {
+            maxTriangleArea = currentTriangleArea;
+            largestTriangleIndex = std::ptrdiff_t(i);
+        }
+
+        ++xSrcBucketBegin;
+        ++ySrcBucketBegin;
+    }
+
+    return largestTriangleIndex;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Contiguous buffer versions of the function above,
+// vectorized like findLargestTriangleInBucket
+//-------------------------------------------------------------------
+inline std::ptrdiff_t findLargestTriangleInBucket2d(const double* xSrcBucketBegin,
+                                                    const double* ySrcBucketBegin,
+                                                    const std::size_t& bucketSize,
+                                                    const double& xPreviousPoint,
+                                                    const double& yPreviousPoint,
+                                                    const double& xNextBucketAvgValue,
+                                                    const double& yNextBucketAvgValue)
+{
+    double a = xPreviousPoint - xNextBucketAvgValue;
+    double b = yNextBucketAvgValue - yPreviousPoint;
+
+    double maxTriangleArea = -1;
+
+    std::ptrdiff_t largestTriangleIndex = -1;
+
+    std::size_t i = 0;
+
+#if defined(__AVX512F__)
+
+    if(bucketSize >= 8)
+    {
+        const __m512d va = _mm512_set1_pd(a);
+        const __m512d vb = _mm512_set1_pd(b);
+        const __m512d xPrevious = _mm512_set1_pd(xPreviousPoint);
+        const __m512d yPrevious = _mm512_set1_pd(yPreviousPoint);
+        const __m512i absMask = _mm512_set1_epi64(0x7FFFFFFFFFFFFFFFLL);
+        const __m512i indexStep = _mm512_set1_epi64(8);
+
+        __m512d laneMaxAreas = _mm512_set1_pd(-1.0);
+        __m512i laneIndices = _mm512_set1_epi64(-1);
+        __m512i indices = _mm512_set_epi64(7,6,5,4,3,2,1,0);
+
+        for(; i + 8 <= bucketSize; i += 8)
+        {
+            __m512d area = _mm512_add_pd(_mm512_mul_pd(va,_mm512_sub_pd(_mm512_loadu_pd(ySrcBucketBegin + i),yPrevious)),
+                                         _mm512_mul_pd(vb,_mm512_sub_pd(_mm512_loadu_pd(xSrcBucketBegin + i),xPrevious)));
+            area = _mm512_castsi512_pd(_mm512_and_si512(_mm512_castpd_si512(area),absMask));
+
+            __mmask8 isBigger = _mm512_cmp_pd_mask(area,laneMaxAreas,_CMP_GT_OQ);
+
+            laneMaxAreas = _mm512_mask_blend_pd(isBigger,laneMaxAreas,area);
+            laneIndices = _mm512_mask_blend_epi64(isBigger,laneIndices,indices);
+
+            indices = _mm512_add_epi64(indices,indexStep);
+        }
+
+        alignas(64) double areas[8];
+        alignas(64) std::int64_t lanes[8];
+        _mm512_store_pd(areas,laneMaxAreas);
+        _mm512_store_si512(reinterpret_cast<__m512i*>(lanes),laneIndices);
+
+        reduceLargestTriangleLanes(areas,lanes,8,maxTriangleArea,largestTriangleIndex);
+    }
+
+#elif defined(__AVX2__)
+
+    if(bucketSize >= 4)
+    {
+        const __m256d va = _mm256_set1_pd(a);
+        const __m256d vb = _mm256_set1_pd(b);
+        const __m256d xPrevious = _mm256_set1_pd(xPreviousPoint);
+        const __m256d yPrevious = _mm256_set1_pd(yPreviousPoint);
+        const __m256d signMask = _mm256_set1_pd(-0.0);
+        const __m256i indexStep = _mm256_set1_epi64x(4);
+
+        __m256d laneMaxAreas = _mm256_set1_pd(-1.0);
+        __m256i laneIndices = _mm256_set1_epi64x(-1);
+        __m256i indices = _mm256_set_epi64x(3,2,1,0);
+
+        for(; i + 4 <= bucketSize; i += 4)
+        {
+            __m256d area = _mm256_add_pd(_mm256_mul_pd(va,_mm256_sub_pd(_mm256_loadu_pd(ySrcBucketBegin + i),yPrevious)),
+                                         _mm256_mul_pd(vb,_mm256_sub_pd(_mm256_loadu_pd(xSrcBucketBegin + i),xPrevious)));
+            area = _mm256_andnot_pd(signMask,area);
+
+            __m256d isBigger = _mm256_cmp_pd(area,laneMaxAreas,_CMP_GT_OQ);
+
+            laneMaxAreas = _mm256_blendv_pd(laneMaxAreas,area,isBigger);
+            laneIndices = _mm256_castpd_si256(_mm256_blendv_pd(_mm256_castsi256_pd(laneIndices),
+                                                               _mm256_castsi256_pd(indices),
+                                                               isBigger));
+
+            indices = _mm256_add_epi64(indices,indexStep);
+        }
+
+        alignas(32) double areas[4];
+        alignas(32) std::int64_t lanes[4];
+        _mm256_store_pd(areas,laneMaxAreas);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes),laneIndices);
+
+        reduceLargestTriangleLanes(areas,lanes,4,maxTriangleArea,largestTriangleIndex);
+    }
+
+#endif
+
+    for(; i < bucketSize; ++i)
+    {
+        double currentTriangleArea = blMathAPI::abs( a*(ySrcBucketBegin[i] - yPreviousPoint) + b*(xSrcBucketBegin[i] - xPreviousPoint) );
+
+        if(currentTriangleArea > maxTriangleArea)
+        {
+            maxTriangleArea = currentTriangleArea;
+            largestTriangleIndex = std::ptrdiff_t(i);
+        }
+    }
+
+    return (largestTriangleIndex < 0) ? 0 : largestTriangleIndex;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+inline std::ptrdiff_t findLargestTriangleInBucket2d(const float* xSrcBucketBegin,
+                                                    const float* ySrcBucketBegin,
+                                                    const std::size_t& bucketSize,
+                                                    const float& xPreviousPoint,
+                                                    const float& yPreviousPoint,
+                                                    const float& xNextBucketAvgValue,
+                                                    const float& yNextBucketAvgValue)
+{
+    float a = xPreviousPoint - xNextBucketAvgValue;
+    float b = yNextBucketAvgValue - yPreviousPoint;
+
+    float maxTriangleArea = -1;
+
+    std::ptrdiff_t largestTriangleIndex = -1;
+
+    std::size_t i = 0;
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+
+    // 32 bit lane indices, very large
+    // buckets go through the scalar loop
+
+    if(bucketSize >= 16 && bucketSize <= std::size_t(0x7FFFFFFF))
+    {
+        alignas(64) float areas[16];
+        alignas(64) std::int32_t lanes[16];
+
+        int numberOfLanes = 0;
+
+#if defined(__AVX512F__)
+
+        const __m512 va = _mm512_set1_ps(a);
+        const __m512 vb = _mm512_set1_ps(b);
+        const __m512 xPrevious = _mm512_set1_ps(xPreviousPoint);
+        const __m512 yPrevious = _mm512_set1_ps(yPreviousPoint);
+        const __m512i absMask = _mm512_set1_epi32(0x7FFFFFFF);
+        const __m512i indexStep = _mm512_set1_epi32(16);
+
+        __m512 laneMaxAreas = _mm512_set1_ps(-1.0f);
+        __m512i laneIndices = _mm512_set1_epi32(-1);
+        __m512i indices = _mm512_set_epi32(15,14,13,12,11,10,9,8,7,6,5,4,3,2,1,0);
+
+        for(; i + 16 <= bucketSize; i += 16)
+        {
+            __m512 area = _mm512_add_ps(_mm512_mul_ps(va,_mm512_sub_ps(_mm512_loadu_ps(ySrcBucketBegin + i),yPrevious)),
+                                        _mm512_mul_ps(vb,_mm512_sub_ps(_mm512_loadu_ps(xSrcBucketBegin + i),xPrevious)));
+            area = _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(area),absMask));
+
+            __mmask16 isBigger = _mm512_cmp_ps_mask(area,laneMaxAreas,_CMP_GT_OQ);
+
+            laneMaxAreas = _mm512_mask_blend_ps(isBigger,laneMaxAreas,area);
+            laneIndices = _mm512_mask_blend_epi32(isBigger,laneIndices,indices);
+
+            indices = _mm512_add_epi32(indices,indexStep);
+        }
+
+        _mm512_store_ps(areas,laneMaxAreas);
+        _mm512_store_si512(reinterpret_cast<__m512i*>(lanes),laneIndices);
+
+        numberOfLanes = 16;
+
+#else
+
+        const __m256 va = _mm256_set1_ps(a);
+        const __m256 vb = _mm256_set1_ps(b);
+        const __m256 xPrevious = _mm256_set1_ps(xPreviousPoint);
+        const __m256 yPrevious = _mm256_set1_ps(yPreviousPoint);
+        const __m256 signMask = _mm256_set1_ps(-0.0f);
+        const __m256i indexStep = _mm256_set1_epi32(8);
+
+        __m256 laneMaxAreas = _mm256_set1_ps(-1.0f);
+        __m256i laneIndices = _mm256_set1_epi32(-1);
+        __m256i indices = _mm256_set_epi32(7,6,5,4,3,2,1,0);
+
+        for(; i + 8 <= bucketSize; i += 8)
+        {
+            __m256 area = _mm256_add_ps(_mm256_mul_ps(va,_mm256_sub_ps(_mm256_loadu_ps(ySrcBucketBegin + i),yPrevious)),
+                                        _mm256_mul_ps(vb,_mm256_sub_ps(_mm256_loadu_ps(xSrcBucketBegin + i),xPrevious)));
+            area = _mm256_andnot_ps(signMask,area);
+
+            __m256 isBigger = _mm256_cmp_ps(area,laneMaxAreas,_CMP_GT_OQ);
+
+            laneMaxAreas = _mm256_blendv_ps(laneMaxAreas,area,isBigger);
+            laneIndices = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(laneIndices),
+                                                               _mm256_castsi256_ps(indices),
+                                                               isBigger));
+
+            indices = _mm256_add_epi32(indices,indexStep);
+        }
+
+        _mm256_store_ps(areas,laneMaxAreas);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes),laneIndices);
+
+        numberOfLanes = 8;
+
+#endif
+
+        reduceLargestTriangleLanes(areas,lanes,numberOfLanes,maxTriangleArea,largestTriangleIndex);
+    }
+
+#endif
+
+    for(; i < bucketSize; ++i)
+    {
+        float currentTriangleArea = blMathAPI::abs( a*(ySrcBucketBegin[i] - yPreviousPoint) + b*(xSrcBucketBegin[i] - xPreviousPoint) );
+
+        if(currentTriangleArea > maxTriangleArea)
+        {
+            maxTriangleArea = currentTriangleArea;
+            largestTriangleIndex = std::ptrdiff_t(i);
+        }
+    }
+
+    return (largestTriangleIndex < 0) ? 0 : largestTriangleIndex;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Non-const pointers would otherwise pick the
+// generic template, so forward them explicitly
+//-------------------------------------------------------------------
+inline std::ptrdiff_t findLargestTriangleInBucket2d(double* xSrcBucketBegin,
+                                                    double* ySrcBucketBegin,
+                                                    const std::size_t& bucketSize,
+                                                    const double& xPreviousPoint,
+                                                    const double& yPreviousPoint,
+                                                    const double& xNextBucketAvgValue,
+                                                    const double& yNextBucketAvgValue)
+{
+    return findLargestTriangleInBucket2d(static_cast<const double*>(xSrcBucketBegin),
+                                         static_cast<const double*>(ySrcBucketBegin),
+                                         bucketSize,
+                                         xPreviousPoint,
+                                         yPreviousPoint,
+                                         xNextBucketAvgValue,
+                                         yNextBucketAvgValue);
+}
+
+inline std::ptrdiff_t findLargestTriangleInBucket2d(float* xSrcBucketBegin,
+                                                    float* ySrcBucketBegin,
+                                                    const std::size_t& bucketSize,
+                                                    const float& xPreviousPoint,
+                                                    const float& yPreviousPoint,
+                                                    const float& xNextBucketAvgValue,
+                                                    const float& yNextBucketAvgValue)
+{
+    return findLargestTriangleInBucket2d(static_cast<const float*>(xSrcBucketBegin),
+                                         static_cast<const float*>(ySrcBucketBegin),
+                                         bucketSize,
+                                         xPreviousPoint,
+                                         yPreviousPoint,
+                                         xNextBucketAvgValue,
+                                         yNextBucketAvgValue);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The following function downsamples unevenly sampled
+// data with the Largest-Triangle-Three-Buckets algorithm
+// using buckets of equal x range instead of an equal
+// number of samples, and the true triangle area in x/y
+//
+// The x axis must be sorted, the bucket edges are found
+// by binary search on it, and the previous point of every
+// bucket is the point picked in the bucket before it
+//
+// Empty buckets (gaps in the data) give no point, so the
+// function returns how many points it actually wrote
+//-------------------------------------------------------------------
+template<typename xSrcDataIteratorType,
+         typename ySrcDataIteratorType,
+         typename xDstDataIteratorType,
+         typename yDstDataIteratorType>
+
+inline std::size_t largestTriangleThreeBucketsIrregular(xSrcDataIteratorType xSrcDataBegin,
+                                                        ySrcDataIteratorType ySrcDataBegin,
+                                                        const std::size_t& srcDataSize,
+                                                        xDstDataIteratorType xDstDataBegin,
+                                                        yDstDataIteratorType yDstDataBegin,
+                                                        const std::size_t& dstDataSize)
+{
+    if(srcDataSize == 0 || dstDataSize == 0)
+        return 0;
+
+    if(dstDataSize >= srcDataSize || dstDataSize <= 2)
+    {
+        // Keep every point, or just the
+        // first and last ones
+
+        std::size_t numberOfPoints = (dstDataSize >= srcDataSize) ? srcDataSize : ((dstDataSize == 1 || srcDataSize == 1) ? 1 : 2);
+
+        for(std::size_t i = 0; i < numberOfPoints; ++i)
+        {
+            std::ptrdiff_t srcIndex = (numberOfPoints == 2) ? std::ptrdiff_t(i * (srcDataSize - 1)) : std::ptrdiff_t(i);
+
+            xDstDataBegin[std::ptrdiff_t(i)] = xSrcDataBegin[srcIndex];
+            yDstDataBegin[std::ptrdiff_t(i)] = ySrcDataBegin[srcIndex];
+        }
+
+        return numberOfPoints;
+    }
+
+    typedef typename std::decay<decltype(*xSrcDataBegin)>::type xValueType;
+    typedef typename std::decay<decltype(*ySrcDataBegin)>::type yValueType;
+
+    // x is binned and averaged in its own type (double
+    // for integer x) so that large offsets such as epoch
+    // timestamps keep their spacing whatever the y type,
+    // the averages and areas use the wider of the two
+
+    typedef typename std::conditional<std::is_floating_point<xValueType>::value,xValueType,double>::type xNumberType;
+    typedef typename std::common_type<xNumberType,yValueType>::type areaNumberType;
+
+    std::ptrdiff_t lastIndex = std::ptrdiff_t(srcDataSize - 1);
+
+    std::ptrdiff_t numberOfInnerBuckets = std::ptrdiff_t(dstDataSize) - 2;
+
+    // The inner points [1,lastIndex) are split into
+    // buckets of equal x range, the bucket edges are
+    // found by binary search on the sorted x axis
+
+    xNumberType xFirst = static_cast<xNumberType>(xSrcDataBegin[1]);
+    xNumberType xRange = static_cast<xNumberType>(xSrcDataBegin[lastIndex]) - xFirst;
+
+    std::vector<std::ptrdiff_t> bucketBegins(static_cast<std::size_t>(numberOfInnerBuckets) + 1);
+
+    bucketBegins.front() = 1;
+    bucketBegins.back() = lastIndex;
+
+    for(std::ptrdiff_t b = 1; b < numberOfInnerBuckets; ++b)
+    {
+        xNumberType bucketEdge = xFirst + xRange * static_cast<xNumberType>(b) / static_cast<xNumberType>(numberOfInnerBuckets);
+
+        bucketBegins[b] = std::lower_bound(xSrcDataBegin + 1,
+                                           xSrcDataBegin + lastIndex,
+                                           bucketEdge,
+                                           [](const decltype(*xSrcDataBegin)& x,const xNumberType& edge)
+                                           {
+                                               return static_cast<xNumberType>(x) < edge;
+                                           }) - xSrcDataBegin;
+    }
+
+    // The x/y average of every bucket,
+    // computed in a parallel pass
+
+    std::vector<areaNumberType> xBucketAvgValues(static_cast<std::size_t>(numberOfInnerBuckets));
+    std::vector<areaNumberType> yBucketAvgValues(static_cast<std::size_t>(numberOfInnerBuckets));
+
+    #pragma omp parallel for schedule(static)
+    for(std::ptrdiff_t b = 0; b < numberOfInnerBuckets; ++b)
+    {
+        std::ptrdiff_t bucketSize = bucketBegins[b + 1] - bucketBegins[b];
+
+        if(bucketSize <= 0)
+            continue;
+
+        // x is summed relative to the first point of
+        // the bucket, so the sum doesn't swamp the
+        // spacing of large x values
+
+        xNumberType xOrigin = static_cast<xNumberType>(xSrcDataBegin[bucketBegins[b]]);
+
+        xNumberType xSum = 0;
+        areaNumberType ySum = 0;
+
+        for(std::ptrdiff_t i = bucketBegins[b]; i < bucketBegins[b + 1]; ++i)
+        {
+            xSum += static_cast<xNumberType>(xSrcDataBegin[i]) - xOrigin;
+            ySum += static_cast<areaNumberType>(ySrcDataBegin[i]);
+        }
+
+        xBucketAvgValues[b] = static_cast<areaNumberType>(xOrigin + xSum / static_cast<xNumberType>(bucketSize));
+        yBucketAvgValues[b] = ySum / static_cast<areaNumberType>(bucketSize);
+    }
+
+    // Now pick the points bucket by bucket, the next
+    // bucket's average comes from the next non-empty
+    // bucket or the last point if there isn't one
+
+    xDstDataBegin[0] = xSrcDataBegin[0];
+    yDstDataBegin[0] = ySrcDataBegin[0];
+
+    std::size_t numberOfPoints = 1;
+
+    areaNumberType xPreviousPoint = static_cast<areaNumberType>(xSrcDataBegin[0]);
+    areaNumberType yPreviousPoint = static_cast<areaNumberType>(ySrcDataBegin[0]);
+
+    areaNumberType xNextBucketAvgValue = static_cast<areaNumberType>(xSrcDataBegin[lastIndex]);
+    areaNumberType yNextBucketAvgValue = static_cast<areaNumberType>(ySrcDataBegin[lastIndex]);
+
+    std::vector<std::ptrdiff_t> nextNonEmptyBuckets(static_cast<std::size_t>(numberOfInnerBuckets));
+
+    std::ptrdiff_t nextNonEmptyBucket = numberOfInnerBuckets;
+
+    for(std::ptrdiff_t b = numberOfInnerBuckets - 1; b >= 0; --b)
+    {
+        nextNonEmptyBuckets[b] = nextNonEmptyBucket;
+
+        if(bucketBegins[b + 1] > bucketBegins[b])
+            nextNonEmptyBucket = b;
+    }
+
+    for(std::ptrdiff_t b = 0; b < numberOfInnerBuckets; ++b)
+    {
+        std::ptrdiff_t bucketSize = bucketBegins[b + 1] - bucketBegins[b];
+
+        if(bucketSize <= 0)
+            continue;
+
+        if(nextNonEmptyBuckets[b] < numberOfInnerBuckets)
+        {
+            xNextBucketAvgValue = xBucketAvgValues[nextNonEmptyBuckets[b]];
+            yNextBucketAvgValue = yBucketAvgValues[nextNonEmptyBuckets[b]];
+        }
+        else
+        {
+            xNextBucketAvgValue = static_cast<areaNumberType>(xSrcDataBegin[lastIndex]);
+            yNextBucketAvgValue = static_cast<areaNumberType>(ySrcDataBegin[lastIndex]);
+        }
+
+        std::ptrdiff_t largestTriangleIndex = bucketBegins[b] + findLargestTriangleInBucket2d(xSrcDataBegin + bucketBegins[b],
+                                                                                              ySrcDataBegin + bucketBegins[b],
+                                                                                              std::size_t(bucketSize),
+                                                                                              xPreviousPoint,
+                                                                                              yPreviousPoint,
+                                                                                              xNextBucketAvgValue,
+                                                                                              yNextBucketAvgValue);
+
+        xPreviousPoint = static_cast<areaNumberType>(xSrcDataBegin[largestTriangleIndex]);
+        yPreviousPoint = static_cast<areaNumberType>(ySrcDataBegin[largestTriangleIndex]);
+
+        xDstDataBegin[std::ptrdiff_t(numberOfPoints)] = xSrcDataBegin[largestTriangleIndex];
+        yDstDataBegin[std::ptrdiff_t(numberOfPoints)] = ySrcDataBegin[largestTriangleIndex];
+
+        ++numberOfPoints;
+    }
+
+    xDstDataBegin[std::ptrdiff_t(numberOfPoints)] = xSrcDataBegin[lastIndex];
+    yDstDataBegin[std::ptrdiff_t(numberOfPoints)] = ySrcDataBegin[lastIndex];
+
+    ++numberOfPoints;
+
+    return numberOfPoints;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The following function finds where the min and
+// max of a chunk of samples are (the first ones if
+// they repeat), used by the min/max preselection
+//-------------------------------------------------------------------
+template<typename srcDataIteratorType>
+
+inline void findMinMaxInChunk(srcDataIteratorType srcChunkBegin,
+                              const std::size_t& chunkSize,
+                              std::size_t& minIndex,
+                              std::size_t& maxIndex)
+{
+    minIndex = 0;
+    maxIndex = 0;
+
+    auto minValue = (*srcChunkBegin);
+    auto maxValue = minValue;
+
+    for(std::size_t i = 1; i < chunkSize; ++i)
+    {
+        ++srcChunkBegin;
+
+        if((*srcChunkBegin) < minValue)
+        {
+            minValue = (*srcChunkBegin);
+            minIndex = i;
+        }
+        else if((*srcChunkBegin) > maxValue)
+        {
+            maxValue = (*srcChunkBegin);
+            maxIndex = i;
+        }
+    }
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The following function downsamples a source into
+// the destination container in two stages (MinMaxLTTB):
+//
+// 1. The inner samples are split into chunks and only
+//    the min and max of every chunk are kept, which is
+//    cheap and done in parallel, leaving about
+//    "preselectionRatio" candidates per destination point
+//
+// 2. The Largest-Triangle-Three-Buckets algorithm picks
+//    the destination points among those candidates
+//
+// The first and last samples are always candidates, and
+// with the usual ratios (4 to 8) the output looks almost
+// the same as running LTTB over every sample
+//-------------------------------------------------------------------
+template<typename srcDataIteratorType,
+         typename dstDataIteratorType>
+
+inline void minMaxLargestTriangleThreeBuckets(srcDataIteratorType srcDataBegin,
+                                              const std::size_t& srcDataSize,
+                                              dstDataIteratorType dstDataBegin,
+                                              const std::size_t& dstDataSize,
+                                              const std::size_t& preselectionRatio = 4)
+{
+    // Every chunk gives two candidates
+
+    std::size_t numberOfChunks = (preselectionRatio < 2 ? 2 : preselectionRatio) * dstDataSize / 2;
+
+    if(dstDataSize <= 2 || srcDataSize <= 2 + 4 * numberOfChunks)
+    {
+        // Not enough samples for the
+        // preselection to pay off
+
+        largestTriangleThreeBuckets(srcDataBegin,srcDataSize,dstDataBegin,dstDataSize);
+
+        return;
+    }
+
+    typedef typename std::decay<decltype(*srcDataBegin)>::type valueType;
+
+    std::size_t numberOfInnerSamples = srcDataSize - 2;
+
+    std::vector<valueType> candidates(2 * numberOfChunks + 2);
+
+    candidates.front() = srcDataBegin[0];
+    candidates.back() = srcDataBegin[std::ptrdiff_t(srcDataSize - 1)];
+
+    #pragma omp parallel for schedule(static)
+    for(std::ptrdiff_t chunk = 0; chunk < std::ptrdiff_t(numberOfChunks); ++chunk)
+    {
+        std::size_t chunkBegin = 1 + std::size_t(chunk) * numberOfInnerSamples / numberOfChunks;
+        std::size_t chunkEnd = 1 + (std::size_t(chunk) + 1) * numberOfInnerSamples / numberOfChunks;
+
+        std::size_t minIndex;
+        std::size_t maxIndex;
+
+        findMinMaxInChunk(srcDataBegin + std::ptrdiff_t(chunkBegin),chunkEnd - chunkBegin,minIndex,maxIndex);
+
+        // Keep the two candidates in
+        // the order they come in
+
+        std::size_t firstIndex = (minIndex < maxIndex) ? minIndex : maxIndex;
+        std::size_t secondIndex = (minIndex < maxIndex) ? maxIndex : minIndex;
+
+        candidates[1 + 2 * chunk] = srcDataBegin[std::ptrdiff_t(chunkBegin + firstIndex)];
+        candidates[2 + 2 * chunk] = srcDataBegin[std::ptrdiff_t(chunkBegin + secondIndex)];
+    }
+
+    largestTriangleThreeBuckets(candidates.data(),candidates.size(),dstDataBegin,dstDataSize);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The x/y version of the two stage
+// downsampling above, the x points of
+// the candidates are carried along
+//-------------------------------------------------------------------
+template<typename xSrcDataIteratorType,
+         typename ySrcDataIteratorType,
+         typename xDstDataIteratorType,
+         typename yDstDataIteratorType>
+
+inline void minMaxLargestTriangleThreeBuckets(xSrcDataIteratorType xSrcDataBegin,
+                                              ySrcDataIteratorType ySrcDataBegin,
+                                              const std::size_t& srcDataSize,
+                                              xDstDataIteratorType xDstDataBegin,
+                                              yDstDataIteratorType yDstDataBegin,
+                                              const std::size_t& dstDataSize,
+                                              const std::size_t& preselectionRatio = 4)
+{
+    std::size_t numberOfChunks = (preselectionRatio < 2 ? 2 : preselectionRatio) * dstDataSize / 2;
+
+    if(dstDataSize <= 2 || srcDataSize <= 2 + 4 * numberOfChunks)
+    {
+        largestTriangleThreeBuckets(xSrcDataBegin,ySrcDataBegin,srcDataSize,xDstDataBegin,yDstDataBegin,dstDataSize);
+
+        return;
+    }
+
+    typedef typename std::decay<decltype(*xSrcDataBegin)>::type xValueType;
+    typedef typename std::decay<decltype(*ySrcDataBegin)>::type yValueType;
+
+    std::size_t numberOfInnerSamples = srcDataSize - 2;
+
+    std::vector<xValueType> xCandidates(2 * numberOfChunks + 2);
+    std::vector<yValueType> yCandidates(2 * numberOfChunks + 2);
+
+    xCandidates.front() = xSrcDataBegin[0];
+    yCandidates.front() = ySrcDataBegin[0];
+
+    xCandidates.back() = xSrcDataBegin[std::ptrdiff_t(srcDataSize - 1)];
+    yCandidates.back() = ySrcDataBegin[std::ptrdiff_t(srcDataSize - 1)];
+
+    #pragma omp parallel for schedule(static)
+    for(std::ptrdiff_t chunk = 0; chunk < std::ptrdiff_t(numberOfChunks); ++chunk)
+    {
+        std::size_t chunkBegin = 1 + std::size_t(chunk) * numberOfInnerSamples / numberOfChunks;
+        std::size_t chunkEnd = 1 + (std::size_t(chunk) + 1) * numberOfInnerSamples / numberOfChunks;
+
+        std::size_t minIndex;
+        std::size_t maxIndex;
+
+        findMinMaxInChunk(ySrcDataBegin + std::ptrdiff_t(chunkBegin),chunkEnd - chunkBegin,minIndex,maxIndex);
+
+        std::ptrdiff_t firstIndex = std::ptrdiff_t(chunkBegin + ((minIndex < maxIndex) ? minIndex : maxIndex));
+        std::ptrdiff_t secondIndex = std::ptrdiff_t(chunkBegin + ((minIndex < maxIndex) ? maxIndex : minIndex));
+
+        xCandidates[1 + 2 * chunk] = xSrcDataBegin[firstIndex];
+        yCandidates[1 + 2 * chunk] = ySrcDataBegin[firstIndex];
+
+        xCandidates[2 + 2 * chunk] = xSrcDataBegin[secondIndex];
+        yCandidates[2 + 2 * chunk] = ySrcDataBegin[secondIndex];
+    }
+
+    largestTriangleThreeBuckets(xCandidates.data(),yCandidates.data(),yCandidates.size(),xDstDataBegin,yDstDataBegin,dstDataSize);
+}
+//-------------------------------------------------------------------
+
+
+
 //-------------------------------------------------------------------
 // End of the blMathAPI namespace
 }
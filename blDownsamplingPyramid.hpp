@@ -0,0 +1,618 @@
+#ifndef BL_DOWNSAMPLINGPYRAMID_HPP
+#define BL_DOWNSAMPLINGPYRAMID_HPP
+
+
+///-------------------------------------------------------------------
+///
+///
+///
+/// PURPOSE:        A precomputed level-of-detail pyramid used to
+///                 downsample any range of a large data set without
+///                 touching the raw samples again
+///
+///                 Every level splits the data into blocks of a power
+///                 of two samples and keeps the min, max, first, last
+///                 and sum of each block, each level's blocks being
+///                 twice the size of the level below
+///
+/// AUTHOR:         Vincenzo Barbato
+///                 navyenzo@gmail.com
+///
+/// NOTE:           Ranges are answered with the blocks of the level
+///                 that gives at least the requested number of points,
+///                 so the bins snap outward to that level's blocks
+///
+///                 The "first" of each bin is the sample simpleDownsample
+///                 picks when the step is a power of two (and at least
+///                 the finest block size), and the min/max envelope is
+///                 the candidate set used by min/max preselection
+///
+///                 The file format is the native in-memory layout, so
+///                 files are not portable between endiannesses or
+///                 number types
+///
+/// LISENSE:        MIT-LICENCE
+///                 http://www.opensource.org/licenses/mit-license.php
+///
+///
+///
+///-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Includes needed for this file
+//-------------------------------------------------------------------
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+#include "blMemoryMappedFile.hpp"
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// NOTE: This class is defined within the blMathAPI namespace
+//-------------------------------------------------------------------
+namespace blMathAPI
+{
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The summary of one block of samples
+//-------------------------------------------------------------------
+template<typename blNumberType>
+struct blPyramidBlock
+{
+    blNumberType                            min;
+    blNumberType                            max;
+    blNumberType                            first;
+    blNumberType                            last;
+    blNumberType                            sum;
+    std::uint64_t                           count;
+
+    blNumberType                            mean()const{return sum / static_cast<blNumberType>(count);}
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Merges two consecutive blocks
+//-------------------------------------------------------------------
+template<typename blNumberType>
+
+inline blPyramidBlock<blNumberType> mergePyramidBlocks(const blPyramidBlock<blNumberType>& leftBlock,
+                                                       const blPyramidBlock<blNumberType>& rightBlock)
+{
+    blPyramidBlock<blNumberType> mergedBlock;
+
+    mergedBlock.min = (rightBlock.min < leftBlock.min) ? rightBlock.min : leftBlock.min;
+    mergedBlock.max = (rightBlock.max > leftBlock.max) ? rightBlock.max : leftBlock.max;
+    mergedBlock.first = leftBlock.first;
+    mergedBlock.last = rightBlock.last;
+    mergedBlock.sum = leftBlock.sum + rightBlock.sum;
+    mergedBlock.count = leftBlock.count + rightBlock.count;
+
+    return mergedBlock;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+class blDownsamplingPyramid
+{
+public: // Constructors and destructors
+
+
+
+    // Default constructor
+
+    blDownsamplingPyramid();
+
+    // The pyramid may point into a
+    // mapped file so it is not copyable
+
+    blDownsamplingPyramid(const blDownsamplingPyramid<blNumberType>&) = delete;
+    blDownsamplingPyramid<blNumberType>&    operator=(const blDownsamplingPyramid<blNumberType>&) = delete;
+
+    // Destructor
+
+    ~blDownsamplingPyramid();
+
+
+
+public: // Public functions
+
+
+
+    // Builds the pyramid in one pass over the
+    // source, the finest blocks hold "finestBlockSize"
+    // samples (rounded up to a power of two)
+
+    template<typename srcDataIteratorType>
+
+    void                                    build(srcDataIteratorType srcDataBegin,
+                                                  const std::size_t& srcDataSize,
+                                                  const std::size_t& finestBlockSize = 64);
+
+    // Downsamples the range [rangeBegin,rangeEnd) into at
+    // most "dstDataSize" bins, writing one blPyramidBlock
+    // per bin and returning how many were written
+
+    template<typename dstDataIteratorType>
+
+    std::size_t                             downsample(const std::size_t& rangeBegin,
+                                                       const std::size_t& rangeEnd,
+                                                       const std::size_t& dstDataSize,
+                                                       dstDataIteratorType dstDataBegin)const;
+
+    // Saves the pyramid to a file, and opens a
+    // saved pyramid by memory mapping the file
+    // so its blocks are read straight from it
+
+    bool                                    save(const std::string& filename)const;
+    bool                                    openMemoryMapped(const std::string& filename);
+
+    // Empties the pyramid
+
+    void                                    clear();
+
+    // Functions used to
+    // get the pyramid info
+
+    const std::size_t&                      getNumberOfSamples()const;
+    std::size_t                             getNumberOfLevels()const;
+    std::size_t                             getBlockSize(const std::size_t& level)const;
+    std::size_t                             getNumberOfBlocks(const std::size_t& level)const;
+
+    const blPyramidBlock<blNumberType>&     getBlock(const std::size_t& level,
+                                                     const std::size_t& blockIndex)const;
+
+
+
+private: // Private functions
+
+
+
+    // Calculates where every level
+    // starts in the blocks array
+
+    std::size_t                             setupLevels(const std::size_t& numberOfSamples,
+                                                        const std::size_t& finestBlockSizeLog2);
+
+
+
+private: // Private variables
+
+
+
+    // Number of samples summarized
+
+    std::size_t                             m_numberOfSamples;
+
+    // The finest blocks hold 2^m_finestBlockSizeLog2 samples
+
+    std::size_t                             m_finestBlockSizeLog2;
+
+    // Where every level starts in the blocks
+    // array and how many blocks it has
+
+    std::vector<std::size_t>                m_levelOffsets;
+    std::vector<std::size_t>                m_levelSizes;
+
+    // The blocks of all levels one after the
+    // other, either owned or in a mapped file
+
+    std::vector< blPyramidBlock<blNumberType> > m_ownedBlocks;
+    blMemoryMappedFile                      m_mappedFile;
+
+    const blPyramidBlock<blNumberType>*     m_blocks;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Header of a saved pyramid, the
+// blocks start right after it
+//-------------------------------------------------------------------
+struct blDownsamplingPyramidFileHeader
+{
+    char                                    magic[8];
+    std::uint32_t                           numberSize;
+    std::uint32_t                           blockSize;
+    std::uint64_t                           numberOfSamples;
+    std::uint64_t                           finestBlockSizeLog2;
+    std::uint64_t                           numberOfBlocks;
+    char                                    padding[24];
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blDownsamplingPyramid<blNumberType>::blDownsamplingPyramid()
+{
+    m_numberOfSamples = 0;
+    m_finestBlockSizeLog2 = 0;
+    m_blocks = nullptr;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blDownsamplingPyramid<blNumberType>::~blDownsamplingPyramid()
+{
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blDownsamplingPyramid<blNumberType>::clear()
+{
+    m_numberOfSamples = 0;
+    m_finestBlockSizeLog2 = 0;
+
+    m_levelOffsets.clear();
+    m_levelSizes.clear();
+
+    m_ownedBlocks.clear();
+    m_mappedFile.close();
+
+    m_blocks = nullptr;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline std::size_t blDownsamplingPyramid<blNumberType>::setupLevels(const std::size_t& numberOfSamples,
+                                                                    const std::size_t& finestBlockSizeLog2)
+{
+    m_numberOfSamples = numberOfSamples;
+    m_finestBlockSizeLog2 = finestBlockSizeLog2;
+
+    m_levelOffsets.clear();
+    m_levelSizes.clear();
+
+    std::size_t numberOfBlocks = 0;
+
+    if(numberOfSamples == 0)
+        return numberOfBlocks;
+
+    // Levels keep halving until one
+    // block covers all the samples
+
+    std::size_t blockSizeLog2 = finestBlockSizeLog2;
+
+    while(true)
+    {
+        std::size_t levelSize = ((numberOfSamples - 1) >> blockSizeLog2) + 1;
+
+        m_levelOffsets.push_back(numberOfBlocks);
+        m_levelSizes.push_back(levelSize);
+
+        numberOfBlocks += levelSize;
+
+        // The block size of the next level
+        // has to fit in a std::size_t
+
+        if(levelSize == 1 || blockSizeLog2 + 1 >= std::size_t(std::numeric_limits<std::size_t>::digits))
+            break;
+
+        ++blockSizeLog2;
+    }
+
+    return numberOfBlocks;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename srcDataIteratorType>
+
+inline void blDownsamplingPyramid<blNumberType>::build(srcDataIteratorType srcDataBegin,
+                                                       const std::size_t& srcDataSize,
+                                                       const std::size_t& finestBlockSize)
+{
+    clear();
+
+    std::size_t finestBlockSizeLog2 = 0;
+
+    while((std::size_t(1) << finestBlockSizeLog2) < finestBlockSize)
+        ++finestBlockSizeLog2;
+
+    m_ownedBlocks.resize(setupLevels(srcDataSize,finestBlockSizeLog2));
+
+    if(srcDataSize == 0)
+        return;
+
+    // The finest level, in one
+    // pass over the source
+
+    std::size_t finestBlockSizeRounded = std::size_t(1) << finestBlockSizeLog2;
+
+    for(std::size_t b = 0; b < m_levelSizes[0]; ++b)
+    {
+        std::size_t numberOfSamplesInBlock = finestBlockSizeRounded;
+
+        if(b == m_levelSizes[0] - 1)
+            numberOfSamplesInBlock = srcDataSize - b * finestBlockSizeRounded;
+
+        blPyramidBlock<blNumberType>& block = m_ownedBlocks[b];
+
+        block.min = (*srcDataBegin);
+        block.max = block.min;
+        block.first = block.min;
+        block.sum = 0;
+        block.count = numberOfSamplesInBlock;
+
+        for(std::size_t i = 0; i < numberOfSamplesInBlock; ++i)
+        {
+            blNumberType sample = (*srcDataBegin);
+
+            if(sample < block.min)
+                block.min = sample;
+            if(sample > block.max)
+                block.max = sample;
+
+            block.sum += sample;
+            block.last = sample;
+
+            ++srcDataBegin;
+        }
+    }
+
+    // Every other level merges pairs
+    // of blocks from the level below
+
+    for(std::size_t level = 1; level < m_levelSizes.size(); ++level)
+    {
+        const blPyramidBlock<blNumberType>* lowerBlocks = &m_ownedBlocks[m_levelOffsets[level - 1]];
+        blPyramidBlock<blNumberType>* blocks = &m_ownedBlocks[m_levelOffsets[level]];
+
+        std::ptrdiff_t levelSize = std::ptrdiff_t(m_levelSizes[level]);
+        std::ptrdiff_t lowerLevelSize = std::ptrdiff_t(m_levelSizes[level - 1]);
+
+        #pragma omp parallel for schedule(static)
+        for(std::ptrdiff_t b = 0; b < levelSize; ++b)
+        {
+            if(2 * b + 1 < lowerLevelSize)
+                blocks[b] = mergePyramidBlocks(lowerBlocks[2 * b],lowerBlocks[2 * b + 1]);
+            else
+                blocks[b] = lowerBlocks[2 * b];
+        }
+    }
+
+    m_blocks = m_ownedBlocks.data();
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename dstDataIteratorType>
+
+inline std::size_t blDownsamplingPyramid<blNumberType>::downsample(const std::size_t& rangeBegin,
+                                                                   const std::size_t& rangeEnd,
+                                                                   const std::size_t& dstDataSize,
+                                                                   dstDataIteratorType dstDataBegin)const
+{
+    std::size_t end = (rangeEnd < m_numberOfSamples) ? rangeEnd : m_numberOfSamples;
+
+    if(rangeBegin >= end || dstDataSize == 0)
+        return 0;
+
+    std::size_t rangeSize = end - rangeBegin;
+
+    // Pick the coarsest level whose blocks
+    // still give at least dstDataSize bins
+
+    std::size_t level = m_levelSizes.size() - 1;
+
+    while(level > 0 && (getBlockSize(level) > rangeSize / dstDataSize))
+        --level;
+
+    std::size_t blockSizeLog2 = m_finestBlockSizeLog2 + level;
+
+    std::size_t firstBlock = rangeBegin >> blockSizeLog2;
+    std::size_t lastBlock = (end - 1) >> blockSizeLog2;
+
+    std::size_t numberOfBlocks = lastBlock - firstBlock + 1;
+
+    std::size_t numberOfBins = (dstDataSize < numberOfBlocks) ? dstDataSize : numberOfBlocks;
+
+    const blPyramidBlock<blNumberType>* blocks = m_blocks + m_levelOffsets[level] + firstBlock;
+
+    // Every bin merges the blocks that fall
+    // inside of it, up to three since the
+    // range isn't aligned to the blocks
+
+    for(std::size_t bin = 0; bin < numberOfBins; ++bin)
+    {
+        std::size_t binBegin = bin * numberOfBlocks / numberOfBins;
+        std::size_t binEnd = (bin + 1) * numberOfBlocks / numberOfBins;
+
+        blPyramidBlock<blNumberType> binBlock = blocks[binBegin];
+
+        for(std::size_t b = binBegin + 1; b < binEnd; ++b)
+            binBlock = mergePyramidBlocks(binBlock,blocks[b]);
+
+        (*dstDataBegin) = binBlock;
+        ++dstDataBegin;
+    }
+
+    return numberOfBins;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline bool blDownsamplingPyramid<blNumberType>::save(const std::string& filename)const
+{
+    std::ofstream file(filename.c_str(),std::ios::binary | std::ios::trunc);
+
+    if(!file)
+        return false;
+
+    std::size_t numberOfBlocks = m_levelSizes.empty() ? 0 : m_levelOffsets.back() + m_levelSizes.back();
+
+    blDownsamplingPyramidFileHeader header;
+    std::memset(&header,0,sizeof(header));
+    std::memcpy(header.magic,"blPyrmd",8);
+    header.numberSize = std::uint32_t(sizeof(blNumberType));
+    header.blockSize = std::uint32_t(sizeof(blPyramidBlock<blNumberType>));
+    header.numberOfSamples = std::uint64_t(m_numberOfSamples);
+    header.finestBlockSizeLog2 = std::uint64_t(m_finestBlockSizeLog2);
+    header.numberOfBlocks = std::uint64_t(numberOfBlocks);
+
+    file.write(reinterpret_cast<const char*>(&header),sizeof(header));
+
+    if(numberOfBlocks > 0)
+        file.write(reinterpret_cast<const char*>(m_blocks),std::streamsize(numberOfBlocks * sizeof(blPyramidBlock<blNumberType>)));
+
+    return bool(file);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline bool blDownsamplingPyramid<blNumberType>::openMemoryMapped(const std::string& filename)
+{
+    clear();
+
+    if(!m_mappedFile.open(filename))
+        return false;
+
+    // Check that the file holds a pyramid
+    // of this number type and that it is
+    // as long as the header says
+
+    blDownsamplingPyramidFileHeader header;
+
+    if(m_mappedFile.size() < sizeof(header))
+    {
+        clear();
+        return false;
+    }
+
+    std::memcpy(&header,m_mappedFile.data(),sizeof(header));
+
+    if(std::memcmp(header.magic,"blPyrmd",8) != 0 ||
+       header.numberSize != sizeof(blNumberType) ||
+       header.blockSize != sizeof(blPyramidBlock<blNumberType>))
+    {
+        clear();
+        return false;
+    }
+
+    // The block size is used as a shift count and
+    // the number of blocks is bounded by division
+    // so that a corrupt header can't overflow
+
+    std::size_t maxNumberOfBlocks = (m_mappedFile.size() - sizeof(header)) / sizeof(blPyramidBlock<blNumberType>);
+
+    if(header.finestBlockSizeLog2 >= std::uint64_t(std::numeric_limits<std::size_t>::digits) ||
+       header.numberOfSamples > std::uint64_t(std::numeric_limits<std::size_t>::max()) ||
+       header.numberOfBlocks > std::uint64_t(maxNumberOfBlocks))
+    {
+        clear();
+        return false;
+    }
+
+    std::size_t numberOfBlocks = setupLevels(std::size_t(header.numberOfSamples),std::size_t(header.finestBlockSizeLog2));
+
+    if(numberOfBlocks != std::size_t(header.numberOfBlocks))
+    {
+        clear();
+        return false;
+    }
+
+    m_blocks = reinterpret_cast<const blPyramidBlock<blNumberType>*>(m_mappedFile.data() + sizeof(header));
+
+    return true;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const std::size_t& blDownsamplingPyramid<blNumberType>::getNumberOfSamples()const
+{
+    return m_numberOfSamples;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline std::size_t blDownsamplingPyramid<blNumberType>::getNumberOfLevels()const
+{
+    return m_levelSizes.size();
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline std::size_t blDownsamplingPyramid<blNumberType>::getBlockSize(const std::size_t& level)const
+{
+    return std::size_t(1) << (m_finestBlockSizeLog2 + level);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline std::size_t blDownsamplingPyramid<blNumberType>::getNumberOfBlocks(const std::size_t& level)const
+{
+    return m_levelSizes[level];
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const blPyramidBlock<blNumberType>& blDownsamplingPyramid<blNumberType>::getBlock(const std::size_t& level,
+                                                                                       const std::size_t& blockIndex)const
+{
+    return m_blocks[m_levelOffsets[level] + blockIndex];
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// End of the blMathAPI namespace
+}
+//-------------------------------------------------------------------
+
+
+
+#endif // BL_DOWNSAMPLINGPYRAMID_HPP
@@ -50,6 +50,30 @@
 
 
 
+// A streaming version of the
+// Largest-Triangle-Three-Buckets
+// downsampling for live data
+
+#include "blStreamingLTTB.hpp"
+
+
+
+// A precomputed min/max level-of-detail
+// pyramid to downsample any range of a
+// large data set, and the memory mapped
+// file it can be saved to and opened from
+
+#include "blMemoryMappedFile.hpp"
+#include "blDownsamplingPyramid.hpp"
+
+// A memory mapped array of numbers that
+// can be downsampled in place, scanning
+// the file in bounded memory windows
+
+#include "blMemoryMappedArray.hpp"
+
+
+
 // Functions used to convert
 // strings to numbers or viceversa
 
@@ -123,6 +147,14 @@
 // differential equations
 
 #include "blRungaKutta.hpp"
+#include "blRungaKuttaEnsemble.hpp"
+#include "blRungaKuttaSteppers.hpp"
+#include "blRungaKuttaFixedSize.hpp"
+#include "blRungaKuttaParareal.hpp"
+#include "blRungaKuttaEvents.hpp"
+#include "blRungaKuttaSinks.hpp"
+#include "blRungaKuttaSensitivities.hpp"
+#include "blStiffSolvers.hpp"
 
 //-------------------------------------------------------------------
 
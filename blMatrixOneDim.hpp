@@ -183,6 +183,283 @@ private: // Private functions
 //---------------------------------------------------------------------------------------
 
 
+//---------------------------------------------------------------------------------------
+// CLASS:			vbScalarTraits<vbType>
+// PURPOSE:			Real/complex split for the scalar type, so that the algorithms can
+//					conjugate, take magnitudes and pick Householder phases without
+//					promoting real matrices to complex
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+class vbScalarTraits
+{
+public: // Public variables
+
+	typedef vbType							RealType;
+
+	static const bool						IsComplex = false;
+
+public: // Public functions
+
+	// Used to get the complex conjugate (a no-op for real numbers)
+	static vbType							Conj(const vbType& x){return x;}
+
+	// Used to get |x|^2 without taking a square root
+	static RealType							AbsSquared(const vbType& x){return x*x;}
+
+	// Used to get x/|x|, or 1 when x is zero
+	static vbType							Phase(const vbType& x){return (x < vbType(0)) ? vbType(-1) : vbType(1);}
+};
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+class vbScalarTraits< complex<vbType> >
+{
+public: // Public variables
+
+	typedef vbType							RealType;
+
+	static const bool						IsComplex = true;
+
+public: // Public functions
+
+	static complex<vbType>					Conj(const complex<vbType>& x){return std::conj(x);}
+
+	static RealType							AbsSquared(const complex<vbType>& x){return x.real()*x.real() + x.imag()*x.imag();}
+
+	static complex<vbType>					Phase(const complex<vbType>& x)
+	{
+		vbType Mag = std::abs(x);
+		return (Mag == vbType(0)) ? complex<vbType>(1) : x/Mag;
+	}
+};
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+// CLASS:			vbNumericsPolicy<vbType>
+// PURPOSE:			Defines what "zero" and "converged" mean for the vbMatrix algorithms,
+//					scaling a relative tolerance by the matrix size, its norm and the
+//					machine epsilon instead of using hard-coded thresholds
+// NOTE:			Tolerances are magnitudes, so they are kept in the real type even
+//					for complex matrices
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+class vbNumericsPolicy
+{
+public: // Public variables
+
+	typedef typename vbScalarTraits<vbType>::RealType RealType;
+
+public: // Default constructors and destructors
+
+	// Default constructor (a ToleranceFactor of 10 reproduces the old DefineZero,
+	// a MaxConditionNumber of 0 means inv only rejects exactly singular matrices)
+	explicit vbNumericsPolicy(const RealType& ToleranceFactor = RealType(10),
+							  const int& MaxNumOfIterations = 100,
+							  const RealType& AbsoluteZero = RealType(0),
+							  const RealType& MaxConditionNumber = RealType(0));
+
+	// Default destructor
+	~vbNumericsPolicy(void);
+
+public: // Public functions
+
+	// Used to define a zero for the matrix A:
+	// Zero = max(AbsoluteZero,ToleranceFactor * max(m,n) * eps * ||A||)
+	RealType								GetZero(const vbMatrix<vbType>& A)const;
+
+	// Used to define the pivot under which a triangular factor of A is
+	// singular to working precision (the round-off level of A):
+	// PivotZero = max(AbsoluteZero,eps * ||A||), looser than GetZero
+	// which is meant for rank decisions
+	RealType								GetPivotZero(const vbMatrix<vbType>& A)const;
+
+	// Used to get the tolerance under which an iterative
+	// algorithm working on an n-dimensional problem is done
+	RealType								GetConvergenceTolerance(const int& n)const;
+
+	// Used by iterative algorithms to know when to stop, either
+	// because the error is under tolerance or because the error
+	// stopped decreasing once it got to round-off level
+	bool									HasConverged(const RealType& Error,
+														 const RealType& PreviousError,
+														 const int& n,
+														 const int& NumOfIterations)const;
+
+	// Used to know if an estimated condition number is too large for
+	// an inverse to be trusted (never, when MaxConditionNumber is 0)
+	bool									IsIllConditioned(const RealType& ConditionNumber)const;
+
+	const RealType&							GetToleranceFactor()const;
+	const int&								GetMaxNumOfIterations()const;
+	const RealType&							GetAbsoluteZero()const;
+	const RealType&							GetMaxConditionNumber()const;
+
+private: // Private variables
+
+	// Relative tolerance, in multiples of the machine epsilon
+	RealType								m_ToleranceFactor;
+
+	// Hard stop for iterative algorithms
+	int										m_MaxNumOfIterations;
+
+	// Floor for the zero threshold (used to honor explicitly passed zeroes)
+	RealType								m_AbsoluteZero;
+
+	// Largest condition number inv accepts (0 to skip the check)
+	RealType								m_MaxConditionNumber;
+};
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbNumericsPolicy<vbType>::vbNumericsPolicy(const RealType& ToleranceFactor,
+												  const int& MaxNumOfIterations,
+												  const RealType& AbsoluteZero,
+												  const RealType& MaxConditionNumber)
+{
+	m_ToleranceFactor = ToleranceFactor;
+	m_MaxNumOfIterations = MaxNumOfIterations;
+	m_AbsoluteZero = AbsoluteZero;
+	m_MaxConditionNumber = MaxConditionNumber;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbNumericsPolicy<vbType>::~vbNumericsPolicy(void)
+{
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline typename vbNumericsPolicy<vbType>::RealType vbNumericsPolicy<vbType>::GetZero(const vbMatrix<vbType>& A)const
+{
+	int m = A.GetNumOfRows();
+	int n = A.GetNumOfCols();
+
+	// Tall matrices are scaled by the max column sum,
+	// wide matrices by the max row sum
+	RealType Zero;
+	if(m >= n)
+		Zero = numeric_limits<RealType>::epsilon() * RealType(m) * m_ToleranceFactor * std::abs(Norm1(A));
+	else
+		Zero = numeric_limits<RealType>::epsilon() * RealType(n) * m_ToleranceFactor * std::abs(NormInf(A));
+
+	if(Zero < m_AbsoluteZero)
+		return m_AbsoluteZero;
+
+	return Zero;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline typename vbNumericsPolicy<vbType>::RealType vbNumericsPolicy<vbType>::GetPivotZero(const vbMatrix<vbType>& A)const
+{
+	RealType PivotZero = numeric_limits<RealType>::epsilon() * std::abs(Norm1(A));
+
+	if(PivotZero < m_AbsoluteZero)
+		return m_AbsoluteZero;
+
+	return PivotZero;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline typename vbNumericsPolicy<vbType>::RealType vbNumericsPolicy<vbType>::GetConvergenceTolerance(const int& n)const
+{
+	RealType Tolerance = numeric_limits<RealType>::epsilon() * RealType(n > 0 ? n : 1) * m_ToleranceFactor;
+
+	if(Tolerance < m_AbsoluteZero)
+		return m_AbsoluteZero;
+
+	return Tolerance;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline bool vbNumericsPolicy<vbType>::HasConverged(const RealType& Error,
+												   const RealType& PreviousError,
+												   const int& n,
+												   const int& NumOfIterations)const
+{
+	if(NumOfIterations >= m_MaxNumOfIterations)
+		return true;
+
+	RealType Tolerance = GetConvergenceTolerance(n);
+
+	if(std::abs(Error) <= Tolerance)
+		return true;
+
+	// Once we are within sqrt(Tolerance) a convergent iteration should
+	// keep shrinking the error, if it doesn't we're at round-off level
+	// and any further iteration is wasted work
+	if(std::abs(Error) <= std::sqrt(Tolerance) && std::abs(Error) >= std::abs(PreviousError))
+		return true;
+
+	return false;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline bool vbNumericsPolicy<vbType>::IsIllConditioned(const RealType& ConditionNumber)const
+{
+	// A NaN estimate counts as ill-conditioned too
+	return (m_MaxConditionNumber > RealType(0) && !(ConditionNumber <= m_MaxConditionNumber));
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline const typename vbNumericsPolicy<vbType>::RealType& vbNumericsPolicy<vbType>::GetToleranceFactor()const
+{
+	return m_ToleranceFactor;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline const int& vbNumericsPolicy<vbType>::GetMaxNumOfIterations()const
+{
+	return m_MaxNumOfIterations;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline const typename vbNumericsPolicy<vbType>::RealType& vbNumericsPolicy<vbType>::GetAbsoluteZero()const
+{
+	return m_AbsoluteZero;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline const typename vbNumericsPolicy<vbType>::RealType& vbNumericsPolicy<vbType>::GetMaxConditionNumber()const
+{
+	return m_MaxConditionNumber;
+}
+//---------------------------------------------------------------------------------------
+
+
 //---------------------------------------------------------------------------------------
 template<typename vbType>
 inline vbMatrix<vbType>::~vbMatrix(void)
@@ -410,11 +687,8 @@ inline void vbMatrix<vbType>::MakeSquare()
 template<typename vbType>
 inline vbType vbMatrix<vbType>::DefineZero()
 {
-	// Define what it means to be zero
-	if(m_NumOfRows >= m_NumOfCols)
-		return (numeric_limits<vbType>::epsilon() * m_NumOfRows * vbType(10) * Norm1(*this));
-	else
-		return (numeric_limits<vbType>::epsilon() * m_NumOfCols * vbType(10) * NormInf(*this));
+	// Define what it means to be zero using the default numerics policy
+	return vbNumericsPolicy<vbType>().GetZero(*this);
 }
 //---------------------------------------------------------------------------------------
 
@@ -428,7 +702,7 @@ static inline vbMatrix<vbType> vbMatrix<vbType>::CreateUnitRowVector(const int&
 	if(WhichComponentToMakeUnity < 0 || WhichComponentToMakeUnity >= NumOfCols)
 		return CreateUnitRowVector<vbType>(NumOfCols,0);
 
-	vbMatrix<vbType> Matrix(1,NumOfCols,0);
+	vbMatrix<vbType> Matrix(1,NumOfCols,vbType(0));
 	Matrix(0,WhichComponentToMakeUnity) = vbType(1);
 
 	return Matrix;
@@ -445,7 +719,7 @@ static inline vbMatrix<vbType> vbMatrix<vbType>::CreateUnitColVector(const int&
 	if(WhichComponentToMakeUnity < 0 || WhichComponentToMakeUnity >= NumOfRows)
 		return CreateUnitColVector<vbType>(NumOfRows,0);
 
-	vbMatrix<vbType> Matrix(NumOfRows,1,0);
+	vbMatrix<vbType> Matrix(NumOfRows,1,vbType(0));
 	Matrix(WhichComponentToMakeUnity,0) = vbType(1);
 
 	return Matrix;
@@ -464,7 +738,7 @@ inline const vbMatrix<vbType> vbMatrix<vbType>::GetRowVector(const int& i)const
 	}
 	else
 	{
-		vbMatrix<vbType> RowVector(1,m_NumOfCols,0);
+		vbMatrix<vbType> RowVector(1,m_NumOfCols,vbType(0));
 		for(int j = 0; j < m_NumOfCols; ++j)
 			RowVector(0,j) = (*this)(i,j);
 
@@ -485,7 +759,7 @@ inline const vbMatrix<vbType> vbMatrix<vbType>::GetColVector(const int& i)const
 	}
 	else
 	{
-		vbMatrix<vbType> ColVector(m_NumOfRows,1,0);
+		vbMatrix<vbType> ColVector(m_NumOfRows,1,vbType(0));
 		for(int j = 0; j < m_NumOfRows; ++j)
 			ColVector(j,0) = (*this)(j,i);
 			
@@ -500,18 +774,18 @@ template<typename vbType>
 inline vbType vbMatrix<vbType>::GetRowVectorMagnitude(const int& WhichRow)
 {
 	// Check index validity
-	if(i < 0 || i >= m_NumOfRows)
+	if(WhichRow < 0 || WhichRow >= m_NumOfRows)
 	{
 		GlobalErrorLog += "\nTried to calculate the magnitude of a row vector using the wrong index";
 		return vbType(0);
 	}
 
-	vbType Mag = 0;
+	typename vbScalarTraits<vbType>::RealType Mag = 0;
 
 	for(int j = 0; j < m_NumOfCols; ++j)
-		Mag += ((*this)(WhichRow,j) * (*this)(WhichRow,j));
+		Mag += vbScalarTraits<vbType>::AbsSquared((*this)(WhichRow,j));
 
-	return std::sqrt(Mag);
+	return vbType(std::sqrt(Mag));
 }
 //---------------------------------------------------------------------------------------
 
@@ -521,18 +795,18 @@ template<typename vbType>
 inline vbType vbMatrix<vbType>::GetColVectorMagnitude(const int& WhichColumn)
 {
 	// Check index validity
-	if(i < 0 || i >= m_NumOfCols)
+	if(WhichColumn < 0 || WhichColumn >= m_NumOfCols)
 	{
 		GlobalErrorLog += "\nTried to calculate the magnitude of a col vector with out of bounds index";
 		return vbType(0);
 	}
 
-	vbType Mag = 0;
+	typename vbScalarTraits<vbType>::RealType Mag = 0;
 
 	for(int j = 0; j < m_NumOfRows; ++j)
-		Mag += ((*this)(j,WhichColumn) * (*this)(j,WhichColumn));
+		Mag += vbScalarTraits<vbType>::AbsSquared((*this)(j,WhichColumn));
 
-	return std::sqrt(Mag);
+	return vbType(std::sqrt(Mag));
 }
 //---------------------------------------------------------------------------------------
 
@@ -556,7 +830,7 @@ inline vbMatrix<vbType> vbMatrix<vbType>::GetNonZeroColVectors(const vbType& Zer
 	}
 
 	// Prepare the NonZeroColVectors matrix
-	vbMatrix<vbType> NonZeroColVectors(0,0,0);
+	vbMatrix<vbType> NonZeroColVectors(0,0,vbType(0));
 
 	// Index used to keep track of non zero vectors
 	int Index;
@@ -626,7 +900,7 @@ inline void vbMatrix<vbType>::GetMatrixBlock(const int& i1,
 		std::swap(j1,j2);
 
 	// Initialize the matrix
-	M = vbMatrix<vbType>(i2-i1+1,j2-j1+1,0);
+	M = vbMatrix<vbType>(i2-i1+1,j2-j1+1,vbType(0));
 
 	for(int i = i1; i <= i2; ++i)
 		for(int j = j1; j <= j2; ++j)
@@ -657,7 +931,7 @@ inline vbMatrix<vbType> vbMatrix<vbType>::GetMatrixBlock(const int& i1,
 		std::swap(j1,j2);
 
 	// Initialize the matrix
-	vbMatrix<vbType> M = vbMatrix<vbType>(i2-i1+1,j2-j1+1,0);
+	vbMatrix<vbType> M = vbMatrix<vbType>(i2-i1+1,j2-j1+1,vbType(0));
 
 	for(int i = i1; i <= i2; ++i)
 		for(int j = j1; j <= j2; ++j)
@@ -1043,6 +1317,53 @@ inline vbMatrix<vbType> operator /(const vbType& x,const vbMatrix<vbType>& M)
 //---------------------------------------------------------------------------------------
 
 
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline void MultiplyRow(const vbType* ARow,const vbType* B,vbType* CRow,const int& p,const int& n)
+{
+	// CRow += ARow*B for one row of a row-major product, looping k
+	// before j so that B and CRow are walked contiguously
+	for(int k = 0; k < p; ++k)
+	{
+		vbType a = ARow[k];
+		const vbType* BRow = B + k*n;
+
+		for(int j = 0; j < n; ++j)
+			CRow[j] += a*BRow[j];
+	}
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline void MultiplyRow(const complex<vbType>* ARow,const complex<vbType>* B,complex<vbType>* CRow,const int& p,const int& n)
+{
+	// Complex version working on the interleaved (re,im) storage with
+	// plain real arithmetic, std::complex's operator* goes through the
+	// Inf/NaN recovery path and keeps the loop from vectorizing
+	const vbType* b = reinterpret_cast<const vbType*>(B);
+	vbType* c = reinterpret_cast<vbType*>(CRow);
+
+	for(int k = 0; k < p; ++k)
+	{
+		vbType ar = ARow[k].real();
+		vbType ai = ARow[k].imag();
+		const vbType* BRow = b + 2*k*n;
+
+		for(int j = 0; j < n; ++j)
+		{
+			vbType br = BRow[2*j];
+			vbType bi = BRow[2*j+1];
+
+			c[2*j] += ar*br - ai*bi;
+			c[2*j+1] += ar*bi + ai*br;
+		}
+	}
+}
+//---------------------------------------------------------------------------------------
+
+
 //---------------------------------------------------------------------------------------
 template<typename vbType>
 inline vbMatrix<vbType> operator*(const vbMatrix<vbType>& M1,const vbMatrix<vbType>& M2)
@@ -1061,15 +1382,24 @@ inline vbMatrix<vbType> operator*(const vbMatrix<vbType>& M1,const vbMatrix<vbTy
 	}
 
 	// Each component of the new matrix is:  Cij = Aik*Bkj;
-	vbMatrix<vbType> Result(M1.GetNumOfRows(),M2.GetNumOfCols(),0);
+	int m = M1.GetNumOfRows();
+	int p = M1.GetNumOfCols();
+	int n = M2.GetNumOfCols();
+
+	vbMatrix<vbType> Result(m,n,vbType(0));
+
+	if(m == 0 || n == 0 || p == 0)
+		return Result;
+
+	const vbType* A = &M1.GetMatrixArray()[0];
+	const vbType* B = &M2.GetMatrixArray()[0];
+	vbType* C = &Result.GetMatrixArray()[0];
 
 	#pragma omp parallel
 	{
 		#pragma omp for
-		for(int i = 0; i < M1.GetNumOfRows(); ++i)
-			for(int j = 0; j < M2.GetNumOfCols(); ++j)
-				for(int k = 0; k < M1.GetNumOfCols(); ++k)
-					Result(i,j) += M1(i,k)*M2(k,j);
+		for(int i = 0; i < m; ++i)
+			MultiplyRow(A + i*p,B,C + i*n,p,n);
 	}
 
 	return Result;
@@ -1333,6 +1663,26 @@ inline vbMatrix<vbType> Transpose(const vbMatrix<vbType>& M)
 //---------------------------------------------------------------------------------------
 
 
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbMatrix<vbType> ConjugateTranspose(const vbMatrix<vbType>& M)
+{
+	// Same as Transpose for real matrices, the inverse of a unitary
+	// matrix (such as the Q of a complex QR) for complex ones
+	int m = M.GetNumOfRows();
+	int n = M.GetNumOfCols();
+
+	vbMatrix<vbType> TransposedMatrix(n,m,vbType(0));
+
+	for(int i = 0; i < m; ++i)
+		for(int j = 0; j < n; ++j)
+			TransposedMatrix(j,i) = vbScalarTraits<vbType>::Conj(M(i,j));
+
+	return TransposedMatrix;
+}
+//---------------------------------------------------------------------------------------
+
+
 //---------------------------------------------------------------------------------------
 template<typename vbType>
 inline void vbMatrix<vbType>::OrthoNormalizeMatrix()
@@ -1362,7 +1712,7 @@ inline void vbMatrix<vbType>::OrthoNormalizeMatrix()
 template<typename vbType>
 inline const vbMatrix<vbType> vbMatrix<vbType>::GetOrthonormalizedMatrix()const
 {
-	vbMatrix<vbType> OrthogonalMatrix(m_NumOfRows,m_NumOfCols,0);
+	vbMatrix<vbType> OrthogonalMatrix(m_NumOfRows,m_NumOfCols,vbType(0));
 	vbMatrix<vbType> vi,vii,vj;
 
 	for(int i = 0; i < m_NumOfCols; ++i)
@@ -1393,48 +1743,77 @@ inline void QRdecomposition(const vbMatrix<vbType>& M,
 							vbMatrix<vbType>& R,
 							const vbType& Zero = 0.00000001)
 {
+	// Householder QR done in place on R, the reflector for column k
+	// being H = I - 2*v*v' with v along x - Alpha*e1, where Alpha has
+	// the phase of -x(0) so the subtraction never cancels.  Only the
+	// complex instantiation does complex arithmetic, real matrices
+	// stay real throughout
+	typedef typename vbScalarTraits<vbType>::RealType RealType;
+
 	int m = M.GetNumOfRows();
 	int n = M.GetNumOfCols();
 
 	R = M;
-	vbMatrix<vbType> x,u,v,Qk;
-	vbType xMag;
-	vbType uMag;
-	complex<vbType> a;
-	complex<vbType> j(0,1);
-	vbMatrix<vbType> II;
 	Q = eye<vbType>(m);
 
-	int NumOfIterations = min(m-1,n-1);
+	vector<vbType> v(m);
+	vector<vbType> w(m);
 
-	for(int i = 0; i < NumOfIterations; ++i)
+	int NumOfIterations = min(m-1,n);
+
+	for(int k = 0; k < NumOfIterations; ++k)
 	{
-		R = R.GetMatrixBlock(i,i,m-1,n-1);
+		// Magnitude of the part of column k on and below the diagonal
+		RealType xMag = 0;
+		for(int i = k; i < m; ++i)
+			xMag += vbScalarTraits<vbType>::AbsSquared(R(i,k));
+		xMag = std::sqrt(xMag);
 
-		x = R.GetColVector(0);
-		xMag = GetColVectorMagnitude(x,0);
-		a = -std::exp(j*x(0,0))*xMag;
+		vbType Alpha = -vbScalarTraits<vbType>::Phase(R(k,k))*vbType(xMag);
 
-		u = x - xMag*CreateUnitColVector<vbType>(R.GetNumOfRows(),0);
+		for(int i = k; i < m; ++i)
+			v[i] = R(i,k);
+		v[k] -= Alpha;
 
-		// Check if u is a zero vector
-		uMag = GetColVectorMagnitude(u,0);
-		if(EqualsZero(uMag,Zero))
-		{
-			R = Transpose(Q)*M;
-			return;
-		}
+		// Check if v is a zero vector (the column is already reduced)
+		RealType vMag = 0;
+		for(int i = k; i < m; ++i)
+			vMag += vbScalarTraits<vbType>::AbsSquared(v[i]);
+		vMag = std::sqrt(vMag);
 
-		v = u/uMag;
+		if(EqualsZero(vMag,RealType(std::abs(Zero))))
+			continue;
 
-		Qk = eye<vbType>(R.GetNumOfRows()) - vbType(2)*v*Transpose(v);
+		for(int i = k; i < m; ++i)
+			v[i] /= vMag;
 
-		II = eye<vbType>(m);
-		II.SetMatrixBlock(i,i,Qk);
+		// R = H*R, touching only the trailing block
+		for(int j = k; j < n; ++j)
+		{
+			vbType Dot = 0;
+			for(int i = k; i < m; ++i)
+				Dot += vbScalarTraits<vbType>::Conj(v[i])*R(i,j);
+			Dot *= vbType(2);
+			for(int i = k; i < m; ++i)
+				R(i,j) -= v[i]*Dot;
+		}
+
+		// Q = Q*H
+		for(int i = 0; i < m; ++i)
+		{
+			vbType Dot = 0;
+			for(int l = k; l < m; ++l)
+				Dot += Q(i,l)*v[l];
+			w[i] = vbType(2)*Dot;
+		}
 
-		Q = Q*II;
+		for(int i = 0; i < m; ++i)
+			for(int l = k; l < m; ++l)
+				Q(i,l) -= w[i]*vbScalarTraits<vbType>::Conj(v[l]);
 
-		R = Transpose(Q)*M;
+		// Exact zeroes below the diagonal
+		for(int i = k + 1; i < m; ++i)
+			R(i,k) = vbType(0);
 	}
 }
 //---------------------------------------------------------------------------------------
@@ -1442,23 +1821,31 @@ inline void QRdecomposition(const vbMatrix<vbType>& M,
 
 //---------------------------------------------------------------------------------------
 template<typename vbType>
-inline int rank(const vbMatrix<vbType>& A)
+inline void QRdecomposition(const vbMatrix<vbType>& M,
+							vbMatrix<vbType>& Q,
+							vbMatrix<vbType>& R,
+							const vbNumericsPolicy<vbType>& Policy)
 {
-	// Define a zero
-	vbType Zero = DefineZero(A);
+	// Use a zero scaled by the norm of M instead of a fixed threshold
+	QRdecomposition(M,Q,R,vbType(Policy.GetZero(M)));
+}
+//---------------------------------------------------------------------------------------
 
-	// Carry out a QR decomposition
-	vbMatrix<vbType> Q,R;
-	QRdecomposition(A,Q,R,Zero);
 
-	int NumOfIterations = min(R.GetNumOfRows(),R.GetNumOfCols());
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline int rank(const vbMatrix<vbType>& A)
+{
+	return rank(A,vbNumericsPolicy<vbType>());
+}
+//---------------------------------------------------------------------------------------
 
-	int Rank = 0;
-	for(int i = 0; i < NumOfIterations; ++i)
-		if(!EqualsZero(R(i,i),Zero))
-			++Rank;
 
-	return Rank;
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline int rank(const vbMatrix<vbType>& A,const vbNumericsPolicy<vbType>& Policy)
+{
+	return rank(A,vbType(Policy.GetZero(A)));
 }
 //---------------------------------------------------------------------------------------
 
@@ -1488,7 +1875,7 @@ template<typename vbType>
 inline int rank_triangular(const vbMatrix<vbType>& A)
 {
 	// Define a zero
-	vbType Zero = DefineZero(A);
+	vbType Zero = vbNumericsPolicy<vbType>().GetZero(A);
 
 	// Calculate the rank of a triangular matrix blindly (does not check whether
 	// the matrix is really triangular
@@ -1522,7 +1909,7 @@ inline int rank_triangular(const vbMatrix<vbType>& A,const vbType& Zero)
 
 //---------------------------------------------------------------------------------------
 template<typename vbType>
-inline complex<vbType> det(const vbMatrix<vbType>& A,const vbType& Zero)
+inline vbType det(const vbMatrix<vbType>& A,const vbType& Zero)
 {
 	// Check to make sure matrix A is square
 	int m = A.GetNumOfRows();
@@ -1542,14 +1929,39 @@ inline complex<vbType> det(const vbMatrix<vbType>& A,const vbType& Zero)
 				A(0,2)*(A(1,0)*A(2,1) - A(2,0)*A(1,1)));
 	}
 
-	vbMatrix<vbType> Q,R;
-	QRdecomposition(A,Q,R,Zero);
+	// Gaussian elimination with partial pivoting in the scalar type
+	// of A, the determinant being the product of the pivots with a
+	// sign flip for every row swap
+	vbMatrix<vbType> U = A;
+	vbType Det = 1;
+
+	for(int k = 0; k < m; ++k)
+	{
+		int Pivot = k;
+		for(int i = k + 1; i < m; ++i)
+			if(vbScalarTraits<vbType>::AbsSquared(U(i,k)) > vbScalarTraits<vbType>::AbsSquared(U(Pivot,k)))
+				Pivot = i;
+
+		if(EqualsZero(std::abs(U(Pivot,k)),std::abs(Zero)))
+			return vbType(0);
+
+		if(Pivot != k)
+		{
+			for(int j = k; j < m; ++j)
+				std::swap(U(k,j),U(Pivot,j));
+			Det = -Det;
+		}
+
+		Det *= U(k,k);
+
+		for(int i = k + 1; i < m; ++i)
+		{
+			vbType Factor = U(i,k)/U(k,k);
+			for(int j = k + 1; j < m; ++j)
+				U(i,j) -= Factor*U(k,j);
+		}
+	}
 
-	complex<vbType> Det = 1;
-	
-	for(int i = 0; i < R.GetNumOfRows(); ++i)
-		Det *= R(i,i);
-	
 	return Det;
 }
 //---------------------------------------------------------------------------------------
@@ -1565,7 +1977,7 @@ inline vbType det_triangular(const vbMatrix<vbType>& A)
 	if(m != A.GetNumOfCols())
 		return 0;
 
-	complex<vbType> Det = 1;
+	vbType Det = 1;
 	for(int i = 0; i < m; ++i)
 		Det *=A(i,i);
 
@@ -1654,47 +2066,1427 @@ inline void LUdecomposition(const vbMatrix<vbType>& M,vbMatrix<vbType>& L,vbMatr
 template<typename vbType>
 inline vbMatrix<vbType> inv(const vbMatrix<vbType>& A)
 {
-	// Make sure that A is a square matrix
-	int m = A.GetNumOfRows();
-	if(m != A.GetNumOfCols())
-	{
+	return inv(A,vbNumericsPolicy<vbType>());
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbMatrix<vbType> inv(const vbMatrix<vbType>& A,const vbNumericsPolicy<vbType>& Policy)
+{
+	// Make sure that A is a square matrix
+	int m = A.GetNumOfRows();
+	if(m != A.GetNumOfCols())
+	{
 		GlobalErrorLog += "\nTried to take the inverse of a non-square matrix";
 		return vbMatrix<vbType>(0,0,vbType(0));
 	}
 
-	// First do a QR decomposition on A:  A = QR
-	vbMatrix<vbType> Q,R;
-	QRdecomposition(A,Q,R);
+	// First do a QR decomposition on A:  A = QR
+	vbMatrix<vbType> Q,R;
+	QRdecomposition(A,Q,R,Policy);
+
+	// Check if A is singular (merely ill-conditioned matrices
+	// can be refused with the policy's MaxConditionNumber)
+	if(rank_triangular(R,vbType(Policy.GetPivotZero(A))) != m)
+	{
+		GlobalErrorLog += "\nTried to take the inverse of a singular matrix";
+		return vbMatrix<vbType>(0,0,vbType(0));
+	}
+
+	// When the policy asks for it, also refuse matrices so ill-conditioned
+	// that the inverse would be mostly noise (the condition number is
+	// estimated from the QR factors we already have)
+	if(Policy.GetMaxConditionNumber() > typename vbNumericsPolicy<vbType>::RealType(0) &&
+	   Policy.IsIllConditioned(EstimateCondition1(A,Q,R)))
+	{
+		GlobalErrorLog += "\nTried to take the inverse of an ill-conditioned matrix";
+		return vbMatrix<vbType>(0,0,vbType(0));
+	}
+
+	// The inverse of A = inv(R)*ConjugateTranspose(Q) where R is upper triangular
+	// Calculate the inverse of R using backsubstitution with unit vectors
+	vbMatrix<vbType> Rinv(m,m,vbType(0));
+
+	for(int i = m-1; i >= 0; --i) // Loop over cols
+	{
+		for(int j = m-1; j >= 0; --j) // Loop over rows
+		{
+			if(j == i)
+				Rinv(j,i) = vbType(1)/R(j,j);
+			else if(j < i)
+			{
+				Rinv(j,i) = 0;
+				for(int k = j+1; k < m; ++k)
+					Rinv(j,i) -= R(j,k)*Rinv(k,i);
+				Rinv(j,i) /= R(j,j);
+			}
+		}
+	}
+
+	// The inverse of the original matrix A = inv(R)*ConjugateTranspose(Q)
+	return (Rinv*ConjugateTranspose(Q));
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbMatrix<vbType> SolveUpperTriangular(const vbMatrix<vbType>& R,const vbMatrix<vbType>& B)
+{
+	// Solves R*X = B by back-substitution, where R is upper triangular
+	// (does not check whether R is really triangular)
+	int m = R.GetNumOfRows();
+	int n = B.GetNumOfCols();
+
+	vbMatrix<vbType> X(m,n,vbType(0));
+
+	for(int j = 0; j < n; ++j)
+	{
+		for(int i = m-1; i >= 0; --i)
+		{
+			vbType Sum = B(i,j);
+			for(int k = i+1; k < m; ++k)
+				Sum -= R(i,k)*X(k,j);
+			X(i,j) = Sum/R(i,i);
+		}
+	}
+
+	return X;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbMatrix<vbType> SolveUpperTriangularTransposed(const vbMatrix<vbType>& R,const vbMatrix<vbType>& B)
+{
+	// Solves ConjugateTranspose(R)*X = B by forward-substitution, where R is
+	// upper triangular, without having to form the transpose of R
+	int m = R.GetNumOfRows();
+	int n = B.GetNumOfCols();
+
+	vbMatrix<vbType> X(m,n,vbType(0));
+
+	for(int j = 0; j < n; ++j)
+	{
+		for(int i = 0; i < m; ++i)
+		{
+			vbType Sum = B(i,j);
+			for(int k = 0; k < i; ++k)
+				Sum -= vbScalarTraits<vbType>::Conj(R(k,i))*X(k,j);
+			X(i,j) = Sum/vbScalarTraits<vbType>::Conj(R(i,i));
+		}
+	}
+
+	return X;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbMatrix<vbType> SolveQR(const vbMatrix<vbType>& Q,const vbMatrix<vbType>& R,const vbMatrix<vbType>& B)
+{
+	// Solves A*X = B given the factors of A = QR: X = inv(R)*ConjugateTranspose(Q)*B
+	return SolveUpperTriangular(R,ConjugateTranspose(Q)*B);
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbMatrix<vbType> SolveQRTransposed(const vbMatrix<vbType>& Q,const vbMatrix<vbType>& R,const vbMatrix<vbType>& B)
+{
+	// Solves ConjugateTranspose(A)*X = B given the factors of A = QR:
+	// X = Q*inv(ConjugateTranspose(R))*B
+	return Q*SolveUpperTriangularTransposed(R,B);
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline typename vbScalarTraits<vbType>::RealType EstimateInverseNorm1(const vbMatrix<vbType>& Q,const vbMatrix<vbType>& R)
+{
+	// Estimates Norm1(inv(A)) from the factors of A = QR using Hager's
+	// method with Higham's refinements, which only needs a handful of
+	// O(n^2) solves instead of the O(n^3) explicit inverse
+	typedef typename vbScalarTraits<vbType>::RealType RealType;
+
+	int n = R.GetNumOfRows();
+	if(n == 0)
+		return RealType(0);
+
+	vbMatrix<vbType> x(n,1,vbType(1)/vbType(n));
+	vbMatrix<vbType> y,z;
+	vbMatrix<vbType> Xi(n,1,vbType(0));
+
+	RealType Estimate = 0;
+	int LastIndex = -1;
+
+	for(int k = 0; k < 5; ++k)
+	{
+		y = SolveQR(Q,R,x);
+		Estimate = std::abs(Norm1(y));
+
+		// The sign of y (its phase for complex matrices)
+		for(int i = 0; i < n; ++i)
+			Xi(i,0) = vbScalarTraits<vbType>::Phase(y(i,0));
+
+		z = SolveQRTransposed(Q,R,Xi);
+
+		// Find the largest component of z and compare it to Re(z'*x)
+		int MaxIndex = 0;
+		RealType zMax = 0;
+		RealType ztx = 0;
+		for(int i = 0; i < n; ++i)
+		{
+			if(std::abs(z(i,0)) > zMax)
+			{
+				zMax = std::abs(z(i,0));
+				MaxIndex = i;
+			}
+			ztx += std::real(vbScalarTraits<vbType>::Conj(z(i,0))*x(i,0));
+		}
+
+		// Check if we've reached a local maximum
+		if(zMax <= ztx || MaxIndex == LastIndex)
+			break;
+
+		x = vbMatrix<vbType>(n,1,vbType(0));
+		x(MaxIndex,0) = vbType(1);
+		LastIndex = MaxIndex;
+	}
+
+	// Higham's alternating vector guards against
+	// the cases where Hager's method underestimates
+	if(n > 1)
+	{
+		for(int i = 0; i < n; ++i)
+			x(i,0) = vbType(((i % 2) ? RealType(-1) : RealType(1)) * (RealType(1) + RealType(i)/RealType(n-1)));
+
+		RealType Alternative = RealType(2)*std::abs(Norm1(SolveQR(Q,R,x)))/RealType(3*n);
+
+		if(Alternative > Estimate)
+			Estimate = Alternative;
+	}
+
+	return Estimate;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline typename vbScalarTraits<vbType>::RealType EstimateCondition1(const vbMatrix<vbType>& A,const vbMatrix<vbType>& Q,const vbMatrix<vbType>& R)
+{
+	// Estimated condition number in the 1-norm from an existing QR factorization
+	return std::abs(Norm1(A))*EstimateInverseNorm1(Q,R);
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline typename vbScalarTraits<vbType>::RealType EstimateCondition1(const vbMatrix<vbType>& A,const vbNumericsPolicy<vbType>& Policy = vbNumericsPolicy<vbType>())
+{
+	// Check to make sure matrix A is square
+	if(A.GetNumOfRows() != A.GetNumOfCols())
+	{
+		GlobalErrorLog += "\nTried to estimate the condition number of a non-square matrix";
+		return typename vbScalarTraits<vbType>::RealType(0);
+	}
+
+	vbMatrix<vbType> Q,R;
+	QRdecomposition(A,Q,R,Policy);
+
+	// A singular matrix has an infinite condition number
+	if(rank_triangular(R,vbType(Policy.GetPivotZero(A))) != A.GetNumOfRows())
+		return numeric_limits<typename vbScalarTraits<vbType>::RealType>::infinity();
+
+	return EstimateCondition1(A,Q,R);
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline bool ShermanMorrisonUpdate(vbMatrix<vbType>& Ainv,
+								  const vbMatrix<vbType>& u,
+								  const vbMatrix<vbType>& v,
+								  const vbNumericsPolicy<vbType>& Policy = vbNumericsPolicy<vbType>())
+{
+	// Updates a cached inverse in O(n^2) after a rank-1 change of A:
+	// inv(A + u*Transpose(v)) = Ainv - (Ainv*u)*(Transpose(v)*Ainv)/(1 + Transpose(v)*Ainv*u)
+	int n = Ainv.GetNumOfRows();
+	if(n != Ainv.GetNumOfCols() || u.GetNumOfRows() != n || v.GetNumOfRows() != n)
+	{
+		GlobalErrorLog += "\nTried a Sherman-Morrison update with mismatched sizes";
+		return false;
+	}
+
+	// Ainvu = Ainv*u and vtAinv = Transpose(v)*Ainv
+	vector<vbType> Ainvu(n,vbType(0));
+	vector<vbType> vtAinv(n,vbType(0));
+	for(int i = 0; i < n; ++i)
+	{
+		for(int j = 0; j < n; ++j)
+		{
+			Ainvu[i] += Ainv(i,j)*u(j,0);
+			vtAinv[i] += v(j,0)*Ainv(j,i);
+		}
+	}
+
+	vbType Denominator = vbType(1);
+	for(int i = 0; i < n; ++i)
+		Denominator += v(i,0)*Ainvu[i];
+
+	// The updated matrix is singular (or nearly so)
+	if(std::abs(Denominator) <= Policy.GetConvergenceTolerance(n))
+	{
+		GlobalErrorLog += "\nSherman-Morrison update would make the matrix singular";
+		return false;
+	}
+
+	for(int i = 0; i < n; ++i)
+	{
+		vbType Factor = Ainvu[i]/Denominator;
+		for(int j = 0; j < n; ++j)
+			Ainv(i,j) -= Factor*vtAinv[j];
+	}
+
+	return true;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline bool WoodburyUpdate(vbMatrix<vbType>& Ainv,
+						   const vbMatrix<vbType>& U,
+						   const vbMatrix<vbType>& C,
+						   const vbMatrix<vbType>& V,
+						   const vbNumericsPolicy<vbType>& Policy = vbNumericsPolicy<vbType>())
+{
+	// Updates a cached inverse in O(k*n^2) after a rank-k change of A, where
+	// U is nxk, C is kxk and V is kxn:
+	// inv(A + U*C*V) = Ainv - Ainv*U*inv(inv(C) + V*Ainv*U)*V*Ainv
+	int n = Ainv.GetNumOfRows();
+	int k = U.GetNumOfCols();
+	if(n != Ainv.GetNumOfCols() || U.GetNumOfRows() != n ||
+	   C.GetNumOfRows() != k || C.GetNumOfCols() != k ||
+	   V.GetNumOfRows() != k || V.GetNumOfCols() != n)
+	{
+		GlobalErrorLog += "\nTried a Woodbury update with mismatched sizes";
+		return false;
+	}
+
+	// Only kxk matrices get inverted here
+	if(rank(C,Policy) != k)
+	{
+		GlobalErrorLog += "\nTried a Woodbury update with a singular C";
+		return false;
+	}
+
+	vbMatrix<vbType> Cinv = inv(C,Policy);
+
+	vbMatrix<vbType> AinvU = Ainv*U;
+	vbMatrix<vbType> VAinv = V*Ainv;
+	vbMatrix<vbType> Capacitance = Cinv + V*AinvU;
+
+	if(rank(Capacitance,Policy) != k)
+	{
+		GlobalErrorLog += "\nWoodbury update would make the matrix singular";
+		return false;
+	}
+
+	Ainv -= AinvU*inv(Capacitance,Policy)*VAinv;
+
+	return true;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline void GivensRotation(const vbType& a,const vbType& b,vbType& c,vbType& s,vbType& r)
+{
+	// Calculates c and s such that [c,s;-conj(s),c]*[a;b] = [r;0], with a
+	// real c (which makes the rotation unitary for complex a and b too)
+	if(b == vbType(0))
+	{
+		c = vbType(1);
+		s = vbType(0);
+		r = a;
+		return;
+	}
+
+	typename vbScalarTraits<vbType>::RealType Norm = std::sqrt(vbScalarTraits<vbType>::AbsSquared(a) +
+																vbScalarTraits<vbType>::AbsSquared(b));
+	vbType Phase = vbScalarTraits<vbType>::Phase(a);
+
+	c = vbType(std::abs(a)/Norm);
+	s = Phase*vbScalarTraits<vbType>::Conj(b)/vbType(Norm);
+	r = Phase*vbType(Norm);
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+// CLASS:			vbQRFactorization<vbType>
+// PURPOSE:			Keeps the A = QR factors of a matrix so that linear systems can be
+//					solved repeatedly and low-rank changes of A can be folded into the
+//					factors in O(n^2) instead of re-factorizing in O(n^3)
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+class vbQRFactorization
+{
+public: // Default constructors and destructors
+
+	// Default constructor
+	vbQRFactorization(void);
+
+	// Constructor factorizes the matrix A
+	vbQRFactorization(const vbMatrix<vbType>& A,
+					  const vbNumericsPolicy<vbType>& Policy = vbNumericsPolicy<vbType>());
+
+	// Default destructor
+	~vbQRFactorization(void);
+
+public: // Public functions
+
+	// Used to factorize a matrix A = QR
+	void									Factorize(const vbMatrix<vbType>& A,
+													  const vbNumericsPolicy<vbType>& Policy = vbNumericsPolicy<vbType>());
+
+	// Used to solve A*X = B
+	vbMatrix<vbType>						Solve(const vbMatrix<vbType>& B)const;
+
+	// Used to update the factors after A = A + U*Transpose(V), where
+	// U is mxk and V is nxk (k = 1 is a rank-1 update), in O(k*n^2)
+	void									Update(const vbMatrix<vbType>& U,const vbMatrix<vbType>& V);
+
+	// Used to update the factors after A = A - U*Transpose(V)
+	void									Downdate(const vbMatrix<vbType>& U,const vbMatrix<vbType>& V);
+
+	const vbMatrix<vbType>&					GetQ()const;
+	const vbMatrix<vbType>&					GetR()const;
+
+private: // Private functions
+
+	// Applies the rotation [c,s;-s,c] to rows i,i+1 of R and
+	// the transposed rotation to columns i,i+1 of Q, so that
+	// the product Q*R doesn't change
+	void									RotateRows(const int& i,const vbType& c,const vbType& s);
+
+	// Folds a single rank-1 change u*Transpose(v) into the factors
+	void									UpdateRank1(const vbMatrix<vbType>& u,const vbMatrix<vbType>& v);
+
+private: // Private variables
+
+	// The orthogonal (mxm) and upper triangular (mxn) factors
+	vbMatrix<vbType>						m_Q;
+	vbMatrix<vbType>						m_R;
+};
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbQRFactorization<vbType>::vbQRFactorization(void)
+{
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbQRFactorization<vbType>::vbQRFactorization(const vbMatrix<vbType>& A,
+													const vbNumericsPolicy<vbType>& Policy)
+{
+	Factorize(A,Policy);
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbQRFactorization<vbType>::~vbQRFactorization(void)
+{
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline void vbQRFactorization<vbType>::Factorize(const vbMatrix<vbType>& A,
+												 const vbNumericsPolicy<vbType>& Policy)
+{
+	QRdecomposition(A,m_Q,m_R,Policy);
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbMatrix<vbType> vbQRFactorization<vbType>::Solve(const vbMatrix<vbType>& B)const
+{
+	if(m_R.GetNumOfRows() != m_R.GetNumOfCols())
+	{
+		GlobalErrorLog += "\nTried to solve a system with a non-square QR factorization";
+		return vbMatrix<vbType>(0,0,vbType(0));
+	}
+
+	return SolveQR(m_Q,m_R,B);
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline void vbQRFactorization<vbType>::RotateRows(const int& i,const vbType& c,const vbType& s)
+{
+	int m = m_Q.GetNumOfRows();
+	int n = m_R.GetNumOfCols();
+
+	// Rows i and i+1 of R are rotated by G = [c,s;-conj(s),c],
+	// and Q is multiplied by ConjugateTranspose(G) to compensate
+	vbType sConj = vbScalarTraits<vbType>::Conj(s);
+
+	for(int j = 0; j < n; ++j)
+	{
+		vbType Ri = m_R(i,j);
+		vbType Rii = m_R(i+1,j);
+		m_R(i,j) = c*Ri + s*Rii;
+		m_R(i+1,j) = c*Rii - sConj*Ri;
+	}
+
+	for(int j = 0; j < m; ++j)
+	{
+		vbType Qi = m_Q(j,i);
+		vbType Qii = m_Q(j,i+1);
+		m_Q(j,i) = c*Qi + sConj*Qii;
+		m_Q(j,i+1) = c*Qii - s*Qi;
+	}
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline void vbQRFactorization<vbType>::UpdateRank1(const vbMatrix<vbType>& u,const vbMatrix<vbType>& v)
+{
+	// A + u*Transpose(v) = Q*(R + w*Transpose(v)) where w = ConjugateTranspose(Q)*u
+	// (Golub & Van Loan, section 12.5.1)
+	int m = m_R.GetNumOfRows();
+	int n = m_R.GetNumOfCols();
+
+	vector<vbType> w(m,vbType(0));
+	for(int i = 0; i < m; ++i)
+		for(int j = 0; j < m; ++j)
+			w[i] += vbScalarTraits<vbType>::Conj(m_Q(j,i))*u(j,0);
+
+	vbType c,s,r;
+
+	// Rotate w into a multiple of the first unit vector from the
+	// bottom up, which turns R into an upper Hessenberg matrix
+	for(int i = m-1; i > 0; --i)
+	{
+		GivensRotation(w[i-1],w[i],c,s,r);
+		w[i-1] = r;
+		w[i] = vbType(0);
+		RotateRows(i-1,c,s);
+	}
+
+	// Now the rank-1 change only touches the first row of R
+	for(int j = 0; j < n; ++j)
+		m_R(0,j) += w[0]*v(j,0);
+
+	// Restore R to upper triangular form by
+	// zeroing out the sub-diagonal
+	int NumOfRotations = min(m-1,n);
+	for(int i = 0; i < NumOfRotations; ++i)
+	{
+		GivensRotation(m_R(i,i),m_R(i+1,i),c,s,r);
+		RotateRows(i,c,s);
+		m_R(i+1,i) = vbType(0);
+	}
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline void vbQRFactorization<vbType>::Update(const vbMatrix<vbType>& U,const vbMatrix<vbType>& V)
+{
+	if(U.GetNumOfRows() != m_Q.GetNumOfRows() || V.GetNumOfRows() != m_R.GetNumOfCols() ||
+	   U.GetNumOfCols() != V.GetNumOfCols())
+	{
+		GlobalErrorLog += "\nTried to update a QR factorization with mismatched sizes";
+		return;
+	}
+
+	// A rank-k change is folded in as k rank-1 changes
+	for(int k = 0; k < U.GetNumOfCols(); ++k)
+		UpdateRank1(U.GetColVector(k),V.GetColVector(k));
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline void vbQRFactorization<vbType>::Downdate(const vbMatrix<vbType>& U,const vbMatrix<vbType>& V)
+{
+	Update(-U,V);
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline const vbMatrix<vbType>& vbQRFactorization<vbType>::GetQ()const
+{
+	return m_Q;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline const vbMatrix<vbType>& vbQRFactorization<vbType>::GetR()const
+{
+	return m_R;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+// CLASS:			vbCholeskyFactorization<vbType>
+// PURPOSE:			Keeps the A = L*Transpose(L) factor of a symmetric positive definite
+//					matrix, with O(n^2) rank-1 updates and downdates of the factor
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+class vbCholeskyFactorization
+{
+public: // Default constructors and destructors
+
+	// Default constructor
+	vbCholeskyFactorization(void);
+
+	// Constructor factorizes the matrix A
+	vbCholeskyFactorization(const vbMatrix<vbType>& A);
+
+	// Default destructor
+	~vbCholeskyFactorization(void);
+
+public: // Public functions
+
+	// Used to factorize A = L*Transpose(L), returns false if A
+	// is not square or not (numerically) positive definite
+	bool									Factorize(const vbMatrix<vbType>& A);
+
+	// Used to solve A*X = B
+	vbMatrix<vbType>						Solve(const vbMatrix<vbType>& B)const;
+
+	// Used to update the factor after A = A + X*Transpose(X),
+	// where X is nxk (k = 1 is a rank-1 update), in O(k*n^2)
+	void									Update(const vbMatrix<vbType>& X);
+
+	// Used to update the factor after A = A - X*Transpose(X), returns
+	// false (leaving the factor untouched) if the result would not be
+	// positive definite
+	bool									Downdate(const vbMatrix<vbType>& X);
+
+	const vbMatrix<vbType>&					GetL()const;
+
+private: // Private variables
+
+	// The lower triangular factor
+	vbMatrix<vbType>						m_L;
+};
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbCholeskyFactorization<vbType>::vbCholeskyFactorization(void)
+{
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbCholeskyFactorization<vbType>::vbCholeskyFactorization(const vbMatrix<vbType>& A)
+{
+	Factorize(A);
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbCholeskyFactorization<vbType>::~vbCholeskyFactorization(void)
+{
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline bool vbCholeskyFactorization<vbType>::Factorize(const vbMatrix<vbType>& A)
+{
+	int n = A.GetNumOfRows();
+	if(n != A.GetNumOfCols())
+	{
+		GlobalErrorLog += "\nTried to do a Cholesky factorization on non-square matrix";
+		return false;
+	}
+
+	m_L = vbMatrix<vbType>(n,n,vbType(0));
+
+	for(int j = 0; j < n; ++j)
+	{
+		vbType Diagonal = A(j,j);
+		for(int k = 0; k < j; ++k)
+			Diagonal -= m_L(j,k)*m_L(j,k);
+
+		if(Diagonal <= vbType(0))
+		{
+			GlobalErrorLog += "\nTried to do a Cholesky factorization on a matrix that is not positive definite";
+			m_L.clear();
+			return false;
+		}
+
+		m_L(j,j) = std::sqrt(Diagonal);
+
+		for(int i = j+1; i < n; ++i)
+		{
+			vbType Sum = A(i,j);
+			for(int k = 0; k < j; ++k)
+				Sum -= m_L(i,k)*m_L(j,k);
+			m_L(i,j) = Sum/m_L(j,j);
+		}
+	}
+
+	return true;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbMatrix<vbType> vbCholeskyFactorization<vbType>::Solve(const vbMatrix<vbType>& B)const
+{
+	// L*Transpose(L)*X = B is solved as L*Y = B and then
+	// Transpose(L)*X = Y, both by substitution
+	int n = m_L.GetNumOfRows();
+	int k = B.GetNumOfCols();
+
+	vbMatrix<vbType> X(n,k,vbType(0));
+
+	for(int c = 0; c < k; ++c)
+	{
+		for(int i = 0; i < n; ++i)
+		{
+			vbType Sum = B(i,c);
+			for(int j = 0; j < i; ++j)
+				Sum -= m_L(i,j)*X(j,c);
+			X(i,c) = Sum/m_L(i,i);
+		}
+
+		for(int i = n-1; i >= 0; --i)
+		{
+			vbType Sum = X(i,c);
+			for(int j = i+1; j < n; ++j)
+				Sum -= m_L(j,i)*X(j,c);
+			X(i,c) = Sum/m_L(i,i);
+		}
+	}
+
+	return X;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline void vbCholeskyFactorization<vbType>::Update(const vbMatrix<vbType>& X)
+{
+	int n = m_L.GetNumOfRows();
+	if(X.GetNumOfRows() != n)
+	{
+		GlobalErrorLog += "\nTried to update a Cholesky factorization with a vector of the wrong size";
+		return;
+	}
+
+	vector<vbType> x(n,vbType(0));
+
+	for(int c = 0; c < X.GetNumOfCols(); ++c)
+	{
+		for(int i = 0; i < n; ++i)
+			x[i] = X(i,c);
+
+		// Sweep the vector into the factor one column
+		// at a time with plane rotations
+		for(int k = 0; k < n; ++k)
+		{
+			vbType r = std::sqrt(m_L(k,k)*m_L(k,k) + x[k]*x[k]);
+			vbType Cos = r/m_L(k,k);
+			vbType Sin = x[k]/m_L(k,k);
+			m_L(k,k) = r;
+
+			for(int i = k+1; i < n; ++i)
+			{
+				m_L(i,k) = (m_L(i,k) + Sin*x[i])/Cos;
+				x[i] = Cos*x[i] - Sin*m_L(i,k);
+			}
+		}
+	}
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline bool vbCholeskyFactorization<vbType>::Downdate(const vbMatrix<vbType>& X)
+{
+	int n = m_L.GetNumOfRows();
+	if(X.GetNumOfRows() != n)
+	{
+		GlobalErrorLog += "\nTried to downdate a Cholesky factorization with a vector of the wrong size";
+		return false;
+	}
+
+	// Work on a copy so that a failed downdate
+	// leaves the current factor intact
+	vbMatrix<vbType> L = m_L;
+	vector<vbType> x(n,vbType(0));
+
+	for(int c = 0; c < X.GetNumOfCols(); ++c)
+	{
+		for(int i = 0; i < n; ++i)
+			x[i] = X(i,c);
+
+		for(int k = 0; k < n; ++k)
+		{
+			vbType Diagonal = L(k,k)*L(k,k) - x[k]*x[k];
+			if(Diagonal <= vbType(0))
+			{
+				GlobalErrorLog += "\nCholesky downdate would make the matrix indefinite";
+				return false;
+			}
+
+			vbType r = std::sqrt(Diagonal);
+			vbType Cos = r/L(k,k);
+			vbType Sin = x[k]/L(k,k);
+			L(k,k) = r;
+
+			for(int i = k+1; i < n; ++i)
+			{
+				L(i,k) = (L(i,k) - Sin*x[i])/Cos;
+				x[i] = Cos*x[i] - Sin*L(i,k);
+			}
+		}
+	}
+
+	m_L = L;
+
+	return true;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline const vbMatrix<vbType>& vbCholeskyFactorization<vbType>::GetL()const
+{
+	return m_L;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+// CLASS:			vbLUFactorization<vbType>
+// PURPOSE:			Keeps the P*A = L*U factors (partial pivoting) of a square matrix, so
+//					that the same matrix can be solved against many right hand sides, as
+//					implicit integrators do between Jacobian updates
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+class vbLUFactorization
+{
+public: // Default constructors and destructors
+
+	// Default constructor
+	vbLUFactorization(void);
+
+	// Constructor factorizes the matrix A
+	vbLUFactorization(const vbMatrix<vbType>& A,
+					  const vbNumericsPolicy<vbType>& Policy = vbNumericsPolicy<vbType>());
+
+	// Default destructor
+	~vbLUFactorization(void);
+
+public: // Public functions
+
+	// Used to factorize P*A = L*U, returns false if A is not square or
+	// is singular to working precision, that is if a pivot falls under the
+	// policy's PivotZero (refactorizing a matrix of the same size doesn't allocate)
+	bool									Factorize(const vbMatrix<vbType>& A,
+													  const vbNumericsPolicy<vbType>& Policy = vbNumericsPolicy<vbType>());
+
+	// Used to solve A*X = B
+	vbMatrix<vbType>						Solve(const vbMatrix<vbType>& B)const;
+
+	// Used to solve A*x = b for a single right hand side of n values,
+	// overwriting b with the solution (doesn't allocate)
+	void									SolveInPlace(vbType* b)const;
+
+	// L (unit diagonal, below the diagonal) and U (on and above
+	// the diagonal) stored in one matrix, and the row swapped
+	// with row k at step k of the elimination
+	const vbMatrix<vbType>&					GetLU()const;
+	const vector<int>&						GetPivots()const;
+
+private: // Private variables
+
+	vbMatrix<vbType>						m_LU;
+	vector<int>								m_Pivots;
+};
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbLUFactorization<vbType>::vbLUFactorization(void)
+{
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbLUFactorization<vbType>::vbLUFactorization(const vbMatrix<vbType>& A,
+													const vbNumericsPolicy<vbType>& Policy)
+{
+	Factorize(A,Policy);
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbLUFactorization<vbType>::~vbLUFactorization(void)
+{
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline bool vbLUFactorization<vbType>::Factorize(const vbMatrix<vbType>& A,
+												 const vbNumericsPolicy<vbType>& Policy)
+{
+	int n = A.GetNumOfRows();
+	if(n != A.GetNumOfCols())
+	{
+		GlobalErrorLog += "\nTried to do a LU factorization on non-square matrix";
+		return false;
+	}
+
+	m_LU = A;
+	m_Pivots.resize(n);
+
+	if(n == 0)
+		return true;
+
+	vbType* LU = &m_LU.GetMatrixArray()[0];
+
+	// A pivot under the round-off level of A means A is singular to
+	// working precision, as in the QR based inverse and solvers
+	typename vbScalarTraits<vbType>::RealType PivotZero = Policy.GetPivotZero(A);
+
+	for(int k = 0; k < n; ++k)
+	{
+		// Pick the largest pivot in the column
+		int Pivot = k;
+		for(int i = k+1; i < n; ++i)
+		{
+			if(std::abs(LU[i*n + k]) > std::abs(LU[Pivot*n + k]))
+				Pivot = i;
+		}
+
+		m_Pivots[k] = Pivot;
+
+		if(std::abs(LU[Pivot*n + k]) <= PivotZero)
+		{
+			GlobalErrorLog += "\nTried to do a LU factorization on a singular matrix";
+			return false;
+		}
+
+		if(Pivot != k)
+		{
+			for(int j = 0; j < n; ++j)
+				std::swap(LU[k*n + j],LU[Pivot*n + j]);
+		}
+
+		for(int i = k+1; i < n; ++i)
+		{
+			vbType Factor = LU[i*n + k]/LU[k*n + k];
+			LU[i*n + k] = Factor;
+
+			for(int j = k+1; j < n; ++j)
+				LU[i*n + j] -= Factor*LU[k*n + j];
+		}
+	}
+
+	return true;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline void vbLUFactorization<vbType>::SolveInPlace(vbType* b)const
+{
+	int n = m_LU.GetNumOfRows();
+
+	if(n == 0)
+		return;
+
+	const vbType* LU = &m_LU.GetMatrixArray()[0];
+
+	// P*A*x = P*b is solved as L*y = P*b and
+	// then U*x = y, both by substitution
+	for(int k = 0; k < n; ++k)
+	{
+		if(m_Pivots[k] != k)
+			std::swap(b[k],b[m_Pivots[k]]);
+	}
+
+	for(int i = 1; i < n; ++i)
+	{
+		vbType Sum = b[i];
+		for(int j = 0; j < i; ++j)
+			Sum -= LU[i*n + j]*b[j];
+		b[i] = Sum;
+	}
+
+	for(int i = n-1; i >= 0; --i)
+	{
+		vbType Sum = b[i];
+		for(int j = i+1; j < n; ++j)
+			Sum -= LU[i*n + j]*b[j];
+		b[i] = Sum/LU[i*n + i];
+	}
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbMatrix<vbType> vbLUFactorization<vbType>::Solve(const vbMatrix<vbType>& B)const
+{
+	int n = m_LU.GetNumOfRows();
+	int k = B.GetNumOfCols();
+
+	if(B.GetNumOfRows() != n)
+	{
+		GlobalErrorLog += "\nTried to solve a LU factorized system with the wrong number of rows";
+		return vbMatrix<vbType>(0,0,vbType(0));
+	}
+
+	vbMatrix<vbType> X(n,k,vbType(0));
+	vector<vbType> x(n,vbType(0));
 
-	// Check if A is singular
-	if(rank_triangular(R) != m)
+	for(int c = 0; c < k; ++c)
 	{
-		GlobalErrorLog += "\nTried to take the inverse of a singular matrix";
-		return A;
+		for(int i = 0; i < n; ++i)
+			x[i] = B(i,c);
+
+		SolveInPlace(&x[0]);
+
+		for(int i = 0; i < n; ++i)
+			X(i,c) = x[i];
 	}
 
-	// The inverse of A = inv(R)*Transpose(Q) where R is upper triangular
-	// Calculate the inverse of R using backsubstitution with unit vectors
-	vbMatrix<vbType> Rinv(m,m,0);
+	return X;
+}
+//---------------------------------------------------------------------------------------
 
-	for(int i = m-1; i >= 0; --i) // Loop over cols
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline const vbMatrix<vbType>& vbLUFactorization<vbType>::GetLU()const
+{
+	return m_LU;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline const vector<int>& vbLUFactorization<vbType>::GetPivots()const
+{
+	return m_Pivots;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline void ResizeAndZero(vbMatrix<vbType>& Result,const int& m,const int& n)
+{
+	// Makes Result an mxn zero matrix, only allocating when its size changes
+	if(Result.GetNumOfRows() != m || Result.GetNumOfCols() != n)
+		Result = vbMatrix<vbType>(m,n,vbType(0));
+	else
+		std::fill(Result.GetMatrixArray().begin(),Result.GetMatrixArray().end(),vbType(0));
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline void MultiplyInto(const vbMatrix<vbType>& A,const vbMatrix<vbType>& B,vbMatrix<vbType>& Result)
+{
+	// Result = A*B, writing into Result without allocating when it
+	// already has the right size (Result must not be A or B)
+	int m = A.GetNumOfRows();
+	int p = A.GetNumOfCols();
+	int n = B.GetNumOfCols();
+
+	ResizeAndZero(Result,m,n);
+
+	if(m == 0 || n == 0 || p == 0)
+		return;
+
+	for(int i = 0; i < m; ++i)
+		MultiplyRow(&A.GetMatrixArray()[0] + i*p,&B.GetMatrixArray()[0],&Result.GetMatrixArray()[0] + i*n,p,n);
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+// CLASS:			vbExpmWorkspace<vbType>
+// PURPOSE:			Scratch matrices for expm and c2d, sized on first use and reused
+//					afterwards, so re-discretizing a plant doesn't re-allocate them
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+class vbExpmWorkspace
+{
+public: // Public variables
+
+	// Scaled input matrix and its even powers
+	vbMatrix<vbType>						A;
+	vbMatrix<vbType>						A2;
+	vbMatrix<vbType>						A4;
+	vbMatrix<vbType>						A6;
+	vbMatrix<vbType>						A8;
+
+	// Odd and even parts of the Pade approximant
+	vbMatrix<vbType>						U;
+	vbMatrix<vbType>						V;
+
+	// Intermediate results
+	vbMatrix<vbType>						Temp1;
+	vbMatrix<vbType>						Temp2;
+
+	// Factorization used to solve (V - U)*E = (V + U)
+	vbQRFactorization<vbType>				Factorization;
+
+	// Van Loan block matrices used by c2d
+	vbMatrix<vbType>						Block;
+	vbMatrix<vbType>						BlockExp;
+};
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline void expm(const vbMatrix<vbType>& M,vbMatrix<vbType>& E,vbExpmWorkspace<vbType>& W)
+{
+	// Matrix exponential by Pade approximation with scaling and squaring
+	// (Higham, "The scaling and squaring method for the matrix exponential
+	// revisited", 2005), picking the cheapest Pade degree that is accurate
+	// to double precision for the 1-norm of M
+	int n = M.GetNumOfRows();
+	if(n != M.GetNumOfCols())
 	{
-		for(int j = m-1; j >= 0; --j) // Loop over rows
+		GlobalErrorLog += "\nTried to take the exponential of a non-square matrix";
+		return;
+	}
+
+	if(n == 0)
+	{
+		E = M;
+		return;
+	}
+
+	// Largest norms for which the Pade approximants of
+	// degree 3,5,7,9 and 13 are accurate to double precision
+	static const int Degrees[5] = {3,5,7,9,13};
+	static const double Thetas[5] = {1.495585217958292e-2,
+									 2.539398330063230e-1,
+									 9.504178996162932e-1,
+									 2.097847961257068e0,
+									 5.371920351148152e0};
+
+	// Pade coefficients
+	static const double b3[4] = {120.0,60.0,12.0,1.0};
+	static const double b5[6] = {30240.0,15120.0,3360.0,420.0,30.0,1.0};
+	static const double b7[8] = {17297280.0,8648640.0,1995840.0,277200.0,25200.0,1512.0,56.0,1.0};
+	static const double b9[10] = {17643225600.0,8821612800.0,2075673600.0,302702400.0,30270240.0,
+								  2162160.0,110880.0,3960.0,90.0,1.0};
+	static const double b13[14] = {64764752532480000.0,32382376266240000.0,7771770303897600.0,
+								   1187353796428800.0,129060195264000.0,10559470521600.0,
+								   670442572800.0,33522128640.0,1323241920.0,40840800.0,
+								   960960.0,16380.0,182.0,1.0};
+
+	vbType Norm = Norm1(M);
+
+	int Degree = 13;
+	for(int i = 0; i < 4; ++i)
+	{
+		if(Norm <= vbType(Thetas[i]))
 		{
-			if(j == i)
-				Rinv(j,i) = vbType(1)/R(j,j);
-			else if(j < i)
+			Degree = Degrees[i];
+			break;
+		}
+	}
+
+	// Scale M down by 2^s so that the degree 13 approximant is accurate
+	int s = 0;
+	W.A = M;
+	if(Degree == 13 && Norm > vbType(Thetas[4]))
+	{
+		s = int(std::ceil(std::log(double(Norm)/Thetas[4])/std::log(2.0)));
+		W.A *= vbType(std::ldexp(1.0,-s));
+	}
+
+	// Even powers of the scaled matrix
+	MultiplyInto(W.A,W.A,W.A2);
+	if(Degree >= 5)
+		MultiplyInto(W.A2,W.A2,W.A4);
+	if(Degree >= 7)
+		MultiplyInto(W.A4,W.A2,W.A6);
+	if(Degree == 9)
+		MultiplyInto(W.A6,W.A2,W.A8);
+
+	// Temp1 accumulates the odd part (before the final
+	// multiplication by A) and V accumulates the even part
+	ResizeAndZero(W.Temp1,n,n);
+	ResizeAndZero(W.Temp2,n,n);
+	ResizeAndZero(W.V,n,n);
+
+	if(Degree == 13)
+	{
+		const double* b = b13;
+
+		// Temp2 = b13*A6 + b11*A4 + b9*A2 and U = b12*A6 + b10*A4 + b8*A2
+		ResizeAndZero(W.U,n,n);
+		for(int i = 0; i < n; ++i)
+		{
+			for(int j = 0; j < n; ++j)
 			{
-				Rinv(j,i) = 0;
-				for(int k = j+1; k < m; ++k)
-					Rinv(j,i) -= R(j,k)*Rinv(k,i);
-				Rinv(j,i) /= R(j,j);
+				W.Temp2(i,j) = vbType(b[13])*W.A6(i,j) + vbType(b[11])*W.A4(i,j) + vbType(b[9])*W.A2(i,j);
+				W.U(i,j) = vbType(b[12])*W.A6(i,j) + vbType(b[10])*W.A4(i,j) + vbType(b[8])*W.A2(i,j);
+			}
+		}
+
+		MultiplyInto(W.A6,W.Temp2,W.Temp1);
+		MultiplyInto(W.A6,W.U,W.V);
+
+		for(int i = 0; i < n; ++i)
+		{
+			for(int j = 0; j < n; ++j)
+			{
+				W.Temp1(i,j) += vbType(b[7])*W.A6(i,j) + vbType(b[5])*W.A4(i,j) + vbType(b[3])*W.A2(i,j);
+				W.V(i,j) += vbType(b[6])*W.A6(i,j) + vbType(b[4])*W.A4(i,j) + vbType(b[2])*W.A2(i,j);
+			}
+
+			W.Temp1(i,i) += vbType(b[1]);
+			W.V(i,i) += vbType(b[0]);
+		}
+	}
+	else
+	{
+		const double* b = (Degree == 3) ? b3 : ((Degree == 5) ? b5 : ((Degree == 7) ? b7 : b9));
+		const vbMatrix<vbType>* Powers[4] = {&W.A2,&W.A4,&W.A6,&W.A8};
+
+		// Odd coefficients go with the odd part, even coefficients
+		// with the even part, both multiplying even powers of A
+		for(int k = 1; 2*k <= Degree; ++k)
+		{
+			const vbMatrix<vbType>& P = *Powers[k-1];
+			for(int i = 0; i < n; ++i)
+			{
+				for(int j = 0; j < n; ++j)
+				{
+					W.Temp1(i,j) += vbType(b[2*k+1])*P(i,j);
+					W.V(i,j) += vbType(b[2*k])*P(i,j);
+				}
 			}
 		}
+
+		for(int i = 0; i < n; ++i)
+		{
+			W.Temp1(i,i) += vbType(b[1]);
+			W.V(i,i) += vbType(b[0]);
+		}
+	}
+
+	// The odd part: U = A*Temp1
+	MultiplyInto(W.A,W.Temp1,W.U);
+
+	// Solve (V - U)*E = (V + U)
+	for(int i = 0; i < n; ++i)
+	{
+		for(int j = 0; j < n; ++j)
+		{
+			W.Temp1(i,j) = W.V(i,j) + W.U(i,j);
+			W.Temp2(i,j) = W.V(i,j) - W.U(i,j);
+		}
+	}
+
+	W.Factorization.Factorize(W.Temp2);
+	E = W.Factorization.Solve(W.Temp1);
+
+	// Undo the scaling by repeated squaring
+	for(int i = 0; i < s; ++i)
+	{
+		MultiplyInto(E,E,W.Temp1);
+		E.GetMatrixArray().swap(W.Temp1.GetMatrixArray());
+	}
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbMatrix<vbType> expm(const vbMatrix<vbType>& M)
+{
+	vbExpmWorkspace<vbType> W;
+	vbMatrix<vbType> E;
+	expm(M,E,W);
+	return E;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline bool c2d(const vbMatrix<vbType>& A,const vbMatrix<vbType>& B,const vbType& T,
+				vbMatrix<vbType>& Phi,vbMatrix<vbType>& Gamma,vbExpmWorkspace<vbType>& W)
+{
+	// Discretizes dx/dt = A*x + B*u with a zero-order hold of period T into
+	// x[k+1] = Phi*x[k] + Gamma*u[k] using Van Loan's block exponential:
+	// expm([A,B;0,0]*T) = [Phi,Gamma;0,I]
+	int n = A.GetNumOfRows();
+	int m = B.GetNumOfCols();
+	if(n != A.GetNumOfCols() || n != B.GetNumOfRows())
+	{
+		GlobalErrorLog += "\nTried to discretize a system with mismatched A and B";
+		return false;
+	}
+
+	ResizeAndZero(W.Block,n+m,n+m);
+	for(int i = 0; i < n; ++i)
+	{
+		for(int j = 0; j < n; ++j)
+			W.Block(i,j) = A(i,j)*T;
+		for(int j = 0; j < m; ++j)
+			W.Block(i,n+j) = B(i,j)*T;
+	}
+
+	expm(W.Block,W.BlockExp,W);
+
+	ResizeAndZero(Phi,n,n);
+	ResizeAndZero(Gamma,n,m);
+	for(int i = 0; i < n; ++i)
+	{
+		for(int j = 0; j < n; ++j)
+			Phi(i,j) = W.BlockExp(i,j);
+		for(int j = 0; j < m; ++j)
+			Gamma(i,j) = W.BlockExp(i,n+j);
+	}
+
+	return true;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline bool c2d(const vbMatrix<vbType>& A,const vbMatrix<vbType>& B,const vbMatrix<vbType>& Qc,const vbType& T,
+				vbMatrix<vbType>& Phi,vbMatrix<vbType>& Gamma,vbMatrix<vbType>& Gramian,vbExpmWorkspace<vbType>& W)
+{
+	// Same as above, and also calculates the Gramian over one period:
+	// Gramian = integral from 0 to T of expm(A*t)*Qc*Transpose(expm(A*t))
+	// which is the discrete process noise covariance for a continuous
+	// noise intensity Qc, or the controllability Gramian when Qc is
+	// empty (Qc = B*Transpose(B) is used).  Van Loan's block exponential
+	// gives it as: expm([-A,Qc;0,Transpose(A)]*T) = [*,inv(Phi)*Gramian;0,Transpose(Phi)]
+	if(!(c2d(A,B,T,Phi,Gamma,W)))
+		return false;
+
+	int n = A.GetNumOfRows();
+
+	vbMatrix<vbType> Intensity = Qc;
+	if(Qc.GetNumOfRows() == 0)
+		Intensity = B*Transpose(B);
+
+	if(Intensity.GetNumOfRows() != n || Intensity.GetNumOfCols() != n)
+	{
+		GlobalErrorLog += "\nTried to calculate a Gramian with Qc of the wrong size";
+		return false;
+	}
+
+	ResizeAndZero(W.Block,2*n,2*n);
+	for(int i = 0; i < n; ++i)
+	{
+		for(int j = 0; j < n; ++j)
+		{
+			W.Block(i,j) = -A(i,j)*T;
+			W.Block(i,n+j) = Intensity(i,j)*T;
+			W.Block(n+i,n+j) = A(j,i)*T;
+		}
 	}
 
-	// The inverse of the original matrix A = inv(R)*Transpose(Q)
-	return (Rinv*Transpose(Q));
+	expm(W.Block,W.BlockExp,W);
+
+	// Gramian = Phi*E12
+	ResizeAndZero(Gramian,n,n);
+	for(int i = 0; i < n; ++i)
+		for(int k = 0; k < n; ++k)
+			for(int j = 0; j < n; ++j)
+				Gramian(i,j) += Phi(i,k)*W.BlockExp(k,n+j);
+
+	return true;
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline bool c2d(const vbMatrix<vbType>& A,const vbMatrix<vbType>& B,const vbType& T,
+				vbMatrix<vbType>& Phi,vbMatrix<vbType>& Gamma)
+{
+	vbExpmWorkspace<vbType> W;
+	return c2d(A,B,T,Phi,Gamma,W);
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline bool c2d(const vbMatrix<vbType>& A,const vbMatrix<vbType>& B,const vbMatrix<vbType>& Qc,const vbType& T,
+				vbMatrix<vbType>& Phi,vbMatrix<vbType>& Gamma,vbMatrix<vbType>& Gramian)
+{
+	vbExpmWorkspace<vbType> W;
+	return c2d(A,B,Qc,T,Phi,Gamma,Gramian,W);
 }
 //---------------------------------------------------------------------------------------
 
@@ -1761,7 +3553,7 @@ template<typename vbType>
 inline vbMatrix<vbType> invBLOCK(const vbMatrix<vbType>& M)
 {
 	// Define a Zero
-	vbType Zero = DefineZero(M);
+	vbType Zero = vbNumericsPolicy<vbType>().GetZero(M);
 
 	if(M.GetNumOfRows() != M.GetNumOfCols())
 	{
@@ -1796,7 +3588,7 @@ inline vbMatrix<vbType> invBLOCK(const vbMatrix<vbType>& M)
 	M.GetMatrixBlocks(A,B,C,D);
 
 	// Resulting inverse matrix
-	vbMatrix<vbType> Result = vbMatrix<vbType>(m,m,0);
+	vbMatrix<vbType> Result = vbMatrix<vbType>(m,m,vbType(0));
 
 	// Check if D is singular:
 	// D is not singular then use Sd to find inverse
@@ -1834,9 +3626,18 @@ inline vbMatrix<vbType> invBLOCK(const vbMatrix<vbType>& M)
 //---------------------------------------------------------------------------------------
 template<typename vbType>
 inline vbMatrix<vbType> pinv(const vbMatrix<vbType>& M)
+{
+	return pinv(M,vbNumericsPolicy<vbType>());
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbMatrix<vbType> pinv(const vbMatrix<vbType>& M,const vbNumericsPolicy<vbType>& Policy)
 {
 	// Define a zero
-	vbType Zero = DefineZero(M);
+	vbType Zero = Policy.GetZero(M);
 
 	// Get the number of rows and cols and store them
 	int m = M.GetNumOfRows();
@@ -1855,7 +3656,7 @@ inline vbMatrix<vbType> pinv(const vbMatrix<vbType>& M)
 		// Get the magnitude of the vector
 		vbType Mag = GetRowVectorMagnitude(M,0);
 		if(EqualsZero(Mag,Zero))
-			return (vbMatrix<vbType>(n,m,0));
+			return (vbMatrix<vbType>(n,m,vbType(0)));
 		else
 			return (Transpose(M)/Mag);
 	}
@@ -1864,7 +3665,7 @@ inline vbMatrix<vbType> pinv(const vbMatrix<vbType>& M)
 		// Get the magnitude of the vector
 		vbType Mag = GetColVectorMagnitude(M,0);
 		if(EqualsZero(Mag,Zero))
-			return(vbMatrix<vbType>(n,m,0));
+			return(vbMatrix<vbType>(n,m,vbType(0)));
 		else
 			return(Transpose(M)/Mag);
 	}
@@ -1889,11 +3690,11 @@ inline vbMatrix<vbType> pinv(const vbMatrix<vbType>& M)
 		ProjA = OrthogonalProjection(A,Transpose(A));
 		ProjB = OrthogonalProjection(B,Transpose(B));
 
-		return vbMatrix<vbType>(Transpose(vbMatrix<vbType>(ProjB * A * inv(Transpose(A) * ProjB * A))),
-								Transpose(vbMatrix<vbType>(ProjA * B * inv(Transpose(B) * ProjA * B))),false);
+		return vbMatrix<vbType>(Transpose(vbMatrix<vbType>(ProjB * A * inv(Transpose(A) * ProjB * A,Policy))),
+								Transpose(vbMatrix<vbType>(ProjA * B * inv(Transpose(B) * ProjA * B,Policy))),false);
 	}
 	else
-		return Transpose(pinv(Transpose(M)));
+		return Transpose(pinv(Transpose(M),Policy));
 }
 //---------------------------------------------------------------------------------------
 
@@ -1904,14 +3705,14 @@ inline void vbMatrix<vbType>::Normalize()
 {
 	for(int i = 0; i < m_NumOfCols; ++i)
 	{
-		complex<vbType> Mag = 0;
+		typename vbScalarTraits<vbType>::RealType Mag = 0;
 
 		for(int j = 0; j < m_NumOfRows; ++j)
-			Mag += at(j,i)*std::conj(at(j,i));
+			Mag += vbScalarTraits<vbType>::AbsSquared(at(j,i));
 
 		Mag = std::sqrt(Mag);
 
-		if(Mag != complex<vbType>(0))
+		if(Mag != 0)
 			for(int j = 0; j < m_NumOfRows; ++j)
 				at(j,i) /= Mag;
 	}
@@ -1927,8 +3728,8 @@ inline vbType Norm1(const vbMatrix<vbType>& A)
 	int m = A.GetNumOfRows();
 	int n = A.GetNumOfCols();
 
-	vbType Norm = 0;
-	vbType ColSum = 0;
+	typename vbScalarTraits<vbType>::RealType Norm = 0;
+	typename vbScalarTraits<vbType>::RealType ColSum = 0;
 
 	// The norm1 of a matrix A is the maximum absolute column sum
 	for(int j = 0; j < n; ++j)
@@ -1954,8 +3755,8 @@ inline vbType NormInf(const vbMatrix<vbType>& A)
 	int m = A.GetNumOfRows();
 	int n = A.GetNumOfCols();
 
-	vbType Norm = 0;
-	vbType RowSum = 0;
+	typename vbScalarTraits<vbType>::RealType Norm = 0;
+	typename vbScalarTraits<vbType>::RealType RowSum = 0;
 
 	// The NormInf of a matrix A is the maximum absolute row sum
 	for(int i = 0; i < m; ++i)
@@ -1981,13 +3782,13 @@ inline vbType NormFrobenius(const vbMatrix<vbType>& A)
 	int m = A.GetNumOfRows();
 	int n = A.GetNumOfCols();
 
-	vbType Result = 0;
+	typename vbScalarTraits<vbType>::RealType Result = 0;
 
 	for(int i = 0; i < m; ++i)
 		for(int j = 0; j < n; ++j)
-			Result += A(i,j)*std::conj(A(i,j));
+			Result += vbScalarTraits<vbType>::AbsSquared(A(i,j));
 
-	return std::sqrt(Result);
+	return vbType(std::sqrt(Result));
 }
 //---------------------------------------------------------------------------------------
 
@@ -2048,11 +3849,12 @@ inline vbType NormInf(const vbMatrix<vbSet<vbType>>& A)
 
 //---------------------------------------------------------------------------------------
 template<typename vbType>
-inline complex<vbType> trace(const vbMatrix<vbType>& M)
+inline vbType trace(const vbMatrix<vbType>& M)
 {
 	// The trace -- addition of all the diagonal elements
 	// equals to the sum of the eigenvalues of the matrix M
-	complex<vbType> Result = 0;
+	// (real for real matrices, so no complex promotion)
+	vbType Result = 0;
 	int m = M.GetNumOfRows();
 
 	// Check to make sure the matrix M is square
@@ -2072,9 +3874,32 @@ inline complex<vbType> trace(const vbMatrix<vbType>& M)
 
 //---------------------------------------------------------------------------------------
 template<typename vbType>
-inline vbMatrix<vbType> MatrixSign(const vbMatrix<vbType>& M,const int& ConvergentRate = 3,const vbType& Zero = 0.00000001)
+inline vbMatrix<vbType> MatrixSign(const vbMatrix<vbType>& M,const int& ConvergentRate = 3)
+{
+	return MatrixSign(M,vbNumericsPolicy<vbType>(),ConvergentRate);
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbMatrix<vbType> MatrixSign(const vbMatrix<vbType>& M,const int& ConvergentRate,const vbType& Zero)
+{
+	// An explicitly passed zero is used as the convergence tolerance
+	return MatrixSign(M,vbNumericsPolicy<vbType>(0,100,std::abs(Zero)),ConvergentRate);
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline vbMatrix<vbType> MatrixSign(const vbMatrix<vbType>& M,const vbNumericsPolicy<vbType>& Policy,const int& ConvergentRate = 3)
 {
-	vbType NewErr = 1;
+	typedef typename vbNumericsPolicy<vbType>::RealType RealType;
+
+	RealType NewErr = 1;
+	RealType OldErr = 1;
+	int NumOfIterations = 0;
 	int m = M.GetNumOfRows();
 
 	// Check to make sure that the matrix M is square
@@ -2094,13 +3919,13 @@ inline vbMatrix<vbType> MatrixSign(const vbMatrix<vbType>& M,const int& Converge
 	vbMatrix<vbType> Qr = eye<vbType>(m);
 	vbMatrix<vbType> Pold,Qold;
 	vbMatrix<vbType> S = M;
-	vbMatrix<vbType> Sinvsquared = power(inv(S),2);
+	vbMatrix<vbType> Sinvsquared = power(inv(S,Policy),2);
 
-	while(!(EqualsZero(NewErr,Zero)))
+	while(!(Policy.HasConverged(NewErr,OldErr,m,NumOfIterations)))
 	{
 		Pr = eye<vbType>(m);
 		Qr = eye<vbType>(m);
-		Sinvsquared = power(inv(S),2);
+		Sinvsquared = power(inv(S,Policy),2);
 		for(int i = 0; i < r; ++i)
 		{
 			Pold = Pr;
@@ -2109,9 +3934,12 @@ inline vbMatrix<vbType> MatrixSign(const vbMatrix<vbType>& M,const int& Converge
 			Qr = Pold + Qold;
 		}
 
-		S = S*inv(Qr)*Pr;
+		S = S*inv(Qr,Policy)*Pr;
+
+		OldErr = NewErr;
+		NewErr = std::abs(std::real(trace(S*S)) - RealType(m))/RealType(m);
 
-		NewErr = std::abs(std::real(trace(S*S)) - vbType(m))/vbType(m);
+		++NumOfIterations;
 	}
 
 	return S;
@@ -2122,9 +3950,19 @@ inline vbMatrix<vbType> MatrixSign(const vbMatrix<vbType>& M,const int& Converge
 //---------------------------------------------------------------------------------------
 template<typename vbType>
 inline void eigs(const vbMatrix<vbType>& A,vbMatrix<vbType>& EigenValues,vbMatrix<vbType>& EigenVectors)
+{
+	eigs(A,EigenValues,EigenVectors,vbNumericsPolicy<vbType>());
+}
+//---------------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------------------
+template<typename vbType>
+inline void eigs(const vbMatrix<vbType>& A,vbMatrix<vbType>& EigenValues,vbMatrix<vbType>& EigenVectors,
+				 const vbNumericsPolicy<vbType>& Policy)
 {
 	// Define a zero
-	vbType Zero = DefineZero(A);
+	vbType Zero = Policy.GetZero(A);
 
 	// Check if matrix A is square
 	int m = A.GetNumOfRows();
@@ -2146,7 +3984,7 @@ inline void eigs(const vbMatrix<vbType>& A,vbMatrix<vbType>& EigenValues,vbMatri
 	if(m == 2)
 	{
 		// Prepare the eigen value and eigen vector matrices
-		EigenVectors = vbMatrix<vbType>(m,m,0);
+		EigenVectors = vbMatrix<vbType>(m,m,vbType(0));
 		EigenValues = EigenVectors;
 
 		// Calculate the eigen values using the determinant of the 2x2 matrix
@@ -2180,7 +4018,7 @@ inline void eigs(const vbMatrix<vbType>& A,vbMatrix<vbType>& EigenValues,vbMatri
 
 	// Case for when A > 2x2
 	// Prepare the eigen vector and eigen value matrices
-	EigenVectors = vbMatrix<vbType>(m,m,0);
+	EigenVectors = vbMatrix<vbType>(m,m,vbType(0));
 	EigenValues = EigenVectors;
 	vbMatrix<vbType> SPlusEigenVectors;
 	vbMatrix<vbType> SMinusEigenVectors;
@@ -2195,7 +4033,7 @@ inline void eigs(const vbMatrix<vbType>& A,vbMatrix<vbType>& EigenValues,vbMatri
 	vbType EigAvg = std::real(trace(A))/vbType(m);
 
 	// Calculate the Sign+ and the Sign- of the shifted A (A is shifted by the EigAvg amount)
-	SPlus = vbType(0.5)*(II + MatrixSign(A - EigAvg*II));
+	SPlus = vbType(0.5)*(II + MatrixSign(A - EigAvg*II,Policy));
 	SMinus = II - SPlus;
 
 	// Calculate the traces of the Sign+ and Sign- matrices
@@ -2213,15 +4051,15 @@ inline void eigs(const vbMatrix<vbType>& A,vbMatrix<vbType>& EigenValues,vbMatri
 	EigenVectors.SetMatrixBlock(0,SMinusTrace,SPlusEigenVectors);
 
 	// Recursively call the eigs function until the individual eigenvalues are calculated
-	vbMatrix<vbType> RecursiveEigenValues1 = pinv(SMinusEigenVectors)*A*SMinusEigenVectors;
-	vbMatrix<vbType> RecursiveEigenValues2 = pinv(SPlusEigenVectors)*A*SPlusEigenVectors;
+	vbMatrix<vbType> RecursiveEigenValues1 = pinv(SMinusEigenVectors,Policy)*A*SMinusEigenVectors;
+	vbMatrix<vbType> RecursiveEigenValues2 = pinv(SPlusEigenVectors,Policy)*A*SPlusEigenVectors;
 
 	// Calculate the eigen value block matrix
 	EigenValues.SetMatrixBlock(0,0,RecursiveEigenValues1);
 	EigenValues.SetMatrixBlock(SMinusTrace,SMinusTrace,RecursiveEigenValues2);
 
-	eigs(EigenValues.GetMatrixBlock(0,0,SMinusTrace-1,SMinusTrace-1),RecursiveEigenValues1,SMinusEigenVectors);
-	eigs(EigenValues.GetMatrixBlock(SMinusTrace,SMinusTrace,m-1,m-1),RecursiveEigenValues2,SPlusEigenVectors);
+	eigs(EigenValues.GetMatrixBlock(0,0,SMinusTrace-1,SMinusTrace-1),RecursiveEigenValues1,SMinusEigenVectors,Policy);
+	eigs(EigenValues.GetMatrixBlock(SMinusTrace,SMinusTrace,m-1,m-1),RecursiveEigenValues2,SPlusEigenVectors,Policy);
 	EigenValues.SetMatrixBlock(0,0,RecursiveEigenValues1);
 	EigenValues.SetMatrixBlock(SMinusTrace,SMinusTrace,RecursiveEigenValues2);
 }
@@ -2276,7 +4114,7 @@ inline vbMatrix<vbType> BlockDiagonalize(const vbMatrix<vbType>& M)
 		return M;
 
 	// Create the resulting block diagonalized matrix
-	vbMatrix<vbType> Result(m,m,0);
+	vbMatrix<vbType> Result(m,m,vbType(0));
 
 	// Divide the matrix into blocks as follows: M = [A,B;C,D]
 	// A -- (m-1)x(m-1)
@@ -2315,14 +4153,14 @@ inline const vbMatrix<vbType> vbMatrix<vbType>::GetNormalizedMatrix()const
 	vbMatrix<vbType> Result(*this);
 	for(int i = 0; i < m_NumOfCols; ++i)
 	{
-		complex<vbType> Mag = 0;
+		typename vbScalarTraits<vbType>::RealType Mag = 0;
 
 		for(int j = 0; j < m_NumOfRows; ++j)
-			Mag += std::real(at(j,i)*std::conj(at(j,i)));
+			Mag += vbScalarTraits<vbType>::AbsSquared(at(j,i));
 
 		Mag = std::sqrt(Mag);
 
-		if(Mag != complex<vbType>(0))
+		if(Mag != 0)
 			for(int j = 0; j < m_NumOfRows; ++j)
 				Result.at(j,i) /= Mag;
 	}
@@ -2547,7 +4385,7 @@ inline void vbMatrix<vbType>::RandomizeMatrixIntelligently(const vbType& MinValu
 template<typename vbType>
 inline vbMatrix<vbType> eye(const int& NumOfRows)
 {
-	vbMatrix<vbType> Matrix(NumOfRows,NumOfRows,0);
+	vbMatrix<vbType> Matrix(NumOfRows,NumOfRows,vbType(0));
 
 	for(int i = 0; i < NumOfRows; ++i)
 		Matrix(i,i) = 1;
@@ -2561,7 +4399,7 @@ inline vbMatrix<vbType> eye(const int& NumOfRows)
 template<typename vbType>
 inline vbMatrix<vbType> zeroes(const int& NumOfRows,const int& NumOfCols)
 {
-	vbMatrix<vbType> Matrix(NumOfRows,NumOfRows,0);
+	vbMatrix<vbType> Matrix(NumOfRows,NumOfRows,vbType(0));
 	return Matrix;
 }
 //---------------------------------------------------------------------------------------
@@ -2635,7 +4473,7 @@ inline bool riccati(const vbMatrix<vbType>& A,const vbMatrix<vbType>& B,
 	vbMatrix<vbType> D = B*inv(R)*Transpose(B);
 
 	// Construct the hamiltonian matrix: H = [A,-D;-Q,-Transpose(A)];
-	vbMatrix<vbType> H(2*m,2*m,0);
+	vbMatrix<vbType> H(2*m,2*m,vbType(0));
 	H.SetMatrixBlock(0,0,A);
 	H.SetMatrixBlock(0,m,-D);
 	H.SetMatrixBlock(m,0,-Q);
@@ -2752,9 +4590,9 @@ inline vbType hinf(const vbMatrix<vbType>& A,const vbMatrix<vbType>& B,
 	vbMatrix<vbType> Dt = Transpose(D);
 
 	// Define a matrix Hgamma that will be used to calculate the infinity norm of the system
-	vbMatrix<vbType> HgammaMin(2*m,2*m,0);
-	vbMatrix<vbType> HgammaMax(2*m,2*m,0);
-	vbMatrix<vbType> HgammaNew(2*m,2*m,0);
+	vbMatrix<vbType> HgammaMin(2*m,2*m,vbType(0));
+	vbMatrix<vbType> HgammaMax(2*m,2*m,vbType(0));
+	vbMatrix<vbType> HgammaNew(2*m,2*m,vbType(0));
 
 	// Define matrices S and R which will be used to create the Hgamma matrix
 	vbMatrix<vbType> S;
@@ -2922,4 +4760,4 @@ inline vbType riccatiMIMO(const vbMatrix<vbType>& A,const vbMatrix<vbType>& B,
 
 //---------------------------------------------------------------------------------------
 #endif // _VBMATRIX_
-//---------------------------------------------------------------------------------------
\ No newline at end of file
+//---------------------------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,580 @@
+#ifndef BL_MEMORYMAPPEDARRAY_HPP
+#define BL_MEMORYMAPPEDARRAY_HPP
+
+
+///-------------------------------------------------------------------
+///
+///
+///
+/// PURPOSE:        A read-only array of numbers stored in a raw
+///                 binary file and memory mapped, its iterators
+///                 are plain pointers so it can be passed directly
+///                 to the downsampling algorithms, plus versions
+///                 of those algorithms that scan the file in
+///                 windows and release the pages behind them, so
+///                 that decimating a file much bigger than memory
+///                 only keeps a couple of windows resident
+///
+/// AUTHOR:         Vincenzo Barbato
+///                 navyenzo@gmail.com
+///
+/// NOTE:           All things in this library are defined within the
+///                 blMathAPI namespace
+///
+/// LISENSE:        MIT-LICENCE
+///                 http://www.opensource.org/licenses/mit-license.php
+///
+///
+///
+///-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Includes needed for this file
+//-------------------------------------------------------------------
+#include <algorithm>
+#include <cstddef>
+#include <string>
+
+#include "blMemoryMappedFile.hpp"
+#include "blDownsamplingAlgorithms.hpp"
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// NOTE: This class is defined within the blMathAPI namespace
+//-------------------------------------------------------------------
+namespace blMathAPI
+{
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+class blMemoryMappedArray
+{
+public: // Public typedefs
+
+
+
+    typedef blNumberType                    value_type;
+    typedef const blNumberType*             iterator;
+    typedef const blNumberType*             const_iterator;
+
+
+
+public: // Constructors and destructors
+
+
+
+    // Default constructor
+
+    blMemoryMappedArray();
+
+    // Constructor that opens a file
+
+    explicit blMemoryMappedArray(const std::string& filename,
+                                 const std::size_t& headerSize = 0);
+
+    // A mapping is not copyable
+
+    blMemoryMappedArray(const blMemoryMappedArray<blNumberType>&) = delete;
+    blMemoryMappedArray<blNumberType>&      operator=(const blMemoryMappedArray<blNumberType>&) = delete;
+
+    // Destructor
+
+    ~blMemoryMappedArray();
+
+
+
+public: // Public functions
+
+
+
+    // Maps the file and views everything after the
+    // first "headerSize" bytes as an array of numbers
+    // (trailing bytes that don't make a whole number
+    // are ignored)
+    //
+    // Returns false if the file could not be mapped
+    // or the numbers would not be properly aligned
+
+    bool                                    open(const std::string& filename,
+                                                 const std::size_t& headerSize = 0,
+                                                 const blMemoryAccessHint& accessHint = BL_ACCESS_SEQUENTIAL,
+                                                 const bool& useHugePages = false);
+
+    // Unmaps the file
+
+    void                                    close();
+
+    // Functions used to
+    // access the numbers
+
+    bool                                    isOpen()const;
+    bool                                    empty()const;
+
+    const std::size_t&                      size()const;
+
+    const blNumberType*                     data()const;
+
+    const_iterator                          begin()const;
+    const_iterator                          end()const;
+
+    const blNumberType&                     operator[](const std::size_t& index)const;
+
+    // Gives an access hint for a range of numbers,
+    // used by the scans below to prefetch the next
+    // window and to drop the windows already done
+
+    bool                                    advise(const std::size_t& firstIndex,
+                                                   const std::size_t& numberOfElements,
+                                                   const blMemoryAccessHint& accessHint)const;
+
+    // Function used to get the mapped file
+
+    const blMemoryMappedFile&               getMappedFile()const;
+
+
+
+private: // Private variables
+
+
+
+    // The mapped file
+
+    blMemoryMappedFile                      m_mappedFile;
+
+    // The numbers in the mapping
+
+    const blNumberType*                     m_data;
+    std::size_t                             m_size;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blMemoryMappedArray<blNumberType>::blMemoryMappedArray()
+{
+    m_data = nullptr;
+    m_size = 0;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blMemoryMappedArray<blNumberType>::blMemoryMappedArray(const std::string& filename,
+                                                              const std::size_t& headerSize) : blMemoryMappedArray()
+{
+    open(filename,headerSize);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blMemoryMappedArray<blNumberType>::~blMemoryMappedArray()
+{
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline bool blMemoryMappedArray<blNumberType>::open(const std::string& filename,
+                                                    const std::size_t& headerSize,
+                                                    const blMemoryAccessHint& accessHint,
+                                                    const bool& useHugePages)
+{
+    close();
+
+    if(!m_mappedFile.open(filename,accessHint,useHugePages))
+        return false;
+
+    if(m_mappedFile.size() <= headerSize)
+    {
+        // A file with no numbers
+        // is still a valid array
+
+        return true;
+    }
+
+    // The mapping is page aligned, so only the
+    // header can break the numbers' alignment
+
+    if(headerSize % alignof(blNumberType) != 0)
+    {
+        close();
+        return false;
+    }
+
+    m_data = reinterpret_cast<const blNumberType*>(m_mappedFile.data() + headerSize);
+    m_size = (m_mappedFile.size() - headerSize) / sizeof(blNumberType);
+
+    return true;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blMemoryMappedArray<blNumberType>::close()
+{
+    m_mappedFile.close();
+
+    m_data = nullptr;
+    m_size = 0;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline bool blMemoryMappedArray<blNumberType>::isOpen()const
+{
+    return m_mappedFile.isOpen();
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline bool blMemoryMappedArray<blNumberType>::empty()const
+{
+    return m_size == 0;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const std::size_t& blMemoryMappedArray<blNumberType>::size()const
+{
+    return m_size;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const blNumberType* blMemoryMappedArray<blNumberType>::data()const
+{
+    return m_data;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline typename blMemoryMappedArray<blNumberType>::const_iterator blMemoryMappedArray<blNumberType>::begin()const
+{
+    return m_data;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline typename blMemoryMappedArray<blNumberType>::const_iterator blMemoryMappedArray<blNumberType>::end()const
+{
+    return m_data + m_size;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const blNumberType& blMemoryMappedArray<blNumberType>::operator[](const std::size_t& index)const
+{
+    return m_data[index];
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline bool blMemoryMappedArray<blNumberType>::advise(const std::size_t& firstIndex,
+                                                      const std::size_t& numberOfElements,
+                                                      const blMemoryAccessHint& accessHint)const
+{
+    if(m_data == nullptr || firstIndex >= m_size)
+        return false;
+
+    std::size_t offset = std::size_t(reinterpret_cast<const char*>(m_data + firstIndex) - m_mappedFile.data());
+
+    return m_mappedFile.advise(offset,
+                               std::min(numberOfElements,m_size - firstIndex) * sizeof(blNumberType),
+                               accessHint);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const blMemoryMappedFile& blMemoryMappedArray<blNumberType>::getMappedFile()const
+{
+    return m_mappedFile;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The plan of a windowed Largest-Triangle-Three-Buckets
+// scan, the inner buckets are the same ones used by
+// largestTriangleThreeBuckets and are grouped into
+// windows of about half the allowed resident memory,
+// so the window being scanned and the prefetched one
+// fit in it together
+//-------------------------------------------------------------------
+struct blBucketScanPlan
+{
+    std::size_t                             bucketStep = 0;
+    std::size_t                             numberOfInnerBuckets = 0;
+    std::size_t                             bucketsPerWindow = 0;
+    std::size_t                             numberOfWindows = 0;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+inline blBucketScanPlan planBucketScan(const std::size_t& srcDataSize,
+                                       const std::size_t& dstDataSize,
+                                       const std::size_t& sampleSize,
+                                       const std::size_t& maxResidentBytes)
+{
+    blBucketScanPlan plan;
+
+    if(dstDataSize < 3 || dstDataSize >= srcDataSize)
+        return plan;
+
+    plan.bucketStep = srcDataSize / dstDataSize;
+    plan.numberOfInnerBuckets = dstDataSize - 2;
+
+    std::size_t bytesPerBucket = plan.bucketStep * sampleSize;
+
+    plan.bucketsPerWindow = std::max(std::size_t(1),maxResidentBytes / 2 / std::max(std::size_t(1),bytesPerBucket));
+    plan.bucketsPerWindow = std::min(plan.bucketsPerWindow,plan.numberOfInnerBuckets);
+
+    plan.numberOfWindows = (plan.numberOfInnerBuckets + plan.bucketsPerWindow - 1) / plan.bucketsPerWindow;
+
+    return plan;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Gets the buckets [firstBucket,endBucket) of a window
+// (numbered from 1 like the destination points they
+// give) and the samples the window reads, which are
+// its buckets plus the bucket after them whose average
+// is needed to pick the window's last point
+//-------------------------------------------------------------------
+inline void getBucketScanWindow(const blBucketScanPlan& plan,
+                                const std::size_t& windowIndex,
+                                std::size_t& firstBucket,
+                                std::size_t& endBucket,
+                                std::size_t& firstSample,
+                                std::size_t& numberOfSamples)
+{
+    firstBucket = 1 + windowIndex * plan.bucketsPerWindow;
+    endBucket = std::min(firstBucket + plan.bucketsPerWindow,plan.numberOfInnerBuckets + 1);
+
+    firstSample = 1 + (firstBucket - 1) * plan.bucketStep;
+    numberOfSamples = (endBucket - firstBucket + 1) * plan.bucketStep;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The following function downsamples a memory mapped
+// array with the Largest-Triangle-Three-Buckets algorithm
+// giving the same points as largestTriangleThreeBuckets,
+// but it scans the array in windows, prefetching the
+// next window and dropping the pages of the finished
+// ones, so the resident memory stays around the given
+// number of bytes no matter how big the file is
+//-------------------------------------------------------------------
+template<typename blNumberType,
+         typename dstDataIteratorType>
+
+inline void largestTriangleThreeBucketsMapped(const blMemoryMappedArray<blNumberType>& srcData,
+                                              dstDataIteratorType dstDataBegin,
+                                              const std::size_t& dstDataSize,
+                                              const std::size_t& maxResidentBytes = std::size_t(256) << 20)
+{
+    const std::size_t& srcDataSize = srcData.size();
+
+    const blNumberType* srcDataBegin = srcData.begin();
+
+    blBucketScanPlan plan = planBucketScan(srcDataSize,dstDataSize,sizeof(blNumberType),maxResidentBytes);
+
+    if(plan.numberOfWindows == 0)
+    {
+        // Nothing to scan, the special
+        // cases touch just a few samples
+
+        largestTriangleThreeBuckets(srcDataBegin,srcDataSize,dstDataBegin,dstDataSize);
+
+        return;
+    }
+
+    // The triangles are measured from the first
+    // sample like in largestTriangleThreeBuckets
+
+    blNumberType previousBucketPoint = srcDataBegin[0];
+
+    (*dstDataBegin) = previousBucketPoint;
+    ++dstDataBegin;
+
+    std::size_t firstBucket = 0;
+    std::size_t endBucket = 0;
+    std::size_t firstSample = 0;
+    std::size_t numberOfSamples = 0;
+
+    getBucketScanWindow(plan,0,firstBucket,endBucket,firstSample,numberOfSamples);
+
+    srcData.advise(firstSample,numberOfSamples,BL_ACCESS_WILL_NEED);
+
+    for(std::size_t windowIndex = 0; windowIndex < plan.numberOfWindows; ++windowIndex)
+    {
+        getBucketScanWindow(plan,windowIndex,firstBucket,endBucket,firstSample,numberOfSamples);
+
+        // Start reading the next window
+        // while this one is scanned
+
+        if(windowIndex + 1 < plan.numberOfWindows)
+        {
+            std::size_t nextFirstBucket = 0;
+            std::size_t nextEndBucket = 0;
+            std::size_t nextFirstSample = 0;
+            std::size_t nextNumberOfSamples = 0;
+
+            getBucketScanWindow(plan,windowIndex + 1,nextFirstBucket,nextEndBucket,nextFirstSample,nextNumberOfSamples);
+
+            srcData.advise(nextFirstSample,nextNumberOfSamples,BL_ACCESS_WILL_NEED);
+        }
+
+        for(std::size_t bucketIndex = firstBucket; bucketIndex < endBucket; ++bucketIndex)
+        {
+            const blNumberType* srcCurrentBucketIterator = srcDataBegin + 1 + (bucketIndex - 1) * plan.bucketStep;
+            const blNumberType* srcNextBucketIterator = srcCurrentBucketIterator + plan.bucketStep;
+
+            // Calculate the average value
+            // of the next bucket
+
+            blNumberType nextBucketAvgValue = 0;
+
+            for(std::size_t i = 0; i < plan.bucketStep; ++i)
+                nextBucketAvgValue += srcNextBucketIterator[i];
+
+            nextBucketAvgValue /= static_cast<blNumberType>(plan.bucketStep);
+
+            std::ptrdiff_t largestTriangleIndex = findLargestTriangleInBucket(srcCurrentBucketIterator,
+                                                                              plan.bucketStep,
+                                                                              nextBucketAvgValue,
+                                                                              previousBucketPoint);
+
+            if(largestTriangleIndex >= 0)
+                (*dstDataBegin) = srcCurrentBucketIterator[largestTriangleIndex];
+
+            ++dstDataBegin;
+        }
+
+        // Drop the window's buckets, the bucket
+        // after them is the next window's first
+
+        srcData.advise(firstSample,(endBucket - firstBucket) * plan.bucketStep,BL_ACCESS_DONT_NEED);
+    }
+
+    (*dstDataBegin) = srcDataBegin[srcDataSize - 1];
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The following function downsamples a memory mapped array
+// by skipping samples like simpleDownsample, dropping the
+// pages it has gone past once they add up to the given
+// number of bytes, and switching to random access when
+// the samples are more than a page apart so the system
+// doesn't read in the pages being skipped
+//-------------------------------------------------------------------
+template<typename blNumberType,
+         typename dstDataIteratorType>
+
+inline void simpleDownsampleMapped(const blMemoryMappedArray<blNumberType>& srcData,
+                                   dstDataIteratorType dstDataBegin,
+                                   const std::size_t& dstDataSize,
+                                   const std::size_t& maxResidentBytes = std::size_t(256) << 20)
+{
+    const std::size_t& srcDataSize = srcData.size();
+
+    if(srcDataSize == 0 || dstDataSize == 0)
+        return;
+
+    const blNumberType* srcDataBegin = srcData.begin();
+
+    if(srcDataSize / dstDataSize * sizeof(blNumberType) > blMemoryMappedFile::getPageSize())
+        srcData.advise(0,srcDataSize,BL_ACCESS_RANDOM);
+
+    std::size_t releaseWindowSize = std::max(std::size_t(1),maxResidentBytes / sizeof(blNumberType));
+
+    std::size_t releasedSamples = 0;
+
+    blExactSamplingStepper stepper(srcDataSize,dstDataSize);
+
+    for(std::size_t i = 0; i < dstDataSize; ++i)
+    {
+        if(i > 0)
+            stepper.step();
+
+        (*dstDataBegin) = srcDataBegin[stepper.index];
+
+        ++dstDataBegin;
+
+        // Drop the pages we've gone past
+
+        if(stepper.index - releasedSamples >= releaseWindowSize)
+        {
+            srcData.advise(releasedSamples,stepper.index - releasedSamples,BL_ACCESS_DONT_NEED);
+
+            releasedSamples = stepper.index;
+        }
+    }
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// End of the blMathAPI namespace
+}
+//-------------------------------------------------------------------
+
+
+
+#endif // BL_MEMORYMAPPEDARRAY_HPP
@@ -0,0 +1,464 @@
+#ifndef BL_MEMORYMAPPEDFILE_HPP
+#define BL_MEMORYMAPPEDFILE_HPP
+
+
+///-------------------------------------------------------------------
+///
+///
+///
+/// PURPOSE:        A simple read-only memory mapped file, used to
+///                 work on large data sets saved to disk without
+///                 reading them into memory first, with access
+///                 hints so that large sequential scans don't
+///                 keep the whole file resident
+///
+/// AUTHOR:         Vincenzo Barbato
+///                 navyenzo@gmail.com
+///
+/// NOTE:           All things in this library are defined within the
+///                 blMathAPI namespace
+///
+/// LISENSE:        MIT-LICENCE
+///                 http://www.opensource.org/licenses/mit-license.php
+///
+///
+///
+///-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Includes needed for this file
+//-------------------------------------------------------------------
+#include <cstddef>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// NOTE: This class is defined within the blMathAPI namespace
+//-------------------------------------------------------------------
+namespace blMathAPI
+{
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Enum used to tell the system how a
+// mapped range is going to be accessed
+//-------------------------------------------------------------------
+enum blMemoryAccessHint {BL_ACCESS_NORMAL,
+                         BL_ACCESS_SEQUENTIAL,
+                         BL_ACCESS_RANDOM,
+                         BL_ACCESS_WILL_NEED,
+                         BL_ACCESS_DONT_NEED};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+class blMemoryMappedFile
+{
+public: // Constructors and destructors
+
+
+
+    // Default constructor
+
+    blMemoryMappedFile();
+
+    // Constructor that opens a file
+
+    explicit blMemoryMappedFile(const std::string& filename);
+
+    // A mapping is not copyable
+
+    blMemoryMappedFile(const blMemoryMappedFile&) = delete;
+    blMemoryMappedFile&                     operator=(const blMemoryMappedFile&) = delete;
+
+    // Destructor
+
+    ~blMemoryMappedFile();
+
+
+
+public: // Public functions
+
+
+
+    // Maps the whole file read-only, returning
+    // false if it could not be opened or mapped
+    // (an empty file opens with a null data pointer)
+    //
+    // The access hint is applied to the whole
+    // mapping, and huge pages are asked for
+    // where the system supports them for files
+
+    bool                                    open(const std::string& filename,
+                                                 const blMemoryAccessHint& accessHint = BL_ACCESS_NORMAL,
+                                                 const bool& useHugePages = false);
+
+    // Unmaps the file
+
+    void                                    close();
+
+    // Functions used to get
+    // the mapped contents
+
+    bool                                    isOpen()const;
+
+    const char*                             data()const;
+    std::size_t                             size()const;
+
+    // Gives an access hint for the whole mapping
+    // or for a byte range of it (widened to whole
+    // pages), returning false if the hint could
+    // not be applied (always on Windows)
+    //
+    // BL_ACCESS_DONT_NEED drops the pages of the
+    // range from the process, they are read back
+    // from the file if touched again
+
+    bool                                    advise(const blMemoryAccessHint& accessHint)const;
+
+    bool                                    advise(const std::size_t& offset,
+                                                   const std::size_t& length,
+                                                   const blMemoryAccessHint& accessHint)const;
+
+    // Size of a memory page
+
+    static std::size_t                      getPageSize();
+
+
+
+private: // Private variables
+
+
+
+    // The mapped view and its size
+
+    const char*                             m_data;
+    std::size_t                             m_size;
+
+    bool                                    m_isOpen;
+
+#ifdef _WIN32
+
+    // The file and mapping handles
+
+    HANDLE                                  m_fileHandle;
+    HANDLE                                  m_mappingHandle;
+
+#endif
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+inline blMemoryMappedFile::blMemoryMappedFile()
+{
+    m_data = nullptr;
+    m_size = 0;
+    m_isOpen = false;
+
+#ifdef _WIN32
+    m_fileHandle = INVALID_HANDLE_VALUE;
+    m_mappingHandle = NULL;
+#endif
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+inline blMemoryMappedFile::blMemoryMappedFile(const std::string& filename) : blMemoryMappedFile()
+{
+    open(filename);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+inline blMemoryMappedFile::~blMemoryMappedFile()
+{
+    close();
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+inline bool blMemoryMappedFile::open(const std::string& filename,
+                                     const blMemoryAccessHint& accessHint,
+                                     const bool& useHugePages)
+{
+    close();
+
+#ifdef _WIN32
+
+    m_fileHandle = CreateFileA(filename.c_str(),
+                               GENERIC_READ,
+                               FILE_SHARE_READ,
+                               NULL,
+                               OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL,
+                               NULL);
+
+    if(m_fileHandle == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+
+    if(!GetFileSizeEx(m_fileHandle,&fileSize))
+    {
+        close();
+        return false;
+    }
+
+    m_size = std::size_t(fileSize.QuadPart);
+
+    if(m_size > 0)
+    {
+        m_mappingHandle = CreateFileMappingA(m_fileHandle,NULL,PAGE_READONLY,0,0,NULL);
+
+        if(m_mappingHandle == NULL)
+        {
+            close();
+            return false;
+        }
+
+        m_data = static_cast<const char*>(MapViewOfFile(m_mappingHandle,FILE_MAP_READ,0,0,0));
+
+        if(m_data == nullptr)
+        {
+            close();
+            return false;
+        }
+    }
+
+#else
+
+    int fileDescriptor = ::open(filename.c_str(),O_RDONLY);
+
+    if(fileDescriptor < 0)
+        return false;
+
+    struct stat fileStatus;
+
+    if(fstat(fileDescriptor,&fileStatus) != 0)
+    {
+        ::close(fileDescriptor);
+        return false;
+    }
+
+    m_size = std::size_t(fileStatus.st_size);
+
+    if(m_size > 0)
+    {
+        void* mappedData = mmap(nullptr,m_size,PROT_READ,MAP_PRIVATE,fileDescriptor,0);
+
+        if(mappedData == MAP_FAILED)
+        {
+            ::close(fileDescriptor);
+            m_size = 0;
+            return false;
+        }
+
+        m_data = static_cast<const char*>(mappedData);
+
+#ifdef MADV_HUGEPAGE
+
+        if(useHugePages)
+            madvise(mappedData,m_size,MADV_HUGEPAGE);
+
+#endif
+    }
+
+    // The mapping stays valid
+    // after the file is closed
+
+    ::close(fileDescriptor);
+
+#endif
+
+    m_isOpen = true;
+
+#ifdef _WIN32
+    (void)useHugePages;
+#endif
+
+    if(accessHint != BL_ACCESS_NORMAL)
+        advise(accessHint);
+
+    return true;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+inline void blMemoryMappedFile::close()
+{
+#ifdef _WIN32
+
+    if(m_data != nullptr)
+        UnmapViewOfFile(m_data);
+
+    if(m_mappingHandle != NULL)
+        CloseHandle(m_mappingHandle);
+
+    if(m_fileHandle != INVALID_HANDLE_VALUE)
+        CloseHandle(m_fileHandle);
+
+    m_mappingHandle = NULL;
+    m_fileHandle = INVALID_HANDLE_VALUE;
+
+#else
+
+    if(m_data != nullptr)
+        munmap(const_cast<char*>(m_data),m_size);
+
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+    m_isOpen = false;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+inline bool blMemoryMappedFile::isOpen()const
+{
+    return m_isOpen;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+inline const char* blMemoryMappedFile::data()const
+{
+    return m_data;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+inline std::size_t blMemoryMappedFile::size()const
+{
+    return m_size;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+inline bool blMemoryMappedFile::advise(const blMemoryAccessHint& accessHint)const
+{
+    return advise(0,m_size,accessHint);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+inline bool blMemoryMappedFile::advise(const std::size_t& offset,
+                                       const std::size_t& length,
+                                       const blMemoryAccessHint& accessHint)const
+{
+    if(m_data == nullptr || offset >= m_size || length == 0)
+        return false;
+
+#ifdef _WIN32
+
+    (void)accessHint;
+
+    return false;
+
+#else
+
+    // madvise needs a page aligned start
+
+    std::size_t pageSize = getPageSize();
+
+    std::size_t rangeBegin = offset - offset % pageSize;
+    std::size_t rangeEnd = (length > m_size - offset) ? m_size : offset + length;
+
+    int advice = MADV_NORMAL;
+
+    switch(accessHint)
+    {
+    case BL_ACCESS_SEQUENTIAL:
+        advice = MADV_SEQUENTIAL;
+        break;
+    case BL_ACCESS_RANDOM:
+        advice = MADV_RANDOM;
+        break;
+    case BL_ACCESS_WILL_NEED:
+        advice = MADV_WILLNEED;
+        break;
+    case BL_ACCESS_DONT_NEED:
+        advice = MADV_DONTNEED;
+        break;
+    default:
+        advice = MADV_NORMAL;
+        break;
+    }
+
+    return madvise(const_cast<char*>(m_data) + rangeBegin,rangeEnd - rangeBegin,advice) == 0;
+
+#endif
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+inline std::size_t blMemoryMappedFile::getPageSize()
+{
+#ifdef _WIN32
+
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+
+    return std::size_t(systemInfo.dwPageSize);
+
+#else
+
+    long pageSize = sysconf(_SC_PAGESIZE);
+
+    return (pageSize > 0) ? std::size_t(pageSize) : std::size_t(4096);
+
+#endif
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// End of the blMathAPI namespace
+}
+//-------------------------------------------------------------------
+
+
+
+#endif // BL_MEMORYMAPPEDFILE_HPP
@@ -9,7 +9,11 @@
 ///
 /// PURPOSE:        A collection of runga-kutta
 ///                 methods to solve systems of
-///                 differential equations
+///                 differential equations, along
+///                 with symplectic (velocity Verlet,
+///                 Yoshida) and Lie group (RKMK on
+///                 SO(3)) methods for mechanical and
+///                 rotational systems
 ///
 /// AUTHOR:         Vincenzo Barbato
 ///                 navyenzo@gmail.com
@@ -29,8 +33,11 @@
 //-------------------------------------------------------------------
 // Includes needed for this file
 //-------------------------------------------------------------------
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include "blNumericFunctions.hpp"
+#include "blQuaternion.hpp"
 //-------------------------------------------------------------------
 
 
@@ -456,7 +463,7 @@ inline void rkf(const blODEFunctorType& ODEfunctor,
     {
         k[i + 3 * n] = h * yTemp[i];
 
-        y4th[i] = y0[i] + (439.0/216.0) * k[i] - 8.0 * k[i + n] + (3680.0/513.0) * k[i + 2 * n] - (845.0/4101.0) * k[i + 3 * n];
+        y4th[i] = y0[i] + (439.0/216.0) * k[i] - 8.0 * k[i + n] + (3680.0/513.0) * k[i + 2 * n] - (845.0/4104.0) * k[i + 3 * n];
     }
 
     // Calculate the K5 coeffs
@@ -476,11 +483,11 @@ inline void rkf(const blODEFunctorType& ODEfunctor,
 
     for(int i = 0; i < n; ++i)
     {
-        k[i + 5 * n] = h * yTemp;
+        k[i + 5 * n] = h * yTemp[i];
 
         // Using the 4th-order RK
 
-        y4th[i] = y0[i] + (25.0/216.0) * k[i] + (1408.0/2565.0) * k[i + 2 * n] + (2197.0/4104.0) * k[1 + 3 * n] - 0.20 * k[i + 4 * n];
+        y4th[i] = y0[i] + (25.0/216.0) * k[i] + (1408.0/2565.0) * k[i + 2 * n] + (2197.0/4104.0) * k[i + 3 * n] - 0.20 * k[i + 4 * n];
 
         // Using the 5th-order RK
 
@@ -595,15 +602,15 @@ inline void rkCK(const blODEFunctorType& ODEfunctor,
 
     for(int i = 0; i < n; ++i)
     {
-        k[i + 5 * n] = h * yTemp;
+        k[i + 5 * n] = h * yTemp[i];
 
         // Using the 4th-order RK
 
-        y4th[i] = y0[i] + (37.0/378.0) * k[i] + (250.0/621.0) * k[i + 2 * n] + (125.0/594.0) * k[1 + 3 * n] + (512.0/1771.0) * k[i + 4 * n];
+        y4th[i] = y0[i] + (2825.0/27648.0) * k[i] + (18575.0/48384.0) * k[i + 2 * n] + (13525.0/55296.0) * k[i + 3 * n] + (277.0/14336.0) * k[i + 4 * n] + 0.25 * k[i + 5 * n];
 
         // Using the 5th-order RK
 
-        y5th[i] = y0[i] + (2825.0/27648.0) * k[i] + (18575.0/48384.0) * k[i + 2 * n] + (13525.0/55296.0) * k[i + 3 * n] + (277.0/14336.0) * k[i + 4 * n] + 0.25 * k[i + 5 * n];
+        y5th[i] = y0[i] + (37.0/378.0) * k[i] + (250.0/621.0) * k[i + 2 * n] + (125.0/594.0) * k[i + 3 * n] + (512.0/1771.0) * k[i + 5 * n];
     }
 }
 //-------------------------------------------------------------------
@@ -724,7 +731,7 @@ inline int rkfCKSolver(const blODEFunctorType& ODEfunctor,
         rkCK(ODEfunctor,
              numberOfStateVariables,
              initialConditions,
-             t,
+             currentTime,
              h,
              y4thCurrentStateVector,
              y5thCurrentStateVector,
@@ -793,6 +800,740 @@ inline int rkfCKSolver(const blODEFunctorType& ODEfunctor,
 
 
 
+//-------------------------------------------------------------------
+// Gustafsson's PI step size controller, the
+// new step is h * getStepSizeFactor(error,...)
+// where the error is already scaled by the
+// tolerances (a step is accepted if error <= 1)
+//
+// - errorOrder is the order of the error
+//   estimator plus one (5 for Dormand-Prince)
+//-------------------------------------------------------------------
+template<typename blNumberType>
+
+struct blPIStepSizeController
+{
+    blPIStepSizeController(const int& errorOrder = 5,
+                           const blNumberType& beta = 0.04) : alpha(blNumberType(1) / blNumberType(errorOrder) - blNumberType(0.75) * beta),
+                                                              beta(beta),
+                                                              safety(0.9),
+                                                              minFactor(0.2),
+                                                              maxFactor(10),
+                                                              previousError(1e-4),
+                                                              wasLastStepRejected(false){}
+
+    void                                    reset()
+    {
+        previousError = blNumberType(1e-4);
+        wasLastStepRejected = false;
+    }
+
+    blNumberType                            getStepSizeFactor(const blNumberType& error,
+                                                              const bool& isStepAccepted)
+    {
+        blNumberType proportionalTerm = std::pow(std::max(error,blNumberType(1e-16)),alpha);
+
+        if(!isStepAccepted)
+        {
+            wasLastStepRejected = true;
+
+            return std::max(minFactor,safety / proportionalTerm);
+        }
+
+        // The integral term uses the error of the
+        // last accepted step, h_new = h * safety *
+        // error^-alpha * previousError^beta, so a
+        // step that follows a large error grows
+        // less than the error alone would allow
+
+        blNumberType factor = safety * std::pow(previousError,beta) / proportionalTerm;
+
+        factor = std::min(maxFactor,std::max(minFactor,factor));
+
+        // Right after a rejection the step
+        // is not allowed to grow
+
+        if(wasLastStepRejected)
+            factor = std::min(factor,blNumberType(1));
+
+        previousError = std::max(error,blNumberType(1e-4));
+        wasLastStepRejected = false;
+
+        return factor;
+    }
+
+    blNumberType                            alpha;
+    blNumberType                            beta;
+    blNumberType                            safety;
+    blNumberType                            minFactor;
+    blNumberType                            maxFactor;
+    blNumberType                            previousError;
+    bool                                    wasLastStepRejected;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The following function implements one step of
+// the Dormand-Prince 5(4) algorithm for adaptive
+// integration of a system of equations
+//
+// - Use it in a loop to numerically compute
+//   the solution to an ODE system
+//
+// - The method is first-same-as-last (FSAL), the
+//   last stage is the derivative at the new state,
+//   so when the step is accepted the caller copies
+//   k[6n...7n) into k[0...n) and calls the next step
+//   with isFirstStageEvaluated = true, which saves
+//   one ODE evaluation per step
+//-------------------------------------------------------------------
+template<typename blNumberType,
+         typename blStateVectorType,
+         typename blInitialConditionsVectorType,
+         typename blRKcoeffsVectorType,
+         typename blODEFunctorType>
+
+inline void rkDP(const blODEFunctorType& ODEfunctor,
+                 const int& n,
+                 const blInitialConditionsVectorType& y0,
+                 const blNumberType& t,
+                 const blNumberType& h,
+                 blStateVectorType& y5th,
+                 blStateVectorType& yError,
+                 blRKcoeffsVectorType& k,
+                 blStateVectorType& yTemp,
+                 const bool& isFirstStageEvaluated)
+{
+    // NOTE:  This function assumes the following:
+    //
+    //          1.  The size of the state equations
+    //              vector is the same as the size
+    //              of the state variables vector and
+    //              the same as the size of the
+    //              initial conditions vector.
+    //
+    //          2.  The coefficient vector
+    //              is 7*StateSize coefficients
+    //
+    //          3.  Unlike rkf/rkCK, the coefficients are
+    //              the derivatives themselves (not scaled
+    //              by h), so that they can be reused by
+    //              the dense output
+    //
+    //          4.  yError is the difference between the
+    //              5th and the 4th-order solutions
+
+    // Calculate the K1 coeffs
+
+    if(!isFirstStageEvaluated)
+    {
+        ODEfunctor(t,y0,yTemp);
+
+        for(int i = 0; i < n; ++i)
+            k[i] = yTemp[i];
+    }
+
+    for(int i = 0; i < n; ++i)
+        y5th[i] = y0[i] + h * (0.2 * k[i]);
+
+    // Calculate the K2 coeffs
+
+    ODEfunctor(t + 0.2 * h,y5th,yTemp);
+
+    for(int i = 0; i < n; ++i)
+    {
+        k[i + n] = yTemp[i];
+
+        y5th[i] = y0[i] + h * ((3.0/40.0) * k[i] + (9.0/40.0) * k[i + n]);
+    }
+
+    // Calculate the K3 coeffs
+
+    ODEfunctor(t + 0.3 * h,y5th,yTemp);
+
+    for(int i = 0; i < n; ++i)
+    {
+        k[i + 2 * n] = yTemp[i];
+
+        y5th[i] = y0[i] + h * ((44.0/45.0) * k[i] - (56.0/15.0) * k[i + n] + (32.0/9.0) * k[i + 2 * n]);
+    }
+
+    // Calculate the K4 coeffs
+
+    ODEfunctor(t + 0.8 * h,y5th,yTemp);
+
+    for(int i = 0; i < n; ++i)
+    {
+        k[i + 3 * n] = yTemp[i];
+
+        y5th[i] = y0[i] + h * ((19372.0/6561.0) * k[i] - (25360.0/2187.0) * k[i + n] + (64448.0/6561.0) * k[i + 2 * n] - (212.0/729.0) * k[i + 3 * n]);
+    }
+
+    // Calculate the K5 coeffs
+
+    ODEfunctor(t + (8.0/9.0) * h,y5th,yTemp);
+
+    for(int i = 0; i < n; ++i)
+    {
+        k[i + 4 * n] = yTemp[i];
+
+        y5th[i] = y0[i] + h * ((9017.0/3168.0) * k[i] - (355.0/33.0) * k[i + n] + (46732.0/5247.0) * k[i + 2 * n] + (49.0/176.0) * k[i + 3 * n] - (5103.0/18656.0) * k[i + 4 * n]);
+    }
+
+    // Calculate the K6 coeffs
+
+    ODEfunctor(t + h,y5th,yTemp);
+
+    // Using the 5th-order RK
+
+    for(int i = 0; i < n; ++i)
+    {
+        k[i + 5 * n] = yTemp[i];
+
+        y5th[i] = y0[i] + h * ((35.0/384.0) * k[i] + (500.0/1113.0) * k[i + 2 * n] + (125.0/192.0) * k[i + 3 * n] - (2187.0/6784.0) * k[i + 4 * n] + (11.0/84.0) * k[i + 5 * n]);
+    }
+
+    // Calculate the K7 coeffs, the
+    // derivative at the new state
+
+    ODEfunctor(t + h,y5th,yTemp);
+
+    // The error is the difference between
+    // the 5th-order and the 4th-order RK
+
+    for(int i = 0; i < n; ++i)
+    {
+        k[i + 6 * n] = yTemp[i];
+
+        yError[i] = h * ((71.0/57600.0) * k[i] - (71.0/16695.0) * k[i + 2 * n] + (71.0/1920.0) * k[i + 3 * n] - (17253.0/339200.0) * k[i + 4 * n] + (22.0/525.0) * k[i + 5 * n] - (1.0/40.0) * k[i + 6 * n]);
+    }
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The following function calculates the scaled
+// RMS norm of a step error, the step is accepted
+// when it's less than or equal to 1
+//-------------------------------------------------------------------
+template<typename blNumberType,
+         typename blStateVectorType,
+         typename blInitialConditionsVectorType>
+
+inline blNumberType rkErrorNorm(const int& n,
+                                const blInitialConditionsVectorType& y0,
+                                const blStateVectorType& y1,
+                                const blStateVectorType& yError,
+                                const blNumberType& absoluteTolerance,
+                                const blNumberType& relativeTolerance)
+{
+    if(n <= 0)
+        return blNumberType(0);
+
+    blNumberType sum = 0;
+
+    for(int i = 0; i < n; ++i)
+    {
+        blNumberType scale = absoluteTolerance + relativeTolerance * std::max(std::abs(blNumberType(y0[i])),std::abs(blNumberType(y1[i])));
+
+        blNumberType scaledError = yError[i] / scale;
+
+        sum += scaledError * scaledError;
+    }
+
+    return std::sqrt(sum / blNumberType(n));
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The following function evaluates the cubic Hermite
+// interpolant of a step from (t,y0) to (t+h,y1) at
+// t + theta*h, theta in [0,1]
+//
+// - fStart and fEnd are the derivatives at
+//   both ends, for rkDP those are the first
+//   and last stages (k[0...n) and k[6n...7n)),
+//   so the dense output costs no evaluations
+//-------------------------------------------------------------------
+template<typename blNumberType,
+         typename blStateVectorType,
+         typename blInitialConditionsVectorType,
+         typename blRKcoeffsVectorType,
+         typename blOutputVectorType>
+
+inline void rkHermiteDenseOutput(const int& n,
+                                 const blInitialConditionsVectorType& y0,
+                                 const blStateVectorType& y1,
+                                 const blRKcoeffsVectorType& fStart,
+                                 const int& fStartOffset,
+                                 const blRKcoeffsVectorType& fEnd,
+                                 const int& fEndOffset,
+                                 const blNumberType& h,
+                                 const blNumberType& theta,
+                                 blOutputVectorType& yOut)
+{
+    for(int i = 0; i < n; ++i)
+    {
+        blNumberType difference = y1[i] - y0[i];
+        blNumberType startSlope = h * fStart[i + fStartOffset] - difference;
+        blNumberType curvature = difference - h * fEnd[i + fEndOffset] - startSlope;
+
+        yOut[i] = y0[i] + theta * (difference + (1.0 - theta) * (startSlope + theta * curvature));
+    }
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The following function numerically solves an
+// ODE system using the adaptive Dormand-Prince 5(4)
+// algorithm with a PI step size controller, and
+// samples the solution at the requested output
+// times using the dense output, so the output
+// times don't limit the step size
+//
+// - The output times have to be sorted, the ones
+//   outside [t0,tf] are skipped
+//
+// - Returns the number of output times written,
+//   which is less than numberOfOutputTimes if
+//   maxNumberOfSteps weren't enough to reach tf
+//-------------------------------------------------------------------
+template<typename blNumberType,
+         typename blSolutionMatrixType,
+         typename blTimeVectorType,
+         typename blInitialConditionsVectorType,
+         typename blODEFunctorType>
+
+inline int rkDPSolver(const blODEFunctorType& ODEfunctor,
+                      const int& numberOfStateVariables,
+                      const blNumberType& t0,
+                      const blNumberType& tf,
+                      const blTimeVectorType& outputTimes,
+                      const int& numberOfOutputTimes,
+                      blSolutionMatrixType& y,
+                      const blInitialConditionsVectorType& y0,
+                      const blNumberType& absoluteTolerance,
+                      const blNumberType& relativeTolerance,
+                      const int& maxNumberOfSteps)
+{
+    if(numberOfStateVariables <= 0 ||
+       maxNumberOfSteps <= 0 ||
+       tf <= t0)
+    {
+        return 0;
+    }
+
+    // NOTE:  This function assumes the following:
+    //
+    //          1.  The size of the state equations
+    //              vector is the same as the size
+    //              of the initial conditions vector
+    //              and they both are the size stated
+    //              by the numberOfStateVariables
+    //
+    //          2.  The solution is a vector of vectors,
+    //              or matrix, where the rows correspond
+    //              to the different solutions (y1,y2,y3,...,yn)
+    //              and column i is the solution at
+    //              outputTimes[i]
+
+    const int n = numberOfStateVariables;
+
+    std::vector<blNumberType> k(7 * n,blNumberType(0));
+    std::vector<blNumberType> currentState(n,blNumberType(0));
+    std::vector<blNumberType> nextState(n,blNumberType(0));
+    std::vector<blNumberType> yError(n,blNumberType(0));
+    std::vector<blNumberType> yTemp(n,blNumberType(0));
+    std::vector<blNumberType> yOut(n,blNumberType(0));
+
+    for(int i = 0; i < n; ++i)
+        currentState[i] = y0[i];
+
+    // Skip the output times before t0
+
+    int outputIndex = 0;
+    int numberOfOutputsWritten = 0;
+
+    while(outputIndex < numberOfOutputTimes && outputTimes[outputIndex] < t0)
+        ++outputIndex;
+
+    // Evaluate the first stage here, it's
+    // also used to pick the initial step
+    // from the size of the derivatives
+
+    ODEfunctor(t0,currentState,yTemp);
+
+    blNumberType stateNorm = 0;
+    blNumberType derivativeNorm = 0;
+
+    for(int i = 0; i < n; ++i)
+    {
+        k[i] = yTemp[i];
+
+        blNumberType scale = absoluteTolerance + relativeTolerance * std::abs(currentState[i]);
+
+        stateNorm = std::max(stateNorm,std::abs(currentState[i]) / scale);
+        derivativeNorm = std::max(derivativeNorm,std::abs(k[i]) / scale);
+    }
+
+    blNumberType h = (stateNorm < 1e-5 || derivativeNorm < 1e-5) ? blNumberType(1e-6) * (tf - t0) : blNumberType(0.01) * stateNorm / derivativeNorm;
+
+    h = std::min(h,tf - t0);
+
+    blPIStepSizeController<blNumberType> controller;
+
+    blNumberType t = t0;
+
+    int numberOfSteps = 0;
+
+    while(t < tf && numberOfSteps < maxNumberOfSteps)
+    {
+        ++numberOfSteps;
+
+        // Don't step past the final time
+
+        bool isLastStep = false;
+
+        if(t + h >= tf)
+        {
+            h = tf - t;
+            isLastStep = true;
+        }
+
+        rkDP(ODEfunctor,n,currentState,t,h,nextState,yError,k,yTemp,true);
+
+        blNumberType error = rkErrorNorm(n,currentState,nextState,yError,absoluteTolerance,relativeTolerance);
+
+        bool isStepAccepted = (error <= blNumberType(1));
+
+        blNumberType factor = controller.getStepSizeFactor(error,isStepAccepted);
+
+        if(!isStepAccepted)
+        {
+            h *= factor;
+            continue;
+        }
+
+        blNumberType tNext = isLastStep ? tf : t + h;
+
+        // Write all the output times
+        // covered by this step
+
+        while(outputIndex < numberOfOutputTimes && outputTimes[outputIndex] <= tNext)
+        {
+            rkHermiteDenseOutput(n,currentState,nextState,k,0,k,6 * n,h,blNumberType((outputTimes[outputIndex] - t) / h),yOut);
+
+            for(int j = 0; j < n; ++j)
+                y[j][numberOfOutputsWritten] = yOut[j];
+
+            ++outputIndex;
+            ++numberOfOutputsWritten;
+        }
+
+        // First same as last
+
+        for(int i = 0; i < n; ++i)
+        {
+            currentState[i] = nextState[i];
+            k[i] = k[i + 6 * n];
+        }
+
+        t = tNext;
+
+        h *= factor;
+    }
+
+    return numberOfOutputsWritten;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The following function calculates one step of
+// a mechanical system x'' = a(t,x) using the
+// velocity Verlet (leapfrog) algorithm, which is
+// 2nd-order, symplectic and time reversible, so
+// the energy error stays bounded instead of
+// drifting as it does with rk4
+//
+// - The acceleration functor is called as
+//   AccelerationFunctor(t,x,a)
+//
+// - On entry a has to hold the acceleration at
+//   (t,x), on exit it holds the one at the new
+//   (t + h,x), so each step costs only one
+//   acceleration evaluation, call the functor
+//   once before the first step to initialize it
+//-------------------------------------------------------------------
+template<typename blNumberType,
+         typename blStateVectorType,
+         typename blAccelerationFunctorType>
+
+inline void velocityVerlet(const blAccelerationFunctorType& AccelerationFunctor,
+                           const int& numberOfPositions,
+                           const blNumberType& t,
+                           const blNumberType& h,
+                           blStateVectorType& x,
+                           blStateVectorType& v,
+                           blStateVectorType& a)
+{
+    const blNumberType halfStep = h / blNumberType(2);
+
+    // Half kick and drift
+
+    for(int i = 0; i < numberOfPositions; ++i)
+    {
+        v[i] += halfStep * a[i];
+        x[i] += h * v[i];
+    }
+
+    // The acceleration at the new
+    // positions and the second
+    // half kick
+
+    AccelerationFunctor(t + h,x,a);
+
+    for(int i = 0; i < numberOfPositions; ++i)
+        v[i] += halfStep * a[i];
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The following function composes velocity
+// Verlet steps of sizes weights[i]*h into one
+// step of size h, the weights have to add up
+// to one
+//
+// - Symmetric weights keep the composition
+//   symplectic and time reversible, see
+//   yoshida4 and yoshida6
+//-------------------------------------------------------------------
+template<typename blNumberType,
+         typename blStateVectorType,
+         typename blAccelerationFunctorType>
+
+inline void composeVelocityVerlet(const blAccelerationFunctorType& AccelerationFunctor,
+                                  const int& numberOfPositions,
+                                  const blNumberType& t,
+                                  const blNumberType& h,
+                                  blStateVectorType& x,
+                                  blStateVectorType& v,
+                                  blStateVectorType& a,
+                                  const blNumberType* weights,
+                                  const int& numberOfWeights)
+{
+    blNumberType currentTime = t;
+
+    for(int i = 0; i < numberOfWeights; ++i)
+    {
+        blNumberType subStep = weights[i] * h;
+
+        velocityVerlet(AccelerationFunctor,numberOfPositions,currentTime,subStep,x,v,a);
+
+        currentTime += subStep;
+    }
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The following function calculates one step of
+// x'' = a(t,x) using Yoshida's 4th-order symplectic
+// composition of three velocity Verlet steps
+// (3 acceleration evaluations per step)
+//
+// - a works as in velocityVerlet
+//-------------------------------------------------------------------
+template<typename blNumberType,
+         typename blStateVectorType,
+         typename blAccelerationFunctorType>
+
+inline void yoshida4(const blAccelerationFunctorType& AccelerationFunctor,
+                     const int& numberOfPositions,
+                     const blNumberType& t,
+                     const blNumberType& h,
+                     blStateVectorType& x,
+                     blStateVectorType& v,
+                     blStateVectorType& a)
+{
+    // w1 = 1/(2 - 2^(1/3)), w0 = 1 - 2*w1
+
+    const blNumberType weights[3] = {blNumberType(1.3512071919596576),
+                                     blNumberType(-1.7024143839193153),
+                                     blNumberType(1.3512071919596576)};
+
+    composeVelocityVerlet(AccelerationFunctor,numberOfPositions,t,h,x,v,a,weights,3);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The following function calculates one step of
+// x'' = a(t,x) using Yoshida's 6th-order symplectic
+// composition of seven velocity Verlet steps
+// (his solution A, 7 acceleration evaluations
+// per step)
+//
+// - a works as in velocityVerlet
+//-------------------------------------------------------------------
+template<typename blNumberType,
+         typename blStateVectorType,
+         typename blAccelerationFunctorType>
+
+inline void yoshida6(const blAccelerationFunctorType& AccelerationFunctor,
+                     const int& numberOfPositions,
+                     const blNumberType& t,
+                     const blNumberType& h,
+                     blStateVectorType& x,
+                     blStateVectorType& v,
+                     blStateVectorType& a)
+{
+    const blNumberType w1 = blNumberType(-1.17767998417887);
+    const blNumberType w2 = blNumberType(0.235573213359357);
+    const blNumberType w3 = blNumberType(0.784513610477560);
+    const blNumberType w0 = blNumberType(1) - blNumberType(2) * (w1 + w2 + w3);
+
+    const blNumberType weights[7] = {w3,w2,w1,w0,w1,w2,w3};
+
+    composeVelocityVerlet(AccelerationFunctor,numberOfPositions,t,h,x,v,a,weights,7);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The exponential map from rotation vectors to
+// unit quaternions, exp(u) = (cos(|u|/2), sin(|u|/2) u/|u|)
+//-------------------------------------------------------------------
+template<typename blNumberType>
+
+inline blQuaternion<blNumberType> rotationVectorToQuaternion(const blVector3d<blNumberType>& u)
+{
+    blNumberType angle = norm2(u);
+
+    // sin(angle/2)/angle, with its series
+    // for tiny angles to avoid 0/0
+
+    blNumberType scale = blNumberType(0.5);
+
+    if(angle > blNumberType(1e-4))
+        scale = std::sin(angle / blNumberType(2)) / angle;
+    else
+        scale = blNumberType(0.5) - angle * angle / blNumberType(48);
+
+    return blQuaternion<blNumberType>(std::cos(angle / blNumberType(2)),u * scale);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The following function calculates one step of
+// an attitude q (a unit blQuaternion) driven by a
+// body frame angular velocity, q' = q * (0,w) / 2,
+// together with m other state variables x (such as
+// the angular velocity itself), using the 4th-order
+// Runge-Kutta-Munthe-Kaas method
+//
+// - The functor is called as
+//   RotationalODEfunctor(t,q,x,w,dxdt)
+//   and computes the angular velocity w (a
+//   blVector3d) and the derivative of x
+//
+// - The stages live in the Lie algebra (rotation
+//   vectors) and q is only ever multiplied by unit
+//   quaternions, so it stays on SO(3) (to round
+//   off) without renormalization
+//
+// - RKcoeffs has to hold 4*m numbers and
+//   xTemp and dxdt m numbers each
+//-------------------------------------------------------------------
+template<typename blNumberType,
+         typename blStateVectorType,
+         typename blRKcoeffsVectorType,
+         typename blRotationalODEFunctorType>
+
+inline void rkmkQuaternion(const blRotationalODEFunctorType& RotationalODEfunctor,
+                           const int& numberOfStateVariables,
+                           const blNumberType& t,
+                           const blNumberType& h,
+                           blQuaternion<blNumberType>& q,
+                           blStateVectorType& x,
+                           blRKcoeffsVectorType& RKcoeffs,
+                           blStateVectorType& xTemp,
+                           blStateVectorType& dxdt)
+{
+    const int m = numberOfStateVariables;
+
+    const blNumberType stageTimes[4] = {0,blNumberType(0.5),blNumberType(0.5),1};
+    const blNumberType stageWeights[4] = {0,blNumberType(0.5),blNumberType(0.5),1};
+
+    blVector3d<blNumberType> K[4];
+    blVector3d<blNumberType> u(0,0,0);
+    blVector3d<blNumberType> w(0,0,0);
+
+    for(int stage = 0; stage < 4; ++stage)
+    {
+        // The stage point, q * exp(u)
+        // and x + a*h*dxdt
+
+        blQuaternion<blNumberType> qStage = q;
+
+        if(stage > 0)
+        {
+            u = K[stage - 1] * stageWeights[stage];
+
+            qStage = q * rotationVectorToQuaternion(u);
+
+            for(int i = 0; i < m; ++i)
+                xTemp[i] = x[i] + stageWeights[stage] * RKcoeffs[i + (stage - 1) * m];
+        }
+        else
+        {
+            for(int i = 0; i < m; ++i)
+                xTemp[i] = x[i];
+        }
+
+        RotationalODEfunctor(t + stageTimes[stage] * h,qStage,xTemp,w,dxdt);
+
+        // Pull the angular velocity back to the
+        // algebra with the inverse of dexp
+        //
+        // u' = w + [u,w]/2 + [u,[u,w]]/12
+
+        blVector3d<blNumberType> uCrossW = crossProduct(u,w);
+
+        K[stage] = (w + uCrossW * blNumberType(0.5) + crossProduct(u,uCrossW) / blNumberType(12)) * h;
+
+        for(int i = 0; i < m; ++i)
+            RKcoeffs[i + stage * m] = h * dxdt[i];
+    }
+
+    // Combine the stages as in rk4
+
+    blVector3d<blNumberType> v = (K[0] + (K[1] + K[2]) * blNumberType(2) + K[3]) / blNumberType(6);
+
+    q = q * rotationVectorToQuaternion(v);
+
+    for(int i = 0; i < m; ++i)
+        x[i] += (RKcoeffs[i] + blNumberType(2) * (RKcoeffs[i + m] + RKcoeffs[i + 2 * m]) + RKcoeffs[i + 3 * m]) / blNumberType(6);
+}
+//-------------------------------------------------------------------
+
+
+
 //-------------------------------------------------------------------
 // End of the blMathAPI namespace
 }
@@ -0,0 +1,601 @@
+#ifndef BL_RUNGAKUTTAENSEMBLE_HPP
+#define BL_RUNGAKUTTAENSEMBLE_HPP
+
+
+
+///-------------------------------------------------------------------
+///
+///
+///
+/// PURPOSE:        Runga-kutta integrators that advance an ensemble
+///                 of instances of the same ODE system in lockstep
+///                 (monte carlo sweeps, parameter studies), so that
+///                 every stage update is a vectorizable loop over
+///                 the instances
+///
+/// AUTHOR:         Vincenzo Barbato
+///                 navyenzo@gmail.com
+///
+/// NOTE:           All things in this library are defined within the
+///                 blMathAPI namespace
+///
+///                 The states are stored SoA as [state][instance],
+///                 so state variable s of instance j is at
+///                 y[s*numberOfInstances + j], and the ODE functor
+///                 is called once per stage for the whole ensemble:
+///
+///                 ODEfunctor(t,y,dydt,numberOfInstances)
+///
+///                 where t holds the time of every instance (they
+///                 differ in the adaptive integrator)
+///
+/// LISENSE:        MIT-LICENCE
+///                 http://www.opensource.org/licenses/mit-license.php
+///
+///
+///
+///-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Includes needed for this file
+//-------------------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <vector>
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// NOTE: This class is defined within the blMathAPI namespace
+//-------------------------------------------------------------------
+namespace blMathAPI
+{
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+class blEnsembleRungaKutta
+{
+public: // Constructors and destructors
+
+
+
+    // Constructor, all the workspaces are
+    // allocated here and never again
+
+    blEnsembleRungaKutta(const int& numberOfStateVariables,
+                         const int& numberOfInstances);
+
+    // Destructor
+
+    ~blEnsembleRungaKutta();
+
+
+
+public: // Public functions
+
+
+
+    // One 4th-order Runge-Kutta step of size
+    // h for every instance, y is updated in place
+
+    template<typename blODEFunctorType>
+
+    void                                    rk4Step(const blODEFunctorType& ODEfunctor,
+                                                    blNumberType* y,
+                                                    const blNumberType& t,
+                                                    const blNumberType& h);
+
+    // Fixed-step integration of every
+    // instance from t0 to tf
+
+    template<typename blODEFunctorType>
+
+    void                                    rk4Integrate(const blODEFunctorType& ODEfunctor,
+                                                         blNumberType* y,
+                                                         const blNumberType& t0,
+                                                         const blNumberType& tf,
+                                                         const int& numberOfSteps);
+
+    // Adaptive Cash-Karp integration of every
+    // instance from t0 to tf, each instance
+    // controls its own step size and the ones
+    // that rejected a step or already reached
+    // tf are masked out of the update
+    //
+    // The error of a step is the max over the
+    // states of |y5th - y4th| / (absTol + relTol*|y|)
+    //
+    // Returns how many instances reached tf within
+    // maxNumberOfSteps attempted ensemble steps
+
+    template<typename blODEFunctorType>
+
+    int                                     cashKarpIntegrate(const blODEFunctorType& ODEfunctor,
+                                                              blNumberType* y,
+                                                              const blNumberType& t0,
+                                                              const blNumberType& tf,
+                                                              const blNumberType& initialStepSize,
+                                                              const blNumberType& absoluteTolerance,
+                                                              const blNumberType& relativeTolerance,
+                                                              const int& maxNumberOfSteps);
+
+    // Functions used to get the ensemble size and
+    // the per instance results of the last adaptive
+    // integration (time reached, next step size and
+    // number of accepted/rejected steps)
+
+    const int&                              getNumberOfStateVariables()const;
+    const int&                              getNumberOfInstances()const;
+
+    const std::vector<blNumberType>&        getTimes()const;
+    const std::vector<blNumberType>&        getStepSizes()const;
+    const std::vector<int>&                 getNumberOfAcceptedSteps()const;
+    const std::vector<int>&                 getNumberOfRejectedSteps()const;
+
+
+
+private: // Private functions
+
+
+
+    // Computes yStage = y + h*(a[0]*k0 + ... ) for
+    // every state and instance, with the per
+    // instance step sizes
+
+    template<int numberOfStages>
+
+    void                                    combineStages(const blNumberType* y,
+                                                          const blNumberType (&a)[numberOfStages],
+                                                          blNumberType* yStage)const;
+
+
+
+private: // Private variables
+
+
+
+    // Ensemble size
+
+    int                                     m_numberOfStateVariables;
+    int                                     m_numberOfInstances;
+
+    // Stage derivatives stored one after the other,
+    // each of them [state][instance]
+
+    std::vector<blNumberType>               m_k;
+
+    // Stage states and the embedded solution
+
+    std::vector<blNumberType>               m_yStage;
+    std::vector<blNumberType>               m_yEmbedded;
+
+    // Per instance time, step size, stage time,
+    // step error and step counts
+
+    std::vector<blNumberType>               m_t;
+    std::vector<blNumberType>               m_h;
+    std::vector<blNumberType>               m_tStage;
+    std::vector<blNumberType>               m_error;
+
+    std::vector<int>                        m_numberOfAcceptedSteps;
+    std::vector<int>                        m_numberOfRejectedSteps;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blEnsembleRungaKutta<blNumberType>::blEnsembleRungaKutta(const int& numberOfStateVariables,
+                                                                const int& numberOfInstances)
+{
+    m_numberOfStateVariables = std::max(0,numberOfStateVariables);
+    m_numberOfInstances = std::max(0,numberOfInstances);
+
+    std::size_t laneSize = std::size_t(m_numberOfStateVariables) * std::size_t(m_numberOfInstances);
+
+    // Cash-Karp needs six stages
+
+    m_k.assign(6 * laneSize,blNumberType(0));
+
+    m_yStage.assign(laneSize,blNumberType(0));
+    m_yEmbedded.assign(laneSize,blNumberType(0));
+
+    m_t.assign(m_numberOfInstances,blNumberType(0));
+    m_h.assign(m_numberOfInstances,blNumberType(0));
+    m_tStage.assign(m_numberOfInstances,blNumberType(0));
+    m_error.assign(m_numberOfInstances,blNumberType(0));
+
+    m_numberOfAcceptedSteps.assign(m_numberOfInstances,0);
+    m_numberOfRejectedSteps.assign(m_numberOfInstances,0);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blEnsembleRungaKutta<blNumberType>::~blEnsembleRungaKutta()
+{
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const int& blEnsembleRungaKutta<blNumberType>::getNumberOfStateVariables()const
+{
+    return m_numberOfStateVariables;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const int& blEnsembleRungaKutta<blNumberType>::getNumberOfInstances()const
+{
+    return m_numberOfInstances;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const std::vector<blNumberType>& blEnsembleRungaKutta<blNumberType>::getTimes()const
+{
+    return m_t;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const std::vector<blNumberType>& blEnsembleRungaKutta<blNumberType>::getStepSizes()const
+{
+    return m_h;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const std::vector<int>& blEnsembleRungaKutta<blNumberType>::getNumberOfAcceptedSteps()const
+{
+    return m_numberOfAcceptedSteps;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const std::vector<int>& blEnsembleRungaKutta<blNumberType>::getNumberOfRejectedSteps()const
+{
+    return m_numberOfRejectedSteps;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<int numberOfStages>
+inline void blEnsembleRungaKutta<blNumberType>::combineStages(const blNumberType* y,
+                                                              const blNumberType (&a)[numberOfStages],
+                                                              blNumberType* yStage)const
+{
+    const int m = m_numberOfInstances;
+    const std::size_t laneSize = std::size_t(m_numberOfStateVariables) * std::size_t(m);
+
+    const blNumberType* h = m_h.data();
+    const blNumberType* k = m_k.data();
+
+    for(int s = 0; s < m_numberOfStateVariables; ++s)
+    {
+        const std::size_t offset = std::size_t(s) * std::size_t(m);
+
+        // The inner loop runs over the instances
+        // with unit stride, so it vectorizes
+
+        #pragma omp simd
+        for(int j = 0; j < m; ++j)
+        {
+            blNumberType sum = 0;
+
+            for(int r = 0; r < numberOfStages; ++r)
+                sum += a[r] * k[r * laneSize + offset + j];
+
+            yStage[offset + j] = y[offset + j] + h[j] * sum;
+        }
+    }
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename blODEFunctorType>
+inline void blEnsembleRungaKutta<blNumberType>::rk4Step(const blODEFunctorType& ODEfunctor,
+                                                        blNumberType* y,
+                                                        const blNumberType& t,
+                                                        const blNumberType& h)
+{
+    const std::size_t laneSize = m_yStage.size();
+
+    std::fill(m_h.begin(),m_h.end(),h);
+
+    blNumberType* k = m_k.data();
+
+    // Calculate the first coefficients
+
+    std::fill(m_tStage.begin(),m_tStage.end(),t);
+
+    ODEfunctor(m_tStage.data(),y,k,m_numberOfInstances);
+
+    const blNumberType a2[1] = {0.5};
+    combineStages(y,a2,m_yStage.data());
+
+    // Calculate the second coefficients
+
+    std::fill(m_tStage.begin(),m_tStage.end(),t + h/2.0);
+
+    ODEfunctor(m_tStage.data(),m_yStage.data(),k + laneSize,m_numberOfInstances);
+
+    const blNumberType a3[2] = {0,0.5};
+    combineStages(y,a3,m_yStage.data());
+
+    // Calculate the third coefficients
+
+    ODEfunctor(m_tStage.data(),m_yStage.data(),k + 2 * laneSize,m_numberOfInstances);
+
+    const blNumberType a4[3] = {0,0,1};
+    combineStages(y,a4,m_yStage.data());
+
+    // Calculate the fourth coefficients
+
+    std::fill(m_tStage.begin(),m_tStage.end(),t + h);
+
+    ODEfunctor(m_tStage.data(),m_yStage.data(),k + 3 * laneSize,m_numberOfInstances);
+
+    // Finally we calculate the new
+    // values of the state variables
+
+    const blNumberType b[4] = {1.0/6.0,1.0/3.0,1.0/3.0,1.0/6.0};
+    combineStages(y,b,y);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename blODEFunctorType>
+inline void blEnsembleRungaKutta<blNumberType>::rk4Integrate(const blODEFunctorType& ODEfunctor,
+                                                             blNumberType* y,
+                                                             const blNumberType& t0,
+                                                             const blNumberType& tf,
+                                                             const int& numberOfSteps)
+{
+    if(numberOfSteps <= 0 || m_yStage.empty())
+        return;
+
+    blNumberType h = (tf - t0) / blNumberType(numberOfSteps);
+
+    for(int i = 0; i < numberOfSteps; ++i)
+        rk4Step(ODEfunctor,y,t0 + blNumberType(i) * h,h);
+
+    std::fill(m_t.begin(),m_t.end(),tf);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename blODEFunctorType>
+inline int blEnsembleRungaKutta<blNumberType>::cashKarpIntegrate(const blODEFunctorType& ODEfunctor,
+                                                                 blNumberType* y,
+                                                                 const blNumberType& t0,
+                                                                 const blNumberType& tf,
+                                                                 const blNumberType& initialStepSize,
+                                                                 const blNumberType& absoluteTolerance,
+                                                                 const blNumberType& relativeTolerance,
+                                                                 const int& maxNumberOfSteps)
+{
+    const int m = m_numberOfInstances;
+    const int n = m_numberOfStateVariables;
+    const std::size_t laneSize = m_yStage.size();
+
+    std::fill(m_t.begin(),m_t.end(),t0);
+    std::fill(m_numberOfAcceptedSteps.begin(),m_numberOfAcceptedSteps.end(),0);
+    std::fill(m_numberOfRejectedSteps.begin(),m_numberOfRejectedSteps.end(),0);
+
+    if(laneSize == 0 || tf <= t0)
+        return m;
+
+    blNumberType* k = m_k.data();
+    blNumberType* h = m_h.data();
+    blNumberType* t = m_t.data();
+    blNumberType* tStage = m_tStage.data();
+    blNumberType* error = m_error.data();
+
+    // Every instance starts with the same step,
+    // which is then clipped to the remaining
+    // time at every step
+
+    std::fill(m_h.begin(),m_h.end(),std::min(initialStepSize,tf - t0));
+
+    const blNumberType c[6] = {0,0.2,0.3,0.6,1.0,0.875};
+
+    const blNumberType a2[1] = {0.2};
+    const blNumberType a3[2] = {3.0/40.0,9.0/40.0};
+    const blNumberType a4[3] = {0.3,-0.9,1.2};
+    const blNumberType a5[4] = {-11.0/54.0,2.5,-70.0/27.0,35.0/27.0};
+    const blNumberType a6[5] = {1631.0/55296.0,175.0/512.0,575.0/13824.0,44275.0/110592.0,253.0/4096.0};
+
+    const blNumberType b5th[6] = {37.0/378.0,0,250.0/621.0,125.0/594.0,0,512.0/1771.0};
+    const blNumberType b4th[6] = {2825.0/27648.0,0,18575.0/48384.0,13525.0/55296.0,277.0/14336.0,0.25};
+
+    int numberOfFinishedInstances = 0;
+
+    for(int step = 0; step < maxNumberOfSteps; ++step)
+    {
+        // Mask the finished instances out by
+        // giving them a zero step, their state
+        // then doesn't change
+
+        numberOfFinishedInstances = 0;
+
+        for(int j = 0; j < m; ++j)
+        {
+            blNumberType remainingTime = tf - t[j];
+
+            if(remainingTime <= blNumberType(0))
+            {
+                h[j] = 0;
+                ++numberOfFinishedInstances;
+            }
+            else if(h[j] > remainingTime || h[j] <= blNumberType(0))
+            {
+                h[j] = remainingTime;
+            }
+        }
+
+        if(numberOfFinishedInstances == m)
+            break;
+
+        // The six stages of every instance
+
+        #pragma omp simd
+        for(int j = 0; j < m; ++j)
+            tStage[j] = t[j];
+
+        ODEfunctor(tStage,y,k,m);
+
+        combineStages(y,a2,m_yStage.data());
+
+        for(int r = 1; r < 6; ++r)
+        {
+            #pragma omp simd
+            for(int j = 0; j < m; ++j)
+                tStage[j] = t[j] + c[r] * h[j];
+
+            ODEfunctor(tStage,m_yStage.data(),k + std::size_t(r) * laneSize,m);
+
+            switch(r)
+            {
+            case 1: combineStages(y,a3,m_yStage.data()); break;
+            case 2: combineStages(y,a4,m_yStage.data()); break;
+            case 3: combineStages(y,a5,m_yStage.data()); break;
+            case 4: combineStages(y,a6,m_yStage.data()); break;
+            default: break;
+            }
+        }
+
+        // Both solutions, the 5th-order one is
+        // kept and the 4th-order one only gives
+        // the error estimate
+
+        combineStages(y,b5th,m_yStage.data());
+        combineStages(y,b4th,m_yEmbedded.data());
+
+        std::fill(m_error.begin(),m_error.end(),blNumberType(0));
+
+        for(int s = 0; s < n; ++s)
+        {
+            const std::size_t offset = std::size_t(s) * std::size_t(m);
+
+            const blNumberType* y5th = m_yStage.data() + offset;
+            const blNumberType* y4th = m_yEmbedded.data() + offset;
+            const blNumberType* yOld = y + offset;
+
+            #pragma omp simd
+            for(int j = 0; j < m; ++j)
+            {
+                blNumberType scale = absoluteTolerance + relativeTolerance * std::max(std::abs(yOld[j]),std::abs(y5th[j]));
+                error[j] = std::max(error[j],std::abs(y5th[j] - y4th[j]) / scale);
+            }
+        }
+
+        // Accept or reject per instance, the
+        // accepted ones take the new state
+
+        for(int s = 0; s < n; ++s)
+        {
+            const std::size_t offset = std::size_t(s) * std::size_t(m);
+
+            const blNumberType* y5th = m_yStage.data() + offset;
+            blNumberType* yOld = y + offset;
+
+            #pragma omp simd
+            for(int j = 0; j < m; ++j)
+                yOld[j] = (error[j] <= blNumberType(1) && h[j] > blNumberType(0)) ? y5th[j] : yOld[j];
+        }
+
+        for(int j = 0; j < m; ++j)
+        {
+            if(h[j] <= blNumberType(0))
+                continue;
+
+            // New step size from the usual 5th-order
+            // rule, limited to a factor of 5 growth
+            // and 10 shrinking
+
+            blNumberType factor = (error[j] > blNumberType(0)) ? blNumberType(0.9) * std::pow(error[j],blNumberType(-0.2)) : blNumberType(5);
+
+            factor = std::min(blNumberType(5),std::max(blNumberType(0.1),factor));
+
+            if(error[j] <= blNumberType(1))
+            {
+                t[j] += h[j];
+
+                // Land exactly on tf
+
+                if(tf - t[j] <= blNumberType(1e-12) * std::abs(tf))
+                    t[j] = tf;
+
+                ++m_numberOfAcceptedSteps[j];
+            }
+            else
+            {
+                ++m_numberOfRejectedSteps[j];
+            }
+
+            h[j] *= factor;
+        }
+    }
+
+    numberOfFinishedInstances = 0;
+
+    for(int j = 0; j < m; ++j)
+    {
+        if(t[j] >= tf)
+            ++numberOfFinishedInstances;
+    }
+
+    return numberOfFinishedInstances;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// End of the blMathAPI namespace
+}
+//-------------------------------------------------------------------
+
+
+
+#endif // BL_RUNGAKUTTAENSEMBLE_HPP
@@ -0,0 +1,688 @@
+#ifndef BL_RUNGAKUTTAEVENTS_HPP
+#define BL_RUNGAKUTTAEVENTS_HPP
+
+
+
+///-------------------------------------------------------------------
+///
+///
+///
+/// PURPOSE:        Event detection (zero crossings of user
+///                 defined event functions) during adaptive
+///                 runga-kutta integration, crossings are
+///                 bracketed on each accepted step and located
+///                 with Brent's method on the stepper's dense
+///                 output, so the steps don't have to shrink
+///                 to catch the events
+///
+/// AUTHOR:         Vincenzo Barbato
+///                 navyenzo@gmail.com
+///
+/// NOTE:           All things in this library are defined within the
+///                 blMathAPI namespace
+///
+///                 The event functor evaluates all the event
+///                 functions at once:
+///
+///                 EventFunctor(t,y,g)
+///
+///                 and the (optional) event handler is called
+///                 at every located event, it can change the
+///                 state and returns whether the integration
+///                 should restart from the event (true) or
+///                 terminate there (false):
+///
+///                 bool EventHandler(eventIndex,t,y)
+///
+/// LISENSE:        MIT-LICENCE
+///                 http://www.opensource.org/licenses/mit-license.php
+///
+///
+///
+///-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Includes needed for this file
+//-------------------------------------------------------------------
+#include <limits>
+#include <vector>
+#include "blRootFinding.hpp"
+#include "blRungaKuttaSteppers.hpp"
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// NOTE: This class is defined within the blMathAPI namespace
+//-------------------------------------------------------------------
+namespace blMathAPI
+{
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Enum used to pick which zero crossings of
+// an event function count as events
+//-------------------------------------------------------------------
+enum blEventDirection {BL_EVENT_ANY_DIRECTION,
+                       BL_EVENT_RISING,
+                       BL_EVENT_FALLING};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Event handler that terminates the
+// integration at the first event
+//-------------------------------------------------------------------
+struct blTerminateOnEvent
+{
+    template<typename blNumberType>
+
+    bool operator()(const int&,const blNumberType&,blNumberType*)const
+    {
+        return false;
+    }
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Drives a stepper with dense output (such as the
+// blDormandPrinceStepper) and watches the event
+// functions over every accepted step
+//
+// - An event is a sign change of an event function
+//   between the start and the end of a step, when
+//   several functions change sign in the same step
+//   only the earliest crossing is an event, the
+//   integration restarts from there and the others
+//   are found again on the following steps
+//
+// - The event time is taken on the far side of the
+//   crossing (within the location tolerance), so
+//   restarting from the event doesn't find the
+//   same crossing again
+//
+// - An event function that is exactly zero where
+//   the integration (re)starts, such as a handler
+//   putting a bouncing ball back on the ground,
+//   takes its sign from a look-ahead of one location
+//   tolerance along the derivative, or failing that
+//   from the event's direction, so its next
+//   crossing is still found
+//-------------------------------------------------------------------
+template<typename blNumberType>
+class blEventLocator
+{
+public: // Constructors and destructors
+
+
+
+    // Default constructor
+
+    blEventLocator(const int& numberOfStateVariables = 0,
+                   const int& numberOfEvents = 0,
+                   const blNumberType& locationTolerance = 1e-10);
+
+    // Destructor
+
+    ~blEventLocator();
+
+
+
+public: // Public functions
+
+
+
+    // Function used to resize the workspaces,
+    // this is the only function that allocates
+
+    void                                    setSize(const int& numberOfStateVariables,
+                                                    const int& numberOfEvents);
+
+    const int&                              getNumberOfStateVariables()const;
+    const int&                              getNumberOfEvents()const;
+
+    // Which crossings of event i count,
+    // any direction by default
+
+    void                                    setDirection(const int& eventIndex,
+                                                         const blEventDirection& direction);
+
+    // Tolerance and iterations used by
+    // Brent's method to locate events
+
+    void                                    setLocationTolerance(const blNumberType& locationTolerance);
+    void                                    setMaxNumberOfIterations(const int& maxNumberOfIterations);
+
+    // Advances the state y from t0 to tf with
+    // the stepper, stopping at the first event,
+    // returns false if maxNumberOfSteps attempts
+    // weren't enough, t is where it stopped
+
+    template<typename blStepperType,
+             typename blODEFunctorType,
+             typename blEventFunctorType>
+
+    bool                                    integrate(blStepperType& stepper,
+                                                      const blODEFunctorType& ODEfunctor,
+                                                      const blEventFunctorType& EventFunctor,
+                                                      blNumberType* y,
+                                                      blNumberType& t,
+                                                      const blNumberType& tf,
+                                                      const blNumberType& initialStepSize,
+                                                      const int& maxNumberOfSteps);
+
+    // Same but calling the event handler at
+    // every event to either change the state
+    // and restart or terminate
+
+    template<typename blStepperType,
+             typename blODEFunctorType,
+             typename blEventFunctorType,
+             typename blEventHandlerType>
+
+    bool                                    integrate(blStepperType& stepper,
+                                                      const blODEFunctorType& ODEfunctor,
+                                                      const blEventFunctorType& EventFunctor,
+                                                      const blEventHandlerType& EventHandler,
+                                                      blNumberType* y,
+                                                      blNumberType& t,
+                                                      const blNumberType& tf,
+                                                      const blNumberType& initialStepSize,
+                                                      const int& maxNumberOfSteps);
+
+    // Events of the last integration, the
+    // index is -1 when it didn't terminate
+    // at an event
+
+    const int&                              getNumberOfEventsFound()const;
+    const int&                              getTerminalEventIndex()const;
+    const blNumberType&                     getLastEventTime()const;
+
+
+
+private: // Private functions
+
+
+
+    // Whether event i crossed zero
+    // going from gStart to gEnd
+
+    bool                                    isCrossing(const int& eventIndex,
+                                                       const blNumberType& gStart,
+                                                       const blNumberType& gEnd)const;
+
+    // Evaluates the event functions where the
+    // integration (re)starts and gives the ones
+    // sitting exactly on zero a sign
+
+    template<typename blODEFunctorType,
+             typename blEventFunctorType>
+
+    void                                    evaluateStartingEventValues(const blODEFunctorType& ODEfunctor,
+                                                                        const blEventFunctorType& EventFunctor,
+                                                                        const blNumberType& t,
+                                                                        const blNumberType* y);
+
+    // Locates the earliest event within
+    // the stepper's last accepted step,
+    // returns its index or -1 if none
+
+    template<typename blStepperType,
+             typename blEventFunctorType>
+
+    int                                     locateEarliestEvent(const blStepperType& stepper,
+                                                                const blEventFunctorType& EventFunctor,
+                                                                blNumberType& eventTime);
+
+
+
+private: // Private variables
+
+
+
+    int                                     m_numberOfStateVariables;
+    int                                     m_numberOfEvents;
+
+    blNumberType                            m_locationTolerance;
+    int                                     m_maxNumberOfIterations;
+
+    std::vector<blEventDirection>           m_directions;
+
+    int                                     m_numberOfEventsFound;
+    int                                     m_terminalEventIndex;
+    blNumberType                            m_lastEventTime;
+
+    // Event function values at the start and
+    // the end of a step and at a trial time,
+    // the interpolated state and its derivative
+
+    blAlignedBuffer<blNumberType>           m_gStart;
+    blAlignedBuffer<blNumberType>           m_gEnd;
+    blAlignedBuffer<blNumberType>           m_gTrial;
+    blAlignedBuffer<blNumberType>           m_yTrial;
+    blAlignedBuffer<blNumberType>           m_dydtTrial;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blEventLocator<blNumberType>::blEventLocator(const int& numberOfStateVariables,
+                                                    const int& numberOfEvents,
+                                                    const blNumberType& locationTolerance)
+{
+    m_locationTolerance = locationTolerance;
+    m_maxNumberOfIterations = 100;
+
+    m_numberOfEventsFound = 0;
+    m_terminalEventIndex = -1;
+    m_lastEventTime = 0;
+
+    setSize(numberOfStateVariables,numberOfEvents);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blEventLocator<blNumberType>::~blEventLocator()
+{
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blEventLocator<blNumberType>::setSize(const int& numberOfStateVariables,
+                                                  const int& numberOfEvents)
+{
+    m_numberOfStateVariables = std::max(0,numberOfStateVariables);
+    m_numberOfEvents = std::max(0,numberOfEvents);
+
+    m_directions.assign(m_numberOfEvents,BL_EVENT_ANY_DIRECTION);
+
+    m_gStart.resize(m_numberOfEvents);
+    m_gEnd.resize(m_numberOfEvents);
+    m_gTrial.resize(m_numberOfEvents);
+    m_yTrial.resize(m_numberOfStateVariables);
+    m_dydtTrial.resize(m_numberOfStateVariables);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const int& blEventLocator<blNumberType>::getNumberOfStateVariables()const
+{
+    return m_numberOfStateVariables;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const int& blEventLocator<blNumberType>::getNumberOfEvents()const
+{
+    return m_numberOfEvents;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blEventLocator<blNumberType>::setDirection(const int& eventIndex,
+                                                       const blEventDirection& direction)
+{
+    if(eventIndex >= 0 && eventIndex < m_numberOfEvents)
+        m_directions[eventIndex] = direction;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blEventLocator<blNumberType>::setLocationTolerance(const blNumberType& locationTolerance)
+{
+    m_locationTolerance = locationTolerance;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blEventLocator<blNumberType>::setMaxNumberOfIterations(const int& maxNumberOfIterations)
+{
+    m_maxNumberOfIterations = std::max(1,maxNumberOfIterations);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const int& blEventLocator<blNumberType>::getNumberOfEventsFound()const
+{
+    return m_numberOfEventsFound;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const int& blEventLocator<blNumberType>::getTerminalEventIndex()const
+{
+    return m_terminalEventIndex;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const blNumberType& blEventLocator<blNumberType>::getLastEventTime()const
+{
+    return m_lastEventTime;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline bool blEventLocator<blNumberType>::isCrossing(const int& eventIndex,
+                                                     const blNumberType& gStart,
+                                                     const blNumberType& gEnd)const
+{
+    // A function left on zero at the start of
+    // the step (no look-ahead or direction gave
+    // it a sign) has to leave zero before it
+    // can cross again
+
+    if(gStart == blNumberType(0))
+        return false;
+
+    bool isRising = (gStart < blNumberType(0) && gEnd >= blNumberType(0));
+    bool isFalling = (gStart > blNumberType(0) && gEnd <= blNumberType(0));
+
+    switch(m_directions[eventIndex])
+    {
+    case BL_EVENT_RISING:
+        return isRising;
+
+    case BL_EVENT_FALLING:
+        return isFalling;
+
+    default:
+        return (isRising || isFalling);
+    }
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename blODEFunctorType,typename blEventFunctorType>
+inline void blEventLocator<blNumberType>::evaluateStartingEventValues(const blODEFunctorType& ODEfunctor,
+                                                                      const blEventFunctorType& EventFunctor,
+                                                                      const blNumberType& t,
+                                                                      const blNumberType* y)
+{
+    blNumberType* gStart = m_gStart.data();
+
+    EventFunctor(t,y,gStart);
+
+    bool isAnyEventOnZero = false;
+
+    for(int i = 0; i < m_numberOfEvents; ++i)
+        if(gStart[i] == blNumberType(0))
+            isAnyEventOnZero = true;
+
+    if(!isAnyEventOnZero)
+        return;
+
+    // Look one location tolerance ahead
+    // along the derivative
+
+    const int n = m_numberOfStateVariables;
+
+    blNumberType* gTrial = m_gTrial.data();
+    blNumberType* yTrial = m_yTrial.data();
+    blNumberType* dydt = m_dydtTrial.data();
+
+    ODEfunctor(t,y,dydt);
+
+    for(int j = 0; j < n; ++j)
+        yTrial[j] = y[j] + m_locationTolerance * dydt[j];
+
+    EventFunctor(t + m_locationTolerance,static_cast<const blNumberType*>(yTrial),gTrial);
+
+    for(int i = 0; i < m_numberOfEvents; ++i)
+    {
+        if(gStart[i] != blNumberType(0))
+            continue;
+
+        if(gTrial[i] != blNumberType(0))
+            gStart[i] = gTrial[i];
+        else if(m_directions[i] == BL_EVENT_RISING)
+            gStart[i] = -std::numeric_limits<blNumberType>::min();
+        else if(m_directions[i] == BL_EVENT_FALLING)
+            gStart[i] = std::numeric_limits<blNumberType>::min();
+    }
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename blStepperType,typename blEventFunctorType>
+inline int blEventLocator<blNumberType>::locateEarliestEvent(const blStepperType& stepper,
+                                                             const blEventFunctorType& EventFunctor,
+                                                             blNumberType& eventTime)
+{
+    const blNumberType tStart = stepper.getLastStepStartTime();
+    const blNumberType tEnd = stepper.getLastStepEndTime();
+
+    const blNumberType* gStart = m_gStart.data();
+    const blNumberType* gEnd = m_gEnd.data();
+
+    blNumberType* gTrial = m_gTrial.data();
+    blNumberType* yTrial = m_yTrial.data();
+
+    int earliestEvent = -1;
+
+    eventTime = tEnd;
+
+    for(int i = 0; i < m_numberOfEvents; ++i)
+    {
+        if(!isCrossing(i,gStart[i],gEnd[i]))
+            continue;
+
+        // Event function i along the dense output,
+        // at the start of the step it's the value
+        // already known, which also keeps the sign
+        // given to a function starting on zero
+
+        auto eventFunction = [&](const blNumberType& tau)
+        {
+            if(tau == tStart)
+                return gStart[i];
+
+            stepper.denseOutput(tau,yTrial);
+
+            EventFunctor(tau,yTrial,gTrial);
+
+            return gTrial[i];
+        };
+
+        // Only search before the earliest event
+        // found so far, if i crosses there at all
+
+        blNumberType tRight = eventTime;
+
+        if(tRight < tEnd)
+        {
+            blNumberType gRight = eventFunction(tRight);
+
+            if(!isCrossing(i,gStart[i],gRight))
+                continue;
+        }
+
+        blNumberType root = brentsMethod(tStart,tRight,eventFunction,m_locationTolerance,m_maxNumberOfIterations);
+
+        // Move the root past the crossing when
+        // it landed just short of it
+
+        blNumberType step = m_locationTolerance;
+
+        for(int j = 0; j < 8 && root < tRight && !isCrossing(i,gStart[i],eventFunction(root)); ++j)
+        {
+            root = std::min(tRight,root + step);
+            step *= blNumberType(2);
+        }
+
+        if(!isCrossing(i,gStart[i],eventFunction(root)))
+            root = tRight;
+
+        if(earliestEvent < 0 || root < eventTime)
+        {
+            earliestEvent = i;
+            eventTime = root;
+        }
+    }
+
+    return earliestEvent;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename blStepperType,typename blODEFunctorType,typename blEventFunctorType>
+inline bool blEventLocator<blNumberType>::integrate(blStepperType& stepper,
+                                                    const blODEFunctorType& ODEfunctor,
+                                                    const blEventFunctorType& EventFunctor,
+                                                    blNumberType* y,
+                                                    blNumberType& t,
+                                                    const blNumberType& tf,
+                                                    const blNumberType& initialStepSize,
+                                                    const int& maxNumberOfSteps)
+{
+    return integrate(stepper,ODEfunctor,EventFunctor,blTerminateOnEvent(),y,t,tf,initialStepSize,maxNumberOfSteps);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename blStepperType,typename blODEFunctorType,typename blEventFunctorType,typename blEventHandlerType>
+inline bool blEventLocator<blNumberType>::integrate(blStepperType& stepper,
+                                                    const blODEFunctorType& ODEfunctor,
+                                                    const blEventFunctorType& EventFunctor,
+                                                    const blEventHandlerType& EventHandler,
+                                                    blNumberType* y,
+                                                    blNumberType& t,
+                                                    const blNumberType& tf,
+                                                    const blNumberType& initialStepSize,
+                                                    const int& maxNumberOfSteps)
+{
+    blNumberType* gStart = m_gStart.data();
+    blNumberType* gEnd = m_gEnd.data();
+
+    m_numberOfEventsFound = 0;
+    m_terminalEventIndex = -1;
+
+    stepper.reset();
+
+    evaluateStartingEventValues(ODEfunctor,EventFunctor,t,static_cast<const blNumberType*>(y));
+
+    blNumberType h = initialStepSize;
+
+    for(int i = 0; i < maxNumberOfSteps && t < tf; ++i)
+    {
+        // Don't step past the final time
+
+        bool isLastStep = (t + h >= tf);
+
+        if(isLastStep)
+            h = tf - t;
+
+        if(!stepper.step(ODEfunctor,y,t,h))
+            continue;
+
+        if(isLastStep)
+        {
+            t = tf;
+            stepper.setLastStepEndTime(tf);
+        }
+
+        EventFunctor(t,y,gEnd);
+
+        blNumberType eventTime = t;
+
+        int eventIndex = locateEarliestEvent(stepper,EventFunctor,eventTime);
+
+        if(eventIndex < 0)
+        {
+            std::copy(gEnd,gEnd + m_numberOfEvents,gStart);
+            continue;
+        }
+
+        // Back up to the event
+
+        ++m_numberOfEventsFound;
+
+        m_lastEventTime = eventTime;
+
+        t = eventTime;
+
+        stepper.denseOutput(t,y);
+
+        if(!EventHandler(eventIndex,t,y))
+        {
+            m_terminalEventIndex = eventIndex;
+            return true;
+        }
+
+        // Restart from the (possibly changed) state,
+        // the event time is past the crossing so the
+        // event that fired isn't found again
+
+        stepper.reset();
+
+        evaluateStartingEventValues(ODEfunctor,EventFunctor,t,static_cast<const blNumberType*>(y));
+    }
+
+    return (t >= tf);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// End of the blMathAPI namespace
+}
+//-------------------------------------------------------------------
+
+
+
+#endif // BL_RUNGAKUTTAEVENTS_HPP
@@ -0,0 +1,735 @@
+#ifndef BL_RUNGAKUTTAFIXEDSIZE_HPP
+#define BL_RUNGAKUTTAFIXEDSIZE_HPP
+
+
+
+///-------------------------------------------------------------------
+///
+///
+///
+/// PURPOSE:        Runga-kutta steppers specialized at compile
+///                 time on the number of state variables, the
+///                 states are std::arrays and every stage
+///                 combination is unrolled, so that small
+///                 models (3-13 states) step in straight-line
+///                 code with the state kept in registers
+///
+/// AUTHOR:         Vincenzo Barbato
+///                 navyenzo@gmail.com
+///
+/// NOTE:           All things in this library are defined within the
+///                 blMathAPI namespace
+///
+///                 The ODE functor is called as
+///
+///                 ODEfunctor(t,y,dydt)
+///
+///                 with y and dydt of type std::array<blNumberType,N>
+///
+/// LISENSE:        MIT-LICENCE
+///                 http://www.opensource.org/licenses/mit-license.php
+///
+///
+///
+///-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Includes needed for this file
+//-------------------------------------------------------------------
+#include <array>
+#include <type_traits>
+#include "blRungaKutta.hpp"
+#include "blQuaternion.hpp"
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// NOTE: This class is defined within the blMathAPI namespace
+//-------------------------------------------------------------------
+namespace blMathAPI
+{
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Calls functor(i) for i in [index,endIndex), with
+// i passed as a std::integral_constant, so the loop
+// is unrolled by construction
+//-------------------------------------------------------------------
+template<int index,int endIndex>
+
+struct blUnrolledLoop
+{
+    template<typename blFunctorType>
+
+    static void                             run(const blFunctorType& functor)
+    {
+        functor(std::integral_constant<int,index>());
+
+        blUnrolledLoop<index + 1,endIndex>::run(functor);
+    }
+};
+
+template<int endIndex>
+
+struct blUnrolledLoop<endIndex,endIndex>
+{
+    template<typename blFunctorType>
+
+    static void                             run(const blFunctorType&)
+    {
+    }
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Computes yOut = y0 + h*(a[0]*k[0] + ... + a[S-1]*k[S-1])
+// unrolled over both the stages and the states
+//-------------------------------------------------------------------
+template<int numberOfStages,
+         typename blNumberType,
+         std::size_t N>
+
+inline void combineFixedSizeStages(const std::array<blNumberType,N>& y0,
+                                   const blNumberType& h,
+                                   const blNumberType* a,
+                                   const std::array<blNumberType,N>* k,
+                                   std::array<blNumberType,N>& yOut)
+{
+    blUnrolledLoop<0,int(N)>::run([&](auto i)
+    {
+        blNumberType sum = 0;
+
+        blUnrolledLoop<0,numberOfStages>::run([&](auto r)
+        {
+            sum += a[r] * k[r][i];
+        });
+
+        yOut[i] = y0[i] + h * sum;
+    });
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Fixed-step 4th-order Runge-Kutta stepper
+// for N state variables
+//-------------------------------------------------------------------
+template<typename blNumberType,int N>
+class blFixedSizeRK4Stepper
+{
+public: // Public types
+
+
+
+    typedef std::array<blNumberType,N>      blStateType;
+
+
+
+public: // Constructors and destructors
+
+
+
+    // Default constructor
+
+    blFixedSizeRK4Stepper();
+
+    // Destructor
+
+    ~blFixedSizeRK4Stepper();
+
+
+
+public: // Public functions
+
+
+
+    // Advances the state y from t to t + h
+
+    template<typename blODEFunctorType>
+
+    void                                    step(const blODEFunctorType& ODEfunctor,
+                                                 blStateType& y,
+                                                 const blNumberType& t,
+                                                 const blNumberType& h);
+
+    // Advances the state y from t0 to
+    // tf in numberOfSteps equal steps
+
+    template<typename blODEFunctorType>
+
+    void                                    integrate(const blODEFunctorType& ODEfunctor,
+                                                      blStateType& y,
+                                                      const blNumberType& t0,
+                                                      const blNumberType& tf,
+                                                      const int& numberOfSteps);
+
+
+
+private: // Private variables
+
+
+
+    // The stage derivatives and
+    // the intermediate state
+
+    std::array<blStateType,4>               m_k;
+    blStateType                             m_yStage;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,int N>
+inline blFixedSizeRK4Stepper<blNumberType,N>::blFixedSizeRK4Stepper()
+{
+    for(auto& k : m_k)
+        k.fill(blNumberType(0));
+
+    m_yStage.fill(blNumberType(0));
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,int N>
+inline blFixedSizeRK4Stepper<blNumberType,N>::~blFixedSizeRK4Stepper()
+{
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,int N>
+template<typename blODEFunctorType>
+inline void blFixedSizeRK4Stepper<blNumberType,N>::step(const blODEFunctorType& ODEfunctor,
+                                                        blStateType& y,
+                                                        const blNumberType& t,
+                                                        const blNumberType& h)
+{
+    static const blNumberType a2[1] = {0.5};
+    static const blNumberType a3[2] = {0,0.5};
+    static const blNumberType a4[3] = {0,0,1};
+    static const blNumberType b[4] = {1.0/6.0,1.0/3.0,1.0/3.0,1.0/6.0};
+
+    ODEfunctor(t,y,m_k[0]);
+
+    combineFixedSizeStages<1>(y,h,a2,m_k.data(),m_yStage);
+    ODEfunctor(t + h/2.0,m_yStage,m_k[1]);
+
+    combineFixedSizeStages<2>(y,h,a3,m_k.data(),m_yStage);
+    ODEfunctor(t + h/2.0,m_yStage,m_k[2]);
+
+    combineFixedSizeStages<3>(y,h,a4,m_k.data(),m_yStage);
+    ODEfunctor(t + h,m_yStage,m_k[3]);
+
+    combineFixedSizeStages<4>(y,h,b,m_k.data(),y);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,int N>
+template<typename blODEFunctorType>
+inline void blFixedSizeRK4Stepper<blNumberType,N>::integrate(const blODEFunctorType& ODEfunctor,
+                                                             blStateType& y,
+                                                             const blNumberType& t0,
+                                                             const blNumberType& tf,
+                                                             const int& numberOfSteps)
+{
+    if(numberOfSteps <= 0)
+        return;
+
+    blNumberType h = (tf - t0) / blNumberType(numberOfSteps);
+
+    for(int i = 0; i < numberOfSteps; ++i)
+        step(ODEfunctor,y,t0 + blNumberType(i) * h,h);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Adaptive Dormand-Prince 5(4) stepper for N
+// state variables, same interface and behavior
+// as blDormandPrinceStepper
+//-------------------------------------------------------------------
+template<typename blNumberType,int N>
+class blFixedSizeDormandPrinceStepper
+{
+public: // Public types
+
+
+
+    typedef std::array<blNumberType,N>      blStateType;
+
+
+
+public: // Constructors and destructors
+
+
+
+    // Default constructor
+
+    blFixedSizeDormandPrinceStepper(const blNumberType& absoluteTolerance = 1e-6,
+                                    const blNumberType& relativeTolerance = 1e-6);
+
+    // Destructor
+
+    ~blFixedSizeDormandPrinceStepper();
+
+
+
+public: // Public functions
+
+
+
+    void                                    setTolerances(const blNumberType& absoluteTolerance,
+                                                          const blNumberType& relativeTolerance);
+
+    // Forgets the step size history
+    // and the first-same-as-last stage
+
+    void                                    reset();
+
+    // Attempts one step of size h, if the
+    // step is accepted y and t are advanced,
+    // either way h becomes the next step size
+
+    template<typename blODEFunctorType>
+
+    bool                                    step(const blODEFunctorType& ODEfunctor,
+                                                 blStateType& y,
+                                                 blNumberType& t,
+                                                 blNumberType& h);
+
+    // Advances the state y from t0 to tf,
+    // returns false if maxNumberOfSteps
+    // attempts weren't enough
+
+    template<typename blODEFunctorType>
+
+    bool                                    integrate(const blODEFunctorType& ODEfunctor,
+                                                      blStateType& y,
+                                                      const blNumberType& t0,
+                                                      const blNumberType& tf,
+                                                      const blNumberType& initialStepSize,
+                                                      const int& maxNumberOfSteps);
+
+    // Evaluates the solution at any time
+    // within the last accepted step
+
+    void                                    denseOutput(const blNumberType& t,
+                                                        blStateType& yOut)const;
+
+    // Step counts since the last reset
+
+    const int&                              getNumberOfAcceptedSteps()const;
+    const int&                              getNumberOfRejectedSteps()const;
+
+
+
+private: // Private variables
+
+
+
+    blNumberType                            m_absoluteTolerance;
+    blNumberType                            m_relativeTolerance;
+
+    blPIStepSizeController<blNumberType>    m_controller;
+
+    int                                     m_numberOfAcceptedSteps;
+    int                                     m_numberOfRejectedSteps;
+
+    // The last accepted step
+
+    blNumberType                            m_lastStepStartTime;
+    blNumberType                            m_lastStepSize;
+
+    // The stage derivatives, the intermediate
+    // state, the trial state and its error,
+    // a rejected attempt overwrites all of them
+
+    std::array<blStateType,7>               m_k;
+    blStateType                             m_yStage;
+    blStateType                             m_yTrial;
+    blStateType                             m_yError;
+
+    // The states and the derivatives at both
+    // ends of the last accepted step
+
+    blStateType                             m_yStart;
+    blStateType                             m_yEnd;
+    blStateType                             m_fStart;
+    blStateType                             m_fEnd;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,int N>
+inline blFixedSizeDormandPrinceStepper<blNumberType,N>::blFixedSizeDormandPrinceStepper(const blNumberType& absoluteTolerance,
+                                                                                        const blNumberType& relativeTolerance)
+{
+    m_absoluteTolerance = absoluteTolerance;
+    m_relativeTolerance = relativeTolerance;
+
+    for(auto& k : m_k)
+        k.fill(blNumberType(0));
+
+    m_yStage.fill(blNumberType(0));
+    m_yTrial.fill(blNumberType(0));
+    m_yError.fill(blNumberType(0));
+
+    m_yStart.fill(blNumberType(0));
+    m_yEnd.fill(blNumberType(0));
+    m_fStart.fill(blNumberType(0));
+    m_fEnd.fill(blNumberType(0));
+
+    reset();
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,int N>
+inline blFixedSizeDormandPrinceStepper<blNumberType,N>::~blFixedSizeDormandPrinceStepper()
+{
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,int N>
+inline void blFixedSizeDormandPrinceStepper<blNumberType,N>::setTolerances(const blNumberType& absoluteTolerance,
+                                                                           const blNumberType& relativeTolerance)
+{
+    m_absoluteTolerance = absoluteTolerance;
+    m_relativeTolerance = relativeTolerance;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,int N>
+inline void blFixedSizeDormandPrinceStepper<blNumberType,N>::reset()
+{
+    m_controller.reset();
+
+    m_numberOfAcceptedSteps = 0;
+    m_numberOfRejectedSteps = 0;
+
+    m_lastStepStartTime = 0;
+    m_lastStepSize = 0;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,int N>
+inline const int& blFixedSizeDormandPrinceStepper<blNumberType,N>::getNumberOfAcceptedSteps()const
+{
+    return m_numberOfAcceptedSteps;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,int N>
+inline const int& blFixedSizeDormandPrinceStepper<blNumberType,N>::getNumberOfRejectedSteps()const
+{
+    return m_numberOfRejectedSteps;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,int N>
+template<typename blODEFunctorType>
+inline bool blFixedSizeDormandPrinceStepper<blNumberType,N>::step(const blODEFunctorType& ODEfunctor,
+                                                                  blStateType& y,
+                                                                  blNumberType& t,
+                                                                  blNumberType& h)
+{
+    static const blNumberType a2[1] = {0.2};
+    static const blNumberType a3[2] = {3.0/40.0,9.0/40.0};
+    static const blNumberType a4[3] = {44.0/45.0,-56.0/15.0,32.0/9.0};
+    static const blNumberType a5[4] = {19372.0/6561.0,-25360.0/2187.0,64448.0/6561.0,-212.0/729.0};
+    static const blNumberType a6[5] = {9017.0/3168.0,-355.0/33.0,46732.0/5247.0,49.0/176.0,-5103.0/18656.0};
+    static const blNumberType b[6] = {35.0/384.0,0,500.0/1113.0,125.0/192.0,-2187.0/6784.0,11.0/84.0};
+    static const blNumberType e[7] = {71.0/57600.0,0,-71.0/16695.0,71.0/1920.0,-17253.0/339200.0,22.0/525.0,-1.0/40.0};
+
+    static const blStateType zero = {};
+
+    // After the first attempt m_k[0] always
+    // holds the derivative at y
+
+    if(m_numberOfAcceptedSteps == 0 && m_numberOfRejectedSteps == 0)
+        ODEfunctor(t,y,m_k[0]);
+
+    combineFixedSizeStages<1>(y,h,a2,m_k.data(),m_yStage);
+    ODEfunctor(t + 0.2 * h,m_yStage,m_k[1]);
+
+    combineFixedSizeStages<2>(y,h,a3,m_k.data(),m_yStage);
+    ODEfunctor(t + 0.3 * h,m_yStage,m_k[2]);
+
+    combineFixedSizeStages<3>(y,h,a4,m_k.data(),m_yStage);
+    ODEfunctor(t + 0.8 * h,m_yStage,m_k[3]);
+
+    combineFixedSizeStages<4>(y,h,a5,m_k.data(),m_yStage);
+    ODEfunctor(t + (8.0/9.0) * h,m_yStage,m_k[4]);
+
+    combineFixedSizeStages<5>(y,h,a6,m_k.data(),m_yStage);
+    ODEfunctor(t + h,m_yStage,m_k[5]);
+
+    combineFixedSizeStages<6>(y,h,b,m_k.data(),m_yTrial);
+    ODEfunctor(t + h,m_yTrial,m_k[6]);
+
+    combineFixedSizeStages<7>(zero,h,e,m_k.data(),m_yError);
+
+    blNumberType error = rkErrorNorm(N,y,m_yTrial,m_yError,m_absoluteTolerance,m_relativeTolerance);
+
+    bool isStepAccepted = (error <= blNumberType(1));
+
+    blNumberType factor = m_controller.getStepSizeFactor(error,isStepAccepted);
+
+    if(isStepAccepted)
+    {
+        // Only an accepted step replaces what
+        // the dense output interpolates
+
+        m_yStart = y;
+        m_yEnd = m_yTrial;
+        m_fStart = m_k[0];
+        m_fEnd = m_k[6];
+
+        y = m_yTrial;
+
+        // First same as last
+
+        m_k[0] = m_k[6];
+
+        m_lastStepStartTime = t;
+        m_lastStepSize = h;
+
+        t += h;
+
+        ++m_numberOfAcceptedSteps;
+    }
+    else
+        ++m_numberOfRejectedSteps;
+
+    h *= factor;
+
+    return isStepAccepted;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,int N>
+template<typename blODEFunctorType>
+inline bool blFixedSizeDormandPrinceStepper<blNumberType,N>::integrate(const blODEFunctorType& ODEfunctor,
+                                                                       blStateType& y,
+                                                                       const blNumberType& t0,
+                                                                       const blNumberType& tf,
+                                                                       const blNumberType& initialStepSize,
+                                                                       const int& maxNumberOfSteps)
+{
+    reset();
+
+    blNumberType t = t0;
+    blNumberType h = initialStepSize;
+
+    for(int i = 0; i < maxNumberOfSteps && t < tf; ++i)
+    {
+        // Don't step past the final time
+
+        bool isLastStep = (t + h >= tf);
+
+        if(isLastStep)
+            h = tf - t;
+
+        if(step(ODEfunctor,y,t,h) && isLastStep)
+            t = tf;
+    }
+
+    return (t >= tf);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,int N>
+inline void blFixedSizeDormandPrinceStepper<blNumberType,N>::denseOutput(const blNumberType& t,
+                                                                         blStateType& yOut)const
+{
+    if(m_lastStepSize == blNumberType(0))
+    {
+        yOut = m_yEnd;
+        return;
+    }
+
+    blNumberType theta = (t - m_lastStepStartTime) / m_lastStepSize;
+
+    rkHermiteDenseOutput(N,m_yStart,m_yEnd,m_fStart,0,m_fEnd,0,m_lastStepSize,theta,yOut);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// A rigid body state, 13 state variables:
+//
+// - position and velocity in the world frame
+// - orientation as a unit quaternion (body to world)
+// - angular velocity in the body frame
+//-------------------------------------------------------------------
+template<typename blNumberType>
+
+struct blRigidBodyState
+{
+    blVector3d<blNumberType>                position;
+    blVector3d<blNumberType>                velocity;
+    blQuaternion<blNumberType>              orientation;
+    blVector3d<blNumberType>                angularVelocity;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Functions used to pack/unpack a rigid body
+// state to/from the 13 state variables array
+// used by the fixed size steppers
+//-------------------------------------------------------------------
+template<typename blNumberType>
+
+inline void packRigidBodyState(const blRigidBodyState<blNumberType>& state,
+                               std::array<blNumberType,13>& y)
+{
+    y[0] = state.position.x();
+    y[1] = state.position.y();
+    y[2] = state.position.z();
+
+    y[3] = state.velocity.x();
+    y[4] = state.velocity.y();
+    y[5] = state.velocity.z();
+
+    y[6] = state.orientation.w();
+    y[7] = state.orientation.xyz().x();
+    y[8] = state.orientation.xyz().y();
+    y[9] = state.orientation.xyz().z();
+
+    y[10] = state.angularVelocity.x();
+    y[11] = state.angularVelocity.y();
+    y[12] = state.angularVelocity.z();
+}
+
+
+
+template<typename blNumberType>
+
+inline void unpackRigidBodyState(const std::array<blNumberType,13>& y,
+                                 blRigidBodyState<blNumberType>& state)
+{
+    state.position = blVector3d<blNumberType>(y[0],y[1],y[2]);
+    state.velocity = blVector3d<blNumberType>(y[3],y[4],y[5]);
+    state.orientation = blQuaternion<blNumberType>(y[6],y[7],y[8],y[9]);
+    state.angularVelocity = blVector3d<blNumberType>(y[10],y[11],y[12]);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The following function calculates the derivative
+// of a rigid body state given the force (world
+// frame) and torque (body frame) acting on it,
+// with the inertia tensor diagonal in the body
+// frame (principal axes):
+//
+// - position' = velocity
+// - velocity' = force / mass
+// - orientation' = orientation * (0,angularVelocity) / 2
+// - angularVelocity' = I^-1 (torque - w x (I w))
+//
+// - Use it inside the ODE functor of a
+//   blFixedSizeRK4Stepper<blNumberType,13> or a
+//   blFixedSizeDormandPrinceStepper<blNumberType,13>
+//-------------------------------------------------------------------
+template<typename blNumberType>
+
+inline void rigidBodyDerivatives(const std::array<blNumberType,13>& y,
+                                 const blVector3d<blNumberType>& force,
+                                 const blVector3d<blNumberType>& torque,
+                                 const blNumberType& mass,
+                                 const blVector3d<blNumberType>& principalMomentsOfInertia,
+                                 std::array<blNumberType,13>& dydt)
+{
+    blQuaternion<blNumberType> orientation(y[6],y[7],y[8],y[9]);
+    blVector3d<blNumberType> angularVelocity(y[10],y[11],y[12]);
+
+    // Translation
+
+    dydt[0] = y[3];
+    dydt[1] = y[4];
+    dydt[2] = y[5];
+
+    dydt[3] = force.x() / mass;
+    dydt[4] = force.y() / mass;
+    dydt[5] = force.z() / mass;
+
+    // Orientation
+
+    blQuaternion<blNumberType> orientationDerivative = orientation * blQuaternion<blNumberType>(0,angularVelocity);
+
+    dydt[6] = blNumberType(0.5) * orientationDerivative.w();
+    dydt[7] = blNumberType(0.5) * orientationDerivative.xyz().x();
+    dydt[8] = blNumberType(0.5) * orientationDerivative.xyz().y();
+    dydt[9] = blNumberType(0.5) * orientationDerivative.xyz().z();
+
+    // Euler's equations
+
+    blVector3d<blNumberType> angularMomentum(principalMomentsOfInertia.x() * angularVelocity.x(),
+                                             principalMomentsOfInertia.y() * angularVelocity.y(),
+                                             principalMomentsOfInertia.z() * angularVelocity.z());
+
+    blVector3d<blNumberType> netTorque = torque - crossProduct(angularVelocity,angularMomentum);
+
+    dydt[10] = netTorque.x() / principalMomentsOfInertia.x();
+    dydt[11] = netTorque.y() / principalMomentsOfInertia.y();
+    dydt[12] = netTorque.z() / principalMomentsOfInertia.z();
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// End of the blMathAPI namespace
+}
+//-------------------------------------------------------------------
+
+
+
+#endif // BL_RUNGAKUTTAFIXEDSIZE_HPP
@@ -0,0 +1,612 @@
+#ifndef BL_RUNGAKUTTAPARAREAL_HPP
+#define BL_RUNGAKUTTAPARAREAL_HPP
+
+
+
+///-------------------------------------------------------------------
+///
+///
+///
+/// PURPOSE:        Parallel-in-time (Parareal) integration, the
+///                 time span is cut in slices, a cheap fixed-step
+///                 rk4 propagator sweeps them serially, and the
+///                 accurate adaptive Cash-Karp propagator solves
+///                 all the slices in parallel, the two combined
+///                 in a predictor-corrector iteration
+///
+/// AUTHOR:         Vincenzo Barbato
+///                 navyenzo@gmail.com
+///
+/// NOTE:           All things in this library are defined within the
+///                 blMathAPI namespace
+///
+///                 The fine solves run with OpenMP (when it is
+///                 enabled) so the ODE functor is called from
+///                 several threads at once and must not change
+///                 any shared state
+///
+///                 ODEfunctor(t,y,dydt)
+///
+/// LISENSE:        MIT-LICENCE
+///                 http://www.opensource.org/licenses/mit-license.php
+///
+///
+///
+///-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Includes needed for this file
+//-------------------------------------------------------------------
+#include <vector>
+#include "blRungaKuttaSteppers.hpp"
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// NOTE: This class is defined within the blMathAPI namespace
+//-------------------------------------------------------------------
+namespace blMathAPI
+{
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Parareal integrator
+//
+// - With U_i the state at the start of slice i, G the
+//   coarse and F the fine propagator, every iteration
+//   computes F(U_i) for all slices in parallel, then
+//   sweeps the slices serially with
+//
+//   U_i+1 = G(U_i new) + F(U_i old) - G(U_i old)
+//
+// - When the start of a slice didn't change in the
+//   sweep the correction is skipped and U_i+1 is
+//   set to F(U_i), so after k iterations the first k
+//   slices are bit for bit the serial fine solution
+//   computed by integrateSerial, and the iterations
+//   stop when all slices are (at the latest after
+//   as many iterations as there are slices) or when
+//   no slice start moved more than the convergence
+//   tolerance times the fine tolerances
+//-------------------------------------------------------------------
+template<typename blNumberType>
+class blPararealIntegrator
+{
+public: // Constructors and destructors
+
+
+
+    // Default constructor
+
+    blPararealIntegrator(const int& numberOfStateVariables = 0,
+                         const int& numberOfTimeSlices = 1,
+                         const blNumberType& absoluteTolerance = 1e-6,
+                         const blNumberType& relativeTolerance = 1e-6);
+
+    // Destructor
+
+    ~blPararealIntegrator();
+
+
+
+public: // Public functions
+
+
+
+    // Functions used to resize the workspaces,
+    // these are the only functions that allocate
+
+    void                                    setNumberOfStateVariables(const int& numberOfStateVariables);
+    void                                    setNumberOfTimeSlices(const int& numberOfTimeSlices);
+
+    const int&                              getNumberOfStateVariables()const;
+    const int&                              getNumberOfTimeSlices()const;
+
+    // Tolerances of the fine propagator
+
+    void                                    setTolerances(const blNumberType& absoluteTolerance,
+                                                          const blNumberType& relativeTolerance);
+
+    // Number of rk4 steps the coarse
+    // propagator takes per slice
+
+    void                                    setNumberOfCoarseStepsPerSlice(const int& numberOfCoarseStepsPerSlice);
+
+    // Iteration limits, the iterations stop
+    // when the slice starts move less than
+    // convergenceTolerance times the fine
+    // tolerances
+
+    void                                    setMaxNumberOfIterations(const int& maxNumberOfIterations);
+    void                                    setConvergenceTolerance(const blNumberType& convergenceTolerance);
+
+    // Advances the state y from t0 to tf,
+    // returns false if the iterations didn't
+    // converge or a fine solve ran out of steps
+
+    template<typename blODEFunctorType>
+
+    bool                                    integrate(const blODEFunctorType& ODEfunctor,
+                                                      blNumberType* y,
+                                                      const blNumberType& t0,
+                                                      const blNumberType& tf,
+                                                      const blNumberType& initialFineStepSize,
+                                                      const int& maxNumberOfFineStepsPerSlice);
+
+    // The fine propagator applied slice after
+    // slice, the solution Parareal converges to
+
+    template<typename blODEFunctorType>
+
+    bool                                    integrateSerial(const blODEFunctorType& ODEfunctor,
+                                                            blNumberType* y,
+                                                            const blNumberType& t0,
+                                                            const blNumberType& tf,
+                                                            const blNumberType& initialFineStepSize,
+                                                            const int& maxNumberOfFineStepsPerSlice);
+
+    // The state at the start of slice i (with
+    // i = numberOfTimeSlices the final state)
+    // of the last integration
+
+    const blNumberType*                     getSliceState(const int& i)const;
+
+    // Iterations taken by the last integration
+
+    const int&                              getNumberOfIterations()const;
+
+
+
+private: // Private functions
+
+
+
+    // Start time of slice i
+
+    blNumberType                            getSliceTime(const blNumberType& t0,
+                                                         const blNumberType& tf,
+                                                         const int& i)const;
+
+    // Scaled RMS difference of two states
+
+    blNumberType                            scaledDifference(const blNumberType* yOld,
+                                                             const blNumberType* yNew)const;
+
+
+
+private: // Private variables
+
+
+
+    int                                     m_numberOfStateVariables;
+    int                                     m_numberOfTimeSlices;
+
+    blNumberType                            m_absoluteTolerance;
+    blNumberType                            m_relativeTolerance;
+
+    int                                     m_numberOfCoarseStepsPerSlice;
+    int                                     m_maxNumberOfIterations;
+    blNumberType                            m_convergenceTolerance;
+
+    int                                     m_numberOfIterations;
+
+    // The coarse propagator, and one fine
+    // propagator per slice so the slices
+    // can be solved concurrently
+
+    blRK4Stepper<blNumberType>              m_coarseStepper;
+    std::vector< blCashKarpStepper<blNumberType> > m_fineSteppers;
+
+    // Slice start states U_i, the fine and coarse
+    // solutions of each slice from its current
+    // start, and the new coarse solution
+
+    blAlignedBuffer<blNumberType>           m_sliceStates;
+    blAlignedBuffer<blNumberType>           m_fineStates;
+    blAlignedBuffer<blNumberType>           m_coarseStates;
+    blAlignedBuffer<blNumberType>           m_yCoarse;
+
+    // Whether the start of a slice changed
+    // since its fine solution was computed,
+    // and whether that solve succeeded
+
+    std::vector<char>                       m_isSliceStartChanged;
+    std::vector<char>                       m_isFineSolveSuccessful;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blPararealIntegrator<blNumberType>::blPararealIntegrator(const int& numberOfStateVariables,
+                                                                const int& numberOfTimeSlices,
+                                                                const blNumberType& absoluteTolerance,
+                                                                const blNumberType& relativeTolerance)
+{
+    m_numberOfStateVariables = 0;
+    m_numberOfTimeSlices = 1;
+
+    m_absoluteTolerance = absoluteTolerance;
+    m_relativeTolerance = relativeTolerance;
+
+    m_numberOfCoarseStepsPerSlice = 1;
+    m_maxNumberOfIterations = 10;
+    m_convergenceTolerance = 1;
+
+    m_numberOfIterations = 0;
+
+    setNumberOfTimeSlices(numberOfTimeSlices);
+    setNumberOfStateVariables(numberOfStateVariables);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blPararealIntegrator<blNumberType>::~blPararealIntegrator()
+{
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blPararealIntegrator<blNumberType>::setNumberOfStateVariables(const int& numberOfStateVariables)
+{
+    m_numberOfStateVariables = std::max(0,numberOfStateVariables);
+
+    const int n = m_numberOfStateVariables;
+    const int N = m_numberOfTimeSlices;
+
+    m_coarseStepper.setNumberOfStateVariables(n);
+
+    m_fineSteppers.assign(N,blCashKarpStepper<blNumberType>(n,m_absoluteTolerance,m_relativeTolerance));
+
+    m_sliceStates.resize((N + 1) * n);
+    m_fineStates.resize(N * n);
+    m_coarseStates.resize(N * n);
+    m_yCoarse.resize(n);
+
+    m_isSliceStartChanged.assign(N,1);
+    m_isFineSolveSuccessful.assign(N,0);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blPararealIntegrator<blNumberType>::setNumberOfTimeSlices(const int& numberOfTimeSlices)
+{
+    m_numberOfTimeSlices = std::max(1,numberOfTimeSlices);
+
+    setNumberOfStateVariables(m_numberOfStateVariables);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const int& blPararealIntegrator<blNumberType>::getNumberOfStateVariables()const
+{
+    return m_numberOfStateVariables;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const int& blPararealIntegrator<blNumberType>::getNumberOfTimeSlices()const
+{
+    return m_numberOfTimeSlices;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blPararealIntegrator<blNumberType>::setTolerances(const blNumberType& absoluteTolerance,
+                                                              const blNumberType& relativeTolerance)
+{
+    m_absoluteTolerance = absoluteTolerance;
+    m_relativeTolerance = relativeTolerance;
+
+    for(std::size_t i = 0; i < m_fineSteppers.size(); ++i)
+        m_fineSteppers[i].setTolerances(absoluteTolerance,relativeTolerance);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blPararealIntegrator<blNumberType>::setNumberOfCoarseStepsPerSlice(const int& numberOfCoarseStepsPerSlice)
+{
+    m_numberOfCoarseStepsPerSlice = std::max(1,numberOfCoarseStepsPerSlice);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blPararealIntegrator<blNumberType>::setMaxNumberOfIterations(const int& maxNumberOfIterations)
+{
+    m_maxNumberOfIterations = std::max(1,maxNumberOfIterations);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blPararealIntegrator<blNumberType>::setConvergenceTolerance(const blNumberType& convergenceTolerance)
+{
+    m_convergenceTolerance = convergenceTolerance;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const blNumberType* blPararealIntegrator<blNumberType>::getSliceState(const int& i)const
+{
+    return m_sliceStates.data() + i * m_numberOfStateVariables;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const int& blPararealIntegrator<blNumberType>::getNumberOfIterations()const
+{
+    return m_numberOfIterations;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blNumberType blPararealIntegrator<blNumberType>::getSliceTime(const blNumberType& t0,
+                                                                     const blNumberType& tf,
+                                                                     const int& i)const
+{
+    if(i >= m_numberOfTimeSlices)
+        return tf;
+
+    return t0 + (tf - t0) * blNumberType(i) / blNumberType(m_numberOfTimeSlices);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blNumberType blPararealIntegrator<blNumberType>::scaledDifference(const blNumberType* yOld,
+                                                                         const blNumberType* yNew)const
+{
+    const int n = m_numberOfStateVariables;
+
+    blNumberType sum = 0;
+
+    for(int i = 0; i < n; ++i)
+    {
+        blNumberType scale = m_absoluteTolerance + m_relativeTolerance * std::max(std::abs(yOld[i]),std::abs(yNew[i]));
+
+        blNumberType difference = (yNew[i] - yOld[i]) / scale;
+
+        sum += difference * difference;
+    }
+
+    return (n > 0) ? std::sqrt(sum / blNumberType(n)) : blNumberType(0);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename blODEFunctorType>
+inline bool blPararealIntegrator<blNumberType>::integrateSerial(const blODEFunctorType& ODEfunctor,
+                                                                blNumberType* y,
+                                                                const blNumberType& t0,
+                                                                const blNumberType& tf,
+                                                                const blNumberType& initialFineStepSize,
+                                                                const int& maxNumberOfFineStepsPerSlice)
+{
+    const int n = m_numberOfStateVariables;
+    const int N = m_numberOfTimeSlices;
+
+    bool isSuccessful = true;
+
+    std::copy(y,y + n,m_sliceStates.data());
+
+    for(int i = 0; i < N; ++i)
+    {
+        if(!m_fineSteppers[i].integrate(ODEfunctor,y,getSliceTime(t0,tf,i),getSliceTime(t0,tf,i + 1),initialFineStepSize,maxNumberOfFineStepsPerSlice))
+            isSuccessful = false;
+
+        std::copy(y,y + n,m_sliceStates.data() + (i + 1) * n);
+    }
+
+    m_numberOfIterations = 0;
+
+    return isSuccessful;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename blODEFunctorType>
+inline bool blPararealIntegrator<blNumberType>::integrate(const blODEFunctorType& ODEfunctor,
+                                                          blNumberType* y,
+                                                          const blNumberType& t0,
+                                                          const blNumberType& tf,
+                                                          const blNumberType& initialFineStepSize,
+                                                          const int& maxNumberOfFineStepsPerSlice)
+{
+    const int n = m_numberOfStateVariables;
+    const int N = m_numberOfTimeSlices;
+
+    blNumberType* sliceStates = m_sliceStates.data();
+    blNumberType* fineStates = m_fineStates.data();
+    blNumberType* coarseStates = m_coarseStates.data();
+    blNumberType* yCoarse = m_yCoarse.data();
+
+    // The first guess is the coarse
+    // solution over all the slices
+
+    std::copy(y,y + n,sliceStates);
+
+    for(int i = 0; i < N; ++i)
+    {
+        blNumberType* coarseState = coarseStates + i * n;
+
+        std::copy(sliceStates + i * n,sliceStates + (i + 1) * n,coarseState);
+
+        m_coarseStepper.integrate(ODEfunctor,coarseState,getSliceTime(t0,tf,i),getSliceTime(t0,tf,i + 1),m_numberOfCoarseStepsPerSlice);
+
+        std::copy(coarseState,coarseState + n,sliceStates + (i + 1) * n);
+
+        m_isSliceStartChanged[i] = 1;
+    }
+
+    bool hasConverged = false;
+
+    m_numberOfIterations = 0;
+
+    // Slices before this one are already
+    // the serial fine solution
+
+    int firstInexactSlice = 0;
+
+    while(!hasConverged && m_numberOfIterations < m_maxNumberOfIterations)
+    {
+        ++m_numberOfIterations;
+
+        // The fine solves of all the slices
+        // whose start changed, in parallel
+
+        #pragma omp parallel for schedule(dynamic,1)
+        for(int i = firstInexactSlice; i < N; ++i)
+        {
+            if(!m_isSliceStartChanged[i])
+                continue;
+
+            blNumberType* fineState = fineStates + i * n;
+
+            std::copy(sliceStates + i * n,sliceStates + (i + 1) * n,fineState);
+
+            m_isFineSolveSuccessful[i] = m_fineSteppers[i].integrate(ODEfunctor,fineState,getSliceTime(t0,tf,i),getSliceTime(t0,tf,i + 1),initialFineStepSize,maxNumberOfFineStepsPerSlice);
+
+            m_isSliceStartChanged[i] = 0;
+        }
+
+        // The serial correction sweep
+
+        blNumberType maxChange = 0;
+
+        bool isStartChanged = false;
+
+        int newFirstInexactSlice = N;
+
+        for(int i = firstInexactSlice; i < N; ++i)
+        {
+            blNumberType* nextState = sliceStates + (i + 1) * n;
+
+            const blNumberType* fineState = fineStates + i * n;
+
+            if(!isStartChanged)
+            {
+                // Same start as the fine solve,
+                // the correction would just
+                // cancel the coarse solutions
+
+                for(int j = 0; j < n; ++j)
+                    yCoarse[j] = fineState[j];
+            }
+            else
+            {
+                if(newFirstInexactSlice == N)
+                    newFirstInexactSlice = i;
+
+                blNumberType* coarseState = coarseStates + i * n;
+
+                std::copy(sliceStates + i * n,sliceStates + (i + 1) * n,yCoarse);
+
+                m_coarseStepper.integrate(ODEfunctor,yCoarse,getSliceTime(t0,tf,i),getSliceTime(t0,tf,i + 1),m_numberOfCoarseStepsPerSlice);
+
+                for(int j = 0; j < n; ++j)
+                {
+                    blNumberType coarseSolution = yCoarse[j];
+
+                    yCoarse[j] = coarseSolution + fineState[j] - coarseState[j];
+
+                    coarseState[j] = coarseSolution;
+                }
+            }
+
+            maxChange = std::max(maxChange,scaledDifference(nextState,yCoarse));
+
+            // Whether the start of the next
+            // slice moved, bit for bit
+
+            isStartChanged = false;
+
+            for(int j = 0; j < n; ++j)
+            {
+                if(yCoarse[j] != nextState[j])
+                    isStartChanged = true;
+            }
+
+            std::copy(yCoarse,yCoarse + n,nextState);
+
+            if(i + 1 < N)
+                m_isSliceStartChanged[i + 1] = isStartChanged ? 1 : 0;
+        }
+
+        firstInexactSlice = newFirstInexactSlice;
+
+        hasConverged = (firstInexactSlice >= N || maxChange <= m_convergenceTolerance);
+    }
+
+    bool isSuccessful = hasConverged;
+
+    for(int i = 0; i < N; ++i)
+    {
+        if(!m_isFineSolveSuccessful[i])
+            isSuccessful = false;
+    }
+
+    std::copy(sliceStates + N * n,sliceStates + (N + 1) * n,y);
+
+    return isSuccessful;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// End of the blMathAPI namespace
+}
+//-------------------------------------------------------------------
+
+
+
+#endif // BL_RUNGAKUTTAPARAREAL_HPP
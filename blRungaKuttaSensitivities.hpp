@@ -0,0 +1,775 @@
+#ifndef BL_RUNGAKUTTASENSITIVITIES_HPP
+#define BL_RUNGAKUTTASENSITIVITIES_HPP
+
+
+
+///-------------------------------------------------------------------
+///
+///
+///
+/// PURPOSE:        Parameter sensitivities of ODE solutions, for
+///                 gradient based parameter estimation:
+///
+///                 - Forward sensitivities, the variational
+///                   equations S' = J_y*S + J_p for S = dy/dp
+///                   integrated alongside the state by any of
+///                   the steppers
+///                 - A checkpointed discrete adjoint of the
+///                   fixed-step rk4, giving the gradient of a
+///                   loss with respect to all the parameters
+///                   and the initial state for the cost of
+///                   about one extra solve
+///
+/// AUTHOR:         Vincenzo Barbato
+///                 navyenzo@gmail.com
+///
+/// NOTE:           All things in this library are defined within the
+///                 blMathAPI namespace
+///
+///                 The ODE depends on a vector of parameters p:
+///
+///                 ODEfunctor(t,y,p,dydt)
+///
+/// LISENSE:        MIT-LICENCE
+///                 http://www.opensource.org/licenses/mit-license.php
+///
+///
+///
+///-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Includes needed for this file
+//-------------------------------------------------------------------
+#include <limits>
+#include <vector>
+#include "blRungaKuttaSteppers.hpp"
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// NOTE: This class is defined within the blMathAPI namespace
+//-------------------------------------------------------------------
+namespace blMathAPI
+{
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// ODE functor of the state augmented with its
+// forward sensitivities, to be integrated by
+// any of the steppers with n*(1 + P) states
+//
+// - The augmented state is laid out as
+//   [y, S_0, S_1, ..., S_P-1] with S_j = dy/dp_j
+//   (n values each), with S_j initially dy0/dp_j
+//   (zero when y0 doesn't depend on p)
+//
+// - The sensitivity functor computes the batch of
+//   Jacobian products for all the parameters at once
+//
+//   SensitivityFunctor(t,y,p,S,dSdt)
+//
+//   dSdt_j = J_y*S_j + df/dp_j, with S and dSdt
+//   holding the P columns one after the other
+//
+// - Passing blFiniteDifferenceJacobian() instead
+//   approximates each column by one directional
+//   finite difference of the ODE functor
+//
+// - The functor keeps its workspaces, so one
+//   instance can't be shared between threads
+//-------------------------------------------------------------------
+template<typename blNumberType,
+         typename blODEFunctorType,
+         typename blSensitivityFunctorType>
+class blForwardSensitivityFunctor
+{
+public: // Constructors and destructors
+
+
+
+    // Default constructor
+
+    blForwardSensitivityFunctor(const blODEFunctorType& ODEfunctor,
+                                const blSensitivityFunctorType& SensitivityFunctor,
+                                const int& numberOfStateVariables,
+                                const int& numberOfParameters,
+                                const blNumberType* parameters);
+
+    // Destructor
+
+    ~blForwardSensitivityFunctor();
+
+
+
+public: // Public functions
+
+
+
+    // The augmented ODE
+
+    void                                    operator()(const blNumberType& t,
+                                                       const blNumberType* z,
+                                                       blNumberType* dzdt)const;
+
+    // Size of the augmented state
+
+    int                                     getNumberOfAugmentedStateVariables()const;
+
+
+
+private: // Private functions
+
+
+
+    // The sensitivity derivatives, by finite
+    // differences or with the user functor
+
+    void                                    evaluateSensitivities(const blFiniteDifferenceJacobian& SensitivityFunctor,
+                                                                  const blNumberType& t,
+                                                                  const blNumberType* y,
+                                                                  const blNumberType* f,
+                                                                  const blNumberType* S,
+                                                                  blNumberType* dSdt)const;
+
+    template<typename blUserSensitivityFunctorType>
+
+    void                                    evaluateSensitivities(const blUserSensitivityFunctorType& SensitivityFunctor,
+                                                                  const blNumberType& t,
+                                                                  const blNumberType* y,
+                                                                  const blNumberType* f,
+                                                                  const blNumberType* S,
+                                                                  blNumberType* dSdt)const;
+
+
+
+private: // Private variables
+
+
+
+    // The functors are copied so that they can be
+    // passed as temporaries, the parameters aren't
+
+    blODEFunctorType                        m_ODEfunctor;
+    blSensitivityFunctorType                m_SensitivityFunctor;
+
+    int                                     m_numberOfStateVariables;
+    int                                     m_numberOfParameters;
+
+    const blNumberType*                     m_parameters;
+
+    // Perturbed state, parameters and
+    // derivative for the finite differences
+
+    mutable blAlignedBuffer<blNumberType>   m_yPerturbed;
+    mutable blAlignedBuffer<blNumberType>   m_pPerturbed;
+    mutable blAlignedBuffer<blNumberType>   m_fPerturbed;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blODEFunctorType,typename blSensitivityFunctorType>
+inline blForwardSensitivityFunctor<blNumberType,blODEFunctorType,blSensitivityFunctorType>::blForwardSensitivityFunctor(const blODEFunctorType& ODEfunctor,
+                                                                                                                        const blSensitivityFunctorType& SensitivityFunctor,
+                                                                                                                        const int& numberOfStateVariables,
+                                                                                                                        const int& numberOfParameters,
+                                                                                                                        const blNumberType* parameters)
+                                                                                                                        : m_ODEfunctor(ODEfunctor),
+                                                                                                                          m_SensitivityFunctor(SensitivityFunctor)
+{
+    m_numberOfStateVariables = std::max(0,numberOfStateVariables);
+    m_numberOfParameters = std::max(0,numberOfParameters);
+
+    m_parameters = parameters;
+
+    m_yPerturbed.resize(m_numberOfStateVariables);
+    m_pPerturbed.resize(m_numberOfParameters);
+    m_fPerturbed.resize(m_numberOfStateVariables);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blODEFunctorType,typename blSensitivityFunctorType>
+inline blForwardSensitivityFunctor<blNumberType,blODEFunctorType,blSensitivityFunctorType>::~blForwardSensitivityFunctor()
+{
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blODEFunctorType,typename blSensitivityFunctorType>
+inline int blForwardSensitivityFunctor<blNumberType,blODEFunctorType,blSensitivityFunctorType>::getNumberOfAugmentedStateVariables()const
+{
+    return m_numberOfStateVariables * (1 + m_numberOfParameters);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blODEFunctorType,typename blSensitivityFunctorType>
+inline void blForwardSensitivityFunctor<blNumberType,blODEFunctorType,blSensitivityFunctorType>::operator()(const blNumberType& t,
+                                                                                                            const blNumberType* z,
+                                                                                                            blNumberType* dzdt)const
+{
+    const int n = m_numberOfStateVariables;
+
+    m_ODEfunctor(t,z,m_parameters,dzdt);
+
+    evaluateSensitivities(m_SensitivityFunctor,t,z,dzdt,z + n,dzdt + n);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blODEFunctorType,typename blSensitivityFunctorType>
+inline void blForwardSensitivityFunctor<blNumberType,blODEFunctorType,blSensitivityFunctorType>::evaluateSensitivities(const blFiniteDifferenceJacobian&,
+                                                                                                                       const blNumberType& t,
+                                                                                                                       const blNumberType* y,
+                                                                                                                       const blNumberType* f,
+                                                                                                                       const blNumberType* S,
+                                                                                                                       blNumberType* dSdt)const
+{
+    const int n = m_numberOfStateVariables;
+    const int P = m_numberOfParameters;
+
+    const blNumberType sqrtRoundOff = std::sqrt(std::numeric_limits<blNumberType>::epsilon());
+
+    blNumberType* yPerturbed = m_yPerturbed.data();
+    blNumberType* pPerturbed = m_pPerturbed.data();
+    blNumberType* fPerturbed = m_fPerturbed.data();
+
+    std::copy(m_parameters,m_parameters + P,pPerturbed);
+
+    blNumberType stateScale = 1;
+
+    for(int i = 0; i < n; ++i)
+        stateScale = std::max(stateScale,std::abs(y[i]));
+
+    for(int j = 0; j < P; ++j)
+    {
+        const blNumberType* Sj = S + j * n;
+
+        // One directional difference along
+        // (S_j,e_j), scaled so that neither
+        // the state nor the parameter moves
+        // by much more than sqrt(eps) relative
+
+        blNumberType directionScale = 1;
+
+        for(int i = 0; i < n; ++i)
+            directionScale = std::max(directionScale,std::abs(Sj[i]));
+
+        blNumberType delta = sqrtRoundOff * std::max(stateScale,std::abs(m_parameters[j])) / directionScale;
+
+        for(int i = 0; i < n; ++i)
+            yPerturbed[i] = y[i] + delta * Sj[i];
+
+        pPerturbed[j] = m_parameters[j] + delta;
+
+        m_ODEfunctor(t,yPerturbed,pPerturbed,fPerturbed);
+
+        pPerturbed[j] = m_parameters[j];
+
+        blNumberType* dSjdt = dSdt + j * n;
+
+        for(int i = 0; i < n; ++i)
+            dSjdt[i] = (fPerturbed[i] - f[i]) / delta;
+    }
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blODEFunctorType,typename blSensitivityFunctorType>
+template<typename blUserSensitivityFunctorType>
+inline void blForwardSensitivityFunctor<blNumberType,blODEFunctorType,blSensitivityFunctorType>::evaluateSensitivities(const blUserSensitivityFunctorType& SensitivityFunctor,
+                                                                                                                       const blNumberType& t,
+                                                                                                                       const blNumberType* y,
+                                                                                                                       const blNumberType*,
+                                                                                                                       const blNumberType* S,
+                                                                                                                       blNumberType* dSdt)const
+{
+    SensitivityFunctor(t,y,m_parameters,S,dSdt);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Discrete adjoint of the fixed-step rk4, computes
+// the exact gradient (of the rk4 solution, not of
+// the ODE's) of a loss that depends on the states
+// at the steps, L = sum(g_i(y_i)), with respect to
+// the parameters and to the initial state
+//
+// - The forward pass only keeps every so many states
+//   (checkpoints), the backward pass recomputes the
+//   states between two checkpoints from the first
+//   one, so with N steps and checkpoints every
+//   sqrt(N) steps the memory is O(sqrt(N)) states
+//   and the work is about 3 solves plus the
+//   vector-Jacobian products
+//
+// - The vector-Jacobian product functor computes
+//   both products with the Jacobians at (t,y)
+//
+//   VJPfunctor(t,y,p,lambda,lambdaJy,lambdaJp)
+//
+//   lambdaJy = J_y^T*lambda (n values) and
+//   lambdaJp = J_p^T*lambda (P values)
+//
+// - The loss gradient functor is called backwards
+//   for every step state, from the final one to
+//   the initial one, and adds dg_i/dy_i to lambda
+//   (it can also add g_i to a running loss)
+//
+//   LossGradientFunctor(stepIndex,t,y,lambda)
+//-------------------------------------------------------------------
+template<typename blNumberType>
+class blRK4AdjointSolver
+{
+public: // Constructors and destructors
+
+
+
+    // Default constructor, a checkpoint interval
+    // of zero picks about sqrt(numberOfSteps)
+
+    blRK4AdjointSolver(const int& numberOfStateVariables = 0,
+                       const int& numberOfParameters = 0,
+                       const int& checkpointInterval = 0);
+
+    // Destructor
+
+    ~blRK4AdjointSolver();
+
+
+
+public: // Public functions
+
+
+
+    // Function used to resize the workspaces
+
+    void                                    setSize(const int& numberOfStateVariables,
+                                                    const int& numberOfParameters);
+
+    void                                    setCheckpointInterval(const int& checkpointInterval);
+
+    // Integrates from y0 at t0 to tf in
+    // numberOfSteps rk4 steps and back, writing
+    // dL/dy0 and dL/dp, the final state is
+    // available with getFinalState
+
+    template<typename blODEFunctorType,
+             typename blVJPFunctorType,
+             typename blLossGradientFunctorType>
+
+    void                                    computeGradient(const blODEFunctorType& ODEfunctor,
+                                                            const blVJPFunctorType& VJPfunctor,
+                                                            const blLossGradientFunctorType& LossGradientFunctor,
+                                                            const blNumberType* parameters,
+                                                            const blNumberType* y0,
+                                                            const blNumberType& t0,
+                                                            const blNumberType& tf,
+                                                            const int& numberOfSteps,
+                                                            blNumberType* dLdy0,
+                                                            blNumberType* dLdp);
+
+    const blNumberType*                     getFinalState()const;
+
+    // The number of states kept
+    // by the last computation
+
+    int                                     getNumberOfStoredStates()const;
+
+
+
+private: // Private functions
+
+
+
+    // One rk4 step of y in place, keeping
+    // the stage derivatives in m_k
+
+    template<typename blODEFunctorType>
+
+    void                                    step(const blODEFunctorType& ODEfunctor,
+                                                 const blNumberType* parameters,
+                                                 const blNumberType& t,
+                                                 const blNumberType& h,
+                                                 blNumberType* y);
+
+    // Pulls lambda (at the end of the step
+    // from y) back to the start of the
+    // step, adding to dL/dp
+
+    template<typename blODEFunctorType,
+             typename blVJPFunctorType>
+
+    void                                    backwardStep(const blODEFunctorType& ODEfunctor,
+                                                         const blVJPFunctorType& VJPfunctor,
+                                                         const blNumberType* parameters,
+                                                         const blNumberType& t,
+                                                         const blNumberType& h,
+                                                         const blNumberType* y,
+                                                         blNumberType* lambda,
+                                                         blNumberType* dLdp);
+
+
+
+private: // Private variables
+
+
+
+    int                                     m_numberOfStateVariables;
+    int                                     m_numberOfParameters;
+    int                                     m_checkpointInterval;
+
+    // The checkpoint states, and the states
+    // of the segment being pulled back
+
+    std::vector<blNumberType>               m_checkpoints;
+    std::vector<blNumberType>               m_segmentStates;
+
+    // rk4 workspaces, the stage derivatives,
+    // a stage state, the end of a recomputed
+    // step and the final state
+
+    blAlignedBuffer<blNumberType>           m_k;
+    blAlignedBuffer<blNumberType>           m_yStage;
+    blAlignedBuffer<blNumberType>           m_yStepEnd;
+    blAlignedBuffer<blNumberType>           m_yFinal;
+
+    // Adjoint workspaces, the stage adjoints,
+    // the products with the Jacobians and
+    // the adjoint at the start of the step
+
+    blAlignedBuffer<blNumberType>           m_kAdjoint;
+    blAlignedBuffer<blNumberType>           m_lambdaJy;
+    blAlignedBuffer<blNumberType>           m_lambdaJp;
+    blAlignedBuffer<blNumberType>           m_lambdaStart;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blRK4AdjointSolver<blNumberType>::blRK4AdjointSolver(const int& numberOfStateVariables,
+                                                            const int& numberOfParameters,
+                                                            const int& checkpointInterval)
+{
+    m_checkpointInterval = std::max(0,checkpointInterval);
+
+    setSize(numberOfStateVariables,numberOfParameters);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blRK4AdjointSolver<blNumberType>::~blRK4AdjointSolver()
+{
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blRK4AdjointSolver<blNumberType>::setSize(const int& numberOfStateVariables,
+                                                      const int& numberOfParameters)
+{
+    m_numberOfStateVariables = std::max(0,numberOfStateVariables);
+    m_numberOfParameters = std::max(0,numberOfParameters);
+
+    const int n = m_numberOfStateVariables;
+
+    m_k.resize(4 * n);
+    m_yStage.resize(n);
+    m_yStepEnd.resize(n);
+    m_yFinal.resize(n);
+
+    m_kAdjoint.resize(4 * n);
+    m_lambdaJy.resize(n);
+    m_lambdaJp.resize(m_numberOfParameters);
+    m_lambdaStart.resize(n);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blRK4AdjointSolver<blNumberType>::setCheckpointInterval(const int& checkpointInterval)
+{
+    m_checkpointInterval = std::max(0,checkpointInterval);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const blNumberType* blRK4AdjointSolver<blNumberType>::getFinalState()const
+{
+    return m_yFinal.data();
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline int blRK4AdjointSolver<blNumberType>::getNumberOfStoredStates()const
+{
+    if(m_numberOfStateVariables == 0)
+        return 0;
+
+    return int((m_checkpoints.size() + m_segmentStates.size()) / std::size_t(m_numberOfStateVariables));
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename blODEFunctorType>
+inline void blRK4AdjointSolver<blNumberType>::step(const blODEFunctorType& ODEfunctor,
+                                                   const blNumberType* parameters,
+                                                   const blNumberType& t,
+                                                   const blNumberType& h,
+                                                   blNumberType* y)
+{
+    const int n = m_numberOfStateVariables;
+
+    blNumberType* k = m_k.data();
+    blNumberType* yStage = m_yStage.data();
+
+    const blNumberType stageTimes[4] = {0,blNumberType(0.5),blNumberType(0.5),1};
+
+    for(int stage = 0; stage < 4; ++stage)
+    {
+        if(stage == 0)
+            std::copy(y,y + n,yStage);
+        else
+        {
+            for(int i = 0; i < n; ++i)
+                yStage[i] = y[i] + stageTimes[stage] * h * k[i + (stage - 1) * n];
+        }
+
+        ODEfunctor(t + stageTimes[stage] * h,yStage,parameters,k + stage * n);
+    }
+
+    for(int i = 0; i < n; ++i)
+        y[i] += h * (k[i] + blNumberType(2) * (k[i + n] + k[i + 2 * n]) + k[i + 3 * n]) / blNumberType(6);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename blODEFunctorType,typename blVJPFunctorType>
+inline void blRK4AdjointSolver<blNumberType>::backwardStep(const blODEFunctorType& ODEfunctor,
+                                                           const blVJPFunctorType& VJPfunctor,
+                                                           const blNumberType* parameters,
+                                                           const blNumberType& t,
+                                                           const blNumberType& h,
+                                                           const blNumberType* y,
+                                                           blNumberType* lambda,
+                                                           blNumberType* dLdp)
+{
+    const int n = m_numberOfStateVariables;
+    const int P = m_numberOfParameters;
+
+    // Recompute the stage derivatives
+
+    std::copy(y,y + n,m_yStepEnd.data());
+
+    step(ODEfunctor,parameters,t,h,m_yStepEnd.data());
+
+    const blNumberType* k = m_k.data();
+
+    blNumberType* yStage = m_yStage.data();
+    blNumberType* kAdjoint = m_kAdjoint.data();
+    blNumberType* lambdaJy = m_lambdaJy.data();
+    blNumberType* lambdaJp = m_lambdaJp.data();
+    blNumberType* lambdaStart = m_lambdaStart.data();
+
+    const blNumberType stageTimes[4] = {0,blNumberType(0.5),blNumberType(0.5),1};
+    const blNumberType stageWeights[4] = {blNumberType(1) / blNumberType(6),
+                                          blNumberType(1) / blNumberType(3),
+                                          blNumberType(1) / blNumberType(3),
+                                          blNumberType(1) / blNumberType(6)};
+
+    // y1 = y0 + h*sum(b_i*k_i), so the
+    // adjoints of the stage derivatives
+    // start at h*b_i*lambda
+
+    for(int stage = 0; stage < 4; ++stage)
+    {
+        for(int i = 0; i < n; ++i)
+            kAdjoint[i + stage * n] = h * stageWeights[stage] * lambda[i];
+    }
+
+    std::copy(lambda,lambda + n,lambdaStart);
+
+    // k_i = f(t + c_i*h, y0 + c_i*h*k_i-1),
+    // pulled back from the last stage
+
+    for(int stage = 3; stage >= 0; --stage)
+    {
+        if(stage == 0)
+            std::copy(y,y + n,yStage);
+        else
+        {
+            for(int i = 0; i < n; ++i)
+                yStage[i] = y[i] + stageTimes[stage] * h * k[i + (stage - 1) * n];
+        }
+
+        VJPfunctor(t + stageTimes[stage] * h,static_cast<const blNumberType*>(yStage),parameters,static_cast<const blNumberType*>(kAdjoint + stage * n),lambdaJy,lambdaJp);
+
+        for(int j = 0; j < P; ++j)
+            dLdp[j] += lambdaJp[j];
+
+        for(int i = 0; i < n; ++i)
+        {
+            lambdaStart[i] += lambdaJy[i];
+
+            if(stage > 0)
+                kAdjoint[i + (stage - 1) * n] += stageTimes[stage] * h * lambdaJy[i];
+        }
+    }
+
+    std::copy(lambdaStart,lambdaStart + n,lambda);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename blODEFunctorType,typename blVJPFunctorType,typename blLossGradientFunctorType>
+inline void blRK4AdjointSolver<blNumberType>::computeGradient(const blODEFunctorType& ODEfunctor,
+                                                              const blVJPFunctorType& VJPfunctor,
+                                                              const blLossGradientFunctorType& LossGradientFunctor,
+                                                              const blNumberType* parameters,
+                                                              const blNumberType* y0,
+                                                              const blNumberType& t0,
+                                                              const blNumberType& tf,
+                                                              const int& numberOfSteps,
+                                                              blNumberType* dLdy0,
+                                                              blNumberType* dLdp)
+{
+    const int n = m_numberOfStateVariables;
+    const int P = m_numberOfParameters;
+
+    std::fill(dLdp,dLdp + P,blNumberType(0));
+    std::fill(dLdy0,dLdy0 + n,blNumberType(0));
+
+    if(numberOfSteps <= 0)
+    {
+        std::copy(y0,y0 + n,m_yFinal.data());
+        LossGradientFunctor(0,t0,y0,dLdy0);
+        return;
+    }
+
+    const blNumberType h = (tf - t0) / blNumberType(numberOfSteps);
+
+    int checkpointInterval = m_checkpointInterval;
+
+    if(checkpointInterval <= 0)
+        checkpointInterval = std::max(1,int(std::sqrt(blNumberType(numberOfSteps)) + blNumberType(0.5)));
+
+    checkpointInterval = std::min(checkpointInterval,numberOfSteps);
+
+    const int numberOfCheckpoints = (numberOfSteps + checkpointInterval - 1) / checkpointInterval;
+
+    m_checkpoints.resize(std::size_t(numberOfCheckpoints) * std::size_t(n));
+    m_segmentStates.resize(std::size_t(checkpointInterval + 1) * std::size_t(n));
+
+    // Forward pass, keeping the state at
+    // the start of every segment
+
+    blNumberType* y = m_segmentStates.data();
+
+    std::copy(y0,y0 + n,y);
+
+    for(int i = 0; i < numberOfSteps; ++i)
+    {
+        if(i % checkpointInterval == 0)
+            std::copy(y,y + n,m_checkpoints.begin() + std::size_t(i / checkpointInterval) * std::size_t(n));
+
+        step(ODEfunctor,parameters,t0 + blNumberType(i) * h,h,y);
+    }
+
+    // The loss at the final state
+
+    blNumberType* lambda = dLdy0;
+
+    LossGradientFunctor(numberOfSteps,tf,static_cast<const blNumberType*>(y),lambda);
+
+    std::copy(y,y + n,m_yFinal.data());
+
+    // Backward pass, one segment at a time,
+    // recomputing its states from its checkpoint
+
+    for(int segment = numberOfCheckpoints - 1; segment >= 0; --segment)
+    {
+        const int firstStep = segment * checkpointInterval;
+        const int lastStep = std::min(numberOfSteps,firstStep + checkpointInterval);
+
+        blNumberType* segmentStates = m_segmentStates.data();
+
+        std::copy(m_checkpoints.begin() + std::size_t(segment) * std::size_t(n),
+                  m_checkpoints.begin() + std::size_t(segment + 1) * std::size_t(n),
+                  segmentStates);
+
+        for(int i = firstStep; i < lastStep - 1; ++i)
+        {
+            blNumberType* yNext = segmentStates + (i - firstStep + 1) * n;
+
+            std::copy(yNext - n,yNext,yNext);
+
+            step(ODEfunctor,parameters,t0 + blNumberType(i) * h,h,yNext);
+        }
+
+        for(int i = lastStep - 1; i >= firstStep; --i)
+        {
+            const blNumberType* yStart = segmentStates + (i - firstStep) * n;
+
+            const blNumberType tStart = t0 + blNumberType(i) * h;
+
+            backwardStep(ODEfunctor,VJPfunctor,parameters,tStart,h,yStart,lambda,dLdp);
+
+            LossGradientFunctor(i,tStart,yStart,lambda);
+        }
+    }
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// End of the blMathAPI namespace
+}
+//-------------------------------------------------------------------
+
+
+
+#endif // BL_RUNGAKUTTASENSITIVITIES_HPP
@@ -0,0 +1,883 @@
+#ifndef BL_RUNGAKUTTASINKS_HPP
+#define BL_RUNGAKUTTASINKS_HPP
+
+
+
+///-------------------------------------------------------------------
+///
+///
+///
+/// PURPOSE:        Solution sinks for the runga-kutta steppers,
+///                 observers that take the (t,y) of every accepted
+///                 step as the integration goes, so a long run
+///                 doesn't need a solution matrix preallocated for
+///                 all of its steps:
+///
+///                 - blRingBufferSink keeps the latest steps in a
+///                   fixed set of chunks
+///                 - blLTTBSink downsamples every state variable
+///                   on the fly with the streaming LTTB
+///                 - blBinaryFileSink appends the steps to a file
+///
+/// AUTHOR:         Vincenzo Barbato
+///                 navyenzo@gmail.com
+///
+/// NOTE:           All things in this library are defined within the
+///                 blMathAPI namespace
+///
+///                 The sinks are passed to the steppers' integrate
+///                 functions as observers:
+///
+///                 stepper.integrate(ODEfunctor,y,t0,tf,h0,maxSteps,sink)
+///
+/// LISENSE:        MIT-LICENCE
+///                 http://www.opensource.org/licenses/mit-license.php
+///
+///
+///
+///-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Includes needed for this file
+//-------------------------------------------------------------------
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "blStreamingLTTB.hpp"
+#include "blRungaKuttaSteppers.hpp"
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// NOTE: This class is defined within the blMathAPI namespace
+//-------------------------------------------------------------------
+namespace blMathAPI
+{
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Ring buffer of the latest steps, stored in a fixed
+// number of chunks allocated up front
+//
+// - Each chunk holds chunkSize steps, the times in
+//   one contiguous array and the states in another
+//   (step after step, n values each), and when all
+//   chunks are full the oldest chunk is recycled as
+//   a whole, so between (numberOfChunks - 1) and
+//   numberOfChunks chunks worth of steps are kept
+//
+// - The chunks can be read in order, oldest first,
+//   so full chunks can be handed as they are to
+//   chunk based consumers
+//-------------------------------------------------------------------
+template<typename blNumberType>
+class blRingBufferSink
+{
+public: // Constructors and destructors
+
+
+
+    // Default constructor
+
+    blRingBufferSink(const int& numberOfStateVariables = 0,
+                     const int& chunkSize = 1024,
+                     const int& numberOfChunks = 4);
+
+    // Destructor
+
+    ~blRingBufferSink();
+
+
+
+public: // Public functions
+
+
+
+    // Function used to resize the chunks,
+    // this is the only function that
+    // allocates, it also clears the sink
+
+    void                                    setSize(const int& numberOfStateVariables,
+                                                    const int& chunkSize,
+                                                    const int& numberOfChunks);
+
+    // Stores one step
+
+    void                                    operator()(const blNumberType& t,
+                                                       const blNumberType* y);
+
+    // Forgets all the stored steps
+
+    void                                    clear();
+
+    // The stored steps, with step
+    // 0 the oldest one still kept
+
+    int                                     getNumberOfStoredSteps()const;
+
+    const blNumberType&                     getTime(const int& stepIndex)const;
+    const blNumberType*                     getState(const int& stepIndex)const;
+
+    // The stored chunks, with chunk 0
+    // the oldest one, only the last one
+    // can be partially filled
+
+    int                                     getNumberOfStoredChunks()const;
+
+    int                                     getChunkSize(const int& chunkIndex)const;
+    const blNumberType*                     getChunkTimes(const int& chunkIndex)const;
+    const blNumberType*                     getChunkStates(const int& chunkIndex)const;
+
+    // The number of steps received since
+    // the last clear, stored or not
+
+    const std::uint64_t&                    getNumberOfReceivedSteps()const;
+
+    const int&                              getNumberOfStateVariables()const;
+
+
+
+private: // Private functions
+
+
+
+    // Position of the ith oldest
+    // stored chunk in the ring
+
+    int                                     getRingIndex(const int& chunkIndex)const;
+
+
+
+private: // Private variables
+
+
+
+    int                                     m_numberOfStateVariables;
+    int                                     m_chunkSize;
+    int                                     m_numberOfChunks;
+
+    // The ring of chunks, the position of
+    // the oldest chunk, how many chunks are
+    // used and how full the newest one is
+
+    std::vector<blNumberType>               m_times;
+    std::vector<blNumberType>               m_states;
+
+    int                                     m_oldestChunk;
+    int                                     m_numberOfStoredChunks;
+    int                                     m_newestChunkSize;
+
+    std::uint64_t                           m_numberOfReceivedSteps;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blRingBufferSink<blNumberType>::blRingBufferSink(const int& numberOfStateVariables,
+                                                        const int& chunkSize,
+                                                        const int& numberOfChunks)
+{
+    setSize(numberOfStateVariables,chunkSize,numberOfChunks);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blRingBufferSink<blNumberType>::~blRingBufferSink()
+{
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blRingBufferSink<blNumberType>::setSize(const int& numberOfStateVariables,
+                                                    const int& chunkSize,
+                                                    const int& numberOfChunks)
+{
+    m_numberOfStateVariables = std::max(0,numberOfStateVariables);
+    m_chunkSize = std::max(1,chunkSize);
+    m_numberOfChunks = std::max(1,numberOfChunks);
+
+    m_times.assign(std::size_t(m_chunkSize) * std::size_t(m_numberOfChunks),blNumberType(0));
+    m_states.assign(std::size_t(m_chunkSize) * std::size_t(m_numberOfChunks) * std::size_t(m_numberOfStateVariables),blNumberType(0));
+
+    clear();
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blRingBufferSink<blNumberType>::clear()
+{
+    m_oldestChunk = 0;
+    m_numberOfStoredChunks = 0;
+    m_newestChunkSize = 0;
+
+    m_numberOfReceivedSteps = 0;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blRingBufferSink<blNumberType>::operator()(const blNumberType& t,
+                                                       const blNumberType* y)
+{
+    // Start a new chunk when the newest one
+    // is full, recycling the oldest chunk
+    // when there are no free ones left
+
+    if(m_numberOfStoredChunks == 0 || m_newestChunkSize == m_chunkSize)
+    {
+        if(m_numberOfStoredChunks == m_numberOfChunks)
+        {
+            m_oldestChunk = (m_oldestChunk + 1) % m_numberOfChunks;
+            --m_numberOfStoredChunks;
+        }
+
+        ++m_numberOfStoredChunks;
+        m_newestChunkSize = 0;
+    }
+
+    const std::size_t stepPosition = std::size_t(getRingIndex(m_numberOfStoredChunks - 1)) * std::size_t(m_chunkSize) + std::size_t(m_newestChunkSize);
+
+    m_times[stepPosition] = t;
+
+    std::copy(y,y + m_numberOfStateVariables,m_states.begin() + stepPosition * std::size_t(m_numberOfStateVariables));
+
+    ++m_newestChunkSize;
+    ++m_numberOfReceivedSteps;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline int blRingBufferSink<blNumberType>::getRingIndex(const int& chunkIndex)const
+{
+    return (m_oldestChunk + chunkIndex) % m_numberOfChunks;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline int blRingBufferSink<blNumberType>::getNumberOfStoredSteps()const
+{
+    if(m_numberOfStoredChunks == 0)
+        return 0;
+
+    return (m_numberOfStoredChunks - 1) * m_chunkSize + m_newestChunkSize;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const blNumberType& blRingBufferSink<blNumberType>::getTime(const int& stepIndex)const
+{
+    return getChunkTimes(stepIndex / m_chunkSize)[stepIndex % m_chunkSize];
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const blNumberType* blRingBufferSink<blNumberType>::getState(const int& stepIndex)const
+{
+    return getChunkStates(stepIndex / m_chunkSize) + (stepIndex % m_chunkSize) * m_numberOfStateVariables;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline int blRingBufferSink<blNumberType>::getNumberOfStoredChunks()const
+{
+    return m_numberOfStoredChunks;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline int blRingBufferSink<blNumberType>::getChunkSize(const int& chunkIndex)const
+{
+    return (chunkIndex == m_numberOfStoredChunks - 1) ? m_newestChunkSize : m_chunkSize;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const blNumberType* blRingBufferSink<blNumberType>::getChunkTimes(const int& chunkIndex)const
+{
+    return m_times.data() + std::size_t(getRingIndex(chunkIndex)) * std::size_t(m_chunkSize);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const blNumberType* blRingBufferSink<blNumberType>::getChunkStates(const int& chunkIndex)const
+{
+    return m_states.data() + std::size_t(getRingIndex(chunkIndex)) * std::size_t(m_chunkSize) * std::size_t(m_numberOfStateVariables);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const std::uint64_t& blRingBufferSink<blNumberType>::getNumberOfReceivedSteps()const
+{
+    return m_numberOfReceivedSteps;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const int& blRingBufferSink<blNumberType>::getNumberOfStateVariables()const
+{
+    return m_numberOfStateVariables;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Downsamples every state variable on the fly with
+// its own streaming LTTB (see blStreamingLTTB.hpp),
+// keeping only the picked points and their times
+//
+// - Like the streaming LTTB the buckets are counted
+//   in steps, not in time, so with adaptive steps
+//   the buckets are shorter where the solution is
+//   changing fast, which is where the detail is
+//
+// - The picked points are always within the last
+//   two buckets, so only their times are kept to
+//   look up the time of each picked point
+//
+// - flush() has to be called after the integration
+//   to emit the points of the unfinished buckets
+//-------------------------------------------------------------------
+template<typename blNumberType>
+class blLTTBSink
+{
+public: // Constructors and destructors
+
+
+
+    // Default constructor, every picked
+    // point represents bucketSize steps
+
+    blLTTBSink(const int& numberOfStateVariables = 0,
+               const std::size_t& bucketSize = 1);
+
+    // Destructor
+
+    ~blLTTBSink();
+
+
+
+public: // Public functions
+
+
+
+    // Function used to resize the sink,
+    // it also clears it
+
+    void                                    setSize(const int& numberOfStateVariables,
+                                                    const std::size_t& bucketSize);
+
+    // Pushes one step
+
+    void                                    operator()(const blNumberType& t,
+                                                       const blNumberType* y);
+
+    // Emits the points of the unfinished
+    // buckets, after this the sink starts
+    // a new stream
+
+    void                                    flush();
+
+    // Forgets all steps and picked points
+
+    void                                    clear();
+
+    // The picked points of state variable i
+
+    const std::vector<blNumberType>&        getTimes(const int& stateIndex)const;
+    const std::vector<blNumberType>&        getValues(const int& stateIndex)const;
+
+    const int&                              getNumberOfStateVariables()const;
+
+
+
+private: // Private functions
+
+
+
+    // Stores the points emitted
+    // by the LTTB of state i
+
+    void                                    storePoints(const int& stateIndex,
+                                                        const std::size_t& numberOfPoints);
+
+
+
+private: // Private variables
+
+
+
+    int                                     m_numberOfStateVariables;
+    std::size_t                             m_bucketSize;
+
+    std::vector< blStreamingLTTB<blNumberType> > m_downsamplers;
+
+    // The times of the latest steps, indexed
+    // by the step index modulo their size
+
+    std::vector<blNumberType>               m_recentTimes;
+
+    // The picked points of every state
+
+    std::vector< std::vector<blNumberType> > m_times;
+    std::vector< std::vector<blNumberType> > m_values;
+
+    // Room for the points emitted
+    // by one push or flush
+
+    std::size_t                             m_emittedIndices[4];
+    blNumberType                            m_emittedValues[4];
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blLTTBSink<blNumberType>::blLTTBSink(const int& numberOfStateVariables,
+                                            const std::size_t& bucketSize)
+{
+    setSize(numberOfStateVariables,bucketSize);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blLTTBSink<blNumberType>::~blLTTBSink()
+{
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blLTTBSink<blNumberType>::setSize(const int& numberOfStateVariables,
+                                              const std::size_t& bucketSize)
+{
+    m_numberOfStateVariables = std::max(0,numberOfStateVariables);
+    m_bucketSize = std::max(std::size_t(1),bucketSize);
+
+    m_downsamplers.assign(m_numberOfStateVariables,blStreamingLTTB<blNumberType>(m_bucketSize));
+
+    m_recentTimes.assign(2 * m_bucketSize + 4,blNumberType(0));
+
+    m_times.assign(m_numberOfStateVariables,std::vector<blNumberType>());
+    m_values.assign(m_numberOfStateVariables,std::vector<blNumberType>());
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blLTTBSink<blNumberType>::clear()
+{
+    for(int i = 0; i < m_numberOfStateVariables; ++i)
+    {
+        m_downsamplers[i].reset();
+
+        m_times[i].clear();
+        m_values[i].clear();
+    }
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blLTTBSink<blNumberType>::storePoints(const int& stateIndex,
+                                                  const std::size_t& numberOfPoints)
+{
+    for(std::size_t j = 0; j < numberOfPoints; ++j)
+    {
+        m_times[stateIndex].push_back(m_recentTimes[m_emittedIndices[j] % m_recentTimes.size()]);
+        m_values[stateIndex].push_back(m_emittedValues[j]);
+    }
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blLTTBSink<blNumberType>::operator()(const blNumberType& t,
+                                                 const blNumberType* y)
+{
+    if(m_numberOfStateVariables == 0)
+        return;
+
+    // All the downsamplers have seen
+    // the same number of steps
+
+    std::size_t stepIndex = m_downsamplers[0].getNumberOfSamples();
+
+    m_recentTimes[stepIndex % m_recentTimes.size()] = t;
+
+    for(int i = 0; i < m_numberOfStateVariables; ++i)
+    {
+        std::size_t numberOfPoints = m_downsamplers[i].push(y + i,1,m_emittedIndices,m_emittedValues);
+
+        storePoints(i,numberOfPoints);
+    }
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blLTTBSink<blNumberType>::flush()
+{
+    for(int i = 0; i < m_numberOfStateVariables; ++i)
+    {
+        std::size_t numberOfPoints = m_downsamplers[i].flush(m_emittedIndices,m_emittedValues);
+
+        storePoints(i,numberOfPoints);
+    }
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const std::vector<blNumberType>& blLTTBSink<blNumberType>::getTimes(const int& stateIndex)const
+{
+    return m_times[stateIndex];
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const std::vector<blNumberType>& blLTTBSink<blNumberType>::getValues(const int& stateIndex)const
+{
+    return m_values[stateIndex];
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const int& blLTTBSink<blNumberType>::getNumberOfStateVariables()const
+{
+    return m_numberOfStateVariables;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Header at the start of a solution file, the
+// records (t followed by the n states) start
+// right after it
+//-------------------------------------------------------------------
+struct blSolutionFileHeader
+{
+    char                                    magic[8];
+    std::uint32_t                           numberSize;
+    std::uint32_t                           numberOfStateVariables;
+    char                                    padding[16];
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Appends every step to a binary file, as a record
+// of t followed by the n state values, buffering a
+// chunk of records in memory between writes
+//
+// - A new file gets a blSolutionFileHeader, opening
+//   an existing file appends to it, if its header
+//   matches the number type and state size
+//
+// - The buffer is written when full, on flush()
+//   and on close() (called by the destructor)
+//-------------------------------------------------------------------
+template<typename blNumberType>
+class blBinaryFileSink
+{
+public: // Constructors and destructors
+
+
+
+    // Default constructor
+
+    blBinaryFileSink(const int& numberOfStateVariables = 0,
+                     const int& numberOfBufferedSteps = 4096);
+
+    // Destructor
+
+    ~blBinaryFileSink();
+
+
+
+public: // Public functions
+
+
+
+    // Opens the file to append to,
+    // returns false if it can't be
+    // opened or holds another kind
+    // of solution
+
+    bool                                    open(const std::string& filename);
+
+    // Writes the buffered steps and closes the file
+
+    void                                    close();
+
+    bool                                    isOpen()const;
+
+    // Buffers one step
+
+    void                                    operator()(const blNumberType& t,
+                                                       const blNumberType* y);
+
+    // Writes the buffered steps,
+    // returns false on a write error
+
+    bool                                    flush();
+
+    // Steps written or buffered since open
+
+    const std::uint64_t&                    getNumberOfSteps()const;
+
+
+
+private: // Private variables
+
+
+
+    int                                     m_numberOfStateVariables;
+    int                                     m_numberOfBufferedSteps;
+
+    std::ofstream                           m_file;
+
+    std::vector<blNumberType>               m_buffer;
+    std::size_t                             m_bufferSize;
+
+    std::uint64_t                           m_numberOfSteps;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blBinaryFileSink<blNumberType>::blBinaryFileSink(const int& numberOfStateVariables,
+                                                        const int& numberOfBufferedSteps)
+{
+    m_numberOfStateVariables = std::max(0,numberOfStateVariables);
+    m_numberOfBufferedSteps = std::max(1,numberOfBufferedSteps);
+
+    m_buffer.assign(std::size_t(m_numberOfBufferedSteps) * std::size_t(m_numberOfStateVariables + 1),blNumberType(0));
+    m_bufferSize = 0;
+
+    m_numberOfSteps = 0;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blBinaryFileSink<blNumberType>::~blBinaryFileSink()
+{
+    close();
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline bool blBinaryFileSink<blNumberType>::open(const std::string& filename)
+{
+    close();
+
+    m_numberOfSteps = 0;
+
+    blSolutionFileHeader header;
+    std::memset(&header,0,sizeof(header));
+    std::memcpy(header.magic,"blRKsol",8);
+    header.numberSize = std::uint32_t(sizeof(blNumberType));
+    header.numberOfStateVariables = std::uint32_t(m_numberOfStateVariables);
+
+    // Check the header of an existing file
+
+    std::ifstream existingFile(filename.c_str(),std::ios::binary | std::ios::ate);
+
+    bool isNewFile = (!existingFile || existingFile.tellg() == std::streampos(0));
+
+    if(!isNewFile)
+    {
+        blSolutionFileHeader existingHeader;
+
+        existingFile.seekg(0);
+
+        if(!existingFile.read(reinterpret_cast<char*>(&existingHeader),sizeof(existingHeader)) ||
+           std::memcmp(existingHeader.magic,header.magic,8) != 0 ||
+           existingHeader.numberSize != header.numberSize ||
+           existingHeader.numberOfStateVariables != header.numberOfStateVariables)
+        {
+            return false;
+        }
+    }
+
+    existingFile.close();
+
+    m_file.open(filename.c_str(),std::ios::binary | std::ios::app);
+
+    if(!m_file)
+        return false;
+
+    if(isNewFile)
+        m_file.write(reinterpret_cast<const char*>(&header),sizeof(header));
+
+    return bool(m_file);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blBinaryFileSink<blNumberType>::close()
+{
+    if(!m_file.is_open())
+        return;
+
+    flush();
+
+    m_file.close();
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline bool blBinaryFileSink<blNumberType>::isOpen()const
+{
+    return m_file.is_open();
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blBinaryFileSink<blNumberType>::operator()(const blNumberType& t,
+                                                       const blNumberType* y)
+{
+    if(!m_file.is_open())
+        return;
+
+    if(m_bufferSize == m_buffer.size())
+        flush();
+
+    m_buffer[m_bufferSize] = t;
+
+    std::copy(y,y + m_numberOfStateVariables,m_buffer.begin() + m_bufferSize + 1);
+
+    m_bufferSize += std::size_t(m_numberOfStateVariables + 1);
+
+    ++m_numberOfSteps;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline bool blBinaryFileSink<blNumberType>::flush()
+{
+    if(m_bufferSize > 0)
+        m_file.write(reinterpret_cast<const char*>(m_buffer.data()),std::streamsize(m_bufferSize * sizeof(blNumberType)));
+
+    m_bufferSize = 0;
+
+    m_file.flush();
+
+    return bool(m_file);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const std::uint64_t& blBinaryFileSink<blNumberType>::getNumberOfSteps()const
+{
+    return m_numberOfSteps;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// End of the blMathAPI namespace
+}
+//-------------------------------------------------------------------
+
+
+
+#endif // BL_RUNGAKUTTASINKS_HPP
@@ -0,0 +1,1264 @@
+#ifndef BL_RUNGAKUTTASTEPPERS_HPP
+#define BL_RUNGAKUTTASTEPPERS_HPP
+
+
+
+///-------------------------------------------------------------------
+///
+///
+///
+/// PURPOSE:        Stepper objects for the runga-kutta
+///                 family that own all their workspaces,
+///                 so that once constructed a step or a
+///                 whole integration never touches the heap
+///
+/// AUTHOR:         Vincenzo Barbato
+///                 navyenzo@gmail.com
+///
+/// NOTE:           All things in this library are defined within the
+///                 blMathAPI namespace
+///
+///                 The steppers work on raw arrays of state
+///                 variables, so the ODE functor is called as
+///
+///                 ODEfunctor(t,y,dydt)
+///
+///                 where y and dydt are pointers into the
+///                 stepper's (64 byte aligned) workspaces
+///
+///                 The integrate functions optionally take an
+///                 observer, called with the initial state and
+///                 then after every accepted step as
+///
+///                 observer(t,y)
+///
+/// LISENSE:        MIT-LICENCE
+///                 http://www.opensource.org/licenses/mit-license.php
+///
+///
+///
+///-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Includes needed for this file
+//-------------------------------------------------------------------
+#include <cstdint>
+#include <vector>
+#include "blRungaKutta.hpp"
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// NOTE: This class is defined within the blMathAPI namespace
+//-------------------------------------------------------------------
+namespace blMathAPI
+{
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// A fixed size array whose first element
+// is aligned to a 64 byte boundary (a cache
+// line and an AVX-512 register), allocated
+// once at construction
+//-------------------------------------------------------------------
+template<typename blNumberType>
+class blAlignedBuffer
+{
+public: // Constructors and destructors
+
+
+
+    // Default constructor
+
+    blAlignedBuffer(const int& size = 0);
+
+    // Copy constructor and assignment,
+    // the copy gets its own aligned start
+
+    blAlignedBuffer(const blAlignedBuffer<blNumberType>& buffer);
+
+    blAlignedBuffer<blNumberType>&          operator=(const blAlignedBuffer<blNumberType>& buffer);
+
+    // Destructor
+
+    ~blAlignedBuffer();
+
+
+
+public: // Public functions
+
+
+
+    // Reallocates the buffer (the
+    // contents are set to zero)
+
+    void                                    resize(const int& size);
+
+    const int&                              size()const;
+
+    blNumberType*                           data();
+    const blNumberType*                     data()const;
+
+    blNumberType&                           operator[](const int& index);
+    const blNumberType&                     operator[](const int& index)const;
+
+
+
+private: // Private variables
+
+
+
+    // The storage is over-allocated by one
+    // alignment and the data starts at the
+    // first aligned element
+
+    std::vector<blNumberType>               m_storage;
+    std::size_t                             m_alignedOffset;
+    int                                     m_size;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blAlignedBuffer<blNumberType>::blAlignedBuffer(const int& size)
+{
+    m_alignedOffset = 0;
+    m_size = 0;
+
+    resize(size);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blAlignedBuffer<blNumberType>::blAlignedBuffer(const blAlignedBuffer<blNumberType>& buffer)
+{
+    m_alignedOffset = 0;
+    m_size = 0;
+
+    (*this) = buffer;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blAlignedBuffer<blNumberType>::~blAlignedBuffer()
+{
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blAlignedBuffer<blNumberType>& blAlignedBuffer<blNumberType>::operator=(const blAlignedBuffer<blNumberType>& buffer)
+{
+    if(this == &buffer)
+        return (*this);
+
+    if(m_size != buffer.m_size)
+        resize(buffer.m_size);
+
+    std::copy(buffer.data(),buffer.data() + m_size,data());
+
+    return (*this);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blAlignedBuffer<blNumberType>::resize(const int& size)
+{
+    const std::size_t alignment = 64;
+
+    m_size = std::max(0,size);
+
+    // Types that don't tile the alignment
+    // are just stored contiguously
+
+    if(alignment % sizeof(blNumberType) != 0)
+    {
+        m_storage.assign(m_size,blNumberType(0));
+        m_alignedOffset = 0;
+        return;
+    }
+
+    const std::size_t padding = alignment / sizeof(blNumberType);
+
+    m_storage.assign(std::size_t(m_size) + padding,blNumberType(0));
+
+    std::size_t misalignment = reinterpret_cast<std::uintptr_t>(m_storage.data()) % alignment;
+
+    m_alignedOffset = (misalignment == 0 || misalignment % sizeof(blNumberType) != 0) ? 0 : (alignment - misalignment) / sizeof(blNumberType);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const int& blAlignedBuffer<blNumberType>::size()const
+{
+    return m_size;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blNumberType* blAlignedBuffer<blNumberType>::data()
+{
+    return m_storage.data() + m_alignedOffset;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const blNumberType* blAlignedBuffer<blNumberType>::data()const
+{
+    return m_storage.data() + m_alignedOffset;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blNumberType& blAlignedBuffer<blNumberType>::operator[](const int& index)
+{
+    return m_storage[m_alignedOffset + index];
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const blNumberType& blAlignedBuffer<blNumberType>::operator[](const int& index)const
+{
+    return m_storage[m_alignedOffset + index];
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Observer that ignores the solution, used by
+// the integrate functions called without one
+//-------------------------------------------------------------------
+struct blNullObserver
+{
+    template<typename blNumberType>
+
+    void operator()(const blNumberType&,const blNumberType*)const
+    {
+    }
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Passed in place of a Jacobian functor to have the
+// solvers approximate the Jacobian (or its products)
+// by finite differences
+//-------------------------------------------------------------------
+struct blFiniteDifferenceJacobian
+{
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Fixed-step 4th-order Runge-Kutta stepper
+//-------------------------------------------------------------------
+template<typename blNumberType>
+class blRK4Stepper
+{
+public: // Constructors and destructors
+
+
+
+    // Default constructor
+
+    blRK4Stepper(const int& numberOfStateVariables = 0);
+
+    // Destructor
+
+    ~blRK4Stepper();
+
+
+
+public: // Public functions
+
+
+
+    // Function used to resize the workspaces,
+    // this is the only function that allocates
+
+    void                                    setNumberOfStateVariables(const int& numberOfStateVariables);
+
+    const int&                              getNumberOfStateVariables()const;
+
+    // Advances the state y from t to t + h
+
+    template<typename blODEFunctorType>
+
+    void                                    step(const blODEFunctorType& ODEfunctor,
+                                                 blNumberType* y,
+                                                 const blNumberType& t,
+                                                 const blNumberType& h);
+
+    // Advances the state y from t0 to
+    // tf in numberOfSteps equal steps
+
+    template<typename blODEFunctorType>
+
+    void                                    integrate(const blODEFunctorType& ODEfunctor,
+                                                      blNumberType* y,
+                                                      const blNumberType& t0,
+                                                      const blNumberType& tf,
+                                                      const int& numberOfSteps);
+
+    template<typename blODEFunctorType,
+             typename blObserverType>
+
+    void                                    integrate(const blODEFunctorType& ODEfunctor,
+                                                      blNumberType* y,
+                                                      const blNumberType& t0,
+                                                      const blNumberType& tf,
+                                                      const int& numberOfSteps,
+                                                      blObserverType& observer);
+
+
+
+private: // Private variables
+
+
+
+    int                                     m_numberOfStateVariables;
+
+    // The stage derivatives, the state at the
+    // start of the step and the derivative
+    // evaluated by the ODE functor
+
+    blAlignedBuffer<blNumberType>           m_k;
+    blAlignedBuffer<blNumberType>           m_yStart;
+    blAlignedBuffer<blNumberType>           m_yTemp;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blRK4Stepper<blNumberType>::blRK4Stepper(const int& numberOfStateVariables)
+{
+    setNumberOfStateVariables(numberOfStateVariables);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blRK4Stepper<blNumberType>::~blRK4Stepper()
+{
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blRK4Stepper<blNumberType>::setNumberOfStateVariables(const int& numberOfStateVariables)
+{
+    m_numberOfStateVariables = std::max(0,numberOfStateVariables);
+
+    m_k.resize(4 * m_numberOfStateVariables);
+    m_yStart.resize(m_numberOfStateVariables);
+    m_yTemp.resize(m_numberOfStateVariables);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const int& blRK4Stepper<blNumberType>::getNumberOfStateVariables()const
+{
+    return m_numberOfStateVariables;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename blODEFunctorType>
+inline void blRK4Stepper<blNumberType>::step(const blODEFunctorType& ODEfunctor,
+                                             blNumberType* y,
+                                             const blNumberType& t,
+                                             const blNumberType& h)
+{
+    blNumberType* yStart = m_yStart.data();
+    blNumberType* k = m_k.data();
+    blNumberType* yTemp = m_yTemp.data();
+
+    std::copy(y,y + m_numberOfStateVariables,yStart);
+
+    rk4(ODEfunctor,m_numberOfStateVariables,yStart,t,h,y,k,yTemp);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename blODEFunctorType>
+inline void blRK4Stepper<blNumberType>::integrate(const blODEFunctorType& ODEfunctor,
+                                                  blNumberType* y,
+                                                  const blNumberType& t0,
+                                                  const blNumberType& tf,
+                                                  const int& numberOfSteps)
+{
+    blNullObserver observer;
+
+    integrate(ODEfunctor,y,t0,tf,numberOfSteps,observer);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename blODEFunctorType,typename blObserverType>
+inline void blRK4Stepper<blNumberType>::integrate(const blODEFunctorType& ODEfunctor,
+                                                  blNumberType* y,
+                                                  const blNumberType& t0,
+                                                  const blNumberType& tf,
+                                                  const int& numberOfSteps,
+                                                  blObserverType& observer)
+{
+    if(numberOfSteps <= 0)
+        return;
+
+    blNumberType h = (tf - t0) / blNumberType(numberOfSteps);
+
+    observer(t0,static_cast<const blNumberType*>(y));
+
+    for(int i = 0; i < numberOfSteps; ++i)
+    {
+        step(ODEfunctor,y,t0 + blNumberType(i) * h,h);
+
+        observer(t0 + blNumberType(i + 1) * h,static_cast<const blNumberType*>(y));
+    }
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Adaptive Cash-Karp 5(4) stepper, with the
+// error of a step measured by rkErrorNorm and
+// the step size set by a PI controller
+//-------------------------------------------------------------------
+template<typename blNumberType>
+class blCashKarpStepper
+{
+public: // Constructors and destructors
+
+
+
+    // Default constructor
+
+    blCashKarpStepper(const int& numberOfStateVariables = 0,
+                      const blNumberType& absoluteTolerance = 1e-6,
+                      const blNumberType& relativeTolerance = 1e-6);
+
+    // Destructor
+
+    ~blCashKarpStepper();
+
+
+
+public: // Public functions
+
+
+
+    // Function used to resize the workspaces,
+    // this is the only function that allocates
+
+    void                                    setNumberOfStateVariables(const int& numberOfStateVariables);
+
+    const int&                              getNumberOfStateVariables()const;
+
+    void                                    setTolerances(const blNumberType& absoluteTolerance,
+                                                          const blNumberType& relativeTolerance);
+
+    // Forgets the step size history
+
+    void                                    reset();
+
+    // Attempts one step of size h, if the
+    // step is accepted y and t are advanced,
+    // either way h becomes the next step size
+
+    template<typename blODEFunctorType>
+
+    bool                                    step(const blODEFunctorType& ODEfunctor,
+                                                 blNumberType* y,
+                                                 blNumberType& t,
+                                                 blNumberType& h);
+
+    // Advances the state y from t0 to tf,
+    // returns false if maxNumberOfSteps
+    // attempts weren't enough
+
+    template<typename blODEFunctorType>
+
+    bool                                    integrate(const blODEFunctorType& ODEfunctor,
+                                                      blNumberType* y,
+                                                      const blNumberType& t0,
+                                                      const blNumberType& tf,
+                                                      const blNumberType& initialStepSize,
+                                                      const int& maxNumberOfSteps);
+
+    template<typename blODEFunctorType,
+             typename blObserverType>
+
+    bool                                    integrate(const blODEFunctorType& ODEfunctor,
+                                                      blNumberType* y,
+                                                      const blNumberType& t0,
+                                                      const blNumberType& tf,
+                                                      const blNumberType& initialStepSize,
+                                                      const int& maxNumberOfSteps,
+                                                      blObserverType& observer);
+
+    // Step counts since the last reset
+
+    const int&                              getNumberOfAcceptedSteps()const;
+    const int&                              getNumberOfRejectedSteps()const;
+
+
+
+private: // Private variables
+
+
+
+    int                                     m_numberOfStateVariables;
+
+    blNumberType                            m_absoluteTolerance;
+    blNumberType                            m_relativeTolerance;
+
+    blPIStepSizeController<blNumberType>    m_controller;
+
+    int                                     m_numberOfAcceptedSteps;
+    int                                     m_numberOfRejectedSteps;
+
+    // The stage values, the state at the start
+    // of the step, both solutions of the step
+    // and the derivative evaluated by the functor
+
+    blAlignedBuffer<blNumberType>           m_k;
+    blAlignedBuffer<blNumberType>           m_yStart;
+    blAlignedBuffer<blNumberType>           m_y4th;
+    blAlignedBuffer<blNumberType>           m_y5th;
+    blAlignedBuffer<blNumberType>           m_yTemp;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blCashKarpStepper<blNumberType>::blCashKarpStepper(const int& numberOfStateVariables,
+                                                          const blNumberType& absoluteTolerance,
+                                                          const blNumberType& relativeTolerance)
+{
+    m_absoluteTolerance = absoluteTolerance;
+    m_relativeTolerance = relativeTolerance;
+
+    setNumberOfStateVariables(numberOfStateVariables);
+
+    reset();
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blCashKarpStepper<blNumberType>::~blCashKarpStepper()
+{
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blCashKarpStepper<blNumberType>::setNumberOfStateVariables(const int& numberOfStateVariables)
+{
+    m_numberOfStateVariables = std::max(0,numberOfStateVariables);
+
+    m_k.resize(6 * m_numberOfStateVariables);
+    m_yStart.resize(m_numberOfStateVariables);
+    m_y4th.resize(m_numberOfStateVariables);
+    m_y5th.resize(m_numberOfStateVariables);
+    m_yTemp.resize(m_numberOfStateVariables);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const int& blCashKarpStepper<blNumberType>::getNumberOfStateVariables()const
+{
+    return m_numberOfStateVariables;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blCashKarpStepper<blNumberType>::setTolerances(const blNumberType& absoluteTolerance,
+                                                           const blNumberType& relativeTolerance)
+{
+    m_absoluteTolerance = absoluteTolerance;
+    m_relativeTolerance = relativeTolerance;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blCashKarpStepper<blNumberType>::reset()
+{
+    m_controller.reset();
+
+    m_numberOfAcceptedSteps = 0;
+    m_numberOfRejectedSteps = 0;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const int& blCashKarpStepper<blNumberType>::getNumberOfAcceptedSteps()const
+{
+    return m_numberOfAcceptedSteps;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const int& blCashKarpStepper<blNumberType>::getNumberOfRejectedSteps()const
+{
+    return m_numberOfRejectedSteps;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename blODEFunctorType>
+inline bool blCashKarpStepper<blNumberType>::step(const blODEFunctorType& ODEfunctor,
+                                                  blNumberType* y,
+                                                  blNumberType& t,
+                                                  blNumberType& h)
+{
+    const int n = m_numberOfStateVariables;
+
+    blNumberType* yStart = m_yStart.data();
+    blNumberType* y4th = m_y4th.data();
+    blNumberType* y5th = m_y5th.data();
+    blNumberType* k = m_k.data();
+    blNumberType* yTemp = m_yTemp.data();
+
+    std::copy(y,y + n,yStart);
+
+    rkCK(ODEfunctor,n,yStart,t,h,y4th,y5th,k,yTemp);
+
+    // The 4th-order solution is
+    // replaced by the error
+
+    for(int i = 0; i < n; ++i)
+        y4th[i] = y5th[i] - y4th[i];
+
+    blNumberType error = rkErrorNorm(n,yStart,y5th,y4th,m_absoluteTolerance,m_relativeTolerance);
+
+    bool isStepAccepted = (error <= blNumberType(1));
+
+    blNumberType factor = m_controller.getStepSizeFactor(error,isStepAccepted);
+
+    if(isStepAccepted)
+    {
+        std::copy(y5th,y5th + n,y);
+
+        t += h;
+
+        ++m_numberOfAcceptedSteps;
+    }
+    else
+        ++m_numberOfRejectedSteps;
+
+    h *= factor;
+
+    return isStepAccepted;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename blODEFunctorType>
+inline bool blCashKarpStepper<blNumberType>::integrate(const blODEFunctorType& ODEfunctor,
+                                                       blNumberType* y,
+                                                       const blNumberType& t0,
+                                                       const blNumberType& tf,
+                                                       const blNumberType& initialStepSize,
+                                                       const int& maxNumberOfSteps)
+{
+    blNullObserver observer;
+
+    return integrate(ODEfunctor,y,t0,tf,initialStepSize,maxNumberOfSteps,observer);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename blODEFunctorType,typename blObserverType>
+inline bool blCashKarpStepper<blNumberType>::integrate(const blODEFunctorType& ODEfunctor,
+                                                       blNumberType* y,
+                                                       const blNumberType& t0,
+                                                       const blNumberType& tf,
+                                                       const blNumberType& initialStepSize,
+                                                       const int& maxNumberOfSteps,
+                                                       blObserverType& observer)
+{
+    reset();
+
+    observer(t0,static_cast<const blNumberType*>(y));
+
+    blNumberType t = t0;
+    blNumberType h = initialStepSize;
+
+    for(int i = 0; i < maxNumberOfSteps && t < tf; ++i)
+    {
+        // Don't step past the final time
+
+        bool isLastStep = (t + h >= tf);
+
+        if(isLastStep)
+            h = tf - t;
+
+        if(!step(ODEfunctor,y,t,h))
+            continue;
+
+        if(isLastStep)
+            t = tf;
+
+        observer(t,static_cast<const blNumberType*>(y));
+    }
+
+    return (t >= tf);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Adaptive Dormand-Prince 5(4) stepper, with
+// first-same-as-last reuse of the last stage,
+// a PI step size controller and dense output
+// over the last accepted step
+//
+// - Between steps the stepper assumes that y
+//   is the state it returned, if the caller
+//   changes it (or t) it has to call reset()
+//   so the first stage is evaluated again
+//-------------------------------------------------------------------
+template<typename blNumberType>
+class blDormandPrinceStepper
+{
+public: // Constructors and destructors
+
+
+
+    // Default constructor
+
+    blDormandPrinceStepper(const int& numberOfStateVariables = 0,
+                           const blNumberType& absoluteTolerance = 1e-6,
+                           const blNumberType& relativeTolerance = 1e-6);
+
+    // Destructor
+
+    ~blDormandPrinceStepper();
+
+
+
+public: // Public functions
+
+
+
+    // Function used to resize the workspaces,
+    // this is the only function that allocates
+
+    void                                    setNumberOfStateVariables(const int& numberOfStateVariables);
+
+    const int&                              getNumberOfStateVariables()const;
+
+    void                                    setTolerances(const blNumberType& absoluteTolerance,
+                                                          const blNumberType& relativeTolerance);
+
+    // Forgets the step size history
+    // and the first-same-as-last stage
+
+    void                                    reset();
+
+    // Attempts one step of size h, if the
+    // step is accepted y and t are advanced,
+    // either way h becomes the next step size
+
+    template<typename blODEFunctorType>
+
+    bool                                    step(const blODEFunctorType& ODEfunctor,
+                                                 blNumberType* y,
+                                                 blNumberType& t,
+                                                 blNumberType& h);
+
+    // Advances the state y from t0 to tf,
+    // returns false if maxNumberOfSteps
+    // attempts weren't enough
+
+    template<typename blODEFunctorType>
+
+    bool                                    integrate(const blODEFunctorType& ODEfunctor,
+                                                      blNumberType* y,
+                                                      const blNumberType& t0,
+                                                      const blNumberType& tf,
+                                                      const blNumberType& initialStepSize,
+                                                      const int& maxNumberOfSteps);
+
+    template<typename blODEFunctorType,
+             typename blObserverType>
+
+    bool                                    integrate(const blODEFunctorType& ODEfunctor,
+                                                      blNumberType* y,
+                                                      const blNumberType& t0,
+                                                      const blNumberType& tf,
+                                                      const blNumberType& initialStepSize,
+                                                      const int& maxNumberOfSteps,
+                                                      blObserverType& observer);
+
+    // Evaluates the solution at any time
+    // within the last accepted step
+
+    void                                    denseOutput(const blNumberType& t,
+                                                        blNumberType* yOut)const;
+
+    // The last accepted step, the dense
+    // output is valid in [start,end]
+
+    const blNumberType&                     getLastStepStartTime()const;
+    const blNumberType&                     getLastStepEndTime()const;
+    const blNumberType*                     getLastStepStartState()const;
+    const blNumberType*                     getLastStepEndState()const;
+
+    // Used by the drivers that clamp the
+    // last step to land exactly on tf
+
+    void                                    setLastStepEndTime(const blNumberType& lastStepEndTime);
+
+    // Step counts since the last reset
+
+    const int&                              getNumberOfAcceptedSteps()const;
+    const int&                              getNumberOfRejectedSteps()const;
+
+
+
+private: // Private variables
+
+
+
+    int                                     m_numberOfStateVariables;
+
+    blNumberType                            m_absoluteTolerance;
+    blNumberType                            m_relativeTolerance;
+
+    blPIStepSizeController<blNumberType>    m_controller;
+
+    int                                     m_numberOfAcceptedSteps;
+    int                                     m_numberOfRejectedSteps;
+
+    // The last accepted step
+
+    blNumberType                            m_lastStepStartTime;
+    blNumberType                            m_lastStepSize;
+    blNumberType                            m_lastStepEndTime;
+
+    // The stage derivatives, the trial state,
+    // its error and the derivative evaluated
+    // by the functor, a rejected attempt
+    // overwrites all of them
+
+    blAlignedBuffer<blNumberType>           m_k;
+    blAlignedBuffer<blNumberType>           m_yTrial;
+    blAlignedBuffer<blNumberType>           m_yError;
+    blAlignedBuffer<blNumberType>           m_yTemp;
+
+    // The states and the derivatives at both
+    // ends of the last accepted step, which
+    // is all the dense output needs
+
+    blAlignedBuffer<blNumberType>           m_yStart;
+    blAlignedBuffer<blNumberType>           m_yEnd;
+    blAlignedBuffer<blNumberType>           m_fStart;
+    blAlignedBuffer<blNumberType>           m_fEnd;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blDormandPrinceStepper<blNumberType>::blDormandPrinceStepper(const int& numberOfStateVariables,
+                                                                    const blNumberType& absoluteTolerance,
+                                                                    const blNumberType& relativeTolerance)
+{
+    m_absoluteTolerance = absoluteTolerance;
+    m_relativeTolerance = relativeTolerance;
+
+    setNumberOfStateVariables(numberOfStateVariables);
+
+    reset();
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blDormandPrinceStepper<blNumberType>::~blDormandPrinceStepper()
+{
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blDormandPrinceStepper<blNumberType>::setNumberOfStateVariables(const int& numberOfStateVariables)
+{
+    m_numberOfStateVariables = std::max(0,numberOfStateVariables);
+
+    m_k.resize(7 * m_numberOfStateVariables);
+    m_yTrial.resize(m_numberOfStateVariables);
+    m_yError.resize(m_numberOfStateVariables);
+    m_yTemp.resize(m_numberOfStateVariables);
+
+    m_yStart.resize(m_numberOfStateVariables);
+    m_yEnd.resize(m_numberOfStateVariables);
+    m_fStart.resize(m_numberOfStateVariables);
+    m_fEnd.resize(m_numberOfStateVariables);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const int& blDormandPrinceStepper<blNumberType>::getNumberOfStateVariables()const
+{
+    return m_numberOfStateVariables;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blDormandPrinceStepper<blNumberType>::setTolerances(const blNumberType& absoluteTolerance,
+                                                                const blNumberType& relativeTolerance)
+{
+    m_absoluteTolerance = absoluteTolerance;
+    m_relativeTolerance = relativeTolerance;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blDormandPrinceStepper<blNumberType>::reset()
+{
+    m_controller.reset();
+
+    m_numberOfAcceptedSteps = 0;
+    m_numberOfRejectedSteps = 0;
+
+    m_lastStepStartTime = 0;
+    m_lastStepSize = 0;
+    m_lastStepEndTime = 0;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const int& blDormandPrinceStepper<blNumberType>::getNumberOfAcceptedSteps()const
+{
+    return m_numberOfAcceptedSteps;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const int& blDormandPrinceStepper<blNumberType>::getNumberOfRejectedSteps()const
+{
+    return m_numberOfRejectedSteps;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const blNumberType& blDormandPrinceStepper<blNumberType>::getLastStepStartTime()const
+{
+    return m_lastStepStartTime;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const blNumberType& blDormandPrinceStepper<blNumberType>::getLastStepEndTime()const
+{
+    return m_lastStepEndTime;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blDormandPrinceStepper<blNumberType>::setLastStepEndTime(const blNumberType& lastStepEndTime)
+{
+    m_lastStepEndTime = lastStepEndTime;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const blNumberType* blDormandPrinceStepper<blNumberType>::getLastStepStartState()const
+{
+    return m_yStart.data();
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const blNumberType* blDormandPrinceStepper<blNumberType>::getLastStepEndState()const
+{
+    return m_yEnd.data();
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename blODEFunctorType>
+inline bool blDormandPrinceStepper<blNumberType>::step(const blODEFunctorType& ODEfunctor,
+                                                       blNumberType* y,
+                                                       blNumberType& t,
+                                                       blNumberType& h)
+{
+    const int n = m_numberOfStateVariables;
+
+    blNumberType* k = m_k.data();
+    blNumberType* yTrial = m_yTrial.data();
+    blNumberType* yError = m_yError.data();
+    blNumberType* yTemp = m_yTemp.data();
+
+    // After the first attempt k[0...n) always
+    // holds the derivative at y, either from the
+    // last rejected attempt or copied from the
+    // last stage of the last accepted step
+
+    bool isFirstStageEvaluated = (m_numberOfAcceptedSteps > 0 || m_numberOfRejectedSteps > 0);
+
+    rkDP(ODEfunctor,n,y,t,h,yTrial,yError,k,yTemp,isFirstStageEvaluated);
+
+    blNumberType error = rkErrorNorm(n,y,yTrial,yError,m_absoluteTolerance,m_relativeTolerance);
+
+    bool isStepAccepted = (error <= blNumberType(1));
+
+    blNumberType factor = m_controller.getStepSizeFactor(error,isStepAccepted);
+
+    if(isStepAccepted)
+    {
+        // Only an accepted step replaces what the
+        // dense output interpolates, so it stays
+        // valid after any number of rejections
+
+        std::copy(y,y + n,m_yStart.data());
+        std::copy(yTrial,yTrial + n,m_yEnd.data());
+        std::copy(k,k + n,m_fStart.data());
+        std::copy(k + 6 * n,k + 7 * n,m_fEnd.data());
+
+        std::copy(yTrial,yTrial + n,y);
+
+        // First same as last
+
+        std::copy(k + 6 * n,k + 7 * n,k);
+
+        m_lastStepStartTime = t;
+        m_lastStepSize = h;
+
+        t += h;
+
+        m_lastStepEndTime = t;
+
+        ++m_numberOfAcceptedSteps;
+    }
+    else
+        ++m_numberOfRejectedSteps;
+
+    h *= factor;
+
+    return isStepAccepted;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename blODEFunctorType>
+inline bool blDormandPrinceStepper<blNumberType>::integrate(const blODEFunctorType& ODEfunctor,
+                                                            blNumberType* y,
+                                                            const blNumberType& t0,
+                                                            const blNumberType& tf,
+                                                            const blNumberType& initialStepSize,
+                                                            const int& maxNumberOfSteps)
+{
+    blNullObserver observer;
+
+    return integrate(ODEfunctor,y,t0,tf,initialStepSize,maxNumberOfSteps,observer);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename blODEFunctorType,typename blObserverType>
+inline bool blDormandPrinceStepper<blNumberType>::integrate(const blODEFunctorType& ODEfunctor,
+                                                            blNumberType* y,
+                                                            const blNumberType& t0,
+                                                            const blNumberType& tf,
+                                                            const blNumberType& initialStepSize,
+                                                            const int& maxNumberOfSteps,
+                                                            blObserverType& observer)
+{
+    reset();
+
+    observer(t0,static_cast<const blNumberType*>(y));
+
+    blNumberType t = t0;
+    blNumberType h = initialStepSize;
+
+    for(int i = 0; i < maxNumberOfSteps && t < tf; ++i)
+    {
+        // Don't step past the final time
+
+        bool isLastStep = (t + h >= tf);
+
+        if(isLastStep)
+            h = tf - t;
+
+        if(!step(ODEfunctor,y,t,h))
+            continue;
+
+        if(isLastStep)
+        {
+            t = tf;
+            setLastStepEndTime(tf);
+        }
+
+        observer(t,static_cast<const blNumberType*>(y));
+    }
+
+    return (t >= tf);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blDormandPrinceStepper<blNumberType>::denseOutput(const blNumberType& t,
+                                                              blNumberType* yOut)const
+{
+    const int n = m_numberOfStateVariables;
+
+    if(m_lastStepSize == blNumberType(0))
+    {
+        std::copy(m_yEnd.data(),m_yEnd.data() + n,yOut);
+        return;
+    }
+
+    blNumberType theta = (t - m_lastStepStartTime) / m_lastStepSize;
+
+    rkHermiteDenseOutput(n,m_yStart.data(),m_yEnd.data(),m_fStart.data(),0,m_fEnd.data(),0,m_lastStepSize,theta,yOut);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// End of the blMathAPI namespace
+}
+//-------------------------------------------------------------------
+
+
+
+#endif // BL_RUNGAKUTTASTEPPERS_HPP
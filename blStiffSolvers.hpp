@@ -0,0 +1,2243 @@
+#ifndef BL_STIFFSOLVERS_HPP
+#define BL_STIFFSOLVERS_HPP
+
+
+
+///-------------------------------------------------------------------
+///
+///
+///
+/// PURPOSE:        Implicit integrators for stiff ODE systems,
+///                 a Rosenbrock-W method (ROS34PW2) and a variable
+///                 step, variable order (1 to 5) BDF method, plus
+///                 a solver that integrates with Cash-Karp and
+///                 switches to Rosenbrock-W when it detects that
+///                 the problem turned stiff
+///
+/// AUTHOR:         Vincenzo Barbato
+///                 navyenzo@gmail.com
+///
+/// NOTE:           All things in this library are defined within the
+///                 blMathAPI namespace
+///
+///                 The solvers are templated on the matrix and the
+///                 LU factorization types, meant to be vbMatrix<T>
+///                 and vbLUFactorization<T>, which have to provide:
+///
+///                 blMatrixType(rows,cols,value)
+///                 blMatrixType::operator()(i,j)
+///                 bool blLUFactorizationType::Factorize(matrix)
+///                 blLUFactorizationType::SolveInPlace(T* b)
+///
+///                 Like the steppers in blRungaKuttaSteppers.hpp,
+///                 the functors work on raw arrays:
+///
+///                 ODEfunctor(t,y,dydt)
+///                 JacobianFunctor(t,y,J)
+///
+///                 and passing blFiniteDifferenceJacobian() as the
+///                 Jacobian functor approximates J by finite
+///                 differences of the ODE functor
+///
+/// LISENSE:        MIT-LICENCE
+///                 http://www.opensource.org/licenses/mit-license.php
+///
+///
+///
+///-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Includes needed for this file
+//-------------------------------------------------------------------
+#include <limits>
+#include "blRungaKuttaSteppers.hpp"
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// NOTE: This class is defined within the blMathAPI namespace
+//-------------------------------------------------------------------
+namespace blMathAPI
+{
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The following function approximates the Jacobian
+// J(i,j) = dfi/dyj of an ODE system by forward
+// differences, one ODE evaluation per column
+//
+// - f0 is the derivative at (t,y) and yPerturbed
+//   and fPerturbed are n-sized workspaces
+//-------------------------------------------------------------------
+template<typename blNumberType,
+         typename blMatrixType,
+         typename blODEFunctorType>
+
+inline void computeFiniteDifferenceJacobian(const blODEFunctorType& ODEfunctor,
+                                            const int& n,
+                                            const blNumberType& t,
+                                            const blNumberType* y,
+                                            const blNumberType* f0,
+                                            blMatrixType& J,
+                                            blNumberType* yPerturbed,
+                                            blNumberType* fPerturbed)
+{
+    const blNumberType roundOff = std::numeric_limits<blNumberType>::epsilon();
+
+    std::copy(y,y + n,yPerturbed);
+
+    for(int j = 0; j < n; ++j)
+    {
+        // Perturb by about the square root of the
+        // round off, and use the perturbation that
+        // is actually representable
+
+        blNumberType delta = std::sqrt(roundOff * std::max(blNumberType(1e-5),std::abs(y[j])));
+
+        yPerturbed[j] = y[j] + delta;
+
+        delta = yPerturbed[j] - y[j];
+
+        ODEfunctor(t,yPerturbed,fPerturbed);
+
+        for(int i = 0; i < n; ++i)
+            J(i,j) = (fPerturbed[i] - f0[i]) / delta;
+
+        yPerturbed[j] = y[j];
+    }
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// The infinity norm of a square matrix, an upper
+// bound of the spectral radius of the Jacobian
+// used to decide whether a problem is stiff
+//-------------------------------------------------------------------
+template<typename blNumberType,
+         typename blMatrixType>
+
+inline blNumberType matrixNormInf(const blMatrixType& J,
+                                  const int& n)
+{
+    blNumberType norm = 0;
+
+    for(int i = 0; i < n; ++i)
+    {
+        blNumberType rowSum = 0;
+
+        for(int j = 0; j < n; ++j)
+            rowSum += std::abs(J(i,j));
+
+        norm = std::max(norm,rowSum);
+    }
+
+    return norm;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Rosenbrock-W stepper, using the ROS34PW2 method of
+// Rang and Angermann (4 stages, order 3 with an embedded
+// order 2 error estimate, L-stable, and order 2 even
+// with an inexact Jacobian)
+//
+// - Since the method is a W-method the Jacobian is
+//   only re-evaluated after a rejected step or every
+//   so many steps, and when the controller asks for
+//   a step size less than 20% bigger the step size is
+//   kept, so the LU factorization can be reused
+//-------------------------------------------------------------------
+template<typename blNumberType,
+         typename blMatrixType,
+         typename blLUFactorizationType>
+class blRosenbrockWStepper
+{
+public: // Constructors and destructors
+
+
+
+    // Default constructor
+
+    blRosenbrockWStepper(const int& numberOfStateVariables = 0,
+                         const blNumberType& absoluteTolerance = 1e-6,
+                         const blNumberType& relativeTolerance = 1e-6);
+
+    // Destructor
+
+    ~blRosenbrockWStepper();
+
+
+
+public: // Public functions
+
+
+
+    // Function used to resize the workspaces,
+    // this is the only function that allocates
+    // (besides the LU factorization type)
+
+    void                                    setNumberOfStateVariables(const int& numberOfStateVariables);
+
+    const int&                              getNumberOfStateVariables()const;
+
+    void                                    setTolerances(const blNumberType& absoluteTolerance,
+                                                          const blNumberType& relativeTolerance);
+
+    // Maximum number of accepted steps
+    // before the Jacobian is re-evaluated
+
+    void                                    setMaxJacobianAge(const int& maxJacobianAge);
+
+    // Forgets the step size history, the
+    // Jacobian and the LU factorization
+
+    void                                    reset();
+
+    // Attempts one step of size h, if the
+    // step is accepted y and t are advanced,
+    // either way h becomes the next step size
+
+    template<typename blODEFunctorType,
+             typename blJacobianFunctorType>
+
+    bool                                    step(const blODEFunctorType& ODEfunctor,
+                                                 const blJacobianFunctorType& JacobianFunctor,
+                                                 blNumberType* y,
+                                                 blNumberType& t,
+                                                 blNumberType& h);
+
+    // Advances the state y from t0 to tf,
+    // returns false if maxNumberOfSteps
+    // attempts weren't enough
+
+    template<typename blODEFunctorType,
+             typename blJacobianFunctorType>
+
+    bool                                    integrate(const blODEFunctorType& ODEfunctor,
+                                                      const blJacobianFunctorType& JacobianFunctor,
+                                                      blNumberType* y,
+                                                      const blNumberType& t0,
+                                                      const blNumberType& tf,
+                                                      const blNumberType& initialStepSize,
+                                                      const int& maxNumberOfSteps);
+
+    // The last Jacobian evaluated
+
+    const blMatrixType&                     getJacobian()const;
+
+    // Counts since the last reset
+
+    const int&                              getNumberOfAcceptedSteps()const;
+    const int&                              getNumberOfRejectedSteps()const;
+    const int&                              getNumberOfJacobianEvaluations()const;
+    const int&                              getNumberOfLUFactorizations()const;
+
+
+
+private: // Private functions
+
+
+
+    // Evaluate the Jacobian and the time
+    // derivative at (t,y), by finite
+    // differences or with the user functor
+
+    template<typename blODEFunctorType>
+
+    void                                    evaluateJacobian(const blODEFunctorType& ODEfunctor,
+                                                             const blFiniteDifferenceJacobian& JacobianFunctor,
+                                                             const blNumberType& t,
+                                                             const blNumberType* y);
+
+    template<typename blODEFunctorType,
+             typename blJacobianFunctorType>
+
+    void                                    evaluateJacobian(const blODEFunctorType& ODEfunctor,
+                                                             const blJacobianFunctorType& JacobianFunctor,
+                                                             const blNumberType& t,
+                                                             const blNumberType* y);
+
+    // Finite difference time derivative
+    // of the ODE at (t,y)
+
+    template<typename blODEFunctorType>
+
+    void                                    evaluateTimeDerivative(const blODEFunctorType& ODEfunctor,
+                                                                   const blNumberType& t,
+                                                                   const blNumberType* y);
+
+    // Factorizes I/(h*gamma) - J
+
+    bool                                    factorize(const blNumberType& h);
+
+
+
+private: // Private variables
+
+
+
+    int                                     m_numberOfStateVariables;
+
+    blNumberType                            m_absoluteTolerance;
+    blNumberType                            m_relativeTolerance;
+
+    blPIStepSizeController<blNumberType>    m_controller;
+
+    int                                     m_numberOfAcceptedSteps;
+    int                                     m_numberOfRejectedSteps;
+    int                                     m_numberOfJacobianEvaluations;
+    int                                     m_numberOfLUFactorizations;
+
+    // The tableau in the transformed form of
+    // Hairer and Wanner, so that the stages
+    // don't need products with the Jacobian:
+    //
+    // (I/(h*gamma) - J)*u_i = f(t + alpha_i*h, y + sum(a_ij*u_j))
+    //                         + sum(c_ij*u_j)/h + gamma_i*h*df/dt
+    //
+    // y_new = y + sum(m_i*u_i)
+
+    blNumberType                            m_gamma;
+    blNumberType                            m_a[4][4];
+    blNumberType                            m_c[4][4];
+    blNumberType                            m_alpha[4];
+    blNumberType                            m_gammaSum[4];
+    blNumberType                            m_m[4];
+    blNumberType                            m_mError[4];
+
+    // Jacobian and factorization state
+
+    int                                     m_jacobianAge;
+    int                                     m_maxJacobianAge;
+    bool                                    m_isJacobianValid;
+    bool                                    m_isJacobianCurrent;
+    bool                                    m_isFactorizationValid;
+    blNumberType                            m_factorizedStepSize;
+
+    // Whether m_f0 is the derivative at the
+    // current state (after a rejected step)
+
+    bool                                    m_isF0Current;
+
+    blMatrixType                            m_J;
+    blMatrixType                            m_iterationMatrix;
+    blLUFactorizationType                   m_LU;
+
+    // The stages, the derivative at the start
+    // of the step, its time derivative, and the
+    // stage, new state and error workspaces
+
+    blAlignedBuffer<blNumberType>           m_u;
+    blAlignedBuffer<blNumberType>           m_f0;
+    blAlignedBuffer<blNumberType>           m_dfdt;
+    blAlignedBuffer<blNumberType>           m_yStage;
+    blAlignedBuffer<blNumberType>           m_fStage;
+    blAlignedBuffer<blNumberType>           m_yNew;
+    blAlignedBuffer<blNumberType>           m_yError;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline blRosenbrockWStepper<blNumberType,blMatrixType,blLUFactorizationType>::blRosenbrockWStepper(const int& numberOfStateVariables,
+                                                                                                   const blNumberType& absoluteTolerance,
+                                                                                                   const blNumberType& relativeTolerance)
+                                                                                                   : m_controller(3)
+{
+    m_absoluteTolerance = absoluteTolerance;
+    m_relativeTolerance = relativeTolerance;
+
+    m_maxJacobianAge = 20;
+
+    // The ROS34PW2 tableau
+
+    const blNumberType gamma = 4.3586652150845900e-01;
+
+    const blNumberType alpha[4][4] = {{0,0,0,0},
+                                      {8.7173304301691801e-01,0,0,0},
+                                      {8.4457060015369423e-01,-1.1299064236484185e-01,0,0},
+                                      {0,0,1,0}};
+
+    const blNumberType Gamma[4][4] = {{gamma,0,0,0},
+                                      {-8.7173304301691801e-01,gamma,0,0},
+                                      {-9.0338057013044082e-01,5.4180672388095326e-02,gamma,0},
+                                      {2.4212380706095346e-01,-1.2232505839045147e+00,5.4526025533510214e-01,gamma}};
+
+    const blNumberType b[4] = {2.4212380706095346e-01,-1.2232505839045147e+00,1.5452602553351020e+00,4.3586652150845900e-01};
+    const blNumberType bHat[4] = {3.7810903145819369e-01,-9.6042292212423178e-02,5.0000000000000000e-01,2.1793326075422950e-01};
+
+    // Invert the (lower triangular) Gamma
+    // and transform the tableau with it
+
+    blNumberType GammaInverse[4][4] = {};
+
+    for(int j = 0; j < 4; ++j)
+    {
+        GammaInverse[j][j] = blNumberType(1) / Gamma[j][j];
+
+        for(int i = j + 1; i < 4; ++i)
+        {
+            blNumberType sum = 0;
+
+            for(int k = j; k < i; ++k)
+                sum += Gamma[i][k] * GammaInverse[k][j];
+
+            GammaInverse[i][j] = -sum / Gamma[i][i];
+        }
+    }
+
+    m_gamma = gamma;
+
+    for(int i = 0; i < 4; ++i)
+    {
+        m_alpha[i] = 0;
+        m_gammaSum[i] = 0;
+        m_m[i] = 0;
+        m_mError[i] = 0;
+
+        for(int j = 0; j < 4; ++j)
+        {
+            m_alpha[i] += alpha[i][j];
+            m_gammaSum[i] += Gamma[i][j];
+
+            m_a[i][j] = 0;
+
+            for(int k = 0; k < 4; ++k)
+                m_a[i][j] += alpha[i][k] * GammaInverse[k][j];
+
+            m_c[i][j] = (i == j) ? blNumberType(0) : -GammaInverse[i][j];
+
+            m_m[i] += b[j] * GammaInverse[j][i];
+            m_mError[i] += (b[j] - bHat[j]) * GammaInverse[j][i];
+        }
+    }
+
+    setNumberOfStateVariables(numberOfStateVariables);
+
+    reset();
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline blRosenbrockWStepper<blNumberType,blMatrixType,blLUFactorizationType>::~blRosenbrockWStepper()
+{
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline void blRosenbrockWStepper<blNumberType,blMatrixType,blLUFactorizationType>::setNumberOfStateVariables(const int& numberOfStateVariables)
+{
+    m_numberOfStateVariables = std::max(0,numberOfStateVariables);
+
+    const int n = m_numberOfStateVariables;
+
+    m_J = blMatrixType(n,n,blNumberType(0));
+    m_iterationMatrix = blMatrixType(n,n,blNumberType(0));
+
+    m_u.resize(4 * n);
+    m_f0.resize(n);
+    m_dfdt.resize(n);
+    m_yStage.resize(n);
+    m_fStage.resize(n);
+    m_yNew.resize(n);
+    m_yError.resize(n);
+
+    m_isJacobianValid = false;
+    m_isFactorizationValid = false;
+    m_isF0Current = false;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline const int& blRosenbrockWStepper<blNumberType,blMatrixType,blLUFactorizationType>::getNumberOfStateVariables()const
+{
+    return m_numberOfStateVariables;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline void blRosenbrockWStepper<blNumberType,blMatrixType,blLUFactorizationType>::setTolerances(const blNumberType& absoluteTolerance,
+                                                                                                 const blNumberType& relativeTolerance)
+{
+    m_absoluteTolerance = absoluteTolerance;
+    m_relativeTolerance = relativeTolerance;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline void blRosenbrockWStepper<blNumberType,blMatrixType,blLUFactorizationType>::setMaxJacobianAge(const int& maxJacobianAge)
+{
+    m_maxJacobianAge = std::max(0,maxJacobianAge);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline void blRosenbrockWStepper<blNumberType,blMatrixType,blLUFactorizationType>::reset()
+{
+    m_controller.reset();
+
+    m_numberOfAcceptedSteps = 0;
+    m_numberOfRejectedSteps = 0;
+    m_numberOfJacobianEvaluations = 0;
+    m_numberOfLUFactorizations = 0;
+
+    m_jacobianAge = 0;
+    m_isJacobianValid = false;
+    m_isJacobianCurrent = false;
+    m_isFactorizationValid = false;
+    m_factorizedStepSize = 0;
+
+    m_isF0Current = false;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline const blMatrixType& blRosenbrockWStepper<blNumberType,blMatrixType,blLUFactorizationType>::getJacobian()const
+{
+    return m_J;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline const int& blRosenbrockWStepper<blNumberType,blMatrixType,blLUFactorizationType>::getNumberOfAcceptedSteps()const
+{
+    return m_numberOfAcceptedSteps;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline const int& blRosenbrockWStepper<blNumberType,blMatrixType,blLUFactorizationType>::getNumberOfRejectedSteps()const
+{
+    return m_numberOfRejectedSteps;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline const int& blRosenbrockWStepper<blNumberType,blMatrixType,blLUFactorizationType>::getNumberOfJacobianEvaluations()const
+{
+    return m_numberOfJacobianEvaluations;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline const int& blRosenbrockWStepper<blNumberType,blMatrixType,blLUFactorizationType>::getNumberOfLUFactorizations()const
+{
+    return m_numberOfLUFactorizations;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+template<typename blODEFunctorType>
+inline void blRosenbrockWStepper<blNumberType,blMatrixType,blLUFactorizationType>::evaluateTimeDerivative(const blODEFunctorType& ODEfunctor,
+                                                                                                          const blNumberType& t,
+                                                                                                          const blNumberType* y)
+{
+    const int n = m_numberOfStateVariables;
+
+    blNumberType delta = std::sqrt(std::numeric_limits<blNumberType>::epsilon() * std::max(blNumberType(1e-5),std::abs(t)));
+
+    blNumberType tPerturbed = t + delta;
+
+    delta = tPerturbed - t;
+
+    blNumberType* fPerturbed = m_fStage.data();
+
+    ODEfunctor(tPerturbed,y,fPerturbed);
+
+    const blNumberType* f0 = m_f0.data();
+    blNumberType* dfdt = m_dfdt.data();
+
+    for(int i = 0; i < n; ++i)
+        dfdt[i] = (fPerturbed[i] - f0[i]) / delta;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+template<typename blODEFunctorType>
+inline void blRosenbrockWStepper<blNumberType,blMatrixType,blLUFactorizationType>::evaluateJacobian(const blODEFunctorType& ODEfunctor,
+                                                                                                    const blFiniteDifferenceJacobian&,
+                                                                                                    const blNumberType& t,
+                                                                                                    const blNumberType* y)
+{
+    computeFiniteDifferenceJacobian(ODEfunctor,m_numberOfStateVariables,t,y,m_f0.data(),m_J,m_yStage.data(),m_fStage.data());
+
+    evaluateTimeDerivative(ODEfunctor,t,y);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+template<typename blODEFunctorType,typename blJacobianFunctorType>
+inline void blRosenbrockWStepper<blNumberType,blMatrixType,blLUFactorizationType>::evaluateJacobian(const blODEFunctorType& ODEfunctor,
+                                                                                                    const blJacobianFunctorType& JacobianFunctor,
+                                                                                                    const blNumberType& t,
+                                                                                                    const blNumberType* y)
+{
+    JacobianFunctor(t,y,m_J);
+
+    evaluateTimeDerivative(ODEfunctor,t,y);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline bool blRosenbrockWStepper<blNumberType,blMatrixType,blLUFactorizationType>::factorize(const blNumberType& h)
+{
+    const int n = m_numberOfStateVariables;
+
+    blNumberType diagonal = blNumberType(1) / (h * m_gamma);
+
+    for(int i = 0; i < n; ++i)
+    {
+        for(int j = 0; j < n; ++j)
+            m_iterationMatrix(i,j) = -m_J(i,j);
+
+        m_iterationMatrix(i,i) += diagonal;
+    }
+
+    ++m_numberOfLUFactorizations;
+
+    m_isFactorizationValid = m_LU.Factorize(m_iterationMatrix);
+    m_factorizedStepSize = h;
+
+    return m_isFactorizationValid;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+template<typename blODEFunctorType,typename blJacobianFunctorType>
+inline bool blRosenbrockWStepper<blNumberType,blMatrixType,blLUFactorizationType>::step(const blODEFunctorType& ODEfunctor,
+                                                                                        const blJacobianFunctorType& JacobianFunctor,
+                                                                                        blNumberType* y,
+                                                                                        blNumberType& t,
+                                                                                        blNumberType& h)
+{
+    const int n = m_numberOfStateVariables;
+
+    blNumberType* u = m_u.data();
+    blNumberType* f0 = m_f0.data();
+    blNumberType* dfdt = m_dfdt.data();
+    blNumberType* yStage = m_yStage.data();
+    blNumberType* fStage = m_fStage.data();
+    blNumberType* yNew = m_yNew.data();
+    blNumberType* yError = m_yError.data();
+
+    if(!m_isF0Current)
+    {
+        ODEfunctor(t,y,f0);
+        m_isF0Current = true;
+        m_isJacobianCurrent = false;
+    }
+
+    // Re-evaluate the Jacobian when it's
+    // too old, or when a step was rejected
+    // with a Jacobian from an earlier point
+
+    if(!m_isJacobianValid ||
+       m_jacobianAge >= m_maxJacobianAge ||
+       (m_controller.wasLastStepRejected && !m_isJacobianCurrent))
+    {
+        evaluateJacobian(ODEfunctor,JacobianFunctor,t,y);
+
+        ++m_numberOfJacobianEvaluations;
+
+        m_jacobianAge = 0;
+        m_isJacobianValid = true;
+        m_isJacobianCurrent = true;
+        m_isFactorizationValid = false;
+    }
+
+    if(!m_isFactorizationValid || h != m_factorizedStepSize)
+    {
+        if(!factorize(h))
+        {
+            // Singular iteration matrix,
+            // try again with a smaller step
+
+            ++m_numberOfRejectedSteps;
+            m_controller.wasLastStepRejected = true;
+            h *= blNumberType(0.5);
+            return false;
+        }
+    }
+
+    // The four stages
+
+    for(int stage = 0; stage < 4; ++stage)
+    {
+        blNumberType* uStage = u + stage * n;
+
+        const blNumberType* fCurrent = f0;
+
+        if(stage > 0)
+        {
+            for(int i = 0; i < n; ++i)
+            {
+                blNumberType sum = 0;
+
+                for(int j = 0; j < stage; ++j)
+                    sum += m_a[stage][j] * u[i + j * n];
+
+                yStage[i] = y[i] + sum;
+            }
+
+            ODEfunctor(t + m_alpha[stage] * h,yStage,fStage);
+
+            fCurrent = fStage;
+        }
+
+        for(int i = 0; i < n; ++i)
+        {
+            blNumberType sum = 0;
+
+            for(int j = 0; j < stage; ++j)
+                sum += m_c[stage][j] * u[i + j * n];
+
+            uStage[i] = fCurrent[i] + sum / h + m_gammaSum[stage] * h * dfdt[i];
+        }
+
+        m_LU.SolveInPlace(uStage);
+    }
+
+    // The new state and its error
+
+    for(int i = 0; i < n; ++i)
+    {
+        blNumberType sum = 0;
+        blNumberType errorSum = 0;
+
+        for(int j = 0; j < 4; ++j)
+        {
+            sum += m_m[j] * u[i + j * n];
+            errorSum += m_mError[j] * u[i + j * n];
+        }
+
+        yNew[i] = y[i] + sum;
+        yError[i] = errorSum;
+    }
+
+    blNumberType error = rkErrorNorm(n,y,yNew,yError,m_absoluteTolerance,m_relativeTolerance);
+
+    bool isStepAccepted = (error <= blNumberType(1));
+
+    blNumberType factor = m_controller.getStepSizeFactor(error,isStepAccepted);
+
+    if(isStepAccepted)
+    {
+        std::copy(yNew,yNew + n,y);
+
+        t += h;
+
+        m_isF0Current = false;
+
+        ++m_jacobianAge;
+        ++m_numberOfAcceptedSteps;
+
+        // Keep the step size (and so the LU
+        // factorization) when the controller
+        // only asks for a small increase
+
+        if(factor >= blNumberType(1) && factor <= blNumberType(1.2))
+            factor = 1;
+    }
+    else
+        ++m_numberOfRejectedSteps;
+
+    h *= factor;
+
+    return isStepAccepted;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+template<typename blODEFunctorType,typename blJacobianFunctorType>
+inline bool blRosenbrockWStepper<blNumberType,blMatrixType,blLUFactorizationType>::integrate(const blODEFunctorType& ODEfunctor,
+                                                                                             const blJacobianFunctorType& JacobianFunctor,
+                                                                                             blNumberType* y,
+                                                                                             const blNumberType& t0,
+                                                                                             const blNumberType& tf,
+                                                                                             const blNumberType& initialStepSize,
+                                                                                             const int& maxNumberOfSteps)
+{
+    reset();
+
+    blNumberType t = t0;
+    blNumberType h = initialStepSize;
+
+    for(int i = 0; i < maxNumberOfSteps && t < tf; ++i)
+    {
+        // Don't step past the final time
+
+        bool isLastStep = (t + h >= tf);
+
+        if(isLastStep)
+            h = tf - t;
+
+        if(step(ODEfunctor,JacobianFunctor,y,t,h) && isLastStep)
+            t = tf;
+    }
+
+    return (t >= tf);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Variable step, variable order BDF stepper (orders 1
+// to 5), with the BDF formulas built on the actual
+// (non-uniform) past time points
+//
+// - Each step solves the implicit BDF equation with a
+//   simplified Newton iteration on l0*I - J, where
+//   l0 is the leading BDF coefficient, and the LU
+//   factorization is reused for as long as l0 stays
+//   within 30% of the factorized one and the Newton
+//   iteration keeps converging
+//
+// - The Jacobian is only re-evaluated when the Newton
+//   iteration fails with an old Jacobian
+//
+// - The error of a step at order k is estimated from
+//   the (k+1)th divided difference of the solution,
+//   and after k+1 steps at the same order the orders
+//   k-1 and k+1 are tried as well
+//
+// - The stepper keeps the past solution points, so the
+//   caller has to call reset() after changing y or t
+//-------------------------------------------------------------------
+template<typename blNumberType,
+         typename blMatrixType,
+         typename blLUFactorizationType>
+class blBDFStepper
+{
+public: // Constructors and destructors
+
+
+
+    // Default constructor
+
+    blBDFStepper(const int& numberOfStateVariables = 0,
+                 const blNumberType& absoluteTolerance = 1e-6,
+                 const blNumberType& relativeTolerance = 1e-6,
+                 const int& maxOrder = 5);
+
+    // Destructor
+
+    ~blBDFStepper();
+
+
+
+public: // Public functions
+
+
+
+    // Function used to resize the workspaces,
+    // this is the only function that allocates
+    // (besides the LU factorization type)
+
+    void                                    setNumberOfStateVariables(const int& numberOfStateVariables);
+
+    const int&                              getNumberOfStateVariables()const;
+
+    void                                    setTolerances(const blNumberType& absoluteTolerance,
+                                                          const blNumberType& relativeTolerance);
+
+    void                                    setMaxOrder(const int& maxOrder);
+
+    // Forgets the past solution points, the
+    // Jacobian and the LU factorization
+
+    void                                    reset();
+
+    // Attempts one step of size h, if the
+    // step is accepted y and t are advanced,
+    // either way h becomes the next step size
+
+    template<typename blODEFunctorType,
+             typename blJacobianFunctorType>
+
+    bool                                    step(const blODEFunctorType& ODEfunctor,
+                                                 const blJacobianFunctorType& JacobianFunctor,
+                                                 blNumberType* y,
+                                                 blNumberType& t,
+                                                 blNumberType& h);
+
+    // Advances the state y from t0 to tf,
+    // returns false if maxNumberOfSteps
+    // attempts weren't enough
+
+    template<typename blODEFunctorType,
+             typename blJacobianFunctorType>
+
+    bool                                    integrate(const blODEFunctorType& ODEfunctor,
+                                                      const blJacobianFunctorType& JacobianFunctor,
+                                                      blNumberType* y,
+                                                      const blNumberType& t0,
+                                                      const blNumberType& tf,
+                                                      const blNumberType& initialStepSize,
+                                                      const int& maxNumberOfSteps);
+
+    // The order used for the next step
+
+    const int&                              getOrder()const;
+
+    // Counts since the last reset
+
+    const int&                              getNumberOfAcceptedSteps()const;
+    const int&                              getNumberOfRejectedSteps()const;
+    const int&                              getNumberOfJacobianEvaluations()const;
+    const int&                              getNumberOfLUFactorizations()const;
+
+
+
+private: // Private functions
+
+
+
+    // The jth most recent past state (0 is the
+    // last accepted one) and its time
+
+    blNumberType*                           getPastState(const int& j);
+    const blNumberType&                     getPastTime(const int& j)const;
+
+    // Adds the accepted state to the past states
+
+    void                                    pushState(const blNumberType& t,
+                                                      const blNumberType* y);
+
+    // Scaled norm of the error estimate for
+    // order q, q! * h^(q+1) * (q+1)th divided
+    // difference over the q+2 newest points
+
+    blNumberType                            estimateError(const int& q,
+                                                          const blNumberType& h);
+
+    template<typename blODEFunctorType>
+
+    void                                    evaluateJacobian(const blODEFunctorType& ODEfunctor,
+                                                             const blFiniteDifferenceJacobian& JacobianFunctor,
+                                                             const blNumberType& t,
+                                                             const blNumberType* y);
+
+    template<typename blODEFunctorType,
+             typename blJacobianFunctorType>
+
+    void                                    evaluateJacobian(const blODEFunctorType& ODEfunctor,
+                                                             const blJacobianFunctorType& JacobianFunctor,
+                                                             const blNumberType& t,
+                                                             const blNumberType* y);
+
+    // Factorizes l0*I - J
+
+    bool                                    factorize(const blNumberType& leadingCoefficient);
+
+    // Solves the BDF equation at time tNew with
+    // the coefficients in m_coefficients, starting
+    // from the prediction in m_yNew
+
+    template<typename blODEFunctorType>
+
+    bool                                    solveCorrector(const blODEFunctorType& ODEfunctor,
+                                                           const blNumberType& tNew,
+                                                           const int& k);
+
+
+
+private: // Private variables
+
+
+
+    int                                     m_numberOfStateVariables;
+    int                                     m_maxOrder;
+
+    blNumberType                            m_absoluteTolerance;
+    blNumberType                            m_relativeTolerance;
+
+    int                                     m_order;
+    int                                     m_numberOfStepsAtOrder;
+    int                                     m_numberOfConsecutiveRejections;
+
+    int                                     m_numberOfAcceptedSteps;
+    int                                     m_numberOfRejectedSteps;
+    int                                     m_numberOfJacobianEvaluations;
+    int                                     m_numberOfLUFactorizations;
+
+    // Past states, stored as a ring of
+    // (m_maxOrder + 2) states of n values
+
+    int                                     m_numberOfPastStates;
+    int                                     m_newestPastState;
+    blAlignedBuffer<blNumberType>           m_pastStates;
+    std::vector<blNumberType>               m_pastTimes;
+
+    // Jacobian and factorization state
+
+    bool                                    m_isJacobianValid;
+    bool                                    m_isJacobianCurrent;
+    bool                                    m_isFactorizationValid;
+    blNumberType                            m_factorizedCoefficient;
+    int                                     m_jacobianAge;
+
+    blMatrixType                            m_J;
+    blMatrixType                            m_iterationMatrix;
+    blLUFactorizationType                   m_LU;
+
+    // BDF coefficients of the current step, y'(tNew)
+    // is approximated as sum(l_j * y(tNew - j))
+
+    std::vector<blNumberType>               m_coefficients;
+
+    // Workspaces for the derivative at the last
+    // state, the predicted/corrected state, the
+    // constant part of the BDF equation, the
+    // Newton correction and the perturbations
+
+    blAlignedBuffer<blNumberType>           m_f0;
+    blAlignedBuffer<blNumberType>           m_yNew;
+    blAlignedBuffer<blNumberType>           m_yPredicted;
+    blAlignedBuffer<blNumberType>           m_history;
+    blAlignedBuffer<blNumberType>           m_delta;
+    blAlignedBuffer<blNumberType>           m_fNew;
+    blAlignedBuffer<blNumberType>           m_yPerturbed;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline blBDFStepper<blNumberType,blMatrixType,blLUFactorizationType>::blBDFStepper(const int& numberOfStateVariables,
+                                                                                   const blNumberType& absoluteTolerance,
+                                                                                   const blNumberType& relativeTolerance,
+                                                                                   const int& maxOrder)
+{
+    m_absoluteTolerance = absoluteTolerance;
+    m_relativeTolerance = relativeTolerance;
+
+    m_maxOrder = std::min(5,std::max(1,maxOrder));
+    m_numberOfStateVariables = 0;
+
+    setNumberOfStateVariables(numberOfStateVariables);
+
+    reset();
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline blBDFStepper<blNumberType,blMatrixType,blLUFactorizationType>::~blBDFStepper()
+{
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline void blBDFStepper<blNumberType,blMatrixType,blLUFactorizationType>::setNumberOfStateVariables(const int& numberOfStateVariables)
+{
+    m_numberOfStateVariables = std::max(0,numberOfStateVariables);
+
+    const int n = m_numberOfStateVariables;
+
+    // Room for the points needed to
+    // estimate the error at order
+    // maxOrder + 1
+
+    const int maxNumberOfPastStates = 7;
+
+    m_pastStates.resize(maxNumberOfPastStates * n);
+    m_pastTimes.assign(maxNumberOfPastStates,blNumberType(0));
+    m_coefficients.assign(maxNumberOfPastStates,blNumberType(0));
+
+    m_J = blMatrixType(n,n,blNumberType(0));
+    m_iterationMatrix = blMatrixType(n,n,blNumberType(0));
+
+    m_f0.resize(n);
+    m_yNew.resize(n);
+    m_yPredicted.resize(n);
+    m_history.resize(n);
+    m_delta.resize(n);
+    m_fNew.resize(n);
+    m_yPerturbed.resize(n);
+
+    m_numberOfPastStates = 0;
+    m_newestPastState = 0;
+
+    m_isJacobianValid = false;
+    m_isFactorizationValid = false;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline const int& blBDFStepper<blNumberType,blMatrixType,blLUFactorizationType>::getNumberOfStateVariables()const
+{
+    return m_numberOfStateVariables;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline void blBDFStepper<blNumberType,blMatrixType,blLUFactorizationType>::setTolerances(const blNumberType& absoluteTolerance,
+                                                                                         const blNumberType& relativeTolerance)
+{
+    m_absoluteTolerance = absoluteTolerance;
+    m_relativeTolerance = relativeTolerance;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline void blBDFStepper<blNumberType,blMatrixType,blLUFactorizationType>::setMaxOrder(const int& maxOrder)
+{
+    m_maxOrder = std::min(5,std::max(1,maxOrder));
+
+    m_order = std::min(m_order,m_maxOrder);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline void blBDFStepper<blNumberType,blMatrixType,blLUFactorizationType>::reset()
+{
+    m_order = 1;
+    m_numberOfStepsAtOrder = 0;
+    m_numberOfConsecutiveRejections = 0;
+
+    m_numberOfAcceptedSteps = 0;
+    m_numberOfRejectedSteps = 0;
+    m_numberOfJacobianEvaluations = 0;
+    m_numberOfLUFactorizations = 0;
+
+    m_numberOfPastStates = 0;
+    m_newestPastState = 0;
+
+    m_isJacobianValid = false;
+    m_isJacobianCurrent = false;
+    m_isFactorizationValid = false;
+    m_factorizedCoefficient = 0;
+    m_jacobianAge = 0;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline const int& blBDFStepper<blNumberType,blMatrixType,blLUFactorizationType>::getOrder()const
+{
+    return m_order;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline const int& blBDFStepper<blNumberType,blMatrixType,blLUFactorizationType>::getNumberOfAcceptedSteps()const
+{
+    return m_numberOfAcceptedSteps;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline const int& blBDFStepper<blNumberType,blMatrixType,blLUFactorizationType>::getNumberOfRejectedSteps()const
+{
+    return m_numberOfRejectedSteps;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline const int& blBDFStepper<blNumberType,blMatrixType,blLUFactorizationType>::getNumberOfJacobianEvaluations()const
+{
+    return m_numberOfJacobianEvaluations;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline const int& blBDFStepper<blNumberType,blMatrixType,blLUFactorizationType>::getNumberOfLUFactorizations()const
+{
+    return m_numberOfLUFactorizations;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline blNumberType* blBDFStepper<blNumberType,blMatrixType,blLUFactorizationType>::getPastState(const int& j)
+{
+    const int capacity = int(m_pastTimes.size());
+
+    return m_pastStates.data() + ((m_newestPastState - j + capacity) % capacity) * m_numberOfStateVariables;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline const blNumberType& blBDFStepper<blNumberType,blMatrixType,blLUFactorizationType>::getPastTime(const int& j)const
+{
+    const int capacity = int(m_pastTimes.size());
+
+    return m_pastTimes[(m_newestPastState - j + capacity) % capacity];
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline void blBDFStepper<blNumberType,blMatrixType,blLUFactorizationType>::pushState(const blNumberType& t,
+                                                                                     const blNumberType* y)
+{
+    const int capacity = int(m_pastTimes.size());
+
+    if(m_numberOfPastStates > 0)
+        m_newestPastState = (m_newestPastState + 1) % capacity;
+
+    m_numberOfPastStates = std::min(capacity,m_numberOfPastStates + 1);
+
+    m_pastTimes[m_newestPastState] = t;
+
+    std::copy(y,y + m_numberOfStateVariables,getPastState(0));
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline blNumberType blBDFStepper<blNumberType,blMatrixType,blLUFactorizationType>::estimateError(const int& q,
+                                                                                                 const blNumberType& h)
+{
+    const int n = m_numberOfStateVariables;
+
+    // The (q+1)th divided difference over the
+    // q+2 newest points is sum(y_i / prod(t_i - t_j))
+
+    blNumberType* dividedDifference = m_delta.data();
+
+    std::fill(dividedDifference,dividedDifference + n,blNumberType(0));
+
+    blNumberType scale = 1;
+
+    for(int m = 1; m <= q; ++m)
+        scale *= blNumberType(m);
+
+    for(int m = 0; m <= q; ++m)
+        scale *= h;
+
+    for(int i = 0; i < q + 2; ++i)
+    {
+        blNumberType denominator = 1;
+
+        for(int j = 0; j < q + 2; ++j)
+        {
+            if(j != i)
+                denominator *= (getPastTime(i) - getPastTime(j));
+        }
+
+        blNumberType weight = scale / denominator;
+
+        const blNumberType* yi = getPastState(i);
+
+        for(int s = 0; s < n; ++s)
+            dividedDifference[s] += weight * yi[s];
+    }
+
+    blNumberType sum = 0;
+
+    const blNumberType* yNewest = getPastState(0);
+
+    for(int s = 0; s < n; ++s)
+    {
+        blNumberType scaledError = dividedDifference[s] / (m_absoluteTolerance + m_relativeTolerance * std::abs(yNewest[s]));
+
+        sum += scaledError * scaledError;
+    }
+
+    return (n > 0) ? std::sqrt(sum / blNumberType(n)) : blNumberType(0);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+template<typename blODEFunctorType>
+inline void blBDFStepper<blNumberType,blMatrixType,blLUFactorizationType>::evaluateJacobian(const blODEFunctorType& ODEfunctor,
+                                                                                            const blFiniteDifferenceJacobian&,
+                                                                                            const blNumberType& t,
+                                                                                            const blNumberType* y)
+{
+    ODEfunctor(t,y,m_f0.data());
+
+    computeFiniteDifferenceJacobian(ODEfunctor,m_numberOfStateVariables,t,y,m_f0.data(),m_J,m_yPerturbed.data(),m_fNew.data());
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+template<typename blODEFunctorType,typename blJacobianFunctorType>
+inline void blBDFStepper<blNumberType,blMatrixType,blLUFactorizationType>::evaluateJacobian(const blODEFunctorType&,
+                                                                                            const blJacobianFunctorType& JacobianFunctor,
+                                                                                            const blNumberType& t,
+                                                                                            const blNumberType* y)
+{
+    JacobianFunctor(t,y,m_J);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline bool blBDFStepper<blNumberType,blMatrixType,blLUFactorizationType>::factorize(const blNumberType& leadingCoefficient)
+{
+    const int n = m_numberOfStateVariables;
+
+    for(int i = 0; i < n; ++i)
+    {
+        for(int j = 0; j < n; ++j)
+            m_iterationMatrix(i,j) = -m_J(i,j);
+
+        m_iterationMatrix(i,i) += leadingCoefficient;
+    }
+
+    ++m_numberOfLUFactorizations;
+
+    m_isFactorizationValid = m_LU.Factorize(m_iterationMatrix);
+    m_factorizedCoefficient = leadingCoefficient;
+
+    return m_isFactorizationValid;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+template<typename blODEFunctorType>
+inline bool blBDFStepper<blNumberType,blMatrixType,blLUFactorizationType>::solveCorrector(const blODEFunctorType& ODEfunctor,
+                                                                                         const blNumberType& tNew,
+                                                                                         const int& k)
+{
+    const int n = m_numberOfStateVariables;
+
+    blNumberType* yNew = m_yNew.data();
+    blNumberType* history = m_history.data();
+    blNumberType* delta = m_delta.data();
+    blNumberType* fNew = m_fNew.data();
+
+    // The part of the BDF equation
+    // that depends on past states
+
+    std::fill(history,history + n,blNumberType(0));
+
+    for(int j = 1; j <= k; ++j)
+    {
+        const blNumberType* yPast = getPastState(j - 1);
+
+        for(int i = 0; i < n; ++i)
+            history[i] += m_coefficients[j] * yPast[i];
+    }
+
+    // Simplified Newton iteration on
+    // l0*y + history - f(tNew,y) = 0
+
+    blNumberType previousNorm = 0;
+
+    for(int iteration = 0; iteration < 4; ++iteration)
+    {
+        ODEfunctor(tNew,yNew,fNew);
+
+        for(int i = 0; i < n; ++i)
+            delta[i] = fNew[i] - m_coefficients[0] * yNew[i] - history[i];
+
+        m_LU.SolveInPlace(delta);
+
+        blNumberType sum = 0;
+
+        for(int i = 0; i < n; ++i)
+        {
+            yNew[i] += delta[i];
+
+            blNumberType scaledDelta = delta[i] / (m_absoluteTolerance + m_relativeTolerance * std::abs(yNew[i]));
+
+            sum += scaledDelta * scaledDelta;
+        }
+
+        blNumberType norm = (n > 0) ? std::sqrt(sum / blNumberType(n)) : blNumberType(0);
+
+        // Converged when the remaining correction,
+        // estimated from the convergence rate, is
+        // well below the tolerance
+
+        if(iteration == 0)
+        {
+            if(norm <= blNumberType(0.01))
+                return true;
+        }
+        else
+        {
+            blNumberType rate = norm / previousNorm;
+
+            if(rate >= blNumberType(0.9))
+                return false;
+
+            if(norm * rate / (blNumberType(1) - rate) <= blNumberType(0.1))
+                return true;
+        }
+
+        previousNorm = norm;
+    }
+
+    return false;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+template<typename blODEFunctorType,typename blJacobianFunctorType>
+inline bool blBDFStepper<blNumberType,blMatrixType,blLUFactorizationType>::step(const blODEFunctorType& ODEfunctor,
+                                                                                const blJacobianFunctorType& JacobianFunctor,
+                                                                                blNumberType* y,
+                                                                                blNumberType& t,
+                                                                                blNumberType& h)
+{
+    const int n = m_numberOfStateVariables;
+
+    blNumberType* yNew = m_yNew.data();
+    blNumberType* yPredicted = m_yPredicted.data();
+    blNumberType* f0 = m_f0.data();
+
+    if(m_numberOfPastStates == 0)
+        pushState(t,y);
+
+    const blNumberType tNew = t + h;
+
+    // The order can't be higher than the
+    // number of past states allow
+
+    const int k = std::min(m_order,m_numberOfPastStates);
+
+    // Predict the new state by extrapolating
+    // the past states, the first step uses
+    // an explicit Euler step instead
+
+    if(m_numberOfPastStates == 1)
+    {
+        ODEfunctor(t,y,f0);
+
+        for(int i = 0; i < n; ++i)
+            yPredicted[i] = y[i] + h * f0[i];
+    }
+    else
+    {
+        const int numberOfPoints = std::min(k + 1,m_numberOfPastStates);
+
+        std::fill(yPredicted,yPredicted + n,blNumberType(0));
+
+        for(int j = 0; j < numberOfPoints; ++j)
+        {
+            blNumberType weight = 1;
+
+            for(int m = 0; m < numberOfPoints; ++m)
+            {
+                if(m != j)
+                    weight *= (tNew - getPastTime(m)) / (getPastTime(j) - getPastTime(m));
+            }
+
+            const blNumberType* yPast = getPastState(j);
+
+            for(int i = 0; i < n; ++i)
+                yPredicted[i] += weight * yPast[i];
+        }
+    }
+
+    // The BDF coefficients are the derivatives at tNew
+    // of the Lagrange polynomials through tNew and the
+    // k newest past times
+
+    m_coefficients[0] = 0;
+
+    for(int m = 1; m <= k; ++m)
+        m_coefficients[0] += blNumberType(1) / (tNew - getPastTime(m - 1));
+
+    for(int j = 1; j <= k; ++j)
+    {
+        const blNumberType tj = getPastTime(j - 1);
+
+        blNumberType numerator = 1;
+        blNumberType denominator = tj - tNew;
+
+        for(int m = 1; m <= k; ++m)
+        {
+            if(m == j)
+                continue;
+
+            numerator *= (tNew - getPastTime(m - 1));
+            denominator *= (tj - getPastTime(m - 1));
+        }
+
+        m_coefficients[j] = numerator / denominator;
+    }
+
+    // Solve the corrector, re-evaluating the
+    // Jacobian once if an old one doesn't
+    // make the Newton iteration converge
+
+    bool hasConverged = false;
+
+    for(int attempt = 0; attempt < 2 && !hasConverged; ++attempt)
+    {
+        if(!m_isJacobianValid || m_jacobianAge >= 50 || (attempt > 0 && !m_isJacobianCurrent))
+        {
+            evaluateJacobian(ODEfunctor,JacobianFunctor,t,y);
+
+            ++m_numberOfJacobianEvaluations;
+
+            m_isJacobianValid = true;
+            m_isJacobianCurrent = true;
+            m_isFactorizationValid = false;
+            m_jacobianAge = 0;
+        }
+        else if(attempt > 0)
+            break;
+
+        if(!m_isFactorizationValid ||
+           std::abs(m_coefficients[0] / m_factorizedCoefficient - blNumberType(1)) > blNumberType(0.3))
+        {
+            if(!factorize(m_coefficients[0]))
+                break;
+        }
+
+        std::copy(yPredicted,yPredicted + n,yNew);
+
+        hasConverged = solveCorrector(ODEfunctor,tNew,k);
+
+        // A factorization from another step size
+        // may be what made the iteration fail
+
+        if(!hasConverged && m_factorizedCoefficient != m_coefficients[0])
+            m_isFactorizationValid = false;
+    }
+
+    if(!hasConverged)
+    {
+        ++m_numberOfRejectedSteps;
+        ++m_numberOfConsecutiveRejections;
+
+        h *= blNumberType(0.25);
+
+        return false;
+    }
+
+    // Error estimate, k! * h^(k+1) * the (k+1)th
+    // divided difference, or half the difference
+    // to the explicit Euler prediction on the
+    // first step
+
+    blNumberType error = 0;
+
+    pushState(tNew,yNew);
+
+    if(m_numberOfPastStates == 2)
+    {
+        blNumberType sum = 0;
+
+        for(int i = 0; i < n; ++i)
+        {
+            blNumberType scaledError = blNumberType(0.5) * (yNew[i] - yPredicted[i]) / (m_absoluteTolerance + m_relativeTolerance * std::abs(yNew[i]));
+
+            sum += scaledError * scaledError;
+        }
+
+        error = (n > 0) ? std::sqrt(sum / blNumberType(n)) : blNumberType(0);
+    }
+    else
+        error = estimateError(k,h);
+
+    if(error > blNumberType(1))
+    {
+        // Take the new state back out
+
+        const int capacity = int(m_pastTimes.size());
+
+        m_newestPastState = (m_newestPastState - 1 + capacity) % capacity;
+        --m_numberOfPastStates;
+
+        ++m_numberOfRejectedSteps;
+        ++m_numberOfConsecutiveRejections;
+
+        // Repeated rejections usually mean the
+        // past states are no longer smooth, so
+        // start over from order 1
+
+        if(m_numberOfConsecutiveRejections >= 3)
+        {
+            m_order = 1;
+            m_numberOfStepsAtOrder = 0;
+        }
+
+        h *= std::max(blNumberType(0.2),blNumberType(0.9) * std::pow(error,blNumberType(-1) / blNumberType(k + 1)));
+
+        return false;
+    }
+
+    // Accept the step
+
+    std::copy(yNew,yNew + n,y);
+
+    t = tNew;
+
+    ++m_numberOfAcceptedSteps;
+    ++m_numberOfStepsAtOrder;
+    ++m_jacobianAge;
+
+    m_isJacobianCurrent = false;
+    m_numberOfConsecutiveRejections = 0;
+
+    // The step size for the current order, and
+    // after k+1 steps at this order, the step
+    // sizes for the neighboring orders, an
+    // order change has to pay off by 20%
+
+    blNumberType bestFactor = blNumberType(0.9) * std::pow(std::max(error,blNumberType(1e-10)),blNumberType(-1) / blNumberType(k + 1));
+    int bestOrder = k;
+
+    if(m_numberOfStepsAtOrder > k)
+    {
+        if(k > 1)
+        {
+            blNumberType lowerError = estimateError(k - 1,h);
+            blNumberType lowerFactor = blNumberType(0.9 / 1.2) * std::pow(std::max(lowerError,blNumberType(1e-10)),blNumberType(-1) / blNumberType(k));
+
+            if(lowerFactor > bestFactor)
+            {
+                bestFactor = lowerFactor;
+                bestOrder = k - 1;
+            }
+        }
+
+        if(k < m_maxOrder && m_numberOfPastStates >= k + 3)
+        {
+            blNumberType higherError = estimateError(k + 1,h);
+            blNumberType higherFactor = blNumberType(0.9 / 1.2) * std::pow(std::max(higherError,blNumberType(1e-10)),blNumberType(-1) / blNumberType(k + 2));
+
+            if(higherFactor > bestFactor)
+            {
+                bestFactor = higherFactor;
+                bestOrder = k + 1;
+            }
+        }
+    }
+
+    if(bestOrder != m_order)
+    {
+        m_order = bestOrder;
+        m_numberOfStepsAtOrder = 0;
+    }
+
+    h *= std::min(blNumberType(2),std::max(blNumberType(0.2),bestFactor));
+
+    return true;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+template<typename blODEFunctorType,typename blJacobianFunctorType>
+inline bool blBDFStepper<blNumberType,blMatrixType,blLUFactorizationType>::integrate(const blODEFunctorType& ODEfunctor,
+                                                                                     const blJacobianFunctorType& JacobianFunctor,
+                                                                                     blNumberType* y,
+                                                                                     const blNumberType& t0,
+                                                                                     const blNumberType& tf,
+                                                                                     const blNumberType& initialStepSize,
+                                                                                     const int& maxNumberOfSteps)
+{
+    reset();
+
+    blNumberType t = t0;
+    blNumberType h = initialStepSize;
+
+    for(int i = 0; i < maxNumberOfSteps && t < tf; ++i)
+    {
+        // Don't step past the final time
+
+        bool isLastStep = (t + h >= tf);
+
+        if(isLastStep)
+            h = tf - t;
+
+        if(step(ODEfunctor,JacobianFunctor,y,t,h) && isLastStep)
+            t = tf;
+    }
+
+    return (t >= tf);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Integrates with the explicit Cash-Karp method for as
+// long as the problem is not stiff, and switches to the
+// Rosenbrock-W method when it is
+//
+// - Every few accepted Cash-Karp steps the dominant
+//   eigenvalue of the Jacobian is estimated along the
+//   step's error vector (which is dominated by the stiff
+//   components), with two extra ODE evaluations, and the
+//   problem is declared stiff when the step size keeps
+//   running into the stability boundary of Cash-Karp
+//   (|h*lambda| ~ 3.7 on the negative real axis)
+//
+// - While stiff, the problem is declared non-stiff
+//   again once h*||J|| stays under half of that
+//   boundary, so Cash-Karp would be stable at the
+//   Rosenbrock step size
+//-------------------------------------------------------------------
+template<typename blNumberType,
+         typename blMatrixType,
+         typename blLUFactorizationType>
+class blStiffnessSwitchingSolver
+{
+public: // Constructors and destructors
+
+
+
+    // Default constructor
+
+    blStiffnessSwitchingSolver(const int& numberOfStateVariables = 0,
+                               const blNumberType& absoluteTolerance = 1e-6,
+                               const blNumberType& relativeTolerance = 1e-6);
+
+    // Destructor
+
+    ~blStiffnessSwitchingSolver();
+
+
+
+public: // Public functions
+
+
+
+    // Function used to resize the workspaces
+
+    void                                    setNumberOfStateVariables(const int& numberOfStateVariables);
+
+    const int&                              getNumberOfStateVariables()const;
+
+    void                                    setTolerances(const blNumberType& absoluteTolerance,
+                                                          const blNumberType& relativeTolerance);
+
+    // Advances the state y from t0 to tf,
+    // returns false if maxNumberOfSteps
+    // attempts weren't enough
+
+    template<typename blODEFunctorType,
+             typename blJacobianFunctorType>
+
+    bool                                    integrate(const blODEFunctorType& ODEfunctor,
+                                                      const blJacobianFunctorType& JacobianFunctor,
+                                                      blNumberType* y,
+                                                      const blNumberType& t0,
+                                                      const blNumberType& tf,
+                                                      const blNumberType& initialStepSize,
+                                                      const int& maxNumberOfSteps);
+
+    // Whether the last integration
+    // ended with the stiff method
+
+    const bool&                             isStiff()const;
+
+    // Counts of the last integration
+
+    const int&                              getNumberOfExplicitSteps()const;
+    const int&                              getNumberOfImplicitSteps()const;
+    const int&                              getNumberOfSwitches()const;
+
+    const blRosenbrockWStepper<blNumberType,blMatrixType,blLUFactorizationType>& getImplicitStepper()const;
+
+
+
+private: // Private functions
+
+
+
+    // One Cash-Karp step attempt, sets
+    // m_estimatedStiffness when it checks it
+
+    template<typename blODEFunctorType>
+
+    bool                                    explicitStep(const blODEFunctorType& ODEfunctor,
+                                                         blNumberType* y,
+                                                         blNumberType& t,
+                                                         blNumberType& h,
+                                                         const bool& shouldCheckStiffness);
+
+
+
+private: // Private variables
+
+
+
+    int                                     m_numberOfStateVariables;
+
+    blNumberType                            m_absoluteTolerance;
+    blNumberType                            m_relativeTolerance;
+
+    bool                                    m_isStiff;
+
+    int                                     m_numberOfExplicitSteps;
+    int                                     m_numberOfImplicitSteps;
+    int                                     m_numberOfSwitches;
+
+    // h*|lambda| of the last stiffness check
+
+    blNumberType                            m_estimatedStiffness;
+
+    blPIStepSizeController<blNumberType>    m_controller;
+
+    blRosenbrockWStepper<blNumberType,blMatrixType,blLUFactorizationType> m_implicitStepper;
+
+    // Cash-Karp workspaces
+
+    blAlignedBuffer<blNumberType>           m_k;
+    blAlignedBuffer<blNumberType>           m_yStart;
+    blAlignedBuffer<blNumberType>           m_y4th;
+    blAlignedBuffer<blNumberType>           m_y5th;
+    blAlignedBuffer<blNumberType>           m_yTemp;
+    blAlignedBuffer<blNumberType>           m_yProbe;
+    blAlignedBuffer<blNumberType>           m_fProbe;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline blStiffnessSwitchingSolver<blNumberType,blMatrixType,blLUFactorizationType>::blStiffnessSwitchingSolver(const int& numberOfStateVariables,
+                                                                                                               const blNumberType& absoluteTolerance,
+                                                                                                               const blNumberType& relativeTolerance)
+{
+    m_isStiff = false;
+
+    m_numberOfExplicitSteps = 0;
+    m_numberOfImplicitSteps = 0;
+    m_numberOfSwitches = 0;
+
+    m_estimatedStiffness = 0;
+
+    setTolerances(absoluteTolerance,relativeTolerance);
+    setNumberOfStateVariables(numberOfStateVariables);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline blStiffnessSwitchingSolver<blNumberType,blMatrixType,blLUFactorizationType>::~blStiffnessSwitchingSolver()
+{
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline void blStiffnessSwitchingSolver<blNumberType,blMatrixType,blLUFactorizationType>::setNumberOfStateVariables(const int& numberOfStateVariables)
+{
+    m_numberOfStateVariables = std::max(0,numberOfStateVariables);
+
+    const int n = m_numberOfStateVariables;
+
+    m_implicitStepper.setNumberOfStateVariables(n);
+
+    m_k.resize(6 * n);
+    m_yStart.resize(n);
+    m_y4th.resize(n);
+    m_y5th.resize(n);
+    m_yTemp.resize(n);
+    m_yProbe.resize(n);
+    m_fProbe.resize(n);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline const int& blStiffnessSwitchingSolver<blNumberType,blMatrixType,blLUFactorizationType>::getNumberOfStateVariables()const
+{
+    return m_numberOfStateVariables;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline void blStiffnessSwitchingSolver<blNumberType,blMatrixType,blLUFactorizationType>::setTolerances(const blNumberType& absoluteTolerance,
+                                                                                                       const blNumberType& relativeTolerance)
+{
+    m_absoluteTolerance = absoluteTolerance;
+    m_relativeTolerance = relativeTolerance;
+
+    m_implicitStepper.setTolerances(absoluteTolerance,relativeTolerance);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline const bool& blStiffnessSwitchingSolver<blNumberType,blMatrixType,blLUFactorizationType>::isStiff()const
+{
+    return m_isStiff;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline const int& blStiffnessSwitchingSolver<blNumberType,blMatrixType,blLUFactorizationType>::getNumberOfExplicitSteps()const
+{
+    return m_numberOfExplicitSteps;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline const int& blStiffnessSwitchingSolver<blNumberType,blMatrixType,blLUFactorizationType>::getNumberOfImplicitSteps()const
+{
+    return m_numberOfImplicitSteps;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline const int& blStiffnessSwitchingSolver<blNumberType,blMatrixType,blLUFactorizationType>::getNumberOfSwitches()const
+{
+    return m_numberOfSwitches;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+inline const blRosenbrockWStepper<blNumberType,blMatrixType,blLUFactorizationType>& blStiffnessSwitchingSolver<blNumberType,blMatrixType,blLUFactorizationType>::getImplicitStepper()const
+{
+    return m_implicitStepper;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+template<typename blODEFunctorType>
+inline bool blStiffnessSwitchingSolver<blNumberType,blMatrixType,blLUFactorizationType>::explicitStep(const blODEFunctorType& ODEfunctor,
+                                                                                                      blNumberType* y,
+                                                                                                      blNumberType& t,
+                                                                                                      blNumberType& h,
+                                                                                                      const bool& shouldCheckStiffness)
+{
+    const int n = m_numberOfStateVariables;
+
+    blNumberType* yStart = m_yStart.data();
+    blNumberType* y4th = m_y4th.data();
+    blNumberType* y5th = m_y5th.data();
+    blNumberType* k = m_k.data();
+    blNumberType* yTemp = m_yTemp.data();
+
+    std::copy(y,y + n,yStart);
+
+    rkCK(ODEfunctor,n,yStart,t,h,y4th,y5th,k,yTemp);
+
+    // The 4th-order solution is
+    // replaced by the error
+
+    for(int i = 0; i < n; ++i)
+        y4th[i] = y5th[i] - y4th[i];
+
+    blNumberType error = rkErrorNorm(n,yStart,y5th,y4th,m_absoluteTolerance,m_relativeTolerance);
+
+    bool isStepAccepted = (error <= blNumberType(1));
+
+    blNumberType factor = m_controller.getStepSizeFactor(error,isStepAccepted);
+
+    if(isStepAccepted)
+    {
+        // |lambda| ~ ||f(y + e) - f(y)|| / ||e||
+        // with e a small multiple of the error
+
+        if(shouldCheckStiffness)
+        {
+            blNumberType errorNorm = 0;
+            blNumberType stateNorm = 0;
+
+            for(int i = 0; i < n; ++i)
+            {
+                errorNorm += y4th[i] * y4th[i];
+                stateNorm += y5th[i] * y5th[i];
+            }
+
+            errorNorm = std::sqrt(errorNorm);
+            stateNorm = std::sqrt(stateNorm);
+
+            if(errorNorm > blNumberType(0))
+            {
+                blNumberType* yProbe = m_yProbe.data();
+                blNumberType* fProbe = m_fProbe.data();
+
+                blNumberType scale = std::sqrt(std::numeric_limits<blNumberType>::epsilon()) * std::max(blNumberType(1),stateNorm) / errorNorm;
+
+                for(int i = 0; i < n; ++i)
+                    yProbe[i] = y5th[i] + scale * y4th[i];
+
+                ODEfunctor(t + h,y5th,yTemp);
+                ODEfunctor(t + h,yProbe,fProbe);
+
+                blNumberType difference = 0;
+
+                for(int i = 0; i < n; ++i)
+                    difference += (fProbe[i] - yTemp[i]) * (fProbe[i] - yTemp[i]);
+
+                m_estimatedStiffness = h * std::sqrt(difference) / (scale * errorNorm);
+            }
+        }
+
+        std::copy(y5th,y5th + n,y);
+
+        t += h;
+    }
+
+    h *= factor;
+
+    return isStepAccepted;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType,typename blMatrixType,typename blLUFactorizationType>
+template<typename blODEFunctorType,typename blJacobianFunctorType>
+inline bool blStiffnessSwitchingSolver<blNumberType,blMatrixType,blLUFactorizationType>::integrate(const blODEFunctorType& ODEfunctor,
+                                                                                                   const blJacobianFunctorType& JacobianFunctor,
+                                                                                                   blNumberType* y,
+                                                                                                   const blNumberType& t0,
+                                                                                                   const blNumberType& tf,
+                                                                                                   const blNumberType& initialStepSize,
+                                                                                                   const int& maxNumberOfSteps)
+{
+    // Real stability boundary of Cash-Karp
+
+    const blNumberType stabilityBoundary = 3.7;
+
+    m_isStiff = false;
+
+    m_numberOfExplicitSteps = 0;
+    m_numberOfImplicitSteps = 0;
+    m_numberOfSwitches = 0;
+
+    m_controller.reset();
+    m_implicitStepper.reset();
+
+    int numberOfStiffChecks = 0;
+    int numberOfNonStiffChecks = 0;
+
+    blNumberType t = t0;
+    blNumberType h = initialStepSize;
+
+    for(int i = 0; i < maxNumberOfSteps && t < tf; ++i)
+    {
+        // Don't step past the final time
+
+        bool isLastStep = (t + h >= tf);
+
+        if(isLastStep)
+            h = tf - t;
+
+        bool isStepAccepted = false;
+
+        if(!m_isStiff)
+        {
+            // Check the stiffness every 5 steps
+
+            bool shouldCheckStiffness = (m_numberOfExplicitSteps % 5 == 4);
+
+            m_estimatedStiffness = 0;
+
+            isStepAccepted = explicitStep(ODEfunctor,y,t,h,shouldCheckStiffness);
+
+            if(isStepAccepted)
+            {
+                ++m_numberOfExplicitSteps;
+
+                if(shouldCheckStiffness)
+                {
+                    if(m_estimatedStiffness > blNumberType(0.9) * stabilityBoundary)
+                        ++numberOfStiffChecks;
+                    else
+                        numberOfStiffChecks = 0;
+
+                    if(numberOfStiffChecks >= 3)
+                    {
+                        m_isStiff = true;
+                        ++m_numberOfSwitches;
+
+                        numberOfStiffChecks = 0;
+                        numberOfNonStiffChecks = 0;
+
+                        m_implicitStepper.reset();
+                    }
+                }
+            }
+        }
+        else
+        {
+            blNumberType hTaken = h;
+
+            isStepAccepted = m_implicitStepper.step(ODEfunctor,JacobianFunctor,y,t,h);
+
+            if(isStepAccepted)
+            {
+                ++m_numberOfImplicitSteps;
+
+                blNumberType stiffness = hTaken * matrixNormInf<blNumberType>(m_implicitStepper.getJacobian(),m_numberOfStateVariables);
+
+                if(stiffness < blNumberType(0.5) * stabilityBoundary)
+                    ++numberOfNonStiffChecks;
+                else
+                    numberOfNonStiffChecks = 0;
+
+                if(numberOfNonStiffChecks >= 15)
+                {
+                    m_isStiff = false;
+                    ++m_numberOfSwitches;
+
+                    numberOfStiffChecks = 0;
+                    numberOfNonStiffChecks = 0;
+
+                    m_controller.reset();
+                }
+            }
+        }
+
+        if(isStepAccepted && isLastStep)
+            t = tf;
+    }
+
+    return (t >= tf);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// End of the blMathAPI namespace
+}
+//-------------------------------------------------------------------
+
+
+
+#endif // BL_STIFFSOLVERS_HPP
@@ -0,0 +1,482 @@
+#ifndef BL_STREAMINGLTTB_HPP
+#define BL_STREAMINGLTTB_HPP
+
+
+///-------------------------------------------------------------------
+///
+///
+///
+/// PURPOSE:        A streaming version of the Largest-Triangle-Three-
+///                 Buckets downsampling, samples are pushed in chunks
+///                 as they arrive and every bucket is emitted as soon
+///                 as the bucket after it is complete, so live data
+///                 can be decimated without re-scanning its history
+///
+/// AUTHOR:         Vincenzo Barbato
+///                 navyenzo@gmail.com
+///
+/// NOTE:           The buckets, their averages and the triangle areas
+///                 are the same as in largestTriangleThreeBuckets, but
+///                 since a stream has no fixed first point to measure
+///                 every triangle from, the triangles are measured from
+///                 the previously emitted point instead
+///
+///                 Only the current and next buckets are kept, so the
+///                 memory used is two buckets worth of samples
+///
+/// LISENSE:        MIT-LICENCE
+///                 http://www.opensource.org/licenses/mit-license.php
+///
+///
+///
+///-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Includes needed for this file
+//-------------------------------------------------------------------
+#include <vector>
+#include "blDownsamplingAlgorithms.hpp"
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// NOTE: This class is defined within the blMathAPI namespace
+//-------------------------------------------------------------------
+namespace blMathAPI
+{
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+class blStreamingLTTB
+{
+public: // Constructors and destructors
+
+
+
+    // Default constructor, every emitted
+    // point represents "bucketSize" samples
+
+    blStreamingLTTB(const std::size_t& bucketSize = 1);
+
+    // Destructor
+
+    ~blStreamingLTTB();
+
+
+
+public: // Public functions
+
+
+
+    // Pushes a chunk of samples and writes the
+    // points of every bucket finalized by it
+    // into the destination, returning how many
+    // were written (at most 1 + srcDataSize/bucketSize)
+    //
+    // The second version also writes the index
+    // of each emitted point in the whole stream
+
+    template<typename srcDataIteratorType,
+             typename dstDataIteratorType>
+
+    std::size_t                             push(srcDataIteratorType srcDataBegin,
+                                                 const std::size_t& srcDataSize,
+                                                 dstDataIteratorType dstDataBegin);
+
+    template<typename srcDataIteratorType,
+             typename dstIndexIteratorType,
+             typename dstDataIteratorType>
+
+    std::size_t                             push(srcDataIteratorType srcDataBegin,
+                                                 const std::size_t& srcDataSize,
+                                                 dstIndexIteratorType dstIndexBegin,
+                                                 dstDataIteratorType dstDataBegin);
+
+    // Ends the stream, writing the points of the
+    // unfinished buckets followed by the last
+    // sample (at most 3 points), then resets
+
+    template<typename dstDataIteratorType>
+
+    std::size_t                             flush(dstDataIteratorType dstDataBegin);
+
+    template<typename dstIndexIteratorType,
+             typename dstDataIteratorType>
+
+    std::size_t                             flush(dstIndexIteratorType dstIndexBegin,
+                                                  dstDataIteratorType dstDataBegin);
+
+    // Forgets all pushed samples
+    // keeping the bucket size
+
+    void                                    reset();
+
+    // Functions used to get the bucket
+    // size and how many samples were
+    // pushed since the last reset
+
+    const std::size_t&                      getBucketSize()const;
+    const std::size_t&                      getNumberOfSamples()const;
+
+
+
+private: // Private functions
+
+
+
+    // Picks the point of the current bucket
+    // given the average of the bucket after it
+
+    template<typename dstIndexIteratorType,
+             typename dstDataIteratorType>
+
+    void                                    emitCurrentBucket(const std::size_t& numberOfCandidates,
+                                                              const blNumberType& nextBucketAvgValue,
+                                                              dstIndexIteratorType& dstIndexBegin,
+                                                              dstDataIteratorType& dstDataBegin);
+
+    // Writes one point
+
+    template<typename dstIndexIteratorType,
+             typename dstDataIteratorType>
+
+    void                                    emit(const std::size_t& index,
+                                                 const blNumberType& value,
+                                                 dstIndexIteratorType& dstIndexBegin,
+                                                 dstDataIteratorType& dstDataBegin);
+
+
+
+private: // Private variables
+
+
+
+    // Number of samples per bucket
+
+    std::size_t                             m_bucketSize;
+
+    // Samples pushed since the last reset
+
+    std::size_t                             m_numberOfSamples;
+
+    // The previously emitted point, the
+    // triangles are measured from it
+
+    blNumberType                            m_previousPoint;
+
+    // The bucket waiting for its point to be
+    // picked, and the bucket after it whose
+    // average is needed to pick it
+
+    std::vector<blNumberType>               m_currentBucket;
+    std::size_t                             m_currentBucketSize;
+    std::size_t                             m_currentBucketFirstIndex;
+
+    std::vector<blNumberType>               m_nextBucket;
+    std::size_t                             m_nextBucketSize;
+    blNumberType                            m_nextBucketSum;
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// Used to discard the indices of the
+// emitted points in the push/flush
+// functions that don't return them
+//-------------------------------------------------------------------
+struct blDiscardIterator
+{
+    blDiscardIterator&                      operator*(){return *this;}
+    blDiscardIterator&                      operator++(){return *this;}
+
+    template<typename blValueType>
+    blDiscardIterator&                      operator=(const blValueType&){return *this;}
+};
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blStreamingLTTB<blNumberType>::blStreamingLTTB(const std::size_t& bucketSize)
+{
+    m_bucketSize = (bucketSize > 0) ? bucketSize : 1;
+
+    // Both buckets are allocated once here
+    // so pushing never allocates
+
+    m_currentBucket.resize(m_bucketSize);
+    m_nextBucket.resize(m_bucketSize);
+
+    reset();
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline blStreamingLTTB<blNumberType>::~blStreamingLTTB()
+{
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline void blStreamingLTTB<blNumberType>::reset()
+{
+    m_numberOfSamples = 0;
+
+    m_previousPoint = 0;
+
+    m_currentBucketSize = 0;
+    m_currentBucketFirstIndex = 1;
+
+    m_nextBucketSize = 0;
+    m_nextBucketSum = 0;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const std::size_t& blStreamingLTTB<blNumberType>::getBucketSize()const
+{
+    return m_bucketSize;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+inline const std::size_t& blStreamingLTTB<blNumberType>::getNumberOfSamples()const
+{
+    return m_numberOfSamples;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename srcDataIteratorType,
+         typename dstDataIteratorType>
+
+inline std::size_t blStreamingLTTB<blNumberType>::push(srcDataIteratorType srcDataBegin,
+                                                       const std::size_t& srcDataSize,
+                                                       dstDataIteratorType dstDataBegin)
+{
+    return push(srcDataBegin,srcDataSize,blDiscardIterator(),dstDataBegin);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename srcDataIteratorType,
+         typename dstIndexIteratorType,
+         typename dstDataIteratorType>
+
+inline std::size_t blStreamingLTTB<blNumberType>::push(srcDataIteratorType srcDataBegin,
+                                                       const std::size_t& srcDataSize,
+                                                       dstIndexIteratorType dstIndexBegin,
+                                                       dstDataIteratorType dstDataBegin)
+{
+    std::size_t numberOfEmittedPoints = 0;
+
+    for(std::size_t i = 0; i < srcDataSize; ++i,++srcDataBegin)
+    {
+        blNumberType sample = (*srcDataBegin);
+
+        if(m_numberOfSamples == 0)
+        {
+            // The first sample is
+            // always emitted as is
+
+            emit(0,sample,dstIndexBegin,dstDataBegin);
+            ++numberOfEmittedPoints;
+        }
+        else if(m_currentBucketSize < m_bucketSize)
+        {
+            m_currentBucket[m_currentBucketSize] = sample;
+            ++m_currentBucketSize;
+        }
+        else
+        {
+            m_nextBucket[m_nextBucketSize] = sample;
+            ++m_nextBucketSize;
+
+            m_nextBucketSum += sample;
+
+            // Once the next bucket is complete we
+            // know its average, so we can pick the
+            // point of the current bucket and move
+            // on to the next one
+
+            if(m_nextBucketSize == m_bucketSize)
+            {
+                emitCurrentBucket(m_currentBucketSize,
+                                  m_nextBucketSum / static_cast<blNumberType>(m_bucketSize),
+                                  dstIndexBegin,
+                                  dstDataBegin);
+                ++numberOfEmittedPoints;
+
+                m_currentBucket.swap(m_nextBucket);
+                m_currentBucketFirstIndex += m_bucketSize;
+
+                m_nextBucketSize = 0;
+                m_nextBucketSum = 0;
+            }
+        }
+
+        ++m_numberOfSamples;
+    }
+
+    return numberOfEmittedPoints;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename dstDataIteratorType>
+
+inline std::size_t blStreamingLTTB<blNumberType>::flush(dstDataIteratorType dstDataBegin)
+{
+    return flush(blDiscardIterator(),dstDataBegin);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename dstIndexIteratorType,
+         typename dstDataIteratorType>
+
+inline std::size_t blStreamingLTTB<blNumberType>::flush(dstIndexIteratorType dstIndexBegin,
+                                                        dstDataIteratorType dstDataBegin)
+{
+    std::size_t numberOfEmittedPoints = 0;
+
+    if(m_numberOfSamples > 1)
+    {
+        if(m_nextBucketSize > 0)
+        {
+            // The current bucket is complete and the
+            // next one is partial, so we use its
+            // partial average to pick the point and
+            // then carry on with the partial bucket
+
+            emitCurrentBucket(m_currentBucketSize,
+                              m_nextBucketSum / static_cast<blNumberType>(m_nextBucketSize),
+                              dstIndexBegin,
+                              dstDataBegin);
+            ++numberOfEmittedPoints;
+
+            m_currentBucket.swap(m_nextBucket);
+            m_currentBucketFirstIndex += m_bucketSize;
+            m_currentBucketSize = m_nextBucketSize;
+        }
+
+        // Only the current bucket is left, its last
+        // sample is the last point so we pick the
+        // point among the ones before it
+
+        blNumberType lastSample = m_currentBucket[m_currentBucketSize - 1];
+
+        if(m_currentBucketSize > 1)
+        {
+            emitCurrentBucket(m_currentBucketSize - 1,
+                              lastSample,
+                              dstIndexBegin,
+                              dstDataBegin);
+            ++numberOfEmittedPoints;
+        }
+
+        emit(m_numberOfSamples - 1,lastSample,dstIndexBegin,dstDataBegin);
+        ++numberOfEmittedPoints;
+    }
+
+    reset();
+
+    return numberOfEmittedPoints;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename dstIndexIteratorType,
+         typename dstDataIteratorType>
+
+inline void blStreamingLTTB<blNumberType>::emitCurrentBucket(const std::size_t& numberOfCandidates,
+                                                             const blNumberType& nextBucketAvgValue,
+                                                             dstIndexIteratorType& dstIndexBegin,
+                                                             dstDataIteratorType& dstDataBegin)
+{
+    std::ptrdiff_t largestTriangleIndex = findLargestTriangleInBucket(m_currentBucket.data(),
+                                                                      numberOfCandidates,
+                                                                      nextBucketAvgValue,
+                                                                      m_previousPoint);
+
+    // Unlike the batch version we always emit one
+    // point per bucket, so when every triangle is
+    // flat we just take the first point
+
+    if(largestTriangleIndex < 0)
+        largestTriangleIndex = 0;
+
+    emit(m_currentBucketFirstIndex + std::size_t(largestTriangleIndex),
+         m_currentBucket[largestTriangleIndex],
+         dstIndexBegin,
+         dstDataBegin);
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+template<typename blNumberType>
+template<typename dstIndexIteratorType,
+         typename dstDataIteratorType>
+
+inline void blStreamingLTTB<blNumberType>::emit(const std::size_t& index,
+                                                const blNumberType& value,
+                                                dstIndexIteratorType& dstIndexBegin,
+                                                dstDataIteratorType& dstDataBegin)
+{
+    (*dstIndexBegin) = index;
+    (*dstDataBegin) = value;
+
+    ++dstIndexBegin;
+    ++dstDataBegin;
+
+    m_previousPoint = value;
+}
+//-------------------------------------------------------------------
+
+
+
+//-------------------------------------------------------------------
+// End of the blMathAPI namespace
+}
+//-------------------------------------------------------------------
+
+
+
+#endif // BL_STREAMINGLTTB_HPP